@@ -0,0 +1,180 @@
+#include "PreviewTexture.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    // A triangle covering the viewport, scaled to letterbox the image.
+    // Texture row 0 is the top image row, so v runs downwards.
+    const char* kVertexShader = R"(
+#version 410 core
+uniform vec2 scale;
+out vec2 uv;
+void main() {
+    vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    uv = vec2(corner.x, 1.0 - corner.y);
+    gl_Position = vec4((corner * 2.0 - 1.0) * scale, 0.0, 1.0);
+}
+)";
+
+    const char* kFragmentShader = R"(
+#version 410 core
+uniform sampler2D frame;
+uniform float exposure;
+in vec2 uv;
+out vec4 color;
+void main() {
+    if (uv.x > 1.0 || uv.y < 0.0) discard;
+    vec3 c = clamp(texture(frame, uv).rgb * exposure, 0.0, 1.0);
+    vec3 low = c * 12.92;
+    vec3 high = 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055;
+    color = vec4(mix(high, low, lessThanEqual(c, vec3(0.0031308))), 1.0);
+}
+)";
+
+    GLuint compile(GLenum type, const char* source) {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        GLint ok = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+        if (ok != GL_TRUE) {
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            glDeleteShader(shader);
+            throw std::runtime_error(std::string("PreviewTexture: shader did not compile: ") + log);
+        }
+        return shader;
+    }
+}
+
+PreviewTexture::PreviewTexture(SharedFrameReader& reader)
+    : reader(reader) {
+    const size_t tileSize = reader.getTileSize();
+    tileBytes = tileSize * tileSize * sizeof(vec3);
+    bufferBytes = tileBytes * reader.getTileCount();
+    persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, static_cast<GLsizei>(reader.getWidth()),
+                 static_cast<GLsizei>(reader.getHeight()), 0, GL_RGB, GL_FLOAT, nullptr);
+
+    // One slot per tile, laid out like the shared segment
+    glGenBuffers(1, &pixelBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    if (persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bufferBytes), nullptr, flags);
+        mapped = static_cast<vec3*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bufferBytes), flags));
+        if (!mapped) {
+            throw std::runtime_error("PreviewTexture: could not map the pixel buffer");
+        }
+    } else {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bufferBytes), nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    GLuint vertex = compile(GL_VERTEX_SHADER, kVertexShader);
+    GLuint fragment = compile(GL_FRAGMENT_SHADER, kFragmentShader);
+    program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (ok != GL_TRUE) {
+        throw std::runtime_error("PreviewTexture: shader program did not link");
+    }
+    scaleLocation = glGetUniformLocation(program, "scale");
+    exposureLocation = glGetUniformLocation(program, "exposure");
+
+    // The core profile needs a vertex array even with no attributes
+    glGenVertexArrays(1, &vertexArray);
+}
+
+PreviewTexture::~PreviewTexture() {
+    if (fence) glDeleteSync(fence);
+    if (persistent && mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteProgram(program);
+    glDeleteBuffers(1, &pixelBuffer);
+    glDeleteTextures(1, &texture);
+}
+
+size_t PreviewTexture::update() {
+    if (reader.getSequence() == 0) return 0;
+
+    // Do not write into the buffer while the last uploads may still be
+    // reading it
+    if (fence) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    if (!persistent) {
+        mapped = static_cast<vec3*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bufferBytes),
+                                                     GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        if (!mapped) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return 0;
+        }
+    }
+
+    const size_t tileSize = reader.getTileSize();
+    std::vector<size_t> tiles = reader.poll([&](size_t index) { return mapped + index * tileSize * tileSize; });
+
+    if (!persistent) {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        mapped = nullptr;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(tileSize));
+    for (size_t index : tiles) {
+        Tile tile = reader.getTile(index);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(tile.x0), static_cast<GLint>(tile.y0),
+                        static_cast<GLsizei>(tile.width()), static_cast<GLsizei>(tile.height()), GL_RGB, GL_FLOAT,
+                        reinterpret_cast<const void*>(index * tileBytes));
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!tiles.empty()) {
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    return tiles.size();
+}
+
+void PreviewTexture::draw(int viewportWidth, int viewportHeight, float exposure) const {
+    // Shrink one axis so the image keeps its aspect ratio
+    float imageAspect = reader.getWidth() / static_cast<float>(reader.getHeight());
+    float viewAspect = viewportWidth / static_cast<float>(std::max(viewportHeight, 1));
+    float sx = std::min(1.0f, imageAspect / viewAspect);
+    float sy = std::min(1.0f, viewAspect / imageAspect);
+
+    glUseProgram(program);
+    glUniform2f(scaleLocation, sx, sy);
+    glUniform1f(exposureLocation, std::exp2(exposure));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindVertexArray(vertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
@@ -0,0 +1,49 @@
+#ifndef PREVIEWTEXTURE_H
+#define PREVIEWTEXTURE_H
+
+#include <cstddef>
+#include <GL/glew.h>
+#include "SharedFrame.h"
+
+// Shows a frame published through shared memory.  Changed tiles are
+// copied from the segment into a pixel buffer object and uploaded to a
+// float texture from there, so only dirty tiles cross the bus and the
+// copy into the buffer is a plain memcpy.  With GL 4.4 or
+// ARB_buffer_storage the buffer is mapped once, persistently and
+// coherently; otherwise it is mapped for every update.  A fence keeps
+// the next update from overwriting the buffer before the GPU has read it.
+class PreviewTexture {
+public:
+    // Needs a current GL context
+    explicit PreviewTexture(SharedFrameReader& reader);
+    ~PreviewTexture();
+
+    PreviewTexture(const PreviewTexture&) = delete;
+    PreviewTexture& operator=(const PreviewTexture&) = delete;
+
+    // Upload the tiles that changed since the last update and return how
+    // many there were
+    size_t update();
+
+    // Draw the frame letterboxed into a viewport of the given size,
+    // scaled by 2^exposure and sRGB encoded
+    void draw(int viewportWidth, int viewportHeight, float exposure) const;
+
+private:
+    SharedFrameReader& reader;
+    size_t tileBytes;
+    size_t bufferBytes;
+    bool persistent;
+
+    GLuint texture = 0;
+    GLuint pixelBuffer = 0;
+    GLuint vertexArray = 0;
+    GLuint program = 0;
+    GLint scaleLocation = -1;
+    GLint exposureLocation = -1;
+
+    vec3* mapped = nullptr;
+    GLsync fence = nullptr;
+};
+
+#endif // PREVIEWTEXTURE_H
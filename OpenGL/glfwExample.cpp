@@ -1,5 +1,10 @@
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <GL/glew.h>
@@ -11,6 +16,8 @@
 #include "glm/gtc/type_ptr.hpp"
 
 #include "GLSL.h"
+#include "PreviewTexture.h"
+#include "SharedFrame.h"
 
 int CheckGLErrors(const char *s)
 {
@@ -18,8 +25,69 @@ int CheckGLErrors(const char *s)
     return errCount;
 }
 
-int main(void)
+// Attach to a published frame, waiting up to a few seconds for the
+// renderer to create it
+std::unique_ptr<SharedFrameReader> attachPreview(const std::string& name)
 {
+    for (int attempt = 0; ; ++attempt) {
+        try {
+            return std::make_unique<SharedFrameReader>(name);
+        }
+        catch (const std::runtime_error& e) {
+            if (attempt == 50) {
+                std::cerr << e.what() << std::endl;
+                return nullptr;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+}
+
+// Follow a published frame without a window until the renderer
+// finishes, checking that the shared-memory protocol delivers every
+// tile.  Useful over ssh and for testing.
+int runHeadless(SharedFrameReader& reader)
+{
+    FrameBuffer frame(reader.getWidth(), reader.getHeight());
+    std::vector<bool> received(reader.getTileCount(), false);
+    size_t polls = 0, uploads = 0;
+    while (true) {
+        bool finished = reader.isFinished();
+        for (size_t index : reader.poll(frame)) {
+            received[index] = true;
+            ++uploads;
+        }
+        ++polls;
+        if (finished) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
+
+    size_t missing = 0;
+    for (bool r : received) missing += r ? 0 : 1;
+    std::cout << reader.getWidth() << "x" << reader.getHeight() << ", " << reader.getPasses() << " passes, "
+              << uploads << " tile updates in " << polls << " polls, " << missing << " tiles never published" << std::endl;
+    return missing == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+    // glfwExample [--headless] [name] shows the frame a renderer publishes
+    // to the shared-memory segment name; with no name it just opens a
+    // window
+    bool headless = false;
+    std::string previewName;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0) headless = true;
+        else previewName = argv[i];
+    }
+
+    std::unique_ptr<SharedFrameReader> preview;
+    if (!previewName.empty() || headless) {
+        preview = attachPreview(previewName.empty() ? "/cs4212-preview" : previewName);
+        if (!preview) return EXIT_FAILURE;
+        if (headless) return runHeadless(*preview);
+    }
+
     /* Initialize the library */
     if (!glfwInit()) {
         exit (-1);
@@ -34,6 +102,9 @@ int main(void)
     /* Create a windowed mode window and its OpenGL context */
     int winWidth = 1000;
     float aspectRatio = 1.0; // 16.0 / 9.0; // winWidth / (float)winHeight;
+    if (preview) {
+        aspectRatio = preview->getWidth() / (float)preview->getHeight();
+    }
     int winHeight = winWidth / aspectRatio;
     
     GLFWwindow* window = glfwCreateWindow(winWidth, winHeight, "GLFW Example", NULL, NULL);
@@ -79,6 +150,12 @@ int main(void)
     glGetIntegerv(GL_MAJOR_VERSION, &major_version);
     std::cout << "GL_MAJOR_VERSION: " << major_version << std::endl;
 
+    std::unique_ptr<PreviewTexture> previewTexture;
+    if (preview) {
+        previewTexture = std::make_unique<PreviewTexture>(*preview);
+    }
+    float exposure = 0.0f;
+
     double timeDiff = 0.0, startFrameTime = 0.0, endFrameTime = 0.0;
     
     /* Loop until the user closes the window */
@@ -93,6 +170,12 @@ int main(void)
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         /* Render your objects here */
+        if (previewTexture) {
+            glfwGetFramebufferSize(window, &fb_width, &fb_height);
+            glViewport(0, 0, fb_width, fb_height);
+            previewTexture->update();
+            previewTexture->draw(fb_width, fb_height, exposure);
+        }
 
         // Swap the front and back buffers
         glfwSwapBuffers(window);
@@ -103,11 +186,20 @@ int main(void)
         if (glfwGetKey( window, GLFW_KEY_T ) == GLFW_PRESS) {
             std::cout << "fps: " << 1.0/timeDiff << std::endl;
         }
+        // Holding the up and down arrows brightens or darkens the
+        // preview by two stops a second
+        if (glfwGetKey( window, GLFW_KEY_UP ) == GLFW_PRESS) {
+            exposure += 2.0f * timeDiff;
+        }
+        if (glfwGetKey( window, GLFW_KEY_DOWN ) == GLFW_PRESS) {
+            exposure -= 2.0f * timeDiff;
+        }
         if (glfwGetKey( window, GLFW_KEY_ESCAPE ) == GLFW_PRESS) {
             glfwSetWindowShouldClose(window, 1);
         }
     }
   
+    previewTexture.reset();
     glfwTerminate();
     return 0;
 }
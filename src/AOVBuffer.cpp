@@ -0,0 +1,219 @@
+#include "AOVBuffer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+    const char* typeName(AOVBuffer::Type type) {
+        switch (type) {
+        case AOVBuffer::Type::Float: return "Float";
+        case AOVBuffer::Type::Vec3:  return "Vec3";
+        default:                     return "UInt32";
+        }
+    }
+
+    void requireType(AOVBuffer::Type actual, AOVBuffer::Type expected) {
+        if (actual != expected) {
+            throw std::invalid_argument(std::string("AOVBuffer: layer holds ") + typeName(actual) +
+                                        " values, not " + typeName(expected));
+        }
+    }
+}
+
+AOVBuffer::TileBuffer::TileBuffer(const Tile& tile, const std::vector<Type>& types)
+    : tile(tile), planeSize(tile.width() * tile.height()), types(types),
+      floats(types.size()), uints(types.size()) {
+    for (size_t i = 0; i < types.size(); ++i) {
+        if (types[i] == Type::UInt32) {
+            uints[i].assign(planeSize, 0);
+        } else {
+            floats[i].assign(channelCount(types[i]) * planeSize, 0.0f);
+        }
+    }
+}
+
+void AOVBuffer::TileBuffer::typeMismatch(size_t layer, Type type) const {
+    if (layer >= types.size()) {
+        throw std::out_of_range("AOVBuffer::TileBuffer: no such layer");
+    }
+    requireType(types[layer], type);
+    std::abort();  // only called on a mismatch
+}
+
+void AOVBuffer::TileBuffer::clear() {
+    for (auto& f : floats) std::fill(f.begin(), f.end(), 0.0f);
+    for (auto& u : uints) std::fill(u.begin(), u.end(), 0);
+}
+
+AOVBuffer::AOVBuffer(size_t width, size_t height)
+    : width(width), height(height) {
+}
+
+size_t AOVBuffer::addLayer(const std::string& name, Type type) {
+    if (hasLayer(name)) {
+        throw std::invalid_argument("AOVBuffer::addLayer: duplicate layer name " + name);
+    }
+
+    Layer layer;
+    layer.name = name;
+    layer.type = type;
+    if (type == Type::UInt32) {
+        layer.uints.assign(width * height, 0);
+    } else {
+        layer.floats.assign(channelCount(type) * width * height, 0.0f);
+    }
+    layers.push_back(std::move(layer));
+    return layers.size() - 1;
+}
+
+bool AOVBuffer::hasLayer(const std::string& name) const {
+    return std::any_of(layers.begin(), layers.end(), [&](const Layer& l) { return l.name == name; });
+}
+
+size_t AOVBuffer::getLayerIndex(const std::string& name) const {
+    for (size_t i = 0; i < layers.size(); ++i) {
+        if (layers[i].name == name) {
+            return i;
+        }
+    }
+    throw std::out_of_range("AOVBuffer: no layer named " + name);
+}
+
+const AOVBuffer::Layer& AOVBuffer::checkedLayer(size_t layer, Type type) const {
+    const Layer& l = layers.at(layer);
+    requireType(l.type, type);
+    return l;
+}
+
+void AOVBuffer::set(size_t layer, size_t x, size_t y, float value) {
+    checkedLayer(layer, Type::Float);
+    layers[layer].floats[y * width + x] = value;
+}
+
+void AOVBuffer::set(size_t layer, size_t x, size_t y, const vec3& value) {
+    checkedLayer(layer, Type::Vec3);
+    size_t planeSize = width * height;
+    float* plane = layers[layer].floats.data() + y * width + x;
+    plane[0] = value[0];
+    plane[planeSize] = value[1];
+    plane[2 * planeSize] = value[2];
+}
+
+void AOVBuffer::set(size_t layer, size_t x, size_t y, uint32_t value) {
+    checkedLayer(layer, Type::UInt32);
+    layers[layer].uints[y * width + x] = value;
+}
+
+float AOVBuffer::getFloat(size_t layer, size_t x, size_t y) const {
+    return checkedLayer(layer, Type::Float).floats[y * width + x];
+}
+
+vec3 AOVBuffer::getVec3(size_t layer, size_t x, size_t y) const {
+    size_t planeSize = width * height;
+    const float* plane = checkedLayer(layer, Type::Vec3).floats.data() + y * width + x;
+    return vec3(plane[0], plane[planeSize], plane[2 * planeSize]);
+}
+
+uint32_t AOVBuffer::getUInt(size_t layer, size_t x, size_t y) const {
+    return checkedLayer(layer, Type::UInt32).uints[y * width + x];
+}
+
+const float* AOVBuffer::getPlane(size_t layer, size_t channel) const {
+    const Layer& l = layers.at(layer);
+    if (l.type == Type::UInt32 || channel >= channelCount(l.type)) {
+        throw std::out_of_range("AOVBuffer::getPlane: no such float plane");
+    }
+    return l.floats.data() + channel * width * height;
+}
+
+const uint32_t* AOVBuffer::getUIntPlane(size_t layer) const {
+    return checkedLayer(layer, Type::UInt32).uints.data();
+}
+
+AOVBuffer::TileBuffer AOVBuffer::makeTile(const Tile& tile) const {
+    std::vector<Type> types;
+    for (const Layer& l : layers) {
+        types.push_back(l.type);
+    }
+    return TileBuffer(tile, types);
+}
+
+void AOVBuffer::merge(const TileBuffer& tileBuffer) {
+    const Tile& tile = tileBuffer.tile;
+    if (tile.x1 > width || tile.y1 > height) {
+        throw std::out_of_range("AOVBuffer::merge: tile lies outside the buffer");
+    }
+    if (tileBuffer.types.size() != layers.size()) {
+        throw std::invalid_argument("AOVBuffer::merge: tile was made for a different set of layers");
+    }
+
+    // Every tile row of every plane is one contiguous copy
+    size_t w = tile.width();
+    size_t planeSize = width * height;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        Layer& l = layers[i];
+        for (size_t c = 0; c < channelCount(l.type); ++c) {
+            for (size_t y = tile.y0; y < tile.y1; ++y) {
+                size_t src = c * tileBuffer.planeSize + (y - tile.y0) * w;
+                size_t dst = c * planeSize + y * width + tile.x0;
+                if (l.type == Type::UInt32) {
+                    std::copy_n(&tileBuffer.uints[i][src], w, &l.uints[dst]);
+                } else {
+                    std::copy_n(&tileBuffer.floats[i][src], w, &l.floats[dst]);
+                }
+            }
+        }
+    }
+}
+
+void AOVBuffer::clear() {
+    for (Layer& l : layers) {
+        std::fill(l.floats.begin(), l.floats.end(), 0.0f);
+        std::fill(l.uints.begin(), l.uints.end(), 0);
+    }
+}
+
+RowSource AOVBuffer::getRowSource(size_t layer) const {
+    layers.at(layer);
+    return [this, layer](size_t y, std::vector<vec3>& scratch) {
+        // Looked up per row, since adding layers may move them
+        const Layer& l = layers[layer];
+        scratch.resize(width);
+        size_t row = y * width;
+        size_t planeSize = width * height;
+        for (size_t x = 0; x < width; ++x) {
+            switch (l.type) {
+            case Type::Float:
+                scratch[x] = vec3(l.floats[row + x], l.floats[row + x], l.floats[row + x]);
+                break;
+            case Type::Vec3:
+                scratch[x] = vec3(l.floats[row + x], l.floats[planeSize + row + x], l.floats[2 * planeSize + row + x]);
+                break;
+            default: {
+                float v = static_cast<float>(l.uints[row + x]);
+                scratch[x] = vec3(v, v, v);
+                break;
+            }
+            }
+        }
+        return static_cast<const vec3*>(scratch.data());
+    };
+}
+
+FrameBuffer AOVBuffer::toFrameBuffer(size_t layer, FrameBuffer::Layout layout) const {
+    FrameBuffer fb(width, height, layout);
+    RowSource rows = getRowSource(layer);
+    std::vector<vec3> scratch;
+    for (size_t y = 0; y < height; ++y) {
+        fb.setRow(y, rows(y, scratch));
+    }
+    return fb;
+}
+
+size_t AOVBuffer::getMemoryUsage() const {
+    size_t bytes = 0;
+    for (const Layer& l : layers) {
+        bytes += l.floats.size() * sizeof(float) + l.uints.size() * sizeof(uint32_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,136 @@
+#ifndef AOVBUFFER_H
+#define AOVBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "vec.h"
+#include "FrameBuffer.h"
+#include "TileScheduler.h"
+
+// A stack of named image layers (arbitrary output variables) such as
+// depth, normal, albedo or object ID, rendered next to the beauty
+// image.  Each layer has its own element type and is stored as
+// structure-of-arrays planes: a Vec3 layer is three float planes, a
+// Float layer one, a UInt32 layer one plane of integers.  So a depth
+// layer costs 4 bytes per pixel rather than the 12 of a FrameBuffer.
+class AOVBuffer {
+public:
+    enum class Type { Float, Vec3, UInt32 };
+
+    // Number of planes used by a layer of the given type
+    static size_t channelCount(Type type) { return type == Type::Vec3 ? 3 : 1; }
+
+    // Tile-local copy of every layer, written by one thread and merged
+    // back in a single pass.  Tiles handed out by a TileScheduler never
+    // overlap, so merges of different tiles need no locking.
+    class TileBuffer {
+    public:
+        const Tile& getTile() const { return tile; }
+
+        // (x, y) are image coordinates inside the tile.  The value type
+        // must match the layer type.  Inline, as they sit in the
+        // innermost loop of the render.
+        void set(size_t layer, size_t x, size_t y, float value) {
+            checkType(layer, Type::Float);
+            floats[layer][localIndex(x, y)] = value;
+        }
+
+        void set(size_t layer, size_t x, size_t y, const vec3& value) {
+            checkType(layer, Type::Vec3);
+            float* plane = floats[layer].data() + localIndex(x, y);
+            plane[0] = value[0];
+            plane[planeSize] = value[1];
+            plane[2 * planeSize] = value[2];
+        }
+
+        void set(size_t layer, size_t x, size_t y, uint32_t value) {
+            checkType(layer, Type::UInt32);
+            uints[layer][localIndex(x, y)] = value;
+        }
+
+        // Reset every layer to zero so the buffer can be reused
+        void clear();
+
+    private:
+        friend class AOVBuffer;
+        TileBuffer(const Tile& tile, const std::vector<Type>& types);
+
+        size_t localIndex(size_t x, size_t y) const { return (y - tile.y0) * tile.width() + (x - tile.x0); }
+
+        void checkType(size_t layer, Type type) const {
+            if (layer >= types.size() || types[layer] != type) {
+                typeMismatch(layer, type);
+            }
+        }
+        [[noreturn]] void typeMismatch(size_t layer, Type type) const;
+
+        Tile tile;
+        size_t planeSize;
+        std::vector<Type> types;
+        std::vector<std::vector<float>> floats;
+        std::vector<std::vector<uint32_t>> uints;
+    };
+
+    AOVBuffer(size_t width, size_t height);
+
+    size_t getWidth() const { return width; }
+    size_t getHeight() const { return height; }
+
+    // Add a zero-filled layer and return its index.  Names must be unique.
+    size_t addLayer(const std::string& name, Type type);
+
+    size_t getNumLayers() const { return layers.size(); }
+    bool hasLayer(const std::string& name) const;
+
+    // Index of the named layer; throws std::out_of_range if missing
+    size_t getLayerIndex(const std::string& name) const;
+    const std::string& getLayerName(size_t layer) const { return layers[layer].name; }
+    Type getLayerType(size_t layer) const { return layers[layer].type; }
+
+    // Per-pixel access.  The value type must match the layer type.
+    void set(size_t layer, size_t x, size_t y, float value);
+    void set(size_t layer, size_t x, size_t y, const vec3& value);
+    void set(size_t layer, size_t x, size_t y, uint32_t value);
+
+    float getFloat(size_t layer, size_t x, size_t y) const;
+    vec3 getVec3(size_t layer, size_t x, size_t y) const;
+    uint32_t getUInt(size_t layer, size_t x, size_t y) const;
+
+    // Row-major planes of width * height values, for bulk processing.
+    // Channel c of a Vec3 layer is plane c.
+    const float* getPlane(size_t layer, size_t channel = 0) const;
+    const uint32_t* getUIntPlane(size_t layer) const;
+
+    TileBuffer makeTile(const Tile& tile) const;
+
+    // Copy every layer of a tile into the buffer
+    void merge(const TileBuffer& tileBuffer);
+
+    // Reset every layer to zero
+    void clear();
+
+    // A layer as color rows: Float and UInt32 layers become gray
+    RowSource getRowSource(size_t layer) const;
+    FrameBuffer toFrameBuffer(size_t layer, FrameBuffer::Layout layout = FrameBuffer::Layout::RowMajor) const;
+
+    // Total bytes of pixel data across all layers
+    size_t getMemoryUsage() const;
+
+private:
+    struct Layer {
+        std::string name;
+        Type type;
+        std::vector<float> floats;     // channelCount planes, one after another
+        std::vector<uint32_t> uints;
+    };
+
+    const Layer& checkedLayer(size_t layer, Type type) const;
+
+    size_t width;
+    size_t height;
+    std::vector<Layer> layers;
+};
+
+#endif // AOVBUFFER_H
@@ -0,0 +1,140 @@
+#include "AccumulationBuffer.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    vec3 square(const vec3& v) {
+        return vec3(v[0] * v[0], v[1] * v[1], v[2] * v[2]);
+    }
+}
+
+AccumulationBuffer::TileAccumulator::TileAccumulator(const Tile& tile, bool trackMoments)
+    : tile(tile), sum(tile.width() * tile.height(), vec3(0.0f, 0.0f, 0.0f)),
+      count(tile.width() * tile.height(), 0) {
+    if (trackMoments) {
+        sumSq.assign(sum.size(), vec3(0.0f, 0.0f, 0.0f));
+    }
+}
+
+void AccumulationBuffer::TileAccumulator::addSample(size_t x, size_t y, const vec3& color) {
+    size_t i = localIndex(x, y);
+    sum[i] += color;
+    if (!sumSq.empty()) {
+        sumSq[i] += square(color);
+    }
+    ++count[i];
+}
+
+void AccumulationBuffer::TileAccumulator::clear() {
+    std::fill(sum.begin(), sum.end(), vec3(0.0f, 0.0f, 0.0f));
+    std::fill(sumSq.begin(), sumSq.end(), vec3(0.0f, 0.0f, 0.0f));
+    std::fill(count.begin(), count.end(), 0);
+}
+
+AccumulationBuffer::AccumulationBuffer(size_t width, size_t height, bool trackMoments)
+    : width(width), height(height),
+      sum(width * height, vec3(0.0f, 0.0f, 0.0f)), count(width * height, 0) {
+    if (trackMoments) {
+        sumSq.assign(sum.size(), vec3(0.0f, 0.0f, 0.0f));
+    }
+}
+
+void AccumulationBuffer::addSample(size_t x, size_t y, const vec3& color) {
+    size_t i = y * width + x;
+    sum[i] += color;
+    if (!sumSq.empty()) {
+        sumSq[i] += square(color);
+    }
+    ++count[i];
+}
+
+void AccumulationBuffer::merge(const TileAccumulator& tileAccum) {
+    const Tile& tile = tileAccum.tile;
+    if (tile.x1 > width || tile.y1 > height) {
+        throw std::out_of_range("AccumulationBuffer::merge: tile lies outside the buffer");
+    }
+    if (tileAccum.sumSq.empty() != sumSq.empty()) {
+        throw std::invalid_argument("AccumulationBuffer::merge: moment tracking does not match");
+    }
+
+    size_t w = tile.width();
+    for (size_t y = tile.y0; y < tile.y1; ++y) {
+        size_t src = (y - tile.y0) * w;
+        size_t dst = y * width + tile.x0;
+        for (size_t x = 0; x < w; ++x) {
+            sum[dst + x] += tileAccum.sum[src + x];
+            count[dst + x] += tileAccum.count[src + x];
+        }
+        if (!sumSq.empty()) {
+            for (size_t x = 0; x < w; ++x) {
+                sumSq[dst + x] += tileAccum.sumSq[src + x];
+            }
+        }
+    }
+}
+
+vec3 AccumulationBuffer::getMean(size_t x, size_t y) const {
+    size_t i = y * width + x;
+    if (count[i] == 0) {
+        return vec3(0.0f, 0.0f, 0.0f);
+    }
+    return sum[i] / static_cast<float>(count[i]);
+}
+
+vec3 AccumulationBuffer::getVariance(size_t x, size_t y) const {
+    if (sumSq.empty()) {
+        throw std::logic_error("AccumulationBuffer::getVariance: moments are not tracked");
+    }
+
+    size_t i = y * width + x;
+    float n = static_cast<float>(count[i]);
+    if (count[i] < 2) {
+        return vec3(0.0f, 0.0f, 0.0f);
+    }
+
+    vec3 mean = sum[i] / n;
+    vec3 var = (sumSq[i] - square(mean) * n) / (n - 1.0f);
+    for (size_t c = 0; c < 3; ++c) {
+        // Rounding can push a zero variance slightly negative
+        var[c] = std::max(var[c], 0.0f);
+    }
+    return var;
+}
+
+uint64_t AccumulationBuffer::getTotalSamples() const {
+    uint64_t total = 0;
+    for (uint32_t c : count) {
+        total += c;
+    }
+    return total;
+}
+
+void AccumulationBuffer::clear() {
+    std::fill(sum.begin(), sum.end(), vec3(0.0f, 0.0f, 0.0f));
+    std::fill(sumSq.begin(), sumSq.end(), vec3(0.0f, 0.0f, 0.0f));
+    std::fill(count.begin(), count.end(), 0);
+}
+
+void AccumulationBuffer::resolve(FrameBuffer& fb) const {
+    if (fb.getWidth() != width || fb.getHeight() != height) {
+        throw std::invalid_argument("AccumulationBuffer::resolve: frame buffer size does not match");
+    }
+    resolveRows(fb, 0, width, 0, height);
+}
+
+void AccumulationBuffer::resolve(FrameBuffer& fb, TileScheduler& scheduler) const {
+    if (fb.getWidth() != width || fb.getHeight() != height) {
+        throw std::invalid_argument("AccumulationBuffer::resolve: frame buffer size does not match");
+    }
+    scheduler.run(fb, [&](const Tile& tile) {
+        resolveRows(fb, tile.x0, tile.x1, tile.y0, tile.y1);
+    });
+}
+
+void AccumulationBuffer::resolveRows(FrameBuffer& fb, size_t x0, size_t x1, size_t y0, size_t y1) const {
+    for (size_t y = y0; y < y1; ++y) {
+        for (size_t x = x0; x < x1; ++x) {
+            fb(x, y) = getMean(x, y);
+        }
+    }
+}
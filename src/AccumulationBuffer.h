@@ -0,0 +1,89 @@
+#ifndef ACCUMULATIONBUFFER_H
+#define ACCUMULATIONBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vec.h"
+#include "FrameBuffer.h"
+#include "TileScheduler.h"
+
+// Holds running per-pixel sums and sample counts so that a render can
+// add samples over any number of passes and be resolved to a
+// FrameBuffer at any point.  Second moments can be tracked as well for
+// per-pixel variance estimates.
+class AccumulationBuffer {
+public:
+    // Samples for one tile gathered privately by a single thread.  Since
+    // tiles handed out by a TileScheduler never overlap, merging them
+    // back touches disjoint pixels and needs no locking.
+    class TileAccumulator {
+    public:
+        const Tile& getTile() const { return tile; }
+
+        // (x, y) are image coordinates inside the tile
+        void addSample(size_t x, size_t y, const vec3& color);
+
+        // Forget the gathered samples so the accumulator can be reused
+        void clear();
+
+    private:
+        friend class AccumulationBuffer;
+        TileAccumulator(const Tile& tile, bool trackMoments);
+
+        size_t localIndex(size_t x, size_t y) const { return (y - tile.y0) * tile.width() + (x - tile.x0); }
+
+        Tile tile;
+        std::vector<vec3> sum;
+        std::vector<vec3> sumSq;
+        std::vector<uint32_t> count;
+    };
+
+    AccumulationBuffer(size_t width, size_t height, bool trackMoments = false);
+
+    size_t getWidth() const { return width; }
+    size_t getHeight() const { return height; }
+    bool hasMoments() const { return !sumSq.empty(); }
+
+    // Add one sample directly to the shared buffer
+    void addSample(size_t x, size_t y, const vec3& color);
+
+    TileAccumulator makeTile(const Tile& tile) const { return TileAccumulator(tile, hasMoments()); }
+
+    // Fold a tile's samples into the buffer.  Safe to call concurrently
+    // for tiles that do not overlap.
+    void merge(const TileAccumulator& tileAccum);
+
+    vec3 getSum(size_t x, size_t y) const { return sum[y * width + x]; }
+    uint32_t getSampleCount(size_t x, size_t y) const { return count[y * width + x]; }
+
+    // Mean of the samples at (x, y), zero if there are none
+    vec3 getMean(size_t x, size_t y) const;
+
+    // Per-channel sample variance at (x, y).  Requires moments; zero
+    // when fewer than two samples have been taken.
+    vec3 getVariance(size_t x, size_t y) const;
+
+    uint64_t getTotalSamples() const;
+
+    // Reset every pixel to no samples without releasing memory
+    void clear();
+
+    // Write the per-pixel means into fb, which must have the same size
+    void resolve(FrameBuffer& fb) const;
+    void resolve(FrameBuffer& fb, TileScheduler& scheduler) const;
+
+private:
+    friend class Checkpoint;
+
+    void resolveRows(FrameBuffer& fb, size_t x0, size_t x1, size_t y0, size_t y1) const;
+
+    size_t width;
+    size_t height;
+
+    std::vector<vec3> sum;
+    std::vector<vec3> sumSq;
+    std::vector<uint32_t> count;
+};
+
+#endif // ACCUMULATIONBUFFER_H
@@ -0,0 +1,173 @@
+#include "AdaptiveSampler.h"
+#include "handleGraphicsArgs.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+AdaptiveOptions AdaptiveOptions::fromArgs(const sivelab::GraphicsArgs& args) {
+    AdaptiveOptions options;
+    options.samplesPerPixel = static_cast<size_t>(std::max(args.rpp, 2));
+    options.minSamples = static_cast<size_t>(std::max(args.minRpp, 2));
+    if (args.adaptiveSampling) {
+        options.threshold = args.adaptiveThreshold;
+    }
+    return options;
+}
+
+AdaptiveSampler::AdaptiveSampler(size_t width, size_t height, const AdaptiveOptions& options)
+    : options(options), accum(width, height, true) {
+    if (options.threshold <= 0.0f) {
+        throw std::invalid_argument("AdaptiveSampler: the error threshold must be positive");
+    }
+    // Variance needs two samples, and the first pass must fit the budget
+    if (options.samplesPerPixel < 2) {
+        throw std::invalid_argument("AdaptiveSampler: needs a budget of at least 2 samples per pixel");
+    }
+    this->options.minSamples = std::max<size_t>(std::min(options.minSamples, options.samplesPerPixel), 2);
+    this->options.samplesPerPass = std::max<size_t>(options.samplesPerPass, 1);
+}
+
+size_t AdaptiveSampler::getNumConverged() const {
+    return static_cast<size_t>(std::count(converged.begin(), converged.end(), 1));
+}
+
+uint64_t AdaptiveSampler::render(TileScheduler& scheduler, const SampleFunction& sample) {
+    size_t width = getWidth(), height = getHeight();
+    accum.clear();
+    passes = 0;
+
+    // Index tiles by their scanline index, which is what the kernel sees
+    tiles = scheduler.makeTiles(width, height);
+    std::sort(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) { return a.index < b.index; });
+    tileError.assign(tiles.size(), std::numeric_limits<float>::infinity());
+    converged.assign(tiles.size(), 0);
+    tileSamples.assign(tiles.size(), 0);
+
+    uint64_t budget = uint64_t(options.samplesPerPixel) * width * height;
+    uint64_t spent = 0;
+    passSamples.assign(tiles.size(), options.minSamples);
+
+    while (true) {
+        scheduler.run(width, height, [&](const Tile& tile) {
+            size_t n = passSamples[tile.index];
+            if (n == 0) {
+                return;
+            }
+
+            AccumulationBuffer::TileAccumulator local = accum.makeTile(tile);
+            for (size_t y = tile.y0; y < tile.y1; ++y) {
+                for (size_t x = tile.x0; x < tile.x1; ++x) {
+                    uint32_t first = accum.getSampleCount(x, y);
+                    for (size_t s = 0; s < n; ++s) {
+                        local.addSample(x, y, sample(x, y, first + static_cast<uint32_t>(s)));
+                    }
+                }
+            }
+            accum.merge(local);
+
+            tileSamples[tile.index] += n;
+            tileError[tile.index] = estimateError(tile);
+        });
+        ++passes;
+
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            spent += uint64_t(passSamples[i]) * tiles[i].width() * tiles[i].height();
+            bool capped = options.maxSamples > 0 && tileSamples[i] >= options.maxSamples;
+            if (tileError[i] < options.threshold || capped) {
+                converged[i] = 1;
+            }
+        }
+
+        if (spent >= budget || !planPass(budget - spent)) {
+            break;
+        }
+    }
+    return spent;
+}
+
+bool AdaptiveSampler::planPass(uint64_t remaining) {
+    // Share out samplesPerPass per active pixel in proportion to error
+    double weightSum = 0.0;
+    uint64_t activePixels = 0;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        if (!converged[i]) {
+            size_t pixels = tiles[i].width() * tiles[i].height();
+            weightSum += double(std::min(tileError[i], 1e6f)) * pixels;
+            activePixels += pixels;
+        }
+    }
+    if (activePixels == 0) {
+        return false;
+    }
+
+    double passBudget = double(std::min<uint64_t>(remaining, activePixels * options.samplesPerPass));
+    uint64_t cost = 0;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        passSamples[i] = 0;
+        if (converged[i]) {
+            continue;
+        }
+        double share = (weightSum > 0.0) ? passBudget * std::min(tileError[i], 1e6f) / weightSum
+                                         : passBudget / double(activePixels);
+        size_t n = std::max<size_t>(1, static_cast<size_t>(share));
+        if (options.maxSamples > 0) {
+            n = std::min(n, options.maxSamples - tileSamples[i]);
+        }
+        passSamples[i] = n;
+        cost += uint64_t(n) * tiles[i].width() * tiles[i].height();
+    }
+
+    // Shrink the pass when the minimum of one sample everywhere does not fit
+    if (cost > remaining) {
+        double scale = double(remaining) / double(cost);
+        cost = 0;
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            passSamples[i] = static_cast<size_t>(passSamples[i] * scale);
+            cost += uint64_t(passSamples[i]) * tiles[i].width() * tiles[i].height();
+        }
+    }
+    return cost > 0;
+}
+
+float AdaptiveSampler::estimateError(const Tile& tile) const {
+    double sumSq = 0.0;
+    for (size_t y = tile.y0; y < tile.y1; ++y) {
+        for (size_t x = tile.x0; x < tile.x1; ++x) {
+            uint32_t n = accum.getSampleCount(x, y);
+            if (n < 2) {
+                return std::numeric_limits<float>::infinity();
+            }
+            vec3 var = accum.getVariance(x, y);
+            vec3 mean = accum.getMean(x, y);
+            float intensity = std::max((mean[0] + mean[1] + mean[2]) / 3.0f, options.minIntensity);
+            float stdError = std::sqrt((var[0] + var[1] + var[2]) / (3.0f * n));
+            double e = stdError / intensity;
+            sumSq += e * e;
+        }
+    }
+    return static_cast<float>(std::sqrt(sumSq / double(tile.width() * tile.height())));
+}
+
+FrameBuffer AdaptiveSampler::makeHeatmap() const {
+    size_t width = getWidth(), height = getHeight();
+    uint32_t lo = std::numeric_limits<uint32_t>::max(), hi = 0;
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            lo = std::min(lo, accum.getSampleCount(x, y));
+            hi = std::max(hi, accum.getSampleCount(x, y));
+        }
+    }
+
+    FrameBuffer fb(width, height);
+    float range = (hi > lo) ? float(hi - lo) : 1.0f;
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            float t = (accum.getSampleCount(x, y) - lo) / range;
+            fb(x, y) = vec3(std::clamp(3.0f * t, 0.0f, 1.0f),
+                            std::clamp(3.0f * t - 1.0f, 0.0f, 1.0f),
+                            std::clamp(3.0f * t - 2.0f, 0.0f, 1.0f));
+        }
+    }
+    return fb;
+}
@@ -0,0 +1,106 @@
+#ifndef ADAPTIVESAMPLER_H
+#define ADAPTIVESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "vec.h"
+#include "AccumulationBuffer.h"
+#include "FrameBuffer.h"
+#include "TileScheduler.h"
+
+namespace sivelab {
+    class GraphicsArgs;
+}
+
+struct AdaptiveOptions {
+    // Average samples per pixel over the whole image.  The total budget
+    // is this times the pixel count, however it ends up distributed.
+    // At least 2, since the first pass already takes two per pixel.
+    size_t samplesPerPixel = 16;
+
+    // Every pixel gets at least this many samples (2 or more) before its
+    // tile may be declared converged
+    size_t minSamples = 4;
+
+    // Upper limit per pixel, 0 for none beyond the budget
+    size_t maxSamples = 0;
+
+    // Average samples per pixel handed to the active tiles in each pass
+    // after the first.  Noisier tiles get a larger share.
+    size_t samplesPerPass = 4;
+
+    // A tile has converged once the RMS relative standard error of its
+    // pixel means drops below this
+    float threshold = 0.01f;
+
+    // Intensities below this count as this in the relative error, so
+    // near-black pixels do not soak up the budget
+    float minIntensity = 0.01f;
+
+    // samplesPerPixel from --rpp, threshold from --adaptive and
+    // minSamples from --minrpp.  An --rpp under 2, such as the default
+    // of 1, is raised to the smallest budget the sampler takes.
+    static AdaptiveOptions fromArgs(const sivelab::GraphicsArgs& args);
+};
+
+// Renders with a variable number of samples per pixel.  After a first
+// pass of minSamples everywhere, each tile's error is estimated from the
+// per-pixel variance in an AccumulationBuffer.  Converged tiles stop
+// and the rest of the budget goes to the tiles that are still noisy, in
+// proportion to their error.
+class AdaptiveSampler {
+public:
+    // Returns one sample of pixel (x, y).  sampleIndex counts the
+    // samples already taken at that pixel, for seeding or stratifying.
+    using SampleFunction = std::function<vec3(size_t x, size_t y, uint32_t sampleIndex)>;
+
+    AdaptiveSampler(size_t width, size_t height, const AdaptiveOptions& options = AdaptiveOptions());
+
+    size_t getWidth() const { return accum.getWidth(); }
+    size_t getHeight() const { return accum.getHeight(); }
+    const AdaptiveOptions& getOptions() const { return options; }
+
+    // Render from scratch until every tile has converged or the budget
+    // is spent.  Tiles come from the scheduler.  Returns the number of
+    // samples taken.
+    uint64_t render(TileScheduler& scheduler, const SampleFunction& sample);
+
+    const AccumulationBuffer& getAccumulation() const { return accum; }
+    void resolve(FrameBuffer& fb) const { accum.resolve(fb); }
+
+    // Per-tile state of the last render
+    size_t getNumTiles() const { return tiles.size(); }
+    const Tile& getTile(size_t i) const { return tiles[i]; }
+    float getTileError(size_t i) const { return tileError[i]; }
+    bool isTileConverged(size_t i) const { return converged[i]; }
+    size_t getNumConverged() const;
+
+    size_t getPasses() const { return passes; }
+    uint64_t getSamplesSpent() const { return accum.getTotalSamples(); }
+
+    // Samples spent per pixel, from black (fewest) through red and
+    // yellow to white (most)
+    FrameBuffer makeHeatmap() const;
+
+private:
+    // RMS relative standard error of the pixel means in a tile
+    float estimateError(const Tile& tile) const;
+
+    // Per-pixel sample counts for the next pass; false once the budget
+    // cannot pay for another one
+    bool planPass(uint64_t remaining);
+
+    AdaptiveOptions options;
+    AccumulationBuffer accum;
+
+    std::vector<Tile> tiles;
+    std::vector<float> tileError;
+    std::vector<char> converged;
+    std::vector<size_t> passSamples;
+    std::vector<size_t> tileSamples;
+    size_t passes = 0;
+};
+
+#endif // ADAPTIVESAMPLER_H
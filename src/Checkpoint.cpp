@@ -0,0 +1,321 @@
+#include "Checkpoint.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+#include "handleGraphicsArgs.h"
+
+namespace {
+    const char kMagic[8] = { 'C', 'S', '4', '2', '1', '2', 'C', 'K' };
+    const uint32_t kVersion = 1;
+    const uint32_t kFlagMoments = 1;
+
+    // Writes bytes while keeping a running CRC-32
+    class CheckedWriter {
+    public:
+        explicit CheckedWriter(std::ostream& out) : out(out), crc(crc32(0L, Z_NULL, 0)) {}
+
+        void bytes(const void* data, size_t n) {
+            const Bytef* p = static_cast<const Bytef*>(data);
+            // crc32 takes a uInt length, so feed large arrays in pieces
+            for (size_t done = 0; done < n;) {
+                size_t chunk = std::min<size_t>(n - done, 1u << 30);
+                crc = crc32(crc, p + done, static_cast<uInt>(chunk));
+                done += chunk;
+            }
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(n));
+        }
+
+        void u32(uint32_t v) {
+            unsigned char b[4] = { uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24) };
+            bytes(b, 4);
+        }
+
+        void u64(uint64_t v) {
+            u32(static_cast<uint32_t>(v));
+            u32(static_cast<uint32_t>(v >> 32));
+        }
+
+        // 32-bit words in little-endian order, straight from memory on
+        // little-endian hosts
+        void words(const void* data, size_t count) {
+            if constexpr (std::endian::native == std::endian::little) {
+                bytes(data, count * 4);
+            } else {
+                const uint32_t* w = static_cast<const uint32_t*>(data);
+                for (size_t i = 0; i < count; ++i) u32(w[i]);
+            }
+        }
+
+        uLong getCrc() const { return crc; }
+
+    private:
+        std::ostream& out;
+        uLong crc;
+    };
+
+    class CheckedReader {
+    public:
+        explicit CheckedReader(std::istream& in) : in(in), crc(crc32(0L, Z_NULL, 0)) {}
+
+        void bytes(void* data, size_t n) {
+            if (!in.read(static_cast<char*>(data), static_cast<std::streamsize>(n))) {
+                throw std::runtime_error("Checkpoint file is truncated");
+            }
+            const Bytef* p = static_cast<const Bytef*>(data);
+            for (size_t done = 0; done < n;) {
+                size_t chunk = std::min<size_t>(n - done, 1u << 30);
+                crc = crc32(crc, p + done, static_cast<uInt>(chunk));
+                done += chunk;
+            }
+        }
+
+        uint32_t u32() {
+            unsigned char b[4];
+            bytes(b, 4);
+            return uint32_t(b[0]) | (uint32_t(b[1]) << 8) | (uint32_t(b[2]) << 16) | (uint32_t(b[3]) << 24);
+        }
+
+        uint64_t u64() {
+            uint64_t lo = u32();
+            uint64_t hi = u32();
+            return lo | (hi << 32);
+        }
+
+        void words(void* data, size_t count) {
+            bytes(data, count * 4);
+            if constexpr (std::endian::native != std::endian::little) {
+                unsigned char* b = static_cast<unsigned char*>(data);
+                for (size_t i = 0; i < count; ++i, b += 4) {
+                    std::swap(b[0], b[3]);
+                    std::swap(b[1], b[2]);
+                }
+            }
+        }
+
+        uLong getCrc() const { return crc; }
+
+    private:
+        std::istream& in;
+        uLong crc;
+    };
+}
+
+void Checkpoint::write(const std::string& filename, const AccumulationBuffer& accum, const CheckpointInfo& info) {
+    std::string temp = filename + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary);
+        if (!out) {
+            throw std::runtime_error("Could not open " + temp + " for writing");
+        }
+
+        CheckedWriter w(out);
+        w.bytes(kMagic, sizeof(kMagic));
+        w.u32(kVersion);
+        w.u32(accum.hasMoments() ? kFlagMoments : 0);
+        w.u64(accum.width);
+        w.u64(accum.height);
+        w.u64(info.seed);
+        w.u64(info.passes);
+        w.u64(info.userData.size());
+        w.bytes(info.userData.data(), info.userData.size());
+
+        w.words(accum.sum.data(), accum.sum.size() * 3);
+        if (accum.hasMoments()) {
+            w.words(accum.sumSq.data(), accum.sumSq.size() * 3);
+        }
+        w.words(accum.count.data(), accum.count.size());
+
+        uint32_t crc = static_cast<uint32_t>(w.getCrc());
+        unsigned char b[4] = { uint8_t(crc), uint8_t(crc >> 8), uint8_t(crc >> 16), uint8_t(crc >> 24) };
+        out.write(reinterpret_cast<const char*>(b), 4);
+
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Error writing " + temp);
+        }
+    }
+
+    if (std::rename(temp.c_str(), filename.c_str()) != 0) {
+        std::remove(temp.c_str());
+        throw std::runtime_error("Could not replace " + filename);
+    }
+}
+
+CheckpointInfo Checkpoint::read(const std::string& filename, AccumulationBuffer& accum) {
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::runtime_error("Could not open checkpoint " + filename);
+    }
+    uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+
+    CheckedReader r(in);
+    char magic[sizeof(kMagic)];
+    r.bytes(magic, sizeof(magic));
+    if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error(filename + " is not a checkpoint file");
+    }
+    if (r.u32() != kVersion) {
+        throw std::runtime_error(filename + " is from an unsupported checkpoint version");
+    }
+
+    bool moments = (r.u32() & kFlagMoments) != 0;
+    uint64_t width = r.u64();
+    uint64_t height = r.u64();
+
+    CheckpointInfo info;
+    info.seed = r.u64();
+    info.passes = r.u64();
+    uint64_t userSize = r.u64();
+
+    // Check the sizes against the file before allocating anything
+    uint64_t headerSize = sizeof(kMagic) + 4 * 2 + 8 * 5;
+    uint64_t pixelBytes = (moments ? 28 : 16);
+    if (userSize > fileSize || (width != 0 && height > fileSize / pixelBytes / width) ||
+        headerSize + userSize + width * height * pixelBytes + 4 != fileSize) {
+        throw std::runtime_error(filename + " has a corrupt header or is truncated");
+    }
+    info.userData.resize(userSize);
+    r.bytes(info.userData.data(), info.userData.size());
+
+    AccumulationBuffer loaded(width, height, moments);
+    r.words(loaded.sum.data(), loaded.sum.size() * 3);
+    if (moments) {
+        r.words(loaded.sumSq.data(), loaded.sumSq.size() * 3);
+    }
+    r.words(loaded.count.data(), loaded.count.size());
+
+    uint32_t expected = static_cast<uint32_t>(r.getCrc());
+    if (r.u32() != expected) {
+        throw std::runtime_error(filename + " failed its checksum");
+    }
+
+    accum = std::move(loaded);
+    return info;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& filename)
+    : filename(filename), lastSave(std::chrono::steady_clock::now()) {
+    thread = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void CheckpointWriter::rethrowError() {
+    if (error) {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+void CheckpointWriter::save(const AccumulationBuffer& accum, const CheckpointInfo& info) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        rethrowError();
+        // Copy-assignment reuses the snapshot's storage from last time
+        pending.accum = accum;
+        pending.info = info;
+        hasPending = true;
+        lastSave = std::chrono::steady_clock::now();
+    }
+    wake.notify_one();
+}
+
+bool CheckpointWriter::saveIfDue(const AccumulationBuffer& accum, const CheckpointInfo& info,
+                                 std::chrono::steady_clock::duration interval) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (std::chrono::steady_clock::now() - lastSave < interval) {
+            return false;
+        }
+    }
+    save(accum, info);
+    return true;
+}
+
+void CheckpointWriter::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return !hasPending && !busy; });
+    rethrowError();
+}
+
+size_t CheckpointWriter::getWritesCompleted() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return writesCompleted;
+}
+
+void CheckpointWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return hasPending || stopping; });
+        if (!hasPending) {
+            return;
+        }
+
+        // Swap so the next save() copies into the buffer just written
+        std::swap(pending, writing);
+        hasPending = false;
+        busy = true;
+        lock.unlock();
+
+        std::exception_ptr failure;
+        try {
+            Checkpoint::write(filename, writing.accum, writing.info);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+
+        lock.lock();
+        busy = false;
+        if (failure) {
+            error = failure;
+        } else {
+            ++writesCompleted;
+        }
+        idle.notify_all();
+    }
+}
+
+CheckpointOptions CheckpointOptions::fromArgs(const sivelab::GraphicsArgs& args) {
+    if (args.checkpointInterval <= 0) {
+        throw std::invalid_argument("--checkpointinterval must be a positive number of seconds");
+    }
+    CheckpointOptions options;
+    options.filename = args.checkpointFileName;
+    options.interval = std::chrono::seconds(args.checkpointInterval);
+    options.resumeFilename = args.resumeFileName;
+    return options;
+}
+
+std::unique_ptr<CheckpointWriter> CheckpointOptions::makeWriter() const {
+    if (filename.empty()) return nullptr;
+    return std::make_unique<CheckpointWriter>(filename);
+}
+
+bool CheckpointOptions::resume(AccumulationBuffer& accum, CheckpointInfo& info) const {
+    if (resumeFilename.empty()) return false;
+
+    AccumulationBuffer loaded(0, 0);
+    CheckpointInfo loadedInfo = Checkpoint::read(resumeFilename, loaded);
+    if (loaded.getWidth() != accum.getWidth() || loaded.getHeight() != accum.getHeight()) {
+        throw std::runtime_error(resumeFilename + " is a " + std::to_string(loaded.getWidth()) + "x" +
+                                 std::to_string(loaded.getHeight()) + " checkpoint, not " +
+                                 std::to_string(accum.getWidth()) + "x" + std::to_string(accum.getHeight()));
+    }
+    accum = std::move(loaded);
+    info = std::move(loadedInfo);
+    return true;
+}
@@ -0,0 +1,131 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "AccumulationBuffer.h"
+
+namespace sivelab {
+    class GraphicsArgs;
+}
+
+// Everything besides the accumulated samples needed to continue a
+// render.  Per-pixel sample indices are the sample counts already in
+// the AccumulationBuffer, so a sampler that seeds its random numbers
+// from (seed, x, y, sample index) resumes exactly where it stopped.
+struct CheckpointInfo {
+    uint64_t seed = 0;
+    uint64_t passes = 0;
+
+    // Opaque extra state, e.g. a serialized random number generator
+    std::string userData;
+};
+
+// Compact binary checkpoints of a progressive render.  The file holds a
+// small header, the raw little-endian accumulation data and a CRC-32 of
+// everything before it, so truncated or damaged files are rejected.
+// Files are written to a temporary name and renamed into place, so a
+// crash mid-write leaves the previous checkpoint intact.
+class Checkpoint {
+public:
+    static void write(const std::string& filename, const AccumulationBuffer& accum, const CheckpointInfo& info);
+
+    // Replaces accum with the checkpointed buffer.  Throws
+    // std::runtime_error for missing, foreign or damaged files.
+    static CheckpointInfo read(const std::string& filename, AccumulationBuffer& accum);
+};
+
+// Writes checkpoints on a background thread.  save() only copies the
+// buffer, which is a few memcpys, and returns; the slow encoding and
+// file I/O happen off the render threads.  If a save arrives while the
+// previous one is still being written, the newer snapshot replaces any
+// that is still waiting.
+class CheckpointWriter {
+public:
+    explicit CheckpointWriter(const std::string& filename);
+
+    // Finishes any queued write
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    const std::string& getFilename() const { return filename; }
+
+    // Queue a snapshot.  Rethrows the error of a failed earlier write.
+    void save(const AccumulationBuffer& accum, const CheckpointInfo& info);
+
+    // save() if at least interval has passed since the last save (or
+    // since construction).  Returns whether a snapshot was queued.
+    bool saveIfDue(const AccumulationBuffer& accum, const CheckpointInfo& info, std::chrono::steady_clock::duration interval);
+
+    // Block until every queued snapshot is on disk
+    void wait();
+
+    size_t getWritesCompleted() const;
+
+private:
+    struct Snapshot {
+        AccumulationBuffer accum{ 0, 0 };
+        CheckpointInfo info;
+    };
+
+    void run();
+    void rethrowError();
+
+    std::string filename;
+    std::chrono::steady_clock::time_point lastSave;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    Snapshot pending;
+    Snapshot writing;
+    bool hasPending = false;
+    bool busy = false;
+    bool stopping = false;
+    size_t writesCompleted = 0;
+    std::exception_ptr error;
+    std::thread thread;
+};
+
+// What --checkpoint, --checkpointinterval and --resume ask of a
+// progressive render:
+//
+//   CheckpointOptions checkpoints = CheckpointOptions::fromArgs(args);
+//   CheckpointInfo info{ seed, 0, "" };
+//   checkpoints.resume(accum, info);
+//   auto writer = checkpoints.makeWriter();
+//   while (rendering) {
+//       renderPass(accum, info.seed);
+//       ++info.passes;
+//       if (writer) writer->saveIfDue(accum, info, checkpoints.interval);
+//   }
+struct CheckpointOptions {
+    // Empty for no checkpoints
+    std::string filename;
+    std::chrono::seconds interval{ 300 };
+
+    // Empty to start from an empty buffer
+    std::string resumeFilename;
+
+    // Throws std::invalid_argument for a non-positive interval
+    static CheckpointOptions fromArgs(const sivelab::GraphicsArgs& args);
+
+    // A writer for filename, or null when checkpoints are off
+    std::unique_ptr<CheckpointWriter> makeWriter() const;
+
+    // Loads resumeFilename into accum and info when there is one and
+    // returns whether it did; otherwise leaves both alone.  Throws
+    // std::runtime_error as Checkpoint::read does, and when the
+    // checkpoint's size differs from accum's.
+    bool resume(AccumulationBuffer& accum, CheckpointInfo& info) const;
+};
+
+#endif // CHECKPOINT_H
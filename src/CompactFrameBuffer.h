@@ -0,0 +1,95 @@
+#ifndef COMPACTFRAMEBUFFER_H
+#define COMPACTFRAMEBUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+#include "vec.h"
+#include "FrameBuffer.h"
+#include "PixelFormat.h"
+#include "PngEncoder.h"
+
+// A row-major frame buffer that stores its pixels in one of the compact
+// formats from PixelFormat.h.  Pixels are converted as they are read and
+// written; the row functions convert whole rows with the format's SIMD
+// bulk conversions.  Useful for images that stay in RAM for a long time,
+// such as the extra layers of a multi-layer render:
+//
+//   format    bytes/pixel
+//   float32   12
+//   half16    6
+//   rgb9e5    4
+//   srgb8     3
+template <typename Format>
+class CompactFrameBuffer {
+public:
+    using Storage = typename Format::Storage;
+
+    CompactFrameBuffer(size_t width, size_t height)
+        : width(width), height(height), data(width * height, Format::encode(vec3(0.0f, 0.0f, 0.0f))) {
+    }
+
+    // Convert a whole float frame buffer, whatever its layout
+    explicit CompactFrameBuffer(const FrameBuffer& fb)
+        : CompactFrameBuffer(fb.getWidth(), fb.getHeight()) {
+        std::vector<vec3> scratch;
+        for (size_t y = 0; y < height; ++y) {
+            Format::encode(fb.getRow(y, scratch), width, &data[y * width]);
+        }
+    }
+
+    size_t getWidth() const { return width; }
+    size_t getHeight() const { return height; }
+    static constexpr size_t bytesPerPixel() { return sizeof(Storage); }
+
+    vec3 getPixel(size_t x, size_t y) const { return Format::decode(data[y * width + x]); }
+    void setPixel(size_t x, size_t y, const vec3& color) { data[y * width + x] = Format::encode(color); }
+
+    void setBackground(const vec3& color) {
+        std::fill(data.begin(), data.end(), Format::encode(color));
+    }
+
+    // Convert row y to and from width pixels of float color
+    void copyRow(size_t y, vec3* dst) const { Format::decode(&data[y * width], width, dst); }
+    void setRow(size_t y, const vec3* src) { Format::encode(src, width, &data[y * width]); }
+
+    // Decoded rows for the image writers
+    RowSource getRowSource() const {
+        return [this](size_t y, std::vector<vec3>& scratch) {
+            scratch.resize(width);
+            copyRow(y, scratch.data());
+            return static_cast<const vec3*>(scratch.data());
+        };
+    }
+
+    // Convert back to a float frame buffer with the given layout
+    FrameBuffer toFrameBuffer(FrameBuffer::Layout layout = FrameBuffer::Layout::RowMajor) const {
+        FrameBuffer fb(width, height, layout);
+        std::vector<vec3> row(width);
+        for (size_t y = 0; y < height; ++y) {
+            copyRow(y, row.data());
+            fb.setRow(y, row.data());
+        }
+        return fb;
+    }
+
+    void writeToPng(const std::string& filename, const EncodeOptions& options = EncodeOptions()) const {
+        writePngRows(filename, width, height, getRowSource(), options);
+    }
+
+    // Packed pixels in row-major order
+    std::span<const Storage> getData() const { return data; }
+
+private:
+    size_t width;
+    size_t height;
+    std::vector<Storage> data;
+};
+
+using HalfFrameBuffer = CompactFrameBuffer<Half16Format>;
+using RGB9E5FrameBuffer = CompactFrameBuffer<RGB9E5Format>;
+using SRGB8FrameBuffer = CompactFrameBuffer<SRGB8Format>;
+
+#endif // COMPACTFRAMEBUFFER_H
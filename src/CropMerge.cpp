@@ -0,0 +1,124 @@
+#include "CropMerge.h"
+#include "ImageIO.h"
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+    struct MergeSource {
+        std::unique_ptr<ImageRowReader> reader;
+        CropWindow crop;
+    };
+
+    // A non-negative decimal offset, digits only
+    bool parseOffset(const std::string& s, size_t& value) {
+        if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos) return false;
+        try {
+            value = static_cast<size_t>(std::stoull(s));
+        } catch (const std::out_of_range&) {
+            return false;
+        }
+        return true;
+    }
+}
+
+MergeInput MergeInput::parse(const std::string& arg) {
+    MergeInput input;
+    input.filename = arg;
+
+    // Only a suffix that reads as x,y is an offset; anything else after
+    // an '@' is part of the filename
+    size_t at = arg.find_last_of('@');
+    if (at == std::string::npos || at == 0) return input;
+    size_t comma = arg.find(',', at);
+    size_t x0, y0;
+    if (comma == std::string::npos || !parseOffset(arg.substr(at + 1, comma - at - 1), x0) ||
+        !parseOffset(arg.substr(comma + 1), y0)) {
+        return input;
+    }
+    input.filename = arg.substr(0, at);
+    input.hasOffset = true;
+    input.x0 = x0;
+    input.y0 = y0;
+    return input;
+}
+
+MergeReport mergeCrops(const std::vector<MergeInput>& inputs, const std::string& output,
+                       size_t fullWidth, size_t fullHeight) {
+    if (inputs.empty()) {
+        throw std::invalid_argument("mergeCrops: nothing to merge");
+    }
+    if (imageFormatFromFilename(output) == ImageFormat::PFM) {
+        throw std::invalid_argument("mergeCrops: PFM output is not supported, its rows are stored bottom-up");
+    }
+
+    // Open everything first so the frame size and bounds are known
+    // before any output is written
+    bool sizeGiven = fullWidth != 0 && fullHeight != 0;
+    std::vector<MergeSource> sources;
+    for (const MergeInput& input : inputs) {
+        MergeSource source{ openImage(input.filename), CropWindow() };
+        source.crop = source.reader->getCrop();
+
+        if (input.hasOffset) {
+            source.crop.x0 = input.x0;
+            source.crop.y0 = input.y0;
+        } else if (imageFormatFromFilename(input.filename) == ImageFormat::EXR) {
+            if (fullWidth == 0 || fullHeight == 0) {
+                fullWidth = source.crop.fullWidth;
+                fullHeight = source.crop.fullHeight;
+            } else if (!sizeGiven && (source.crop.fullWidth != fullWidth || source.crop.fullHeight != fullHeight)) {
+                throw std::runtime_error(input.filename + " is a crop of a different frame size than the other inputs");
+            }
+        }
+        sources.push_back(std::move(source));
+    }
+    if (fullWidth == 0 || fullHeight == 0) {
+        throw std::invalid_argument("mergeCrops: give the frame size or at least one EXR crop");
+    }
+
+    for (size_t i = 0; i < sources.size(); ++i) {
+        CropWindow& crop = sources[i].crop;
+        crop.fullWidth = fullWidth;
+        crop.fullHeight = fullHeight;
+        if (crop.x0 + crop.width > fullWidth || crop.y0 + crop.height > fullHeight) {
+            throw std::runtime_error(inputs[i].filename + " does not fit in the " + std::to_string(fullWidth) +
+                                     "x" + std::to_string(fullHeight) + " frame");
+        }
+    }
+
+    MergeReport report;
+    report.width = fullWidth;
+    report.height = fullHeight;
+
+    // Readers only move forward, so rows must be asked for in order
+    size_t nextRow = 0;
+    std::vector<uint16_t> coverage;
+    RowSource rows = [&](size_t y, std::vector<vec3>& scratch) -> const vec3* {
+        if (y != nextRow) {
+            throw std::logic_error("mergeCrops: output rows must be written top to bottom");
+        }
+        scratch.assign(fullWidth, vec3(0.0f, 0.0f, 0.0f));
+        coverage.assign(fullWidth, 0);
+
+        // Later inputs overwrite earlier ones where they overlap
+        for (MergeSource& source : sources) {
+            const CropWindow& crop = source.crop;
+            if (y < crop.y0 || y >= crop.y0 + crop.height) continue;
+            source.reader->readRow(scratch.data() + crop.x0);
+            for (size_t x = crop.x0; x < crop.x0 + crop.width; ++x) {
+                ++coverage[x];
+            }
+        }
+        for (uint16_t c : coverage) {
+            if (c == 0) ++report.uncoveredPixels;
+            else if (c > 1) ++report.overlappedPixels;
+        }
+
+        ++nextRow;
+        return scratch.data();
+    };
+
+    writeImage(output, CropWindow::fullFrame(fullWidth, fullHeight), rows);
+    return report;
+}
@@ -0,0 +1,42 @@
+#ifndef CROPMERGE_H
+#define CROPMERGE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "CropWindow.h"
+
+// One image to merge.  EXR files written with a crop window know where
+// they go; other images need their offset given with "file@x,y".
+struct MergeInput {
+    std::string filename;
+    bool hasOffset = false;
+    size_t x0 = 0, y0 = 0;
+
+    // Parse "file" or "file@x,y".  A filename may contain '@'; only a
+    // final "@x,y" of two decimal numbers is taken as the offset.
+    static MergeInput parse(const std::string& arg);
+};
+
+struct MergeReport {
+    size_t width = 0;
+    size_t height = 0;
+
+    // Pixels no input covered, which are left black
+    size_t uncoveredPixels = 0;
+
+    // Pixels covered by more than one input; the last input listed wins
+    size_t overlappedPixels = 0;
+};
+
+// Assemble the crops rendered by separate processes into one image.
+// Rows are streamed from every input straight into the output writer,
+// so only a row per input is ever held in memory, whatever the size of
+// the frame.  The full frame size comes from fullWidth x fullHeight
+// when non-zero and otherwise from the EXR inputs, which must agree.
+// The output format follows its extension; PFM is not supported since
+// it is written bottom row first.
+MergeReport mergeCrops(const std::vector<MergeInput>& inputs, const std::string& output,
+                       size_t fullWidth = 0, size_t fullHeight = 0);
+
+#endif // CROPMERGE_H
@@ -0,0 +1,79 @@
+#include "CropWindow.h"
+#include "handleGraphicsArgs.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    // Parse a whole string as a non-negative integer
+    size_t parseCount(const std::string& s, const std::string& spec) {
+        size_t used = 0;
+        long long v = -1;
+        try {
+            v = std::stoll(s, &used);
+        } catch (const std::exception&) {
+        }
+        if (v < 0 || used != s.size()) {
+            throw std::invalid_argument("Bad crop window '" + spec + "'");
+        }
+        return static_cast<size_t>(v);
+    }
+}
+
+CropWindow CropWindow::fullFrame(size_t fullWidth, size_t fullHeight) {
+    return CropWindow{ 0, 0, fullWidth, fullHeight, fullWidth, fullHeight };
+}
+
+CropWindow CropWindow::parse(const std::string& spec, size_t fullWidth, size_t fullHeight) {
+    size_t slash = spec.find('/');
+    if (slash != std::string::npos) {
+        size_t i = parseCount(spec.substr(0, slash), spec);
+        size_t n = parseCount(spec.substr(slash + 1), spec);
+        if (n == 0 || i >= n) {
+            throw std::invalid_argument("Bad crop band '" + spec + "': need 0 <= i < n");
+        }
+        return bands(fullWidth, fullHeight, n)[i];
+    }
+
+    std::vector<size_t> values;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        values.push_back(parseCount(item, spec));
+    }
+    if (values.size() != 4) {
+        throw std::invalid_argument("Bad crop window '" + spec + "': expected x,y,w,h or i/n");
+    }
+
+    CropWindow crop{ values[0], values[1], values[2], values[3], fullWidth, fullHeight };
+    if (crop.width == 0 || crop.height == 0 ||
+        crop.x0 + crop.width > fullWidth || crop.y0 + crop.height > fullHeight) {
+        throw std::invalid_argument("Crop window '" + spec + "' does not fit in the " +
+                                    std::to_string(fullWidth) + "x" + std::to_string(fullHeight) + " frame");
+    }
+    return crop;
+}
+
+CropWindow CropWindow::fromArgs(const sivelab::GraphicsArgs& args) {
+    size_t fullWidth = static_cast<size_t>(std::max(args.width, 0));
+    size_t fullHeight = static_cast<size_t>(std::max(args.height, 0));
+    if (args.cropWindow.empty()) {
+        return fullFrame(fullWidth, fullHeight);
+    }
+    return parse(args.cropWindow, fullWidth, fullHeight);
+}
+
+std::vector<CropWindow> CropWindow::bands(size_t fullWidth, size_t fullHeight, size_t n) {
+    if (n == 0 || n > fullHeight) {
+        throw std::invalid_argument("Cannot split " + std::to_string(fullHeight) + " rows into " +
+                                    std::to_string(n) + " bands");
+    }
+
+    std::vector<CropWindow> result;
+    for (size_t i = 0; i < n; ++i) {
+        size_t y0 = fullHeight * i / n;
+        size_t y1 = fullHeight * (i + 1) / n;
+        result.push_back(CropWindow{ 0, y0, fullWidth, y1 - y0, fullWidth, fullHeight });
+    }
+    return result;
+}
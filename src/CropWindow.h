@@ -0,0 +1,44 @@
+#ifndef CROPWINDOW_H
+#define CROPWINDOW_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sivelab {
+    class GraphicsArgs;
+}
+
+// A rectangle of a larger frame.  Renders of a crop go into a buffer of
+// width x height pixels; pixel (x, y) of that buffer is pixel
+// (x0 + x, y0 + y) of the full frame, and cameras should still be set
+// up for the full frame size.
+struct CropWindow {
+    size_t x0 = 0, y0 = 0;
+    size_t width = 0, height = 0;
+    size_t fullWidth = 0, fullHeight = 0;
+
+    // The whole of a fullWidth x fullHeight frame
+    static CropWindow fullFrame(size_t fullWidth, size_t fullHeight);
+
+    // Parse "x,y,w,h" or "i/n", the i-th (from 0) of n horizontal bands.
+    // Throws std::invalid_argument for bad specs or windows that do not
+    // fit in the frame.
+    static CropWindow parse(const std::string& spec, size_t fullWidth, size_t fullHeight);
+
+    // The --crop window of the --width x --height frame, or the full
+    // frame when --crop is not given
+    static CropWindow fromArgs(const sivelab::GraphicsArgs& args);
+
+    // Split a frame into n horizontal bands of nearly equal height
+    static std::vector<CropWindow> bands(size_t fullWidth, size_t fullHeight, size_t n);
+
+    bool isFullFrame() const { return x0 == 0 && y0 == 0 && width == fullWidth && height == fullHeight; }
+
+    size_t toFullX(size_t x) const { return x0 + x; }
+    size_t toFullY(size_t y) const { return y0 + y; }
+
+    bool operator==(const CropWindow& other) const = default;
+};
+
+#endif // CROPWINDOW_H
@@ -0,0 +1,342 @@
+#include "Denoiser.h"
+#include "FastMath.h"
+#include "TileScheduler.h"
+#include "handleGraphicsArgs.h"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+    enum GuideBits { UseNormal = 1, UseAlbedo = 2, UseDepth = 4 };
+
+    // Keeps near-black albedo from blowing up the demodulated color
+    const float kAlbedoEpsilon = 1e-3f;
+
+    // Tiles are at most this wide, so per-row sums fit on the stack
+    const size_t kTileSize = 64;
+
+    // Depths are clamped to this before they are compared, so infinite
+    // or FLT_MAX background depth gives large but finite differences
+    // rather than inf - inf
+    const float kMaxDepth = 1e18f;
+
+    // exp(x) for x <= 0, to 1e-5 relative and exactly 1 at 0.  Built
+    // from float and integer arithmetic only, so loops calling it
+    // vectorize, unlike std::exp.  x is clamped to [-60, 0], well above
+    // the denormal range, which would slow every weighted sum it touches
+    // to a crawl; -inf and the huge exponents of a noise-free image land
+    // on -60 and get no weight.  The clamp compares bits, as in FastMath.h,
+    // because GCC will not vectorize float compares.
+    inline float expNegative(float x) {
+        x = fastmath::detail::clamp(x, -60.0f, 0.0f);
+        // t is negative, so truncating t - 1 leaves f in (0, 1]
+        float t = x * 1.44269504f;
+        int32_t i = static_cast<int32_t>(t - 1.0f);
+        float f = t - static_cast<float>(i);
+        // 2^f from a minimax fit through 2^0 and 2^1, so whole powers of
+        // two come out exact
+        float p = 1.0f + f * (0.693032121f + f * (0.241379763f + f * (0.0520323690f + f * 0.0135557472f)));
+        return std::bit_cast<float>(std::bit_cast<int32_t>(p) + (i << 23));
+    }
+
+    struct PassData {
+        size_t width, height;
+        size_t step;
+        const float* in[3];
+        float* out[3];
+        const float* normal[3];
+        const float* albedo[3];
+        const float* depth;
+        float invColor[3];
+        float invNormal, invAlbedo, invDepth;
+    };
+
+    // One tap of the 5x5 kernel applied along a row: the center pixels p
+    // and the pixels q they are compared with
+    struct TapRows {
+        float weight;
+        const float* p[3];
+        const float* q[3];
+        const float* pn[3];
+        const float* qn[3];
+        const float* pa[3];
+        const float* qa[3];
+        const float* pz;
+        const float* qz;
+        const float* depthScale;
+        float invColor[3];
+        float invNormal, invAlbedo;
+    };
+
+    // Add one tap's contribution to columns [begin, end) of the sums.  A
+    // function of its own so the sums can be __restrict; otherwise GCC
+    // needs more alias checks than it will emit and leaves the loop scalar.
+    template <int Guides>
+    void accumulateTap(const TapRows& t, long begin, long end, float* __restrict sr,
+                       float* __restrict sg, float* __restrict sb, float* __restrict sw) {
+        const float *pr = t.p[0], *pg = t.p[1], *pb = t.p[2];
+        const float *qr = t.q[0], *qg = t.q[1], *qb = t.q[2];
+        for (long i = begin; i < end; ++i) {
+            float cr = pr[i] - qr[i], cg = pg[i] - qg[i], cb = pb[i] - qb[i];
+            float e = cr * cr * t.invColor[0] + cg * cg * t.invColor[1] + cb * cb * t.invColor[2];
+            if constexpr ((Guides & UseNormal) != 0) {
+                float nx = t.pn[0][i] - t.qn[0][i], ny = t.pn[1][i] - t.qn[1][i], nz = t.pn[2][i] - t.qn[2][i];
+                e += (nx * nx + ny * ny + nz * nz) * t.invNormal;
+            }
+            if constexpr ((Guides & UseAlbedo) != 0) {
+                float ar = t.pa[0][i] - t.qa[0][i], ag = t.pa[1][i] - t.qa[1][i], ab = t.pa[2][i] - t.qa[2][i];
+                e += (ar * ar + ag * ag + ab * ab) * t.invAlbedo;
+            }
+            if constexpr ((Guides & UseDepth) != 0) {
+                float dz = fastmath::detail::clamp(t.pz[i], -kMaxDepth, kMaxDepth) -
+                           fastmath::detail::clamp(t.qz[i], -kMaxDepth, kMaxDepth);
+                e += dz * dz * t.depthScale[i];
+            }
+            float w = t.weight * expNegative(-e);
+            sr[i] += w * qr[i];
+            sg[i] += w * qg[i];
+            sb[i] += w * qb[i];
+            sw[i] += w;
+        }
+    }
+
+    // One a-trous pass over a tile.  Guides is a compile-time mask so
+    // the inner loop carries no branches.
+    template <int Guides>
+    void filterTile(const PassData& d, const Tile& tile) {
+        static const float h[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+        const size_t tw = tile.width();
+        const long step = static_cast<long>(d.step);
+        const long width = static_cast<long>(d.width);
+        const long height = static_cast<long>(d.height);
+
+        float sum[3][kTileSize], sumW[kTileSize], depthScale[kTileSize];
+
+        for (size_t y = tile.y0; y < tile.y1; ++y) {
+            const size_t row = y * d.width + tile.x0;
+            for (auto& s : sum) std::fill(s, s + tw, 0.0f);
+            std::fill(sumW, sumW + tw, 0.0f);
+            if constexpr ((Guides & UseDepth) != 0) {
+                for (size_t i = 0; i < tw; ++i) {
+                    float z = fastmath::detail::clamp(d.depth[row + i], -kMaxDepth, kMaxDepth);
+                    depthScale[i] = d.invDepth / (z * z + 1e-12f);
+                }
+            }
+
+            for (long dy = -2; dy <= 2; ++dy) {
+                long qy = static_cast<long>(y) + dy * step;
+                if (qy < 0 || qy >= height) continue;
+                for (long dx = -2; dx <= 2; ++dx) {
+                    const long offset = dx * step;
+                    // Columns of the tile whose tap lands inside the image
+                    long begin = std::max(0L, -offset - static_cast<long>(tile.x0));
+                    long end = std::min(static_cast<long>(tw), width - offset - static_cast<long>(tile.x0));
+                    if (begin >= end) continue;
+
+                    const size_t q0 = static_cast<size_t>(qy) * d.width + tile.x0 + offset;
+                    TapRows t;
+                    t.weight = h[dy + 2] * h[dx + 2];
+                    for (size_t c = 0; c < 3; ++c) {
+                        t.p[c] = d.in[c] + row;
+                        t.q[c] = d.in[c] + q0;
+                        t.invColor[c] = d.invColor[c];
+                        if constexpr ((Guides & UseNormal) != 0) {
+                            t.pn[c] = d.normal[c] + row;
+                            t.qn[c] = d.normal[c] + q0;
+                        }
+                        if constexpr ((Guides & UseAlbedo) != 0) {
+                            t.pa[c] = d.albedo[c] + row;
+                            t.qa[c] = d.albedo[c] + q0;
+                        }
+                    }
+                    if constexpr ((Guides & UseDepth) != 0) {
+                        t.pz = d.depth + row;
+                        t.qz = d.depth + q0;
+                        t.depthScale = depthScale;
+                    }
+                    t.invNormal = d.invNormal;
+                    t.invAlbedo = d.invAlbedo;
+                    accumulateTap<Guides>(t, begin, end, sum[0], sum[1], sum[2], sumW);
+                }
+            }
+
+            // The center tap always has weight, so sumW is never zero
+            for (int c = 0; c < 3; ++c) {
+                float* out = d.out[c] + row;
+                for (size_t i = 0; i < tw; ++i) out[i] = sum[c][i] / sumW[i];
+            }
+        }
+    }
+
+    // Standard deviation of the noise in a plane, from the median
+    // difference of horizontal neighbours on every other row.  The median
+    // ignores the few differences that straddle edges.
+    float estimateNoise(const std::vector<float>& plane, size_t width, size_t height, std::vector<float>& scratch) {
+        scratch.clear();
+        for (size_t y = 0; y < height; y += 2) {
+            const float* row = plane.data() + y * width;
+            for (size_t x = 0; x + 1 < width; ++x) scratch.push_back(std::fabs(row[x + 1] - row[x]));
+        }
+        if (scratch.empty()) return 0.0f;
+        auto middle = scratch.begin() + scratch.size() / 2;
+        std::nth_element(scratch.begin(), middle, scratch.end());
+        // For Gaussian noise the median |difference| is 0.954 sigma
+        return *middle / 0.954f;
+    }
+
+    using TileFilter = void (*)(const PassData&, const Tile&);
+
+    TileFilter selectFilter(int guides) {
+        static const TileFilter filters[8] = {
+            filterTile<0>, filterTile<1>, filterTile<2>, filterTile<3>,
+            filterTile<4>, filterTile<5>, filterTile<6>, filterTile<7>,
+        };
+        return filters[guides];
+    }
+
+    // Index of a guide layer of the given type, or -1 if there is none
+    long findGuide(const AOVBuffer& guides, const char* name, AOVBuffer::Type type) {
+        if (!guides.hasLayer(name)) return -1;
+        size_t layer = guides.getLayerIndex(name);
+        if (guides.getLayerType(layer) != type) {
+            throw std::invalid_argument(std::string("Denoiser: guide layer '") + name + "' has the wrong type");
+        }
+        return static_cast<long>(layer);
+    }
+}
+
+DenoiseOptions DenoiseOptions::fromPreset(Preset preset) {
+    DenoiseOptions options;
+    switch (preset) {
+    case Preset::Fast:
+        options.iterations = 3;
+        options.sigmaColor = 5.0f;
+        break;
+    case Preset::Balanced:
+        break;
+    case Preset::Quality:
+        // Tighter edge stopping over a wider footprint
+        options.iterations = 6;
+        options.sigmaColor = 3.0f;
+        options.sigmaNormal = 0.2f;
+        options.sigmaDepth = 0.03f;
+        break;
+    }
+    return options;
+}
+
+DenoiseOptions::Preset DenoiseOptions::presetFromName(const std::string& name) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (lower == "fast") return Preset::Fast;
+    if (lower == "balanced") return Preset::Balanced;
+    if (lower == "quality") return Preset::Quality;
+    throw std::invalid_argument("Unknown denoise preset '" + name + "'");
+}
+
+DenoiseOptions DenoiseOptions::fromArgs(const sivelab::GraphicsArgs& args) {
+    DenoiseOptions options = fromPreset(args.denoisePreset.empty() ? Preset::Balanced : presetFromName(args.denoisePreset));
+    options.numThreads = static_cast<size_t>(std::max(args.numCpus, 1));
+    return options;
+}
+
+Denoiser::Denoiser(const DenoiseOptions& options)
+    : options(options) {
+    if (options.sigmaColor <= 0.0f || options.sigmaNormal <= 0.0f ||
+        options.sigmaAlbedo <= 0.0f || options.sigmaDepth <= 0.0f) {
+        throw std::invalid_argument("Denoiser: edge-stopping widths must be positive");
+    }
+}
+
+void Denoiser::denoise(const FrameBuffer& color, FrameBuffer& out) {
+    run(color, nullptr, out);
+}
+
+void Denoiser::denoise(const FrameBuffer& color, const AOVBuffer& guides, FrameBuffer& out) {
+    if (guides.getWidth() != color.getWidth() || guides.getHeight() != color.getHeight()) {
+        throw std::invalid_argument("Denoiser: guide layers must be the size of the image");
+    }
+    run(color, &guides, out);
+}
+
+void Denoiser::run(const FrameBuffer& color, const AOVBuffer* guides, FrameBuffer& out) {
+    const size_t width = color.getWidth(), height = color.getHeight();
+    const size_t n = width * height;
+
+    PassData d{};
+    d.width = width;
+    d.height = height;
+    int mask = 0;
+    if (guides) {
+        long normal = findGuide(*guides, "normal", AOVBuffer::Type::Vec3);
+        long albedo = findGuide(*guides, "albedo", AOVBuffer::Type::Vec3);
+        long depth = findGuide(*guides, "depth", AOVBuffer::Type::Float);
+        for (size_t c = 0; c < 3; ++c) {
+            if (normal >= 0) d.normal[c] = guides->getPlane(size_t(normal), c);
+            if (albedo >= 0) d.albedo[c] = guides->getPlane(size_t(albedo), c);
+        }
+        if (depth >= 0) d.depth = guides->getPlane(size_t(depth));
+        mask = (normal >= 0 ? UseNormal : 0) | (albedo >= 0 ? UseAlbedo : 0) | (depth >= 0 ? UseDepth : 0);
+    }
+    const bool demodulate = options.demodulateAlbedo && (mask & UseAlbedo);
+
+    // Split into planes, dividing out the albedo if asked
+    for (auto& buffer : planes) {
+        for (auto& plane : buffer) plane.resize(n);
+    }
+    std::vector<vec3> row(width);
+    for (size_t y = 0; y < height; ++y) {
+        color.copyRow(y, row.data());
+        for (size_t x = 0; x < width; ++x) {
+            size_t i = y * width + x;
+            for (size_t c = 0; c < 3; ++c) {
+                float v = row[x][c];
+                planes[0][c][i] = demodulate ? v / (d.albedo[c][i] + kAlbedoEpsilon) : v;
+            }
+        }
+    }
+
+    // Color differences are measured against the noise of each channel
+    float noise[3];
+    std::vector<float> scratch;
+    for (size_t c = 0; c < 3; ++c) {
+        noise[c] = std::max(estimateNoise(planes[0][c], width, height, scratch), 1e-6f);
+    }
+
+    TileScheduler scheduler(options.numThreads, kTileSize);
+    TileFilter filter = selectFilter(mask);
+    size_t current = 0;
+    for (size_t pass = 0; pass < options.iterations; ++pass) {
+        d.step = size_t(1) << pass;
+        for (size_t c = 0; c < 3; ++c) {
+            float sigma = options.sigmaColor * noise[c] / static_cast<float>(d.step);
+            d.invColor[c] = 1.0f / (sigma * sigma);
+        }
+        d.invNormal = 1.0f / (options.sigmaNormal * options.sigmaNormal);
+        d.invAlbedo = 1.0f / (options.sigmaAlbedo * options.sigmaAlbedo);
+        d.invDepth = 1.0f / (options.sigmaDepth * options.sigmaDepth);
+        for (size_t c = 0; c < 3; ++c) {
+            d.in[c] = planes[current][c].data();
+            d.out[c] = planes[1 - current][c].data();
+        }
+        scheduler.run(width, height, [&](const Tile& tile) { filter(d, tile); });
+        current = 1 - current;
+    }
+
+    if (out.getWidth() != width || out.getHeight() != height) {
+        out = FrameBuffer(width, height, color.getLayout());
+    }
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            size_t i = y * width + x;
+            for (size_t c = 0; c < 3; ++c) {
+                float v = planes[current][c][i];
+                row[x][c] = demodulate ? v * (d.albedo[c][i] + kAlbedoEpsilon) : v;
+            }
+        }
+        out.setRow(y, row.data());
+    }
+}
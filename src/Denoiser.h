@@ -0,0 +1,78 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "AOVBuffer.h"
+#include "FrameBuffer.h"
+
+namespace sivelab {
+    class GraphicsArgs;
+}
+
+struct DenoiseOptions {
+    enum class Preset { Fast, Balanced, Quality };
+
+    // A-trous passes; pass i samples a 5x5 grid with a spacing of 2^i
+    // pixels, so the footprint doubles every pass
+    size_t iterations = 5;
+
+    // Edge-stopping widths.  The color width is in multiples of the
+    // noise level, which is estimated from the image per channel, and
+    // halves every pass so later, wider passes only smooth what is
+    // already nearly flat.  Depth is relative to the center pixel's depth.
+    float sigmaColor = 4.0f;
+    float sigmaNormal = 0.3f;
+    float sigmaAlbedo = 0.1f;
+    float sigmaDepth = 0.05f;
+
+    // Divide by albedo before filtering and multiply it back after, so
+    // texture detail is not blurred along with the noise
+    bool demodulateAlbedo = true;
+
+    // Worker threads; 0 uses all hardware threads
+    size_t numThreads = 0;
+
+    static DenoiseOptions fromPreset(Preset preset);
+
+    // "fast", "balanced" or "quality"; throws std::invalid_argument
+    static Preset presetFromName(const std::string& name);
+
+    // The --denoise preset, with threads from --numcpus
+    static DenoiseOptions fromArgs(const sivelab::GraphicsArgs& args);
+};
+
+// Edge-avoiding a-trous wavelet denoiser (after Dammertz et al.,
+// "Edge-Avoiding A-Trous Wavelet Transform for fast Global Illumination
+// Filtering", HPG 2010).  Each pass is a B3-spline blur whose weights
+// drop off across changes of color and of the guide layers, so noise is
+// smoothed within surfaces while edges stay sharp.
+//
+// Guides come from AOVBuffer layers named "normal" (Vec3), "albedo"
+// (Vec3) and "depth" (Float); any that are missing are not used.  The
+// work runs on planar copies of the data, one contiguous row at a time
+// so the weight computation vectorizes, and tiles are spread over a
+// TileScheduler.  The full-size scratch planes are kept between calls,
+// so successive frames of a progressive render reuse them.
+class Denoiser {
+public:
+    explicit Denoiser(const DenoiseOptions& options = DenoiseOptions());
+
+    const DenoiseOptions& getOptions() const { return options; }
+
+    // Denoise color into out, which may be color itself.  out is resized
+    // as needed and keeps color's layout.  Guides must match in size.
+    void denoise(const FrameBuffer& color, FrameBuffer& out);
+    void denoise(const FrameBuffer& color, const AOVBuffer& guides, FrameBuffer& out);
+
+private:
+    void run(const FrameBuffer& color, const AOVBuffer* guides, FrameBuffer& out);
+
+    DenoiseOptions options;
+
+    // Planar color, ping-ponged between passes
+    std::vector<float> planes[2][3];
+};
+
+#endif // DENOISER_H
@@ -0,0 +1,286 @@
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "vec.h"
+#include "vec_packet.h"
+
+// Approximate float math in three accuracy tiers:
+//
+//   Precise  the standard library, for reference and for code that must
+//            match it
+//   Fast     close to full float precision
+//   Fastest  3-4 significant digits, for weights, falloffs and the like
+//
+// Worst errors measured by utest_FastMath over the ranges given there
+// (relative unless marked otherwise):
+//
+//              Fast        Fastest
+//   rsqrt      5e-6        2e-3
+//   exp        3e-7        6e-5
+//   log        2e-7        7e-5      absolute where |ln x| < 1
+//   pow        3e-6        4e-4      x in [0.01, 100], |y| <= 4
+//   sin, cos   3e-7        2e-4      absolute
+//
+// Fast and Fastest are branch-free float and integer arithmetic, so loops
+// calling them vectorize where std::exp and friends do not (see
+// expNegative in Denoiser.cpp for the same idea).  The packet overloads
+// run that scalar code across the lanes of a packet<float, W>.
+//
+// Domains: log and pow need positive normal x; exp saturates below -87
+// (to about 1.6e-38) and above 88 (to about 1.65e38); sin and cos hold
+// their accuracy for |x| up to about 1e4.
+namespace fastmath {
+    enum class Accuracy { Precise, Fast, Fastest };
+
+    namespace detail {
+        // Nearest integer for |x| < 2^22, by pushing the fraction bits out
+        // of a float and back
+        inline float roundNearest(float x) {
+            const float shift = 12582912.0f;  // 1.5 * 2^23
+            return (x + shift) - shift;
+        }
+
+        // x clamped to [lo, hi] for lo < 0 <= hi.  Compares the bit patterns
+        // as integers, which order the same way as the floats: float
+        // compares may trap, and under GCC's default -ftrapping-math a
+        // select on one keeps the loop around it from vectorizing
+        inline float clamp(float x, float lo, float hi) {
+            uint32_t bits = std::bit_cast<uint32_t>(x);
+            uint32_t loBits = std::bit_cast<uint32_t>(lo);
+            bits = bits > loBits ? loBits : bits;
+            int32_t signedBits = std::bit_cast<int32_t>(bits);
+            int32_t hiBits = std::bit_cast<int32_t>(hi);
+            return std::bit_cast<float>(signedBits > hiBits ? hiBits : signedBits);
+        }
+
+        // 2^n for integral n in [-126, 127]
+        inline float exp2Integer(float n) {
+            return std::bit_cast<float>((static_cast<int32_t>(n) + 127) << 23);
+        }
+
+        // Every lane through the scalar kernel f; a fixed-length loop over
+        // aligned lanes, which the compiler vectorizes
+        template <size_t W, typename F>
+        inline packet<float, W> lanewise(const packet<float, W>& x, F f) {
+            alignas(packet<float, W>) float lanes[W];
+            x.store(lanes);
+            for (size_t i = 0; i < W; ++i) lanes[i] = f(lanes[i]);
+            return packet<float, W>::load(lanes);
+        }
+    }
+
+    // 1 / sqrt(x): a bit-level first guess and one (Fastest) or two (Fast)
+    // Newton steps
+    template <Accuracy A = Accuracy::Fast>
+    inline float rsqrt(float x) {
+        if constexpr (A == Accuracy::Precise) {
+            return 1.0f / std::sqrt(x);
+        } else {
+            float y = std::bit_cast<float>(0x5f375a86 - (std::bit_cast<int32_t>(x) >> 1));
+            y = y * (1.5f - 0.5f * x * y * y);
+            if constexpr (A == Accuracy::Fast) {
+                y = y * (1.5f - 0.5f * x * y * y);
+            }
+            return y;
+        }
+    }
+
+    // e^x = 2^n e^r with |r| <= ln(2)/2, e^r from its Taylor series
+    template <Accuracy A = Accuracy::Fast>
+    inline float exp(float x) {
+        if constexpr (A == Accuracy::Precise) {
+            return std::exp(x);
+        } else {
+            x = detail::clamp(x, -87.0f, 88.0f);
+            float n = detail::roundNearest(x * 1.44269504f);
+            // ln(2) in two parts so n * ln(2) is exact
+            float r = (x - n * 0.693145752f) - n * 1.42860677e-6f;
+            float p;
+            if constexpr (A == Accuracy::Fast) {
+                p = 1.0f + r * (1.0f + r * (0.5f + r * (1.0f / 6 + r * (1.0f / 24 + r * (1.0f / 120 + r * (1.0f / 720))))));
+            } else {
+                p = 1.0f + r * (1.0f + r * (0.5f + r * (1.0f / 6 + r * (1.0f / 24))));
+            }
+            return p * detail::exp2Integer(n);
+        }
+    }
+
+    // ln(x) = e ln(2) + ln(m) with m in [sqrt(1/2), sqrt(2)), ln(m) from
+    // the series 2 atanh(s), s = (m - 1) / (m + 1)
+    template <Accuracy A = Accuracy::Fast>
+    inline float log(float x) {
+        if constexpr (A == Accuracy::Precise) {
+            return std::log(x);
+        } else {
+            // Offsetting the bits by those of sqrt(1/2) carries mantissas
+            // of sqrt(2) and up into the exponent, leaving m in range
+            const int32_t sqrtHalf = 0x3f3504f3;
+            int32_t bits = std::bit_cast<int32_t>(x) + (0x3f800000 - sqrtHalf);
+            float e = static_cast<float>((bits >> 23) - 127);
+            float m = std::bit_cast<float>((bits & 0x007fffff) + sqrtHalf);
+
+            float s = (m - 1.0f) / (m + 1.0f);
+            float s2 = s * s;
+            float series;
+            if constexpr (A == Accuracy::Fast) {
+                series = 1.0f + s2 * (1.0f / 3 + s2 * (1.0f / 5 + s2 * (1.0f / 7)));
+            } else {
+                series = 1.0f + s2 * (1.0f / 3);
+            }
+            return e * 0.693145752f + (2.0f * s * series + e * 1.42860677e-6f);
+        }
+    }
+
+    template <Accuracy A = Accuracy::Fast>
+    inline float pow(float x, float y) {
+        if constexpr (A == Accuracy::Precise) {
+            return std::pow(x, y);
+        } else {
+            return exp<A>(y * log<A>(x));
+        }
+    }
+
+    // sin(x) = (-1)^k sin(y) and cos(x) = (-1)^k cos(y) with x = y + k pi,
+    // |y| <= pi/2, both from their Taylor series
+    template <Accuracy A = Accuracy::Fast>
+    inline void sincos(float x, float& s, float& c) {
+        if constexpr (A == Accuracy::Precise) {
+            s = std::sin(x);
+            c = std::cos(x);
+        } else {
+            float k = detail::roundNearest(x * 0.318309886f);
+            // pi in three parts so k * pi is exact for moderate k
+            float y = ((x - k * 3.140625f) - k * 9.67502593994140625e-4f) - k * 1.509957990978376432e-7f;
+            float y2 = y * y;
+            if constexpr (A == Accuracy::Fast) {
+                s = y + y * y2 * (-1.0f / 6 + y2 * (1.0f / 120 + y2 * (-1.0f / 5040 + y2 * (1.0f / 362880 + y2 * (-1.0f / 39916800)))));
+                c = 1.0f + y2 * (-0.5f + y2 * (1.0f / 24 + y2 * (-1.0f / 720 + y2 * (1.0f / 40320 + y2 * (-1.0f / 3628800 + y2 * (1.0f / 479001600))))));
+            } else {
+                s = y + y * y2 * (-1.0f / 6 + y2 * (1.0f / 120 + y2 * (-1.0f / 5040)));
+                c = 1.0f + y2 * (-0.5f + y2 * (1.0f / 24 + y2 * (-1.0f / 720 + y2 * (1.0f / 40320))));
+            }
+            // d is 0 for even k and +-1 for odd k
+            float d = k - 2.0f * detail::roundNearest(0.5f * k);
+            float sign = 1.0f - 2.0f * d * d;
+            s *= sign;
+            c *= sign;
+        }
+    }
+
+    template <Accuracy A = Accuracy::Fast>
+    inline float sin(float x) {
+        float s, c;
+        sincos<A>(x, s, c);
+        return s;
+    }
+
+    template <Accuracy A = Accuracy::Fast>
+    inline float cos(float x) {
+        float s, c;
+        sincos<A>(x, s, c);
+        return c;
+    }
+
+    namespace detail {
+        // First guess at 1 / sqrt(x) across a packet, to 2e-3 or better:
+        // the hardware estimate where the packet is one register, else
+        // the Fastest scalar kernel lane by lane
+        template <size_t W>
+        inline packet<float, W> rsqrtEstimate(const packet<float, W>& x) {
+            return lanewise(x, [](float v) { return rsqrt<Accuracy::Fastest>(v); });
+        }
+
+#if defined(VEC_SSE2)
+        template <>
+        inline packet<float, 4> rsqrtEstimate(const packet<float, 4>& x) {
+            packet<float, 4> y;
+            y.r = _mm_rsqrt_ps(x.r);
+            return y;
+        }
+#endif
+
+#if !defined(VEC_NO_SIMD) && defined(__AVX2__)
+        template <>
+        inline packet<float, 8> rsqrtEstimate(const packet<float, 8>& x) {
+            packet<float, 8> y;
+            y.r = _mm256_rsqrt_ps(x.r);
+            return y;
+        }
+#endif
+
+#if !defined(VEC_NO_SIMD) && defined(__AVX512F__)
+        template <>
+        inline packet<float, 16> rsqrtEstimate(const packet<float, 16>& x) {
+            packet<float, 16> y;
+            y.r = _mm512_rsqrt14_ps(x.r);
+            return y;
+        }
+#endif
+    }
+
+    // Packet versions.  rsqrt stays in registers, so its lanes can differ
+    // from the scalar kernel's within the same bounds; the rest run the
+    // scalar kernels lane by lane and match them exactly.
+    template <Accuracy A = Accuracy::Fast, size_t W>
+    inline packet<float, W> rsqrt(const packet<float, W>& x) {
+        if constexpr (A == Accuracy::Precise) {
+            return packet<float, W>(1.0f) / sqrt(x);
+        } else {
+            packet<float, W> y = detail::rsqrtEstimate(x);
+            if constexpr (A == Accuracy::Fast) {
+                y = y * (packet<float, W>(1.5f) - packet<float, W>(0.5f) * x * y * y);
+            }
+            return y;
+        }
+    }
+
+    template <Accuracy A = Accuracy::Fast, size_t W>
+    inline packet<float, W> exp(const packet<float, W>& x) {
+        return detail::lanewise(x, [](float v) { return exp<A>(v); });
+    }
+
+    template <Accuracy A = Accuracy::Fast, size_t W>
+    inline packet<float, W> log(const packet<float, W>& x) {
+        return detail::lanewise(x, [](float v) { return log<A>(v); });
+    }
+
+    template <Accuracy A = Accuracy::Fast, size_t W>
+    inline packet<float, W> pow(const packet<float, W>& x, const packet<float, W>& y) {
+        return exp<A>(y * log<A>(x));
+    }
+
+    template <Accuracy A = Accuracy::Fast, size_t W>
+    inline packet<float, W> sin(const packet<float, W>& x) {
+        return detail::lanewise(x, [](float v) { return sin<A>(v); });
+    }
+
+    template <Accuracy A = Accuracy::Fast, size_t W>
+    inline packet<float, W> cos(const packet<float, W>& x) {
+        return detail::lanewise(x, [](float v) { return cos<A>(v); });
+    }
+
+    template <Accuracy A = Accuracy::Fast, size_t W>
+    inline void sincos(const packet<float, W>& x, packet<float, W>& s, packet<float, W>& c) {
+        alignas(packet<float, W>) float in[W], sines[W], cosines[W];
+        x.store(in);
+        for (size_t i = 0; i < W; ++i) sincos<A>(in[i], sines[i], cosines[i]);
+        s = packet<float, W>::load(sines);
+        c = packet<float, W>::load(cosines);
+    }
+
+    // Unit vectors through rsqrt; zero vectors stay zero as in
+    // vec_packet::normalized.  There is no overload for a single vec: one
+    // sqrtss and divide cost no more than the rsqrt steps there.
+    template <Accuracy A = Accuracy::Fast, size_t N, size_t W>
+    inline vec_packet<float, N, W> normalized(const vec_packet<float, N, W>& v) {
+        packet<float, W> lengthSquared = v.length_squared();
+        packet<float, W> inv = select(lengthSquared > packet<float, W>(0.0f), rsqrt<A>(lengthSquared), packet<float, W>(0.0f));
+        return v * inv;
+    }
+}
+
+#endif // FASTMATH_H
@@ -0,0 +1,159 @@
+#include "Film.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+    // Splat into a region [bx0, bx1) x [by0, by1) whose sums and weights
+    // are stored row by row
+    void splat(const PixelFilter& filter, float px, float py, const vec3& color,
+               size_t bx0, size_t by0, size_t bx1, size_t by1, vec3* sum, float* weight) {
+        const long r = filter.getPixelRadius();
+        const long cx = static_cast<long>(std::floor(px));
+        const long cy = static_cast<long>(std::floor(py));
+        const long xBegin = std::max(cx - r, static_cast<long>(bx0));
+        const long xEnd = std::min(cx + r + 1, static_cast<long>(bx1));
+        const long yBegin = std::max(cy - r, static_cast<long>(by0));
+        const long yEnd = std::min(cy + r + 1, static_cast<long>(by1));
+        if (xBegin >= xEnd || yBegin >= yEnd) return;
+
+        // Horizontal weights are the same for every row
+        std::array<float, 2 * Film::kMaxPixelRadius + 1> wx;
+        for (long x = xBegin; x < xEnd; ++x) {
+            wx[x - xBegin] = filter.weight1D(x + 0.5f - px);
+        }
+
+        const size_t stride = bx1 - bx0;
+        for (long y = yBegin; y < yEnd; ++y) {
+            float wy = filter.weight1D(y + 0.5f - py);
+            if (wy == 0.0f) continue;
+            size_t row = (y - by0) * stride - bx0;
+            for (long x = xBegin; x < xEnd; ++x) {
+                float w = wx[x - xBegin] * wy;
+                sum[row + x] += color * w;
+                weight[row + x] += w;
+            }
+        }
+    }
+}
+
+Film::FilmTile::FilmTile(const Tile& tile, const PixelFilter& filter, size_t imageWidth, size_t imageHeight)
+    : tile(tile), filter(filter) {
+    size_t r = static_cast<size_t>(filter.getPixelRadius());
+    x0 = tile.x0 - std::min(tile.x0, r);
+    y0 = tile.y0 - std::min(tile.y0, r);
+    x1 = std::min(tile.x1 + r, imageWidth);
+    y1 = std::min(tile.y1 + r, imageHeight);
+    sum.assign((x1 - x0) * (y1 - y0), vec3(0.0f, 0.0f, 0.0f));
+    weight.assign(sum.size(), 0.0f);
+}
+
+void Film::FilmTile::addSample(float px, float py, const vec3& color) {
+    splat(filter, px, py, color, x0, y0, x1, y1, sum.data(), weight.data());
+}
+
+void Film::FilmTile::clear() {
+    std::fill(sum.begin(), sum.end(), vec3(0.0f, 0.0f, 0.0f));
+    std::fill(weight.begin(), weight.end(), 0.0f);
+}
+
+Film::Film(size_t width, size_t height, const PixelFilter& filter)
+    : width(width), height(height), filter(filter),
+      sum(width * height, vec3(0.0f, 0.0f, 0.0f)), weight(width * height, 0.0f) {
+    if (filter.getPixelRadius() > kMaxPixelRadius) {
+        throw std::invalid_argument("Film: the pixel filter is too wide");
+    }
+}
+
+void Film::addSample(float px, float py, const vec3& color) {
+    splat(filter, px, py, color, 0, 0, width, height, sum.data(), weight.data());
+}
+
+void Film::merge(const FilmTile& filmTile) {
+    if (filmTile.x1 > width || filmTile.y1 > height) {
+        throw std::out_of_range("Film::merge: tile lies outside the film");
+    }
+
+    size_t w = filmTile.x1 - filmTile.x0;
+    for (size_t y = filmTile.y0; y < filmTile.y1; ++y) {
+        size_t src = (y - filmTile.y0) * w;
+        size_t dst = y * width + filmTile.x0;
+        for (size_t x = 0; x < w; ++x) {
+            sum[dst + x] += filmTile.sum[src + x];
+            weight[dst + x] += filmTile.weight[src + x];
+        }
+    }
+}
+
+void Film::renderPass(TileScheduler& scheduler, const Kernel& kernel) {
+    const size_t tileSize = scheduler.getTileSize();
+    if (2 * static_cast<size_t>(filter.getPixelRadius()) > tileSize) {
+        throw std::invalid_argument("Film::renderPass: tiles must be at least twice the filter's pixel radius");
+    }
+
+    if (passTileSize != tileSize || passTiles.empty()) {
+        std::vector<Tile> tiles = scheduler.makeTiles(width, height);
+        std::sort(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) { return a.index < b.index; });
+        passTiles.clear();
+        passTiles.reserve(tiles.size());
+        for (const Tile& tile : tiles) {
+            passTiles.push_back(makeTile(tile));
+        }
+        passTileSize = tileSize;
+    }
+
+    scheduler.run(width, height, [&](const Tile& tile) {
+        FilmTile& filmTile = passTiles[tile.index];
+        filmTile.clear();
+        kernel(filmTile);
+    });
+
+    // Tiles of the same column and row parity are at least one tile
+    // apart, which is more than two aprons
+    for (size_t phase = 0; phase < 4; ++phase) {
+        scheduler.run(width, height, [&](const Tile& tile) {
+            size_t tx = tile.x0 / tileSize, ty = tile.y0 / tileSize;
+            if ((tx & 1) + 2 * (ty & 1) == phase) {
+                merge(passTiles[tile.index]);
+            }
+        });
+    }
+}
+
+vec3 Film::getPixel(size_t x, size_t y) const {
+    size_t i = y * width + x;
+    if (weight[i] == 0.0f) {
+        return vec3(0.0f, 0.0f, 0.0f);
+    }
+    return sum[i] / weight[i];
+}
+
+void Film::clear() {
+    std::fill(sum.begin(), sum.end(), vec3(0.0f, 0.0f, 0.0f));
+    std::fill(weight.begin(), weight.end(), 0.0f);
+}
+
+void Film::resolve(FrameBuffer& fb) const {
+    if (fb.getWidth() != width || fb.getHeight() != height) {
+        throw std::invalid_argument("Film::resolve: frame buffer size does not match");
+    }
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            fb(x, y) = getPixel(x, y);
+        }
+    }
+}
+
+void Film::resolve(FrameBuffer& fb, TileScheduler& scheduler) const {
+    if (fb.getWidth() != width || fb.getHeight() != height) {
+        throw std::invalid_argument("Film::resolve: frame buffer size does not match");
+    }
+    scheduler.run(fb, [&](const Tile& tile) {
+        for (size_t y = tile.y0; y < tile.y1; ++y) {
+            for (size_t x = tile.x0; x < tile.x1; ++x) {
+                fb(x, y) = getPixel(x, y);
+            }
+        }
+    });
+}
@@ -0,0 +1,103 @@
+#ifndef FILM_H
+#define FILM_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "vec.h"
+#include "FrameBuffer.h"
+#include "PixelFilter.h"
+#include "TileScheduler.h"
+
+// Accumulates filtered samples.  Each sample is splatted into every
+// pixel its PixelFilter reaches, and a pixel resolves to the weighted
+// mean sum(w * color) / sum(w).  A box filter of radius 0.5 gives the
+// same result as an AccumulationBuffer; wider filters smooth noise
+// across pixels so fewer samples per pixel are needed.
+class Film {
+public:
+    // Largest filter reach supported, in pixels either side
+    static constexpr int kMaxPixelRadius = 8;
+
+    // Samples for one tile gathered privately by a single thread.  The
+    // tile carries an apron of the filter's pixel radius on every side
+    // (clipped to the image) for splats that cross its border.
+    class FilmTile {
+    public:
+        const Tile& getTile() const { return tile; }
+
+        // Splat a sample at continuous image position (px, py); pixel
+        // (x, y) covers [x, x + 1) x [y, y + 1).  The sample should lie
+        // inside the tile so its whole footprint lands in the apron.
+        void addSample(float px, float py, const vec3& color);
+
+        // Forget the gathered samples so the tile can be reused
+        void clear();
+
+    private:
+        friend class Film;
+        FilmTile(const Tile& tile, const PixelFilter& filter, size_t imageWidth, size_t imageHeight);
+
+        Tile tile;
+        PixelFilter filter;
+
+        // Apron bounds [x0, x1) x [y0, y1)
+        size_t x0, y0, x1, y1;
+        std::vector<vec3> sum;
+        std::vector<float> weight;
+    };
+
+    // Fills a FilmTile with the samples for its tile
+    using Kernel = std::function<void(FilmTile&)>;
+
+    // Throws std::invalid_argument for filters wider than kMaxPixelRadius
+    Film(size_t width, size_t height, const PixelFilter& filter = PixelFilter());
+
+    size_t getWidth() const { return width; }
+    size_t getHeight() const { return height; }
+    const PixelFilter& getFilter() const { return filter; }
+
+    // Splat one sample directly into the film
+    void addSample(float px, float py, const vec3& color);
+
+    FilmTile makeTile(const Tile& tile) const { return FilmTile(tile, filter, width, height); }
+
+    // Add a tile's splats to the film.  Tiles whose aprons overlap must
+    // not be merged at the same time.
+    void merge(const FilmTile& filmTile);
+
+    // One pass over the image: kernel runs for every tile of the
+    // scheduler in parallel, each into its own FilmTile, and the tiles
+    // are merged at the end.  The merge runs in four phases by tile
+    // column and row parity; within a phase no two aprons touch, so
+    // neighbours' borders are summed without locks or atomics.  Needs a
+    // filter pixel radius of at most half the tile size.  Tile buffers
+    // are kept for the next pass.
+    void renderPass(TileScheduler& scheduler, const Kernel& kernel);
+
+    vec3 getSum(size_t x, size_t y) const { return sum[y * width + x]; }
+    float getWeight(size_t x, size_t y) const { return weight[y * width + x]; }
+
+    // Filtered value of pixel (x, y), zero where no sample reached
+    vec3 getPixel(size_t x, size_t y) const;
+
+    void clear();
+
+    // Write every pixel into fb, which must have the same size
+    void resolve(FrameBuffer& fb) const;
+    void resolve(FrameBuffer& fb, TileScheduler& scheduler) const;
+
+private:
+    size_t width;
+    size_t height;
+    PixelFilter filter;
+
+    std::vector<vec3> sum;
+    std::vector<float> weight;
+
+    // Tiles of the last renderPass, by Tile::index
+    std::vector<FilmTile> passTiles;
+    size_t passTileSize = 0;
+};
+
+#endif // FILM_H
@@ -1,42 +1,313 @@
 #include "FrameBuffer.h"
+#include "PngEncoder.h"
+#include "TileScheduler.h"
 #include <algorithm>
+#include <cerrno>
 #include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
 
-FrameBuffer::FrameBuffer(size_t width, size_t height)
-    : width(width), height(height), data(width * height) {
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    size_t tileShiftFor(FrameBuffer::Layout layout) {
+        switch (layout) {
+        case FrameBuffer::Layout::Tiled8:  return 3;
+        case FrameBuffer::Layout::Tiled16: return 4;
+        case FrameBuffer::Layout::Morton:  return 6;
+        default:                           return 0;
+        }
+    }
+
+    size_t storageSize(size_t width, size_t height, size_t tileShift) {
+        size_t tileMask = (size_t(1) << tileShift) - 1;
+        size_t tilesX = (width + tileMask) >> tileShift;
+        size_t tilesY = (height + tileMask) >> tileShift;
+        return (tilesX * tilesY) << (2 * tileShift);
+    }
+
+    std::runtime_error systemError(const std::string& what) {
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
 }
 
-vec3& FrameBuffer::operator()(size_t x, size_t y) {
-    return data[y * width + x];
+// A shared, read-write mapping of a whole file
+struct FrameBuffer::Mapping {
+    int fd = -1;
+    void* address = nullptr;
+    size_t bytes = 0;
+
+#ifndef WIN32
+    Mapping(const std::string& filename, size_t bytes)
+        : bytes(bytes) {
+        fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throw systemError("Could not open " + filename);
+        }
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            ::close(fd);
+            throw systemError("Could not resize " + filename);
+        }
+        address = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            throw systemError("Could not map " + filename);
+        }
+    }
+
+    ~Mapping() {
+        ::munmap(address, bytes);
+        ::close(fd);
+    }
+
+    // Applies op to the whole pages spanning [begin, end) bytes
+    template<typename Op>
+    void forPages(size_t begin, size_t end, Op op) const {
+        static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t first = begin / pageSize * pageSize;
+        size_t last = std::min((end + pageSize - 1) / pageSize * pageSize, bytes);
+        op(static_cast<char*>(address) + first, last - first);
+    }
+#else
+    Mapping(const std::string&, size_t) {
+        throw std::runtime_error("Memory-mapped frame buffers are not supported on this platform");
+    }
+#endif
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+};
+
+FrameBuffer::FrameBuffer(size_t width, size_t height, Layout layout)
+    : width(width), height(height), layout(layout),
+      tileShift(tileShiftFor(layout)), tileMask((size_t(1) << tileShift) - 1),
+      tilesX((width + tileMask) >> tileShift) {
+    storage.resize(storageSize(width, height, tileShift));
+    pixels = storage.data();
+    pixelCount = storage.size();
 }
 
-const vec3& FrameBuffer::operator()(size_t x, size_t y) const {
-    return data[y * width + x];
+FrameBuffer::FrameBuffer(size_t width, size_t height, Layout layout, const std::string& backingFile)
+    : width(width), height(height), layout(layout),
+      tileShift(tileShiftFor(layout)), tileMask((size_t(1) << tileShift) - 1),
+      tilesX((width + tileMask) >> tileShift) {
+    pixelCount = storageSize(width, height, tileShift);
+    if (pixelCount == 0) {
+        throw std::invalid_argument("FrameBuffer: cannot map an empty image");
+    }
+    mapping = std::make_unique<Mapping>(backingFile, pixelCount * sizeof(vec3));
+    pixels = static_cast<vec3*>(mapping->address);
+}
+
+FrameBuffer::FrameBuffer(const FrameBuffer& other)
+    : width(other.width), height(other.height), layout(other.layout),
+      tileShift(other.tileShift), tileMask(other.tileMask), tilesX(other.tilesX),
+      storage(other.pixels, other.pixels + other.pixelCount),
+      pixels(storage.data()), pixelCount(storage.size()) {
+}
+
+FrameBuffer::FrameBuffer(FrameBuffer&& other) noexcept
+    : width(other.width), height(other.height), layout(other.layout),
+      tileShift(other.tileShift), tileMask(other.tileMask), tilesX(other.tilesX),
+      storage(std::move(other.storage)), mapping(std::move(other.mapping)),
+      pixels(other.pixels), pixelCount(other.pixelCount) {
+    other.pixels = nullptr;
+    other.pixelCount = 0;
+}
+
+FrameBuffer& FrameBuffer::operator=(const FrameBuffer& other) {
+    if (this != &other) {
+        *this = FrameBuffer(other);
+    }
+    return *this;
+}
+
+FrameBuffer& FrameBuffer::operator=(FrameBuffer&& other) noexcept {
+    width = other.width;
+    height = other.height;
+    layout = other.layout;
+    tileShift = other.tileShift;
+    tileMask = other.tileMask;
+    tilesX = other.tilesX;
+    storage = std::move(other.storage);
+    mapping = std::move(other.mapping);
+    pixels = other.pixels;
+    pixelCount = other.pixelCount;
+    other.pixels = nullptr;
+    other.pixelCount = 0;
+    return *this;
 }
 
+FrameBuffer::~FrameBuffer() = default;
+
 void FrameBuffer::setBackground(const vec3& color) {
-    std::fill(data.begin(), data.end(), color);
+    std::fill_n(pixels, pixelCount, color);
+}
+
+void FrameBuffer::forEachStorageRange(const Tile& tile, const std::function<void(size_t, size_t)>& fn) const {
+    if (tile.width() == 0 || tile.height() == 0) {
+        return;
+    }
+
+    // Merge ranges that touch so each contiguous run is reported once
+    size_t runBegin = 0, runEnd = 0;
+    auto add = [&](size_t begin, size_t end) {
+        if (runEnd != runBegin && begin == runEnd) {
+            runEnd = end;
+            return;
+        }
+        if (runEnd != runBegin) fn(runBegin, runEnd);
+        runBegin = begin;
+        runEnd = end;
+    };
+
+    if (layout == Layout::RowMajor) {
+        for (size_t y = tile.y0; y < tile.y1; ++y) {
+            add(y * width + tile.x0, y * width + tile.x1);
+        }
+    } else {
+        // Every storage block overlapping the tile is contiguous
+        size_t blockSize = size_t(1) << (2 * tileShift);
+        for (size_t by = tile.y0 >> tileShift; by <= (tile.y1 - 1) >> tileShift; ++by) {
+            for (size_t bx = tile.x0 >> tileShift; bx <= (tile.x1 - 1) >> tileShift; ++bx) {
+                size_t block = by * tilesX + bx;
+                add(block * blockSize, (block + 1) * blockSize);
+            }
+        }
+    }
+    fn(runBegin, runEnd);
+}
+
+// Pages shared with neighbouring tiles may be included too.  That is
+// harmless: the mapping is shared, so dropped pages keep their contents
+// in the page cache and are simply faulted back in when next touched.
+void FrameBuffer::adviseTile(const Tile& tile) const {
+#ifndef WIN32
+    if (!mapping) {
+        return;
+    }
+    forEachStorageRange(tile, [&](size_t begin, size_t end) {
+        mapping->forPages(begin * sizeof(vec3), end * sizeof(vec3), [](void* address, size_t length) {
+            ::madvise(address, length, MADV_WILLNEED);
+        });
+    });
+#else
+    (void)tile;
+#endif
+}
+
+void FrameBuffer::flushTile(const Tile& tile) const {
+#ifndef WIN32
+    if (!mapping) {
+        return;
+    }
+    forEachStorageRange(tile, [&](size_t begin, size_t end) {
+        mapping->forPages(begin * sizeof(vec3), end * sizeof(vec3), [](void* address, size_t length) {
+            if (::msync(address, length, MS_SYNC) != 0) {
+                throw systemError("Could not flush frame buffer tile");
+            }
+            ::madvise(address, length, MADV_DONTNEED);
+        });
+    });
+#else
+    (void)tile;
+#endif
+}
+
+void FrameBuffer::sync() const {
+#ifndef WIN32
+    if (mapping && ::msync(mapping->address, mapping->bytes, MS_SYNC) != 0) {
+        throw systemError("Could not flush frame buffer");
+    }
+#endif
 }
 
 void FrameBuffer::setPixel(size_t x, size_t y, const vec3& color) {
     (*this)(x, y) = color;
 }
 
-void FrameBuffer::writeToPng(const std::string& filename) const {
-    png::image<png::rgb_pixel> image(width, height);
-    
-    for (size_t y = 0; y < height; ++y) {
+const vec3* FrameBuffer::getRow(size_t y, std::vector<vec3>& scratch) const {
+    if (layout == Layout::RowMajor) {
+        return &pixels[y * width];
+    }
+    scratch.resize(width);
+    copyRow(y, scratch.data());
+    return scratch.data();
+}
+
+void FrameBuffer::copyRow(size_t y, vec3* dst) const {
+    if (layout == Layout::RowMajor) {
+        std::copy_n(&pixels[y * width], width, dst);
+    } else if (layout == Layout::Morton) {
         for (size_t x = 0; x < width; ++x) {
-            const vec3& color = (*this)(x, y);
-            
-            // Convert from float [0,1] to byte [0,255]
-            png::byte r = static_cast<png::byte>(std::clamp(color[0] * 255.0f, 0.0f, 255.0f));
-            png::byte g = static_cast<png::byte>(std::clamp(color[1] * 255.0f, 0.0f, 255.0f));
-            png::byte b = static_cast<png::byte>(std::clamp(color[2] * 255.0f, 0.0f, 255.0f));
-            
-            image[y][x] = png::rgb_pixel(r, g, b);
-        }
-    }
-    
-    image.write(filename);
-}
\ No newline at end of file
+            dst[x] = pixels[index(x, y)];
+        }
+    } else {
+        // Each tile contributes one contiguous run to the row
+        size_t tileSize = tileMask + 1;
+        for (size_t x = 0; x < width; x += tileSize) {
+            std::copy_n(&pixels[index(x, y)], std::min(tileSize, width - x), dst + x);
+        }
+    }
+}
+
+void FrameBuffer::setRow(size_t y, const vec3* src) {
+    if (layout == Layout::RowMajor) {
+        std::copy_n(src, width, &pixels[y * width]);
+    } else if (layout == Layout::Morton) {
+        for (size_t x = 0; x < width; ++x) {
+            pixels[index(x, y)] = src[x];
+        }
+    } else {
+        size_t tileSize = tileMask + 1;
+        for (size_t x = 0; x < width; x += tileSize) {
+            std::copy_n(src + x, std::min(tileSize, width - x), &pixels[index(x, y)]);
+        }
+    }
+}
+
+RowSource FrameBuffer::getRowSource() const {
+    return [this](size_t y, std::vector<vec3>& scratch) {
+        return getRow(y, scratch);
+    };
+}
+
+FrameBuffer::const_iterator::const_iterator(const FrameBuffer* fb, size_t x, size_t y)
+    : fb(fb), px(x), py(y), ptr(y < fb->height ? &fb->pixels[fb->index(x, y)] : nullptr) {
+}
+
+FrameBuffer::const_iterator& FrameBuffer::const_iterator::operator++() {
+    if (++px == fb->width) {
+        px = 0;
+        ++py;
+        ptr = (py < fb->height) ? &fb->pixels[fb->index(0, py)] : nullptr;
+    } else if (fb->layout == Layout::RowMajor ||
+               (fb->layout != Layout::Morton && (px & fb->tileMask) != 0)) {
+        // Still inside a contiguous run of storage
+        ++ptr;
+    } else {
+        ptr = &fb->pixels[fb->index(px, py)];
+    }
+    return *this;
+}
+
+void FrameBuffer::writeToPng(const std::string& filename, const EncodeOptions& options) const {
+    // Stream the rows straight from the float data
+    writePngRows(filename, width, height, getRowSource(), options);
+}
+
+void FrameBuffer::writeToPng(std::ostream& out, const EncodeOptions& options) const {
+    writePngRows(out, width, height, getRowSource(), options);
+}
+
+std::vector<uint8_t> FrameBuffer::encodePng(const EncodeOptions& options) const {
+    std::ostringstream out(std::ios::binary);
+    writeToPng(out, options);
+    const std::string& bytes = out.str();
+    return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
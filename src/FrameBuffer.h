@@ -1,39 +1,171 @@
 #ifndef FRAMEBUFFER_H
 #define FRAMEBUFFER_H
 
+#include <cstddef>
+#include <functional>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <span>
 #include <vector>
 #include <string>
 #include "vec.h"
+#include "PixelEncode.h"
 #include "png++/png.hpp"
 
+// Supplies row y of an image in row-major order.  The returned pointer
+// may point into the caller's own storage or into scratch, which the
+// source may resize and fill.
+using RowSource = std::function<const vec3*(size_t y, std::vector<vec3>& scratch)>;
+
+struct Tile;
+
 class FrameBuffer {
 public:
-    FrameBuffer(size_t width, size_t height);
-    ~FrameBuffer() = default;
+    // Pixel storage layouts.  RowMajor is plain scanline order.  Tiled8
+    // and Tiled16 keep each 8x8 or 16x16 block of pixels contiguous, and
+    // Morton stores 64x64 blocks whose pixels are in Z-order.  The tiled
+    // layouts pad the image up to a whole number of blocks.
+    enum class Layout { RowMajor, Tiled8, Tiled16, Morton };
+
+    FrameBuffer(size_t width, size_t height, Layout layout = Layout::RowMajor);
+
+    // Keep the pixels in a memory-mapped file rather than on the heap, so
+    // images larger than RAM are paged in and out as they are touched.
+    // The file is created or resized to fit and any existing contents
+    // are kept.  POSIX only.
+    FrameBuffer(size_t width, size_t height, Layout layout, const std::string& backingFile);
+
+    // Copies always live on the heap, even when other is mapped
+    FrameBuffer(const FrameBuffer& other);
+    FrameBuffer(FrameBuffer&& other) noexcept;
+    FrameBuffer& operator=(const FrameBuffer& other);
+    FrameBuffer& operator=(FrameBuffer&& other) noexcept;
+    ~FrameBuffer();
 
     // Access pixel at (x, y)
-    vec3& operator()(size_t x, size_t y);
-    const vec3& operator()(size_t x, size_t y) const;
+    vec3& operator()(size_t x, size_t y) { return pixels[index(x, y)]; }
+    const vec3& operator()(size_t x, size_t y) const { return pixels[index(x, y)]; }
 
     // Get dimensions
     size_t getWidth() const { return width; }
     size_t getHeight() const { return height; }
+    Layout getLayout() const { return layout; }
+    bool isMapped() const { return mapping != nullptr; }
+
+    // Paging hints for mapped buffers; they do nothing on the heap.
+    // adviseTile asks the OS to read in the storage under a tile before
+    // it is rendered.  flushTile writes the tile back to the file and
+    // drops its pages once it is done.  Tiled layouts keep each tile in
+    // few pages, so these are much cheaper there than for RowMajor.
+    void adviseTile(const Tile& tile) const;
+    void flushTile(const Tile& tile) const;
+
+    // Write all modified pages of a mapped buffer back to its file
+    void sync() const;
+
+    // Index of pixel (x, y) within the storage returned by getData()
+    size_t index(size_t x, size_t y) const;
 
     // Set all pixels to a background color
     void setBackground(const vec3& color);
 
     void setPixel(size_t x, size_t y, const vec3 &color);
 
+    // Row-major access independent of the storage layout.  getRow
+    // returns a pointer straight into storage when rows are contiguous
+    // and otherwise gathers the row into scratch.
+    const vec3* getRow(size_t y, std::vector<vec3>& scratch) const;
+    void copyRow(size_t y, vec3* dst) const;
+    void setRow(size_t y, const vec3* src);
+
+    // The rows of this frame buffer as a RowSource for the image writers
+    RowSource getRowSource() const;
+
     // Write the frame buffer to a PNG file
-    void writeToPng(const std::string& filename) const;
+    void writeToPng(const std::string& filename, const EncodeOptions& options = EncodeOptions()) const;
+
+    // Encode as PNG straight into a stream (e.g. std::cout) or memory
+    void writeToPng(std::ostream& out, const EncodeOptions& options = EncodeOptions()) const;
+    std::vector<uint8_t> encodePng(const EncodeOptions& options = EncodeOptions()) const;
+
+    // Get raw data in storage order (row-major only for Layout::RowMajor)
+    std::span<const vec3> getData() const { return std::span<const vec3>(pixels, pixelCount); }
+
+    // Iterates the pixels in row-major order whatever the layout
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = vec3;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const vec3*;
+        using reference = const vec3&;
 
-    // Get raw data (for writing to PNG later)
-    const std::vector<vec3>& getData() const { return data; }
+        const_iterator() = default;
+        const_iterator(const FrameBuffer* fb, size_t x, size_t y);
+
+        reference operator*() const { return *ptr; }
+        pointer operator->() const { return ptr; }
+
+        const_iterator& operator++();
+        const_iterator operator++(int) { const_iterator tmp = *this; ++(*this); return tmp; }
+
+        bool operator==(const const_iterator& other) const { return px == other.px && py == other.py; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+        size_t x() const { return px; }
+        size_t y() const { return py; }
+
+    private:
+        const FrameBuffer* fb = nullptr;
+        size_t px = 0, py = 0;
+        const vec3* ptr = nullptr;
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0, 0); }
+    const_iterator end() const { return const_iterator(this, 0, height); }
 
 private:
+    // Spreads the low 6 bits of v so they occupy the even bit positions
+    static size_t spreadBits(size_t v) {
+        v = (v | (v << 4)) & 0x0F0F;
+        v = (v | (v << 2)) & 0x3333;
+        v = (v | (v << 1)) & 0x5555;
+        return v;
+    }
+
+    // Calls fn with the [begin, end) storage index ranges under a tile
+    void forEachStorageRange(const Tile& tile, const std::function<void(size_t, size_t)>& fn) const;
+
     size_t width;
     size_t height;
-    std::vector<vec3> data;
+    Layout layout;
+
+    // Tile geometry for the blocked layouts (unused for RowMajor)
+    size_t tileShift;
+    size_t tileMask;
+    size_t tilesX;
+
+    // Pixels live either in storage or in a file mapping
+    struct Mapping;
+    std::vector<vec3> storage;
+    std::unique_ptr<Mapping> mapping;
+    vec3* pixels = nullptr;
+    size_t pixelCount = 0;
 };
 
-#endif // FRAMEBUFFER_H
\ No newline at end of file
+inline size_t FrameBuffer::index(size_t x, size_t y) const {
+    if (layout == Layout::RowMajor) {
+        return y * width + x;
+    }
+
+    size_t tile = (y >> tileShift) * tilesX + (x >> tileShift);
+    size_t lx = x & tileMask;
+    size_t ly = y & tileMask;
+    size_t local = (layout == Layout::Morton) ? (spreadBits(lx) | (spreadBits(ly) << 1))
+                                              : ((ly << tileShift) | lx);
+    return (tile << (2 * tileShift)) | local;
+}
+
+#endif // FRAMEBUFFER_H
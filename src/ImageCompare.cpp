@@ -0,0 +1,324 @@
+#include "ImageCompare.h"
+#include "TileScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMAGECOMPARE_SSE2 1
+#endif
+
+namespace {
+    // SSIM window: 11 taps of a Gaussian with sigma 1.5
+    const int kRadius = 5;
+    const size_t kTaps = 2 * kRadius + 1;
+
+    std::array<float, kTaps> gaussianWindow() {
+        std::array<float, kTaps> w;
+        float total = 0.0f;
+        for (int i = -kRadius; i <= kRadius; ++i) {
+            w[i + kRadius] = std::exp(-(i * i) / (2.0f * 1.5f * 1.5f));
+            total += w[i + kRadius];
+        }
+        for (auto& v : w) v /= total;
+        return w;
+    }
+
+    float luminance(const vec3& c) {
+        return 0.2126f * c[0] + 0.7152f * c[1] + 0.0722f * c[2];
+    }
+
+    // Pixels [x0, x0 + n) of row y, straight from storage for row-major
+    // buffers and gathered otherwise
+    const vec3* rowSpan(const FrameBuffer& fb, size_t x0, size_t y, size_t n, std::vector<vec3>& scratch) {
+        if (fb.getLayout() == FrameBuffer::Layout::RowMajor) {
+            return fb.getData().data() + fb.index(x0, y);
+        }
+        scratch.resize(n);
+        for (size_t i = 0; i < n; ++i) scratch[i] = fb(x0 + i, y);
+        return scratch.data();
+    }
+
+    // Adds the per-channel squared differences of n pixels to sum and
+    // raises maxError to the largest absolute difference
+    void squaredError(const vec3* a, const vec3* b, size_t n, float sum[3], float& maxError) {
+        const float* fa = reinterpret_cast<const float*>(a);
+        const float* fb = reinterpret_cast<const float*>(b);
+        size_t i = 0;
+
+#if defined(IMAGECOMPARE_SSE2)
+        // Four pixels are three registers whose lanes hold the channels
+        // rgbr, gbrg and brgb; the lanes are sorted out at the end
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps();
+        __m128 peak = _mm_setzero_ps();
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        for (; i + 4 <= n; i += 4) {
+            const float* pa = fa + 3 * i;
+            const float* pb = fb + 3 * i;
+            __m128 d0 = _mm_sub_ps(_mm_loadu_ps(pa), _mm_loadu_ps(pb));
+            __m128 d1 = _mm_sub_ps(_mm_loadu_ps(pa + 4), _mm_loadu_ps(pb + 4));
+            __m128 d2 = _mm_sub_ps(_mm_loadu_ps(pa + 8), _mm_loadu_ps(pb + 8));
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(d2, d2));
+            peak = _mm_max_ps(peak, _mm_and_ps(d0, absMask));
+            peak = _mm_max_ps(peak, _mm_and_ps(d1, absMask));
+            peak = _mm_max_ps(peak, _mm_and_ps(d2, absMask));
+        }
+        alignas(16) float l0[4], l1[4], l2[4], lp[4];
+        _mm_store_ps(l0, acc0);
+        _mm_store_ps(l1, acc1);
+        _mm_store_ps(l2, acc2);
+        _mm_store_ps(lp, peak);
+        sum[0] += l0[0] + l0[3] + l1[2] + l2[1];
+        sum[1] += l0[1] + l1[0] + l1[3] + l2[2];
+        sum[2] += l0[2] + l1[1] + l2[0] + l2[3];
+        maxError = std::max({ maxError, lp[0], lp[1], lp[2], lp[3] });
+#endif
+
+        for (; i < n; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                float d = fa[3 * i + c] - fb[3 * i + c];
+                sum[c] += d * d;
+                maxError = std::max(maxError, std::fabs(d));
+            }
+        }
+    }
+
+    struct TileError {
+        double sum[3] = { 0.0, 0.0, 0.0 };
+        double ssimSum = 0.0;
+        float maxError = 0.0f;
+    };
+
+    void tileMse(const FrameBuffer& a, const FrameBuffer& b, const Tile& tile, TileError& result) {
+        std::vector<vec3> scratchA, scratchB;
+        for (size_t y = tile.y0; y < tile.y1; ++y) {
+            const vec3* ra = rowSpan(a, tile.x0, y, tile.width(), scratchA);
+            const vec3* rb = rowSpan(b, tile.x0, y, tile.width(), scratchB);
+            float rowSum[3] = { 0.0f, 0.0f, 0.0f };
+            squaredError(ra, rb, tile.width(), rowSum, result.maxError);
+            // Rows are summed in float, the tile in double
+            for (int c = 0; c < 3; ++c) result.sum[c] += rowSum[c];
+        }
+    }
+
+    // SSIM of the luminance over one tile.  The tile is read with a
+    // border of the window radius, clamped at the image edges, and the
+    // Gaussian is applied as separate horizontal and vertical passes
+    // whose inner loops run along contiguous rows so they vectorize.
+    void tileSsim(const FrameBuffer& a, const FrameBuffer& b, const Tile& tile, float peak, TileError& result) {
+        static const std::array<float, kTaps> window = gaussianWindow();
+        const float c1 = (0.01f * peak) * (0.01f * peak);
+        const float c2 = (0.03f * peak) * (0.03f * peak);
+
+        const size_t tw = tile.width(), th = tile.height();
+        const size_t ew = tw + 2 * kRadius, eh = th + 2 * kRadius;
+        const long maxY = static_cast<long>(a.getHeight()) - 1;
+
+        // Luminance, its squares and product over the bordered tile.
+        // Rows are read once from storage; columns past the image edge
+        // repeat the edge pixel.
+        enum { A, B, AA, BB, AB, NumPlanes };
+        std::vector<float> lum[NumPlanes];
+        for (auto& p : lum) p.resize(ew * eh);
+        const size_t left = std::min<size_t>(tile.x0, kRadius);
+        const size_t readX0 = tile.x0 - left;
+        const size_t readCount = std::min(tile.x1 + kRadius, a.getWidth()) - readX0;
+        std::vector<vec3> scratchA, scratchB;
+        for (size_t j = 0; j < eh; ++j) {
+            size_t y = static_cast<size_t>(std::clamp(static_cast<long>(tile.y0 + j) - kRadius, 0L, maxY));
+            const vec3* ra = rowSpan(a, readX0, y, readCount, scratchA);
+            const vec3* rb = rowSpan(b, readX0, y, readCount, scratchB);
+            float* la = lum[A].data() + j * ew;
+            float* lb = lum[B].data() + j * ew;
+            float* dstA = la + (kRadius - left);
+            float* dstB = lb + (kRadius - left);
+            for (size_t i = 0; i < readCount; ++i) {
+                dstA[i] = luminance(ra[i]);
+                dstB[i] = luminance(rb[i]);
+            }
+            std::fill(la, dstA, dstA[0]);
+            std::fill(lb, dstB, dstB[0]);
+            std::fill(dstA + readCount, la + ew, dstA[readCount - 1]);
+            std::fill(dstB + readCount, lb + ew, dstB[readCount - 1]);
+        }
+        for (size_t k = 0; k < ew * eh; ++k) {
+            float va = lum[A][k], vb = lum[B][k];
+            lum[AA][k] = va * va;
+            lum[BB][k] = vb * vb;
+            lum[AB][k] = va * vb;
+        }
+
+        // Horizontal pass: eh rows of tw.  The taps are a fixed count so
+        // the compiler unrolls them and vectorizes across the row.
+        std::vector<float> horiz[NumPlanes];
+        for (int p = 0; p < NumPlanes; ++p) {
+            horiz[p].resize(tw * eh);
+            for (size_t j = 0; j < eh; ++j) {
+                const float* src = lum[p].data() + j * ew;
+                float* dst = horiz[p].data() + j * tw;
+                for (size_t i = 0; i < tw; ++i) {
+                    float v = 0.0f;
+                    for (size_t k = 0; k < kTaps; ++k) v += window[k] * src[i + k];
+                    dst[i] = v;
+                }
+            }
+        }
+
+        // Vertical pass one output row at a time, then SSIM per pixel
+        std::vector<float> mean[NumPlanes];
+        for (auto& m : mean) m.resize(tw);
+        double total = 0.0;
+        for (size_t j = 0; j < th; ++j) {
+            for (int p = 0; p < NumPlanes; ++p) {
+                const float* src = horiz[p].data() + j * tw;
+                float* dst = mean[p].data();
+                for (size_t i = 0; i < tw; ++i) {
+                    float v = 0.0f;
+                    for (size_t k = 0; k < kTaps; ++k) v += window[k] * src[i + k * tw];
+                    dst[i] = v;
+                }
+            }
+            float rowTotal = 0.0f;
+            for (size_t i = 0; i < tw; ++i) {
+                float ma = mean[A][i], mb = mean[B][i];
+                float varA = mean[AA][i] - ma * ma;
+                float varB = mean[BB][i] - mb * mb;
+                float cov = mean[AB][i] - ma * mb;
+                rowTotal += ((2.0f * ma * mb + c1) * (2.0f * cov + c2)) /
+                            ((ma * ma + mb * mb + c1) * (varA + varB + c2));
+            }
+            total += rowTotal;
+        }
+        result.ssimSum = total;
+    }
+
+    // Same black-red-yellow-white ramp as the adaptive sampler heat map
+    vec3 heat(float t) {
+        return vec3(std::clamp(3.0f * t, 0.0f, 1.0f),
+                    std::clamp(3.0f * t - 1.0f, 0.0f, 1.0f),
+                    std::clamp(3.0f * t - 2.0f, 0.0f, 1.0f));
+    }
+}
+
+size_t CompareResult::getWorstTile() const {
+    if (tileMse.empty()) {
+        throw std::logic_error("CompareResult: no tiles");
+    }
+    return static_cast<size_t>(std::max_element(tileMse.begin(), tileMse.end()) - tileMse.begin());
+}
+
+FrameBuffer CompareResult::makeErrorMap(bool ssim) const {
+    std::vector<float> error(tileMse.size());
+    for (size_t i = 0; i < error.size(); ++i) {
+        error[i] = ssim ? 1.0f - tileSsim[i] : tileMse[i];
+    }
+    float lo = error.empty() ? 0.0f : *std::min_element(error.begin(), error.end());
+    float hi = error.empty() ? 0.0f : *std::max_element(error.begin(), error.end());
+    float range = (hi > lo) ? hi - lo : 1.0f;
+
+    FrameBuffer fb(width, height);
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            fb(x, y) = heat((error[(y / tileSize) * tilesX + x / tileSize] - lo) / range);
+        }
+    }
+    return fb;
+}
+
+CompareResult compareImages(const FrameBuffer& reference, const FrameBuffer& test, const CompareOptions& options) {
+    if (reference.getWidth() != test.getWidth() || reference.getHeight() != test.getHeight()) {
+        throw std::invalid_argument("compareImages: images must be the same size");
+    }
+    if (reference.getWidth() == 0 || reference.getHeight() == 0) {
+        throw std::invalid_argument("compareImages: images must not be empty");
+    }
+    if (options.tileSize == 0) {
+        throw std::invalid_argument("compareImages: tile size must be positive");
+    }
+
+    CompareResult result;
+    result.width = reference.getWidth();
+    result.height = reference.getHeight();
+    result.tileSize = options.tileSize;
+    result.tilesX = (result.width + options.tileSize - 1) / options.tileSize;
+    result.tilesY = (result.height + options.tileSize - 1) / options.tileSize;
+
+    // Every tile writes only its own slot, so no locking is needed
+    std::vector<TileError> tiles(result.tilesX * result.tilesY);
+    TileScheduler scheduler(options.numThreads, options.tileSize);
+    scheduler.run(result.width, result.height, [&](const Tile& tile) {
+        TileError& error = tiles[tile.index];
+        tileMse(reference, test, tile, error);
+        if (options.computeSsim) {
+            tileSsim(reference, test, tile, options.peak, error);
+        }
+    });
+
+    result.tileMse.resize(tiles.size());
+    result.tileSsim.resize(tiles.size());
+    double ssimSum = 0.0;
+    for (size_t t = 0; t < tiles.size(); ++t) {
+        const TileError& error = tiles[t];
+        size_t tx = t % result.tilesX, ty = t / result.tilesX;
+        size_t pixels = (std::min(result.width, (tx + 1) * options.tileSize) - tx * options.tileSize) *
+                        (std::min(result.height, (ty + 1) * options.tileSize) - ty * options.tileSize);
+
+        for (int c = 0; c < 3; ++c) result.channelMse[c] += error.sum[c];
+        result.tileMse[t] = static_cast<float>((error.sum[0] + error.sum[1] + error.sum[2]) / (3.0 * pixels));
+        result.tileSsim[t] = options.computeSsim ? static_cast<float>(error.ssimSum / pixels) : 1.0f;
+        result.maxError = std::max(result.maxError, error.maxError);
+        ssimSum += error.ssimSum;
+    }
+
+    double pixelCount = double(result.width) * double(result.height);
+    if (pixelCount > 0) {
+        for (auto& m : result.channelMse) m /= pixelCount;
+        result.mse = (result.channelMse[0] + result.channelMse[1] + result.channelMse[2]) / 3.0;
+        result.ssim = options.computeSsim ? ssimSum / pixelCount : 1.0;
+    }
+    result.psnr = (result.mse > 0.0)
+        ? 10.0 * std::log10(double(options.peak) * options.peak / result.mse)
+        : std::numeric_limits<double>::infinity();
+    return result;
+}
+
+FrameBuffer makeDifferenceImage(const FrameBuffer& reference, const FrameBuffer& test, float scale) {
+    if (reference.getWidth() != test.getWidth() || reference.getHeight() != test.getHeight()) {
+        throw std::invalid_argument("makeDifferenceImage: images must be the same size");
+    }
+    FrameBuffer fb(reference.getWidth(), reference.getHeight());
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) {
+            const vec3& a = reference(x, y);
+            const vec3& b = test(x, y);
+            fb(x, y) = vec3(std::fabs(a[0] - b[0]) * scale, std::fabs(a[1] - b[1]) * scale,
+                            std::fabs(a[2] - b[2]) * scale);
+        }
+    }
+    return fb;
+}
+
+ConvergenceLog::ConvergenceLog(const FrameBuffer& reference, const CompareOptions& options)
+    : reference(reference), options(options) {
+}
+
+const ConvergenceLog::Point& ConvergenceLog::record(const FrameBuffer& image, double seconds, uint64_t samples) {
+    CompareResult result = compareImages(reference, image, options);
+    points.push_back(Point{ seconds, samples, result.mse, result.psnr, result.ssim });
+    return points.back();
+}
+
+void ConvergenceLog::writeCSV(std::ostream& out) const {
+    out << "seconds,samples,mse,psnr,ssim\n";
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision(9);
+    for (const Point& p : points) {
+        out << p.seconds << ',' << p.samples << ',' << p.mse << ',' << p.psnr << ',' << p.ssim << '\n';
+    }
+    out.precision(precision);
+    out.flags(flags);
+}
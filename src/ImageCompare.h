@@ -0,0 +1,100 @@
+#ifndef IMAGECOMPARE_H
+#define IMAGECOMPARE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "vec.h"
+#include "FrameBuffer.h"
+
+struct CompareOptions {
+    // Side of the square tiles the error maps are reported in, which are
+    // also the units of work for the thread pool
+    size_t tileSize = 32;
+
+    // Worker threads; 0 uses all hardware threads
+    size_t numThreads = 0;
+
+    // Largest signal value, used for PSNR and the SSIM constants
+    float peak = 1.0f;
+
+    // SSIM costs several times more than MSE; turn it off for quick
+    // checks such as convergence logging
+    bool computeSsim = true;
+};
+
+// Image differences between a reference and a test image
+struct CompareResult {
+    size_t width = 0;
+    size_t height = 0;
+
+    // Mean squared error over all pixels and channels, and per channel
+    double mse = 0.0;
+    std::array<double, 3> channelMse = { 0.0, 0.0, 0.0 };
+
+    // Peak signal to noise ratio in dB; infinite for identical images
+    double psnr = 0.0;
+
+    // Mean structural similarity of the luminance, using the usual
+    // 11x11 Gaussian window (sigma 1.5).  1 for identical images.
+    double ssim = 1.0;
+
+    // Largest absolute difference of any channel
+    float maxError = 0.0f;
+
+    // Per-tile MSE and SSIM in scanline order, tilesX x tilesY
+    size_t tileSize = 0;
+    size_t tilesX = 0;
+    size_t tilesY = 0;
+    std::vector<float> tileMse;
+    std::vector<float> tileSsim;
+
+    // Index of the tile with the largest MSE.  compareImages always
+    // makes at least one tile; throws std::logic_error if there is none.
+    size_t getWorstTile() const;
+
+    // Image-sized heat map of the tiles, black for the lowest error and
+    // white for the highest.  Uses 1 - SSIM when ssim is set.
+    FrameBuffer makeErrorMap(bool ssim = false) const;
+};
+
+// Compare two images of the same size in any layouts.  Squared errors
+// use SSE2 where available, and tiles are spread over a TileScheduler.
+// Throws std::invalid_argument when the sizes differ or are empty.
+CompareResult compareImages(const FrameBuffer& reference, const FrameBuffer& test,
+                            const CompareOptions& options = CompareOptions());
+
+// |reference - test| * scale for every pixel
+FrameBuffer makeDifferenceImage(const FrameBuffer& reference, const FrameBuffer& test, float scale = 1.0f);
+
+// Error against a fixed reference over the course of a render, for
+// plotting convergence curves of samplers
+class ConvergenceLog {
+public:
+    struct Point {
+        double seconds;
+        uint64_t samples;
+        double mse;
+        double psnr;
+        double ssim;
+    };
+
+    explicit ConvergenceLog(const FrameBuffer& reference, const CompareOptions& options = CompareOptions());
+
+    // Compare image against the reference and add a point to the curve
+    const Point& record(const FrameBuffer& image, double seconds, uint64_t samples = 0);
+
+    const std::vector<Point>& getPoints() const { return points; }
+
+    // One line per point: seconds,samples,mse,psnr,ssim
+    void writeCSV(std::ostream& out) const;
+
+private:
+    FrameBuffer reference;
+    CompareOptions options;
+    std::vector<Point> points;
+};
+
+#endif // IMAGECOMPARE_H
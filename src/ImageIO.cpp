@@ -0,0 +1,760 @@
+#include "ImageIO.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "png++/png.hpp"
+#include "PngEncoder.h"
+
+namespace {
+    // ----------------------------------------------------------------
+    // Little-endian helpers
+    // ----------------------------------------------------------------
+    void putLE32(std::ostream& out, uint32_t v) {
+        char b[4] = { char(v), char(v >> 8), char(v >> 16), char(v >> 24) };
+        out.write(b, 4);
+    }
+
+    void putLE64(std::ostream& out, uint64_t v) {
+        putLE32(out, static_cast<uint32_t>(v));
+        putLE32(out, static_cast<uint32_t>(v >> 32));
+    }
+
+    void putFloatLE(std::ostream& out, float f) {
+        putLE32(out, std::bit_cast<uint32_t>(f));
+    }
+
+    uint32_t byteSwap32(uint32_t v) {
+        return (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+    }
+
+    uint32_t getLE32(std::istream& in) {
+        unsigned char b[4];
+        if (!in.read(reinterpret_cast<char*>(b), 4)) {
+            throw std::runtime_error("Unexpected end of image file");
+        }
+        return uint32_t(b[0]) | (uint32_t(b[1]) << 8) | (uint32_t(b[2]) << 16) | (uint32_t(b[3]) << 24);
+    }
+
+    uint64_t getLE64(std::istream& in) {
+        uint64_t lo = getLE32(in);
+        uint64_t hi = getLE32(in);
+        return lo | (hi << 32);
+    }
+
+    void readBytes(std::istream& in, char* dst, size_t n) {
+        if (!in.read(dst, static_cast<std::streamsize>(n))) {
+            throw std::runtime_error("Unexpected end of image file");
+        }
+    }
+
+    // Write n floats little-endian, straight from memory when the host
+    // byte order already matches
+    void writeFloatsLE(std::ostream& out, const float* src, size_t n, std::vector<char>& scratch) {
+        if constexpr (std::endian::native == std::endian::little) {
+            out.write(reinterpret_cast<const char*>(src), static_cast<std::streamsize>(n * sizeof(float)));
+        } else {
+            scratch.resize(n * 4);
+            for (size_t i = 0; i < n; ++i) {
+                uint32_t v = std::bit_cast<uint32_t>(src[i]);
+                for (int k = 0; k < 4; ++k) scratch[4 * i + k] = char(v >> (8 * k));
+            }
+            out.write(scratch.data(), static_cast<std::streamsize>(scratch.size()));
+        }
+    }
+
+    std::string readToken(std::istream& in) {
+        std::string token;
+        if (!(in >> token)) {
+            throw std::runtime_error("Malformed image header");
+        }
+        return token;
+    }
+
+    // ----------------------------------------------------------------
+    // Radiance RGBE helpers (after Greg Ward's rgbe.c)
+    // ----------------------------------------------------------------
+    void floatToRGBE(const vec3& c, unsigned char rgbe[4]) {
+        float v = std::max(c[0], std::max(c[1], c[2]));
+        if (!(v >= 1e-32f)) {
+            rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+            return;
+        }
+        int e;
+        float scale = std::frexp(v, &e) * 256.0f / v;
+        for (int k = 0; k < 3; ++k) {
+            rgbe[k] = static_cast<unsigned char>(std::max(c[k], 0.0f) * scale);
+        }
+        rgbe[3] = static_cast<unsigned char>(e + 128);
+    }
+
+    vec3 rgbeToFloat(const unsigned char rgbe[4]) {
+        if (rgbe[3] == 0) {
+            return vec3(0.0f, 0.0f, 0.0f);
+        }
+        float f = std::ldexp(1.0f, int(rgbe[3]) - (128 + 8));
+        return vec3(rgbe[0] * f, rgbe[1] * f, rgbe[2] * f);
+    }
+
+    void writeRLEBytes(std::ostream& out, const unsigned char* data, size_t n) {
+        const size_t minRun = 4;
+        size_t cur = 0;
+        while (cur < n) {
+            // Find the next run of at least minRun equal bytes
+            size_t begRun = cur;
+            size_t runCount = 0, oldRunCount = 0;
+            while (runCount < minRun && begRun < n) {
+                begRun += runCount;
+                oldRunCount = runCount;
+                runCount = 1;
+                while (begRun + runCount < n && runCount < 127 && data[begRun] == data[begRun + runCount]) {
+                    ++runCount;
+                }
+            }
+
+            // A short run right before it is still worth encoding as a run
+            if (oldRunCount > 1 && oldRunCount == begRun - cur) {
+                char buf[2] = { char(128 + oldRunCount), char(data[cur]) };
+                out.write(buf, 2);
+                cur = begRun;
+            }
+
+            while (cur < begRun) {
+                size_t literal = std::min<size_t>(begRun - cur, 128);
+                out.put(char(literal));
+                out.write(reinterpret_cast<const char*>(data + cur), static_cast<std::streamsize>(literal));
+                cur += literal;
+            }
+
+            if (runCount >= minRun) {
+                char buf[2] = { char(128 + runCount), char(data[begRun]) };
+                out.write(buf, 2);
+                cur += runCount;
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------
+    // OpenEXR helpers
+    // ----------------------------------------------------------------
+    const uint32_t kExrMagic = 20000630;
+    const uint32_t kExrPixelUInt = 0;
+    const uint32_t kExrPixelHalf = 1;
+    const uint32_t kExrPixelFloat = 2;
+
+    void putExrAttribute(std::ostream& out, const char* name, const char* type, const std::string& value) {
+        out.write(name, static_cast<std::streamsize>(std::strlen(name) + 1));
+        out.write(type, static_cast<std::streamsize>(std::strlen(type) + 1));
+        putLE32(out, static_cast<uint32_t>(value.size()));
+        out.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+    std::string exrBox(int32_t xMin, int32_t yMin, int32_t xMax, int32_t yMax) {
+        std::ostringstream s;
+        for (int32_t v : { xMin, yMin, xMax, yMax }) putLE32(s, static_cast<uint32_t>(v));
+        return s.str();
+    }
+
+    std::string exrFloat(float f) {
+        std::ostringstream s;
+        putFloatLE(s, f);
+        return s.str();
+    }
+
+    // OpenEXR's RLE: split even and odd bytes, delta-encode, then run
+    // length encode with signed counts
+    void exrRleCompress(const std::vector<char>& raw, std::vector<char>& tmp, std::vector<char>& out) {
+        size_t n = raw.size();
+        tmp.resize(n);
+        char* t1 = tmp.data();
+        char* t2 = tmp.data() + (n + 1) / 2;
+        for (size_t i = 0; i < n; ++i) {
+            if (i % 2 == 0) *t1++ = raw[i];
+            else *t2++ = raw[i];
+        }
+
+        unsigned char* t = reinterpret_cast<unsigned char*>(tmp.data());
+        int p = n > 0 ? t[0] : 0;
+        for (size_t i = 1; i < n; ++i) {
+            int d = int(t[i]) - p + (128 + 256);
+            p = t[i];
+            t[i] = static_cast<unsigned char>(d);
+        }
+
+        const int minRun = 3, maxRun = 127;
+        out.clear();
+        const char* in = tmp.data();
+        const char* inEnd = in + n;
+        const char* runStart = in;
+        const char* runEnd = in + 1;
+        while (runStart < inEnd) {
+            while (runEnd < inEnd && *runStart == *runEnd && runEnd - runStart - 1 < maxRun) ++runEnd;
+            if (runEnd - runStart >= minRun) {
+                out.push_back(char((runEnd - runStart) - 1));
+                out.push_back(*runStart);
+                runStart = runEnd;
+            } else {
+                while (runEnd < inEnd &&
+                       ((runEnd + 1 >= inEnd || *runEnd != *(runEnd + 1)) ||
+                        (runEnd + 2 >= inEnd || *(runEnd + 1) != *(runEnd + 2))) &&
+                       runEnd - runStart < maxRun) {
+                    ++runEnd;
+                }
+                out.push_back(char(runStart - runEnd));
+                while (runStart < runEnd) out.push_back(*runStart++);
+            }
+            ++runEnd;
+        }
+    }
+
+    void exrRleUncompress(const std::vector<char>& in, std::vector<char>& tmp, std::vector<char>& raw) {
+        size_t n = raw.size();
+        tmp.resize(n);
+        size_t pos = 0, written = 0;
+        while (pos < in.size()) {
+            int count = static_cast<signed char>(in[pos++]);
+            if (count < 0) {
+                size_t literal = static_cast<size_t>(-count);
+                if (pos + literal > in.size() || written + literal > n) throw std::runtime_error("Corrupt EXR RLE data");
+                std::memcpy(&tmp[written], &in[pos], literal);
+                pos += literal;
+                written += literal;
+            } else {
+                size_t run = static_cast<size_t>(count) + 1;
+                if (pos >= in.size() || written + run > n) throw std::runtime_error("Corrupt EXR RLE data");
+                std::memset(&tmp[written], in[pos++], run);
+                written += run;
+            }
+        }
+        if (written != n) throw std::runtime_error("Corrupt EXR RLE data");
+
+        unsigned char* t = reinterpret_cast<unsigned char*>(tmp.data());
+        for (size_t i = 1; i < n; ++i) {
+            t[i] = static_cast<unsigned char>(int(t[i - 1]) + int(t[i]) - 128);
+        }
+
+        const char* t1 = tmp.data();
+        const char* t2 = tmp.data() + (n + 1) / 2;
+        for (size_t i = 0; i < n; ++i) {
+            raw[i] = (i % 2 == 0) ? *t1++ : *t2++;
+        }
+    }
+
+    // ----------------------------------------------------------------
+    // Readers
+    // ----------------------------------------------------------------
+    class StreamReader : public ImageRowReader {
+    protected:
+        StreamReader(std::istream& in, std::unique_ptr<std::istream> owned)
+            : owned(std::move(owned)), in(in) {
+        }
+
+        std::unique_ptr<std::istream> owned;
+        std::istream& in;
+    };
+
+    class PfmReader : public StreamReader {
+    public:
+        PfmReader(std::istream& stream, std::unique_ptr<std::istream> owned)
+            : StreamReader(stream, std::move(owned)) {
+            std::string magic = readToken(in);
+            if (magic != "PF" && magic != "Pf") {
+                throw std::runtime_error("Not a PFM file");
+            }
+            channels = (magic == "PF") ? 3 : 1;
+            width = std::stoul(readToken(in));
+            height = std::stoul(readToken(in));
+            littleEndian = std::stof(readToken(in)) < 0.0f;
+            in.get();  // single whitespace before the raster
+            dataStart = in.tellg();
+            rowFloats.resize(width * channels);
+        }
+
+        void readRow(vec3* dst) override {
+            if (nextRow >= height) throw std::runtime_error("Read past the end of the PFM image");
+
+            // PFM stores the bottom row first
+            std::streamoff rowBytes = static_cast<std::streamoff>(width * channels * sizeof(float));
+            in.seekg(dataStart + static_cast<std::streamoff>(height - 1 - nextRow) * rowBytes);
+            readBytes(in, reinterpret_cast<char*>(rowFloats.data()), rowFloats.size() * sizeof(float));
+            if (littleEndian != (std::endian::native == std::endian::little)) {
+                for (auto& f : rowFloats) {
+                    f = std::bit_cast<float>(byteSwap32(std::bit_cast<uint32_t>(f)));
+                }
+            }
+
+            for (size_t x = 0; x < width; ++x) {
+                if (channels == 3) {
+                    dst[x] = vec3(rowFloats[3 * x], rowFloats[3 * x + 1], rowFloats[3 * x + 2]);
+                } else {
+                    dst[x] = vec3(rowFloats[x], rowFloats[x], rowFloats[x]);
+                }
+            }
+            ++nextRow;
+        }
+
+    private:
+        size_t channels = 3;
+        bool littleEndian = true;
+        std::streampos dataStart;
+        size_t nextRow = 0;
+        std::vector<float> rowFloats;
+    };
+
+    class HdrReader : public StreamReader {
+    public:
+        HdrReader(std::istream& stream, std::unique_ptr<std::istream> owned)
+            : StreamReader(stream, std::move(owned)) {
+            std::string line;
+            std::getline(in, line);
+            if (line.rfind("#?", 0) != 0) {
+                throw std::runtime_error("Not a Radiance HDR file");
+            }
+            while (std::getline(in, line) && !line.empty()) {
+                if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+                    throw std::runtime_error("Unsupported Radiance HDR format: " + line);
+                }
+            }
+
+            std::string ySign = readToken(in), yValue = readToken(in);
+            std::string xSign = readToken(in), xValue = readToken(in);
+            if (ySign != "-Y" || xSign != "+X") {
+                throw std::runtime_error("Unsupported Radiance HDR orientation");
+            }
+            height = std::stoul(yValue);
+            width = std::stoul(xValue);
+            in.get();  // newline ending the resolution string
+            scanline.resize(width * 4);
+        }
+
+        void readRow(vec3* dst) override {
+            unsigned char head[4];
+            readBytes(in, reinterpret_cast<char*>(head), 4);
+
+            bool rle = width >= 8 && width < 32768 && head[0] == 2 && head[1] == 2 && !(head[2] & 0x80);
+            if (!rle) {
+                std::memcpy(scanline.data(), head, 4);
+                if (width > 1) readBytes(in, reinterpret_cast<char*>(&scanline[4]), (width - 1) * 4);
+                for (size_t x = 0; x < width; ++x) dst[x] = rgbeToFloat(&scanline[4 * x]);
+                return;
+            }
+
+            if (((size_t(head[2]) << 8) | head[3]) != width) {
+                throw std::runtime_error("Radiance HDR scanline width mismatch");
+            }
+
+            // Each of the four components is run-length encoded separately
+            for (size_t c = 0; c < 4; ++c) {
+                size_t x = 0;
+                while (x < width) {
+                    int count = in.get();
+                    if (count == EOF) throw std::runtime_error("Unexpected end of image file");
+                    if (count > 128) {
+                        count -= 128;
+                        int value = in.get();
+                        if (value == EOF || x + count > width) throw std::runtime_error("Corrupt Radiance HDR data");
+                        for (int k = 0; k < count; ++k) scanline[4 * (x++) + c] = static_cast<unsigned char>(value);
+                    } else {
+                        if (count == 0 || x + count > width) throw std::runtime_error("Corrupt Radiance HDR data");
+                        for (int k = 0; k < count; ++k) {
+                            int value = in.get();
+                            if (value == EOF) throw std::runtime_error("Unexpected end of image file");
+                            scanline[4 * (x++) + c] = static_cast<unsigned char>(value);
+                        }
+                    }
+                }
+            }
+            for (size_t x = 0; x < width; ++x) dst[x] = rgbeToFloat(&scanline[4 * x]);
+        }
+
+    private:
+        std::vector<unsigned char> scanline;
+    };
+
+    class ExrReader : public StreamReader {
+    public:
+        ExrReader(std::istream& stream, std::unique_ptr<std::istream> owned)
+            : StreamReader(stream, std::move(owned)) {
+            if (getLE32(in) != kExrMagic) {
+                throw std::runtime_error("Not an OpenEXR file");
+            }
+            uint32_t version = getLE32(in);
+            if ((version & 0xFF) != 2 || (version & 0x200)) {
+                throw std::runtime_error("Only scanline OpenEXR files are supported");
+            }
+
+            bool haveWindow = false;
+            while (true) {
+                std::string name = readCString();
+                if (name.empty()) break;
+                std::string type = readCString();
+                uint32_t size = getLE32(in);
+                std::vector<char> value(size);
+                readBytes(in, value.data(), size);
+
+                if (name == "channels") {
+                    parseChannels(value);
+                } else if (name == "compression") {
+                    // char may be signed, so read the method as a byte
+                    unsigned char method = size < 1 ? 0xff : static_cast<unsigned char>(value[0]);
+                    if (method > 1) {
+                        throw std::runtime_error("Only uncompressed and RLE OpenEXR files are supported");
+                    }
+                    compression = method == 1 ? ExrCompression::RLE : ExrCompression::None;
+                } else if (name == "dataWindow") {
+                    dataWindow = parseBox(value);
+                    haveWindow = true;
+                } else if (name == "displayWindow") {
+                    displayWindow = parseBox(value);
+                    haveDisplay = true;
+                }
+            }
+            if (!haveWindow || channelOffset[0] < 0 || channelOffset[1] < 0 || channelOffset[2] < 0) {
+                throw std::runtime_error("OpenEXR file lacks a data window or R, G, B float channels");
+            }
+            if (dataWindow[2] < dataWindow[0] || dataWindow[3] < dataWindow[1]) {
+                throw std::runtime_error("OpenEXR file has an empty data window");
+            }
+            width = static_cast<size_t>(int64_t(dataWindow[2]) - dataWindow[0] + 1);
+            height = static_cast<size_t>(int64_t(dataWindow[3]) - dataWindow[1] + 1);
+
+            // A data window inside the display window is a crop; overscan
+            // and other layouts are read as plain images
+            if (haveDisplay && dataWindow[0] >= displayWindow[0] && dataWindow[1] >= displayWindow[1] &&
+                dataWindow[2] <= displayWindow[2] && dataWindow[3] <= displayWindow[3]) {
+                crop = CropWindow{ static_cast<size_t>(int64_t(dataWindow[0]) - displayWindow[0]),
+                                   static_cast<size_t>(int64_t(dataWindow[1]) - displayWindow[1]),
+                                   width, height,
+                                   static_cast<size_t>(int64_t(displayWindow[2]) - displayWindow[0] + 1),
+                                   static_cast<size_t>(int64_t(displayWindow[3]) - displayWindow[1] + 1) };
+            }
+
+            offsets.resize(height);
+            for (auto& o : offsets) o = getLE64(in);
+            raw.resize(width * pixelBytes);
+        }
+
+        void readRow(vec3* dst) override {
+            if (nextRow >= height) throw std::runtime_error("Read past the end of the OpenEXR image");
+
+            in.seekg(static_cast<std::streamoff>(offsets[nextRow]));
+            getLE32(in);  // y coordinate
+            uint32_t size = getLE32(in);
+            if (size == raw.size()) {
+                readBytes(in, raw.data(), size);
+            } else if (compression == ExrCompression::RLE) {
+                packed.resize(size);
+                readBytes(in, packed.data(), size);
+                exrRleUncompress(packed, tmp, raw);
+            } else {
+                throw std::runtime_error("OpenEXR scanline has an unexpected size");
+            }
+
+            // Channels are stored as consecutive planes of width values
+            for (size_t c = 0; c < 3; ++c) {
+                const char* plane = raw.data() + width * static_cast<size_t>(channelOffset[c]);
+                for (size_t x = 0; x < width; ++x) {
+                    uint32_t bits;
+                    std::memcpy(&bits, plane + 4 * x, 4);
+                    if constexpr (std::endian::native != std::endian::little) bits = byteSwap32(bits);
+                    dst[x][c] = std::bit_cast<float>(bits);
+                }
+            }
+            ++nextRow;
+        }
+
+    private:
+        // xMin, yMin, xMax, yMax
+        using Box = std::array<int32_t, 4>;
+
+        static Box parseBox(const std::vector<char>& value) {
+            std::istringstream box(std::string(value.begin(), value.end()));
+            Box b;
+            for (auto& v : b) v = static_cast<int32_t>(getLE32(box));
+            return b;
+        }
+
+        std::string readCString() {
+            std::string s;
+            if (!std::getline(in, s, '\0')) throw std::runtime_error("Unexpected end of image file");
+            return s;
+        }
+
+        void parseChannels(const std::vector<char>& value) {
+            size_t pos = 0;
+            size_t offset = 0;
+            while (pos < value.size() && value[pos] != '\0') {
+                std::string name(&value[pos]);
+                pos += name.size() + 1;
+                if (pos + 16 > value.size()) throw std::runtime_error("Corrupt OpenEXR channel list");
+
+                uint32_t type;
+                std::memcpy(&type, &value[pos], 4);
+                if constexpr (std::endian::native != std::endian::little) type = byteSwap32(type);
+                pos += 16;
+
+                size_t bytes = (type == kExrPixelHalf) ? 2 : 4;
+                int slot = (name == "R") ? 0 : (name == "G") ? 1 : (name == "B") ? 2 : -1;
+                if (slot >= 0) {
+                    if (type != kExrPixelFloat) throw std::runtime_error("OpenEXR color channels must be 32-bit float");
+                    channelOffset[slot] = static_cast<long>(offset);
+                } else if (type != kExrPixelUInt && type != kExrPixelHalf && type != kExrPixelFloat) {
+                    throw std::runtime_error("Unknown OpenEXR pixel type");
+                }
+                offset += bytes;
+            }
+            // Each plane is width values, so plane offsets scale by width
+            pixelBytes = offset;
+        }
+
+        ExrCompression compression = ExrCompression::None;
+        Box dataWindow{}, displayWindow{};
+        bool haveDisplay = false;
+        long channelOffset[3] = { -1, -1, -1 };
+        size_t pixelBytes = 0;
+        std::vector<uint64_t> offsets;
+        std::vector<char> raw, packed, tmp;
+        size_t nextRow = 0;
+    };
+
+    class PngReader : public ImageRowReader {
+    public:
+        explicit PngReader(std::istream& in)
+            : image(in) {
+            width = image.get_width();
+            height = image.get_height();
+        }
+
+        void readRow(vec3* dst) override {
+            if (nextRow >= height) throw std::runtime_error("Read past the end of the PNG image");
+            const auto& row = image.get_row(nextRow++);
+            for (size_t x = 0; x < width; ++x) {
+                dst[x] = vec3(row[x].red / 255.0f, row[x].green / 255.0f, row[x].blue / 255.0f);
+            }
+        }
+
+    private:
+        png::image<png::rgb_pixel> image;
+        size_t nextRow = 0;
+    };
+
+    std::unique_ptr<ImageRowReader> makeReader(std::istream& in, std::unique_ptr<std::istream> owned, ImageFormat format) {
+        switch (format) {
+        case ImageFormat::PFM: return std::make_unique<PfmReader>(in, std::move(owned));
+        case ImageFormat::HDR: return std::make_unique<HdrReader>(in, std::move(owned));
+        case ImageFormat::EXR: return std::make_unique<ExrReader>(in, std::move(owned));
+        default:               return std::make_unique<PngReader>(in);
+        }
+    }
+}
+
+ImageFormat imageFormatFromFilename(const std::string& filename) {
+    size_t dot = filename.find_last_of('.');
+    std::string ext = (dot == std::string::npos) ? "" : filename.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (ext == "png") return ImageFormat::PNG;
+    if (ext == "pfm") return ImageFormat::PFM;
+    if (ext == "hdr" || ext == "rgbe" || ext == "pic") return ImageFormat::HDR;
+    if (ext == "exr") return ImageFormat::EXR;
+    throw std::invalid_argument("Unknown image file extension: " + filename);
+}
+
+void writePFM(std::ostream& out, size_t width, size_t height, const RowSource& rows) {
+    out << "PF\n" << width << " " << height << "\n-1.0\n";
+
+    std::vector<vec3> scratch;
+    std::vector<char> swapped;
+    for (size_t i = 0; i < height; ++i) {
+        size_t y = height - 1 - i;
+        const vec3* row = rows(y, scratch);
+        writeFloatsLE(out, reinterpret_cast<const float*>(row), width * 3, swapped);
+    }
+}
+
+void writeRadianceHDR(std::ostream& out, size_t width, size_t height, const RowSource& rows) {
+    out << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " << height << " +X " << width << "\n";
+
+    std::vector<vec3> scratch;
+    std::vector<unsigned char> rgbe(width * 4);
+    std::vector<unsigned char> component(width);
+    for (size_t y = 0; y < height; ++y) {
+        const vec3* row = rows(y, scratch);
+        for (size_t x = 0; x < width; ++x) {
+            floatToRGBE(row[x], &rgbe[4 * x]);
+        }
+
+        if (width < 8 || width >= 32768) {
+            // Run-length encoding is only defined for these widths
+            out.write(reinterpret_cast<const char*>(rgbe.data()), static_cast<std::streamsize>(rgbe.size()));
+            continue;
+        }
+
+        char head[4] = { 2, 2, char(width >> 8), char(width & 0xFF) };
+        out.write(head, 4);
+        for (size_t c = 0; c < 4; ++c) {
+            for (size_t x = 0; x < width; ++x) component[x] = rgbe[4 * x + c];
+            writeRLEBytes(out, component.data(), width);
+        }
+    }
+}
+
+void writeEXR(std::ostream& out, size_t width, size_t height, const RowSource& rows, ExrCompression compression) {
+    writeEXR(out, CropWindow::fullFrame(width, height), rows, compression);
+}
+
+void writeEXR(std::ostream& out, const CropWindow& crop, const RowSource& rows, ExrCompression compression) {
+    if (crop.x0 + crop.width > crop.fullWidth || crop.y0 + crop.height > crop.fullHeight) {
+        throw std::invalid_argument("writeEXR: crop window does not fit in its frame");
+    }
+    size_t width = crop.width;
+    size_t height = crop.height;
+    if (compression == ExrCompression::RLE && out.tellp() == std::streampos(-1)) {
+        throw std::invalid_argument("writeEXR: RLE compression needs a seekable stream");
+    }
+
+    // The header is built in memory so the offsets can be counted from
+    // its size; tellp() fails on pipes such as std::cout
+    std::ostringstream header;
+    putLE32(header, kExrMagic);
+    putLE32(header, 2);
+
+    // Channels must be listed in alphabetical order
+    std::ostringstream channels;
+    for (const char* name : { "B", "G", "R" }) {
+        channels.write(name, 2);
+        putLE32(channels, kExrPixelFloat);
+        putLE32(channels, 0);  // pLinear and reserved bytes
+        putLE32(channels, 1);  // x sampling
+        putLE32(channels, 1);  // y sampling
+    }
+    channels.put('\0');
+
+    int32_t x0 = static_cast<int32_t>(crop.x0);
+    int32_t y0 = static_cast<int32_t>(crop.y0);
+    putExrAttribute(header, "channels", "chlist", channels.str());
+    putExrAttribute(header, "compression", "compression", std::string(1, compression == ExrCompression::RLE ? 1 : 0));
+    putExrAttribute(header, "dataWindow", "box2i",
+                    exrBox(x0, y0, x0 + static_cast<int32_t>(width) - 1, y0 + static_cast<int32_t>(height) - 1));
+    putExrAttribute(header, "displayWindow", "box2i",
+                    exrBox(0, 0, static_cast<int32_t>(crop.fullWidth) - 1, static_cast<int32_t>(crop.fullHeight) - 1));
+    putExrAttribute(header, "lineOrder", "lineOrder", std::string(1, '\0'));
+    putExrAttribute(header, "pixelAspectRatio", "float", exrFloat(1.0f));
+    putExrAttribute(header, "screenWindowCenter", "v2f", exrFloat(0.0f) + exrFloat(0.0f));
+    putExrAttribute(header, "screenWindowWidth", "float", exrFloat(1.0f));
+    header.put('\0');
+    std::string headerBytes = header.str();
+    out.write(headerBytes.data(), static_cast<std::streamsize>(headerBytes.size()));
+
+    size_t rawSize = width * 3 * sizeof(float);
+    std::streampos tableStart = out.tellp();
+    uint64_t blockStart = headerBytes.size() + 8 * height;
+
+    std::vector<uint64_t> offsets(height);
+    if (compression == ExrCompression::None) {
+        // Every block has the same size, so the table is known up front
+        for (size_t y = 0; y < height; ++y) {
+            offsets[y] = blockStart + y * (8 + rawSize);
+        }
+    }
+    for (uint64_t o : offsets) putLE64(out, o);
+
+    std::vector<vec3> scratch;
+    std::vector<char> raw(rawSize), tmp, packed;
+    uint64_t position = blockStart;
+    for (size_t y = 0; y < height; ++y) {
+        const vec3* row = rows(y, scratch);
+
+        // Planar B, G, R
+        char* dst = raw.data();
+        for (int c = 2; c >= 0; --c) {
+            for (size_t x = 0; x < width; ++x) {
+                uint32_t bits = std::bit_cast<uint32_t>(row[x][c]);
+                for (int k = 0; k < 4; ++k) *dst++ = char(bits >> (8 * k));
+            }
+        }
+
+        const std::vector<char>* block = &raw;
+        if (compression == ExrCompression::RLE) {
+            exrRleCompress(raw, tmp, packed);
+            // Incompressible lines are stored raw
+            if (packed.size() < raw.size()) block = &packed;
+        }
+
+        offsets[y] = position;
+        putLE32(out, static_cast<uint32_t>(crop.y0 + y));
+        putLE32(out, static_cast<uint32_t>(block->size()));
+        out.write(block->data(), static_cast<std::streamsize>(block->size()));
+        position += 8 + block->size();
+    }
+
+    if (compression == ExrCompression::RLE) {
+        std::streampos end = out.tellp();
+        out.seekp(tableStart);
+        for (uint64_t o : offsets) putLE64(out, o);
+        out.seekp(end);
+    }
+}
+
+void writeImage(const FrameBuffer& fb, const std::string& filename) {
+    writeImage(filename, CropWindow::fullFrame(fb.getWidth(), fb.getHeight()), fb.getRowSource());
+}
+
+void writeImage(const FrameBuffer& fb, const std::string& filename, const CropWindow& crop) {
+    if (fb.getWidth() != crop.width || fb.getHeight() != crop.height) {
+        throw std::invalid_argument("writeImage: frame buffer is not the size of the crop window");
+    }
+    writeImage(filename, crop, fb.getRowSource());
+}
+
+void writeImage(const std::string& filename, const CropWindow& crop, const RowSource& rows) {
+    ImageFormat format = imageFormatFromFilename(filename);
+    if (format == ImageFormat::PNG) {
+        writePngRows(filename, crop.width, crop.height, rows);
+        return;
+    }
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Could not open " + filename + " for writing");
+    }
+    switch (format) {
+    case ImageFormat::PFM: writePFM(out, crop.width, crop.height, rows); break;
+    case ImageFormat::HDR: writeRadianceHDR(out, crop.width, crop.height, rows); break;
+    default:               writeEXR(out, crop, rows, ExrCompression::RLE); break;
+    }
+    if (!out) {
+        throw std::runtime_error("Error writing " + filename);
+    }
+}
+
+std::unique_ptr<ImageRowReader> openImage(const std::string& filename) {
+    ImageFormat format = imageFormatFromFilename(filename);
+    auto file = std::make_unique<std::ifstream>(filename, std::ios::binary);
+    if (!*file) {
+        throw std::runtime_error("Could not open " + filename);
+    }
+    std::istream& in = *file;
+    return makeReader(in, std::move(file), format);
+}
+
+std::unique_ptr<ImageRowReader> openImage(std::istream& in, ImageFormat format) {
+    return makeReader(in, nullptr, format);
+}
+
+FrameBuffer readImage(const std::string& filename, FrameBuffer::Layout layout) {
+    std::unique_ptr<ImageRowReader> reader = openImage(filename);
+    FrameBuffer fb(reader->getWidth(), reader->getHeight(), layout);
+    std::vector<vec3> row(reader->getWidth());
+    for (size_t y = 0; y < reader->getHeight(); ++y) {
+        reader->readRow(row.data());
+        fb.setRow(y, row.data());
+    }
+    return fb;
+}
@@ -0,0 +1,85 @@
+#ifndef IMAGEIO_H
+#define IMAGEIO_H
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include "vec.h"
+#include "FrameBuffer.h"
+#include "CropWindow.h"
+
+// File formats understood by readImage/writeImage.  PNG is 8-bit; the
+// others keep the linear float data.
+enum class ImageFormat { PNG, PFM, HDR, EXR };
+
+// Pick the format from a file extension (.png, .pfm, .hdr, .exr)
+ImageFormat imageFormatFromFilename(const std::string& filename);
+
+// Pixel compression for EXR output
+enum class ExrCompression { None, RLE };
+
+// HDR writers.  Each pulls rows one at a time from rows, so nothing but
+// a row of converted data is held in memory.
+//
+// PFM writes little-endian floats, bottom row first.  When the host is
+// little-endian the rows are written straight from the source.
+void writePFM(std::ostream& out, size_t width, size_t height, const RowSource& rows);
+
+// Radiance RGBE with run-length encoded scanlines
+void writeRadianceHDR(std::ostream& out, size_t width, size_t height, const RowSource& rows);
+
+// Scanline OpenEXR with 32-bit float R, G and B channels.  Uncompressed
+// output can go to any stream, pipes included; RLE output patches the
+// offset table afterwards and so needs a seekable stream.
+void writeEXR(std::ostream& out, size_t width, size_t height, const RowSource& rows,
+              ExrCompression compression = ExrCompression::None);
+
+// EXR of a crop.  rows supplies crop.width x crop.height pixels; the
+// file's data window is the crop and its display window the full frame.
+void writeEXR(std::ostream& out, const CropWindow& crop, const RowSource& rows,
+              ExrCompression compression = ExrCompression::None);
+
+// Write fb in the format named by the file extension
+void writeImage(const FrameBuffer& fb, const std::string& filename);
+
+// Write a crop-sized fb or row source.  Only EXR files record where the
+// crop sits in the frame; other formats hold just the pixels.  Rows are
+// pulled top row first except for PFM, which is written bottom-up.
+void writeImage(const FrameBuffer& fb, const std::string& filename, const CropWindow& crop);
+void writeImage(const std::string& filename, const CropWindow& crop, const RowSource& rows);
+
+// Reads an image one row at a time, top row first
+class ImageRowReader {
+public:
+    virtual ~ImageRowReader() = default;
+
+    size_t getWidth() const { return width; }
+    size_t getHeight() const { return height; }
+
+    // Where the image sits in a larger frame.  Only EXR files carry this;
+    // everything else reports the full frame of its own size.
+    CropWindow getCrop() const { return crop.fullWidth ? crop : CropWindow::fullFrame(width, height); }
+
+    // Read the next row into dst, which holds getWidth() pixels
+    virtual void readRow(vec3* dst) = 0;
+
+protected:
+    size_t width = 0;
+    size_t height = 0;
+    CropWindow crop;
+};
+
+// Open an image for row-by-row reading.  PFM, HDR and EXR are streamed
+// from the file; PNG is decoded up front and scaled to [0, 1].  The EXR
+// reader handles the uncompressed and RLE scanline files written above.
+// PFM stores its rows bottom-up and the reader seeks to each one, so a
+// PFM stream must be seekable.
+std::unique_ptr<ImageRowReader> openImage(const std::string& filename);
+std::unique_ptr<ImageRowReader> openImage(std::istream& in, ImageFormat format);
+
+// Read a whole image into a new frame buffer
+FrameBuffer readImage(const std::string& filename, FrameBuffer::Layout layout = FrameBuffer::Layout::RowMajor);
+
+#endif // IMAGEIO_H
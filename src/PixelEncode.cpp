@@ -0,0 +1,227 @@
+#include "PixelEncode.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PIXELENCODE_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PIXELENCODE_SSE2 1
+#endif
+
+namespace {
+    // The curve table covers [2^-24, 1) in 24 octaves of 16 segments
+    const int kOctaves = 24;
+    const int kSegmentBits = 4;
+    const int kMantissaShift = 23 - kSegmentBits;
+    const uint32_t kMinBits = uint32_t(127 - kOctaves) << 23;
+    const uint32_t kMaxBits = 0x3F7FFFFF;  // largest float below 1
+    const uint32_t kIndexBias = (127 - kOctaves) << kSegmentBits;
+    const uint32_t kFracMask = (1u << kMantissaShift) - 1;
+    const float kFracScale = 1.0f / float(1u << kMantissaShift);
+
+    // Pattern of per-float rounding offsets, long enough that every
+    // vector width divides it and it covers whole pixels
+    const size_t kPatternLength = 24;
+
+    const int kBayer[4][4] = { { 0, 8, 2, 10 },
+                               { 12, 4, 14, 6 },
+                               { 3, 11, 1, 9 },
+                               { 15, 7, 13, 5 } };
+
+    float bitsToFloat(uint32_t bits) {
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    uint32_t floatToBits(float f) {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+
+    float srgbEncode(float v) {
+        return (v <= 0.0031308f) ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+    }
+}
+
+PixelEncoder::PixelEncoder(const EncodeOptions& options)
+    : options(options) {
+    if (options.transfer == TransferFunction::Linear) {
+        return;
+    }
+
+    size_t segments = size_t(kOctaves) << kSegmentBits;
+    base.resize(segments);
+    slope.resize(segments);
+    for (size_t i = 0; i < segments; ++i) {
+        uint32_t startBits = kMinBits + (uint32_t(i) << kMantissaShift);
+        float v0 = bitsToFloat(startBits);
+        float v1 = bitsToFloat(startBits + (1u << kMantissaShift));
+        float y0 = reference(v0);
+        float y1 = reference(v1);
+        base[i] = y0;
+        slope[i] = y1 - y0;
+    }
+}
+
+float PixelEncoder::reference(float value) const {
+    float v = std::clamp(value, 0.0f, 1.0f);
+    switch (options.transfer) {
+    case TransferFunction::SRGB:
+        v = srgbEncode(v);
+        break;
+    case TransferFunction::Gamma:
+        v = std::pow(v, 1.0f / options.gamma);
+        break;
+    default:
+        break;
+    }
+    return v * 255.0f;
+}
+
+const char* PixelEncoder::simdPath() {
+#if defined(PIXELENCODE_AVX2)
+    return "AVX2";
+#elif defined(PIXELENCODE_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void PixelEncoder::encodeScalar(const float* src, size_t n, uint8_t* dst, const float* pattern, size_t phase) const {
+    bool linear = options.transfer == TransferFunction::Linear;
+    float lo = linear ? 0.0f : bitsToFloat(kMinBits);
+    float hi = linear ? 1.0f : bitsToFloat(kMaxBits);
+
+    for (size_t i = 0; i < n; ++i) {
+        // Written so that NaN ends up at the low end, like the SIMD path
+        float v = src[i];
+        v = (v > lo) ? v : lo;
+        v = (v < hi) ? v : hi;
+
+        float y;
+        if (linear) {
+            y = v * 255.0f;
+        } else {
+            uint32_t bits = floatToBits(v);
+            uint32_t idx = (bits >> kMantissaShift) - kIndexBias;
+            y = base[idx] + slope[idx] * (float(bits & kFracMask) * kFracScale);
+        }
+        dst[i] = static_cast<uint8_t>(y + pattern[(phase + i) % kPatternLength]);
+    }
+}
+
+void PixelEncoder::encode(const vec3* src, size_t count, uint8_t* dst, size_t x, size_t y) const {
+    static_assert(sizeof(vec3) == 3 * sizeof(float), "vec3 must be tightly packed");
+
+    // Rounding offsets: 0.5 everywhere, plus the Bayer threshold of each
+    // pixel when dithering
+    float pattern[kPatternLength];
+    for (size_t j = 0; j < kPatternLength; ++j) {
+        float d = 0.0f;
+        if (options.dither) {
+            d = (kBayer[y & 3][(x + j / 3) & 3] + 0.5f) / 16.0f - 0.5f;
+        }
+        pattern[j] = 0.5f + d;
+    }
+
+    const float* in = reinterpret_cast<const float*>(src);
+    size_t n = count * 3;
+    size_t i = 0;
+
+#if defined(PIXELENCODE_AVX2) || defined(PIXELENCODE_SSE2)
+    bool linear = options.transfer == TransferFunction::Linear;
+#endif
+
+#if defined(PIXELENCODE_AVX2)
+    {
+        const __m256 lo = _mm256_set1_ps(linear ? 0.0f : bitsToFloat(kMinBits));
+        const __m256 hi = _mm256_set1_ps(linear ? 1.0f : bitsToFloat(kMaxBits));
+        const __m256 scale = _mm256_set1_ps(255.0f);
+        const __m256 fracScale = _mm256_set1_ps(kFracScale);
+        const __m256i fracMask = _mm256_set1_epi32(kFracMask);
+        const __m256i bias = _mm256_set1_epi32(kIndexBias);
+
+        auto convert8 = [&](const float* p, size_t phase) {
+            __m256 v = _mm256_max_ps(_mm256_loadu_ps(p), lo);
+            v = _mm256_min_ps(v, hi);
+            __m256 r;
+            if (linear) {
+                r = _mm256_mul_ps(v, scale);
+            } else {
+                __m256i bits = _mm256_castps_si256(v);
+                __m256i idx = _mm256_sub_epi32(_mm256_srli_epi32(bits, kMantissaShift), bias);
+                __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(bits, fracMask)), fracScale);
+                __m256 b = _mm256_i32gather_ps(base.data(), idx, 4);
+                __m256 s = _mm256_i32gather_ps(slope.data(), idx, 4);
+                r = _mm256_add_ps(b, _mm256_mul_ps(s, t));
+            }
+            r = _mm256_add_ps(r, _mm256_loadu_ps(pattern + phase));
+            return _mm256_cvttps_epi32(r);
+        };
+
+        // 16 floats per step so the results pack into 16 bytes
+        size_t phase = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m256i a = convert8(in + i, phase);
+            __m256i b = convert8(in + i + 8, (phase + 8) % kPatternLength);
+            phase = (phase + 16) % kPatternLength;
+
+            __m128i a16 = _mm_packs_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+            __m128i b16 = _mm_packs_epi32(_mm256_castsi256_si128(b), _mm256_extracti128_si256(b, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a16, b16));
+        }
+    }
+#elif defined(PIXELENCODE_SSE2)
+    {
+        const __m128 lo = _mm_set1_ps(linear ? 0.0f : bitsToFloat(kMinBits));
+        const __m128 hi = _mm_set1_ps(linear ? 1.0f : bitsToFloat(kMaxBits));
+        const __m128 scale = _mm_set1_ps(255.0f);
+        const __m128 fracScale = _mm_set1_ps(kFracScale);
+        const __m128i fracMask = _mm_set1_epi32(kFracMask);
+        const __m128i bias = _mm_set1_epi32(kIndexBias);
+
+        auto convert4 = [&](const float* p, size_t phase) {
+            __m128 v = _mm_max_ps(_mm_loadu_ps(p), lo);
+            v = _mm_min_ps(v, hi);
+            __m128 r;
+            if (linear) {
+                r = _mm_mul_ps(v, scale);
+            } else {
+                __m128i bits = _mm_castps_si128(v);
+                __m128i idx = _mm_sub_epi32(_mm_srli_epi32(bits, kMantissaShift), bias);
+                __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(bits, fracMask)), fracScale);
+
+                // No gather before AVX2, so look the segments up one by one
+                alignas(16) uint32_t k[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(k), idx);
+                __m128 b = _mm_setr_ps(base[k[0]], base[k[1]], base[k[2]], base[k[3]]);
+                __m128 s = _mm_setr_ps(slope[k[0]], slope[k[1]], slope[k[2]], slope[k[3]]);
+                r = _mm_add_ps(b, _mm_mul_ps(s, t));
+            }
+            r = _mm_add_ps(r, _mm_loadu_ps(pattern + phase));
+            return _mm_cvttps_epi32(r);
+        };
+
+        size_t phase = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i a = convert4(in + i, phase);
+            __m128i b = convert4(in + i + 4, (phase + 4) % kPatternLength);
+            __m128i c = convert4(in + i + 8, (phase + 8) % kPatternLength);
+            __m128i d = convert4(in + i + 12, (phase + 12) % kPatternLength);
+            phase = (phase + 16) % kPatternLength;
+
+            __m128i ab = _mm_packs_epi32(a, b);
+            __m128i cd = _mm_packs_epi32(c, d);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(ab, cd));
+        }
+    }
+#endif
+
+    encodeScalar(in + i, n - i, dst + i, pattern, i % kPatternLength);
+}
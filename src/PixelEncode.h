@@ -0,0 +1,57 @@
+#ifndef PIXELENCODE_H
+#define PIXELENCODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vec.h"
+
+// Transfer function applied when quantizing linear float color to 8 bits
+enum class TransferFunction { Linear, SRGB, Gamma };
+
+struct EncodeOptions {
+    TransferFunction transfer = TransferFunction::Linear;
+
+    // Exponent for TransferFunction::Gamma, output = input^(1/gamma)
+    float gamma = 2.2f;
+
+    // Add a 4x4 ordered (Bayer) dither before rounding to hide banding
+    bool dither = false;
+};
+
+// Converts spans of vec3 into packed 8-bit RGB.  Values are clamped to
+// [0, 1], passed through the transfer function and rounded to the
+// nearest byte.  The work is done on the span as one flat run of floats
+// with AVX2 or SSE2 when the compiler targets them, and a scalar loop
+// otherwise.  sRGB and gamma curves come from a piecewise-linear table
+// indexed by the float's exponent and top mantissa bits, accurate to well
+// under one output step.
+class PixelEncoder {
+public:
+    explicit PixelEncoder(const EncodeOptions& options = EncodeOptions());
+
+    const EncodeOptions& getOptions() const { return options; }
+
+    // Encode count pixels into dst (3 * count bytes).  (x, y) is the
+    // image position of the first pixel and only matters for dithering.
+    void encode(const vec3* src, size_t count, uint8_t* dst, size_t x = 0, size_t y = 0) const;
+
+    // Exact transfer function of a single channel scaled to [0, 255],
+    // before rounding.  Useful as a reference for the fast path.
+    float reference(float value) const;
+
+    // Name of the instruction set the encoder was compiled for
+    static const char* simdPath();
+
+private:
+    void encodeScalar(const float* src, size_t n, uint8_t* dst, const float* pattern, size_t phase) const;
+
+    EncodeOptions options;
+
+    // Curve table: segment i spans one sixteenth of an octave, and the
+    // encoded value is base[i] + slope[i] * (position within segment)
+    std::vector<float> base;
+    std::vector<float> slope;
+};
+
+#endif // PIXELENCODE_H
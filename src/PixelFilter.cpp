@@ -0,0 +1,95 @@
+#include "PixelFilter.h"
+#include "handleGraphicsArgs.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+    const float kPi = 3.14159265358979f;
+
+    // Mitchell-Netravali cubic on [0, 2)
+    float mitchell(float x, float B, float C) {
+        if (x < 1.0f) {
+            return ((12.0f - 9.0f * B - 6.0f * C) * x * x * x + (-18.0f + 12.0f * B + 6.0f * C) * x * x +
+                    (6.0f - 2.0f * B)) / 6.0f;
+        }
+        return ((-B - 6.0f * C) * x * x * x + (6.0f * B + 30.0f * C) * x * x +
+                (-12.0f * B - 48.0f * C) * x + (8.0f * B + 24.0f * C)) / 6.0f;
+    }
+}
+
+PixelFilter::PixelFilter(Type type, float radius)
+    : type(type), radius(radius > 0.0f ? radius : defaultRadius(type)) {
+    if (!(radius >= 0.0f)) {
+        throw std::invalid_argument("PixelFilter: the radius must not be negative");
+    }
+    tableScale = kTableSize / this->radius;
+
+    // Sample each bin at its middle
+    for (size_t i = 0; i < kTableSize; ++i) {
+        table[i] = evaluate1D((i + 0.5f) / tableScale);
+    }
+}
+
+PixelFilter PixelFilter::fromArgs(const sivelab::GraphicsArgs& args) {
+    return PixelFilter(typeFromName(args.filterName), args.filterRadius);
+}
+
+PixelFilter::Type PixelFilter::typeFromName(const std::string& name) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (Type t : { Type::Box, Type::Tent, Type::Gaussian, Type::Mitchell, Type::BlackmanHarris }) {
+        if (lower == getName(t)) return t;
+    }
+    throw std::invalid_argument("Unknown pixel filter '" + name + "'");
+}
+
+const char* PixelFilter::getName(Type type) {
+    switch (type) {
+    case Type::Box:      return "box";
+    case Type::Tent:     return "tent";
+    case Type::Gaussian: return "gaussian";
+    case Type::Mitchell: return "mitchell";
+    default:             return "blackmanharris";
+    }
+}
+
+float PixelFilter::defaultRadius(Type type) {
+    switch (type) {
+    case Type::Box:      return 0.5f;
+    case Type::Tent:     return 1.0f;
+    case Type::Gaussian: return 1.5f;
+    default:             return 2.0f;
+    }
+}
+
+int PixelFilter::getPixelRadius() const {
+    // A sample anywhere in its pixel reaches pixel centers less than
+    // radius away, and the nearest center k pixels over can be as close
+    // as k - 0.5
+    return static_cast<int>(std::ceil(radius + 0.5f)) - 1;
+}
+
+float PixelFilter::evaluate1D(float d) const {
+    float x = std::fabs(d);
+    if (x > radius) return 0.0f;
+
+    switch (type) {
+    case Type::Box:
+        return 1.0f;
+    case Type::Tent:
+        return 1.0f - x / radius;
+    case Type::Gaussian: {
+        const float alpha = 2.0f;
+        return std::max(std::exp(-alpha * x * x) - std::exp(-alpha * radius * radius), 0.0f);
+    }
+    case Type::Mitchell:
+        return mitchell(2.0f * x / radius, 1.0f / 3.0f, 1.0f / 3.0f);
+    default: {
+        // Four-term Blackman-Harris window spanning [-radius, radius]
+        float t = 2.0f * kPi * (0.5f + 0.5f * x / radius);
+        return 0.35875f - 0.48829f * std::cos(t) + 0.14128f * std::cos(2.0f * t) - 0.01168f * std::cos(3.0f * t);
+    }
+    }
+}
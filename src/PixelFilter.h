@@ -0,0 +1,64 @@
+#ifndef PIXELFILTER_H
+#define PIXELFILTER_H
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace sivelab {
+    class GraphicsArgs;
+}
+
+// Reconstruction filter used to splat a sample into the pixels around
+// it.  All filters are separable, w(dx, dy) = f(dx) f(dy), with f zero
+// beyond the radius.  f is tabulated once at construction so
+// splatting costs a table lookup per pixel and axis.
+class PixelFilter {
+public:
+    // Mitchell uses B = C = 1/3 and Gaussian has its tail shifted down
+    // to reach zero at the radius
+    enum class Type { Box, Tent, Gaussian, Mitchell, BlackmanHarris };
+
+    // Entries in the weight table covering [0, radius)
+    static constexpr size_t kTableSize = 64;
+
+    // A radius of 0 picks the usual one for the type: 0.5 pixels for
+    // Box, 1 for Tent, 1.5 for Gaussian and 2 for the others
+    explicit PixelFilter(Type type = Type::Box, float radius = 0.0f);
+
+    // Filter from --filter and --filterradius
+    static PixelFilter fromArgs(const sivelab::GraphicsArgs& args);
+
+    // "box", "tent", "gaussian", "mitchell" or "blackmanharris".  Throws
+    // std::invalid_argument for anything else.
+    static Type typeFromName(const std::string& name);
+    static const char* getName(Type type);
+    static float defaultRadius(Type type);
+
+    Type getType() const { return type; }
+    float getRadius() const { return radius; }
+
+    // Pixels a sample can reach on each side of the one it falls in
+    int getPixelRadius() const;
+
+    // The filter computed directly, for building and checking the table
+    float evaluate1D(float d) const;
+    float evaluate(float dx, float dy) const { return evaluate1D(dx) * evaluate1D(dy); }
+
+    // Tabulated weights, dx and dy in pixels from the sample
+    float weight1D(float d) const {
+        float a = d < 0.0f ? -d : d;
+        if (a > radius) return 0.0f;
+        size_t i = static_cast<size_t>(a * tableScale);
+        return table[i < kTableSize ? i : kTableSize - 1];
+    }
+    float weight(float dx, float dy) const { return weight1D(dx) * weight1D(dy); }
+
+private:
+    Type type;
+    float radius;
+    float tableScale;
+    std::array<float, kTableSize> table;
+};
+
+#endif // PIXELFILTER_H
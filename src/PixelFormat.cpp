@@ -0,0 +1,306 @@
+#include "PixelFormat.h"
+#include "PixelEncode.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__F16C__) && defined(__AVX__)
+#include <immintrin.h>
+#define PIXELFORMAT_F16C 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PIXELFORMAT_SSE2 1
+#endif
+
+static_assert(sizeof(Half16Format::Storage) == 6, "half pixels must be tightly packed");
+static_assert(sizeof(SRGB8Format::Storage) == 3, "sRGB8 pixels must be tightly packed");
+
+namespace {
+    // RGB9E5 constants: 9 mantissa bits, exponent bias 15, 5 exponent bits
+    const int kMantissaBits = 9;
+    const int kExpBias = 15;
+    const int kMaxExp = 31;
+    const float kMaxRGB9E5 = float((1 << kMantissaBits) - 1) / float(1 << kMantissaBits) * float(1 << (kMaxExp - kExpBias));
+
+    // 2^e for e within the normal float range
+    float pow2(int e) {
+        return std::bit_cast<float>(uint32_t(e + 127) << 23);
+    }
+
+    // Scalar reference for a single RGB9E5 pixel.  floor(log2(max)) is
+    // read from the float's exponent bits, so it is exact.
+    uint32_t encodeRGB9E5(float r, float g, float b) {
+        // Written so that NaN clamps to 0
+        r = (r > 0.0f) ? std::min(r, kMaxRGB9E5) : 0.0f;
+        g = (g > 0.0f) ? std::min(g, kMaxRGB9E5) : 0.0f;
+        b = (b > 0.0f) ? std::min(b, kMaxRGB9E5) : 0.0f;
+        float maxc = std::max(r, std::max(g, b));
+
+        int floorLog2 = int((std::bit_cast<uint32_t>(maxc) >> 23) & 0xFF) - 127;
+        int e = std::max(-kExpBias - 1, floorLog2) + 1 + kExpBias;
+        float scale = pow2(kMantissaBits + kExpBias - e);
+        if (uint32_t(maxc * scale + 0.5f) == (1u << kMantissaBits)) {
+            ++e;
+            scale *= 0.5f;
+        }
+
+        uint32_t rm = uint32_t(r * scale + 0.5f);
+        uint32_t gm = uint32_t(g * scale + 0.5f);
+        uint32_t bm = uint32_t(b * scale + 0.5f);
+        return rm | (gm << 9) | (bm << 18) | (uint32_t(e) << 27);
+    }
+
+    vec3 decodeRGB9E5(uint32_t v) {
+        float scale = pow2(int(v >> 27) - kExpBias - kMantissaBits);
+        return vec3(float(v & 0x1FF) * scale, float((v >> 9) & 0x1FF) * scale, float((v >> 18) & 0x1FF) * scale);
+    }
+
+#if defined(PIXELFORMAT_SSE2)
+    // Four packed RGB pixels (12 floats) to and from one register per channel
+    void loadRGB4(const float* p, __m128& r, __m128& g, __m128& b) {
+        __m128 a = _mm_loadu_ps(p);      // r0 g0 b0 r1
+        __m128 m = _mm_loadu_ps(p + 4);  // g1 b1 r2 g2
+        __m128 c = _mm_loadu_ps(p + 8);  // b2 r3 g3 b3
+        r = _mm_shuffle_ps(a, _mm_shuffle_ps(m, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+        g = _mm_shuffle_ps(_mm_shuffle_ps(a, m, _MM_SHUFFLE(0, 0, 1, 1)),
+                           _mm_shuffle_ps(m, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        b = _mm_shuffle_ps(_mm_shuffle_ps(a, m, _MM_SHUFFLE(1, 1, 2, 2)),
+                           _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+    }
+
+    void storeRGB4(float* p, __m128 r, __m128 g, __m128 b) {
+        __m128 a = _mm_shuffle_ps(_mm_shuffle_ps(r, g, _MM_SHUFFLE(0, 0, 0, 0)),
+                                  _mm_shuffle_ps(b, r, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 m = _mm_shuffle_ps(_mm_shuffle_ps(g, b, _MM_SHUFFLE(1, 1, 1, 1)),
+                                  _mm_shuffle_ps(r, g, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 c = _mm_shuffle_ps(_mm_shuffle_ps(b, r, _MM_SHUFFLE(3, 3, 2, 2)),
+                                  _mm_shuffle_ps(g, b, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        _mm_storeu_ps(p, a);
+        _mm_storeu_ps(p + 4, m);
+        _mm_storeu_ps(p + 8, c);
+    }
+#endif
+
+    // Exact sRGB decode of every 8-bit value
+    struct SRGBTable {
+        float value[256];
+
+        SRGBTable() {
+            for (int i = 0; i < 256; ++i) {
+                float c = i / 255.0f;
+                value[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+        }
+    };
+
+    const SRGBTable& srgbTable() {
+        static const SRGBTable table;
+        return table;
+    }
+
+    const PixelEncoder& srgbEncoder() {
+        static const PixelEncoder encoder(EncodeOptions{ TransferFunction::SRGB, 2.2f, false });
+        return encoder;
+    }
+}
+
+// ----------------------------------------------------------------
+// Float32
+// ----------------------------------------------------------------
+void Float32Format::encode(const vec3* src, size_t count, Storage* dst) {
+    std::copy_n(src, count, dst);
+}
+
+void Float32Format::decode(const Storage* src, size_t count, vec3* dst) {
+    std::copy_n(src, count, dst);
+}
+
+// ----------------------------------------------------------------
+// Half16
+// ----------------------------------------------------------------
+uint16_t Half16Format::floatToHalf(float value) {
+    uint32_t f = std::bit_cast<uint32_t>(value);
+    uint16_t sign = uint16_t((f >> 16) & 0x8000);
+    f &= 0x7FFFFFFF;
+
+    if (f >= 0x7F800000) {
+        // Infinity stays infinity, NaN stays a quiet NaN
+        return sign | 0x7C00 | (f > 0x7F800000 ? 0x200 : 0);
+    }
+    if (f >= 0x477FF000) {
+        // Rounds up past the largest half
+        return sign | 0x7C00;
+    }
+    if (f < 0x38800000) {
+        // Subnormal half: let float addition do the rounding
+        const uint32_t magic = 0x3F000000;
+        float sum = std::bit_cast<float>(f) + std::bit_cast<float>(magic);
+        return sign | uint16_t(std::bit_cast<uint32_t>(sum) - magic);
+    }
+
+    // Rebias the exponent and round the mantissa to nearest even
+    uint32_t odd = (f >> 13) & 1;
+    f += (uint32_t(15 - 127) << 23) + 0xFFF + odd;
+    return sign | uint16_t(f >> 13);
+}
+
+float Half16Format::halfToFloat(uint16_t h) {
+    uint32_t sign = uint32_t(h & 0x8000) << 16;
+    uint32_t exponent = h & 0x7C00;
+    uint32_t mantissa = h & 0x3FF;
+
+    if (exponent == 0x7C00) {
+        return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13));
+    }
+    if (exponent == 0) {
+        // Zero or subnormal, exactly representable as a float
+        float magnitude = float(mantissa) * pow2(-24);
+        return std::bit_cast<float>(sign | std::bit_cast<uint32_t>(magnitude));
+    }
+    return std::bit_cast<float>(sign | ((uint32_t(h & 0x7FFF) << 13) + (uint32_t(127 - 15) << 23)));
+}
+
+Half16Format::Storage Half16Format::encode(const vec3& c) {
+    return { floatToHalf(c[0]), floatToHalf(c[1]), floatToHalf(c[2]) };
+}
+
+vec3 Half16Format::decode(const Storage& s) {
+    return vec3(halfToFloat(s[0]), halfToFloat(s[1]), halfToFloat(s[2]));
+}
+
+// Both directions treat the span as a flat run of 3 * count values
+void Half16Format::encode(const vec3* src, size_t count, Storage* dst) {
+    const float* in = reinterpret_cast<const float*>(src);
+    uint16_t* out = reinterpret_cast<uint16_t*>(dst);
+    size_t n = count * 3;
+    size_t i = 0;
+#if defined(PIXELFORMAT_F16C)
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = floatToHalf(in[i]);
+    }
+}
+
+void Half16Format::decode(const Storage* src, size_t count, vec3* dst) {
+    const uint16_t* in = reinterpret_cast<const uint16_t*>(src);
+    float* out = reinterpret_cast<float*>(dst);
+    size_t n = count * 3;
+    size_t i = 0;
+#if defined(PIXELFORMAT_F16C)
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = halfToFloat(in[i]);
+    }
+}
+
+// ----------------------------------------------------------------
+// RGB9E5
+// ----------------------------------------------------------------
+RGB9E5Format::Storage RGB9E5Format::encode(const vec3& c) {
+    return encodeRGB9E5(c[0], c[1], c[2]);
+}
+
+vec3 RGB9E5Format::decode(const Storage& s) {
+    return decodeRGB9E5(s);
+}
+
+// The SSE2 paths do four pixels at a time with the same arithmetic as
+// the scalar versions, so results match bit for bit
+void RGB9E5Format::encode(const vec3* src, size_t count, Storage* dst) {
+    size_t i = 0;
+#if defined(PIXELFORMAT_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxValue = _mm_set1_ps(kMaxRGB9E5);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i minExp = _mm_set1_epi32(-kExpBias - 1);
+    const __m128i overflow = _mm_set1_epi32(1 << kMantissaBits);
+    for (; i + 4 <= count; i += 4) {
+        __m128 r, g, b;
+        loadRGB4(reinterpret_cast<const float*>(src + i), r, g, b);
+        // max(x, 0) with x first returns 0 for NaN
+        r = _mm_min_ps(_mm_max_ps(r, zero), maxValue);
+        g = _mm_min_ps(_mm_max_ps(g, zero), maxValue);
+        b = _mm_min_ps(_mm_max_ps(b, zero), maxValue);
+        __m128 maxc = _mm_max_ps(r, _mm_max_ps(g, b));
+
+        __m128i floorLog2 = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(maxc), 23), _mm_set1_epi32(127));
+        // No _mm_max_epi32 before SSE4.1
+        __m128i below = _mm_cmplt_epi32(floorLog2, minExp);
+        floorLog2 = _mm_or_si128(_mm_and_si128(below, minExp), _mm_andnot_si128(below, floorLog2));
+        __m128i e = _mm_add_epi32(floorLog2, _mm_set1_epi32(1 + kExpBias));
+
+        // scale = 2^(9 + 15 - e), built directly from exponent bits
+        __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(kMantissaBits + kExpBias + 127), e), 23));
+        __m128i maxm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(maxc, scale), half));
+        __m128i bump = _mm_cmpeq_epi32(maxm, overflow);
+        e = _mm_sub_epi32(e, bump);  // bump is all ones (-1) where set
+        scale = _mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(scale), _mm_slli_epi32(bump, 23)));
+
+        __m128i rm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(r, scale), half));
+        __m128i gm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(g, scale), half));
+        __m128i bm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(b, scale), half));
+        __m128i packed = _mm_or_si128(_mm_or_si128(rm, _mm_slli_epi32(gm, 9)),
+                                      _mm_or_si128(_mm_slli_epi32(bm, 18), _mm_slli_epi32(e, 27)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = encode(src[i]);
+    }
+}
+
+void RGB9E5Format::decode(const Storage* src, size_t count, vec3* dst) {
+    size_t i = 0;
+#if defined(PIXELFORMAT_SSE2)
+    const __m128i mask = _mm_set1_epi32(0x1FF);
+    const __m128i bias = _mm_set1_epi32(127 - kExpBias - kMantissaBits);
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_srli_epi32(v, 27), bias), 23));
+        __m128 r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(v, mask)), scale);
+        __m128 g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 9), mask)), scale);
+        __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 18), mask)), scale);
+        storeRGB4(reinterpret_cast<float*>(dst + i), r, g, b);
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = decode(src[i]);
+    }
+}
+
+// ----------------------------------------------------------------
+// SRGB8
+// ----------------------------------------------------------------
+SRGB8Format::Storage SRGB8Format::encode(const vec3& c) {
+    Storage s;
+    srgbEncoder().encode(&c, 1, s.data());
+    return s;
+}
+
+vec3 SRGB8Format::decode(const Storage& s) {
+    const float* table = srgbTable().value;
+    return vec3(table[s[0]], table[s[1]], table[s[2]]);
+}
+
+void SRGB8Format::encode(const vec3* src, size_t count, Storage* dst) {
+    srgbEncoder().encode(src, count, reinterpret_cast<uint8_t*>(dst));
+}
+
+void SRGB8Format::decode(const Storage* src, size_t count, vec3* dst) {
+    const float* table = srgbTable().value;
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(src);
+    float* out = reinterpret_cast<float*>(dst);
+    for (size_t i = 0; i < count * 3; ++i) {
+        out[i] = table[in[i]];
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef PIXELFORMAT_H
+#define PIXELFORMAT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "vec.h"
+
+// Storage formats for CompactFrameBuffer.  Each format packs one linear
+// RGB pixel into a Storage value and provides scalar encode/decode for
+// single pixels plus bulk conversions of whole spans, which use SIMD
+// where the compiler targets it.
+
+// 32-bit float per channel, the same as FrameBuffer (12 bytes)
+struct Float32Format {
+    using Storage = vec3;
+
+    static Storage encode(const vec3& c) { return c; }
+    static vec3 decode(const Storage& s) { return s; }
+    static void encode(const vec3* src, size_t count, Storage* dst);
+    static void decode(const Storage* src, size_t count, vec3* dst);
+    static const char* name() { return "float32"; }
+};
+
+// IEEE half float per channel (6 bytes).  Conversions round to nearest
+// even and use F16C when available.
+struct Half16Format {
+    using Storage = std::array<uint16_t, 3>;
+
+    static Storage encode(const vec3& c);
+    static vec3 decode(const Storage& s);
+    static void encode(const vec3* src, size_t count, Storage* dst);
+    static void decode(const Storage* src, size_t count, vec3* dst);
+    static const char* name() { return "half16"; }
+
+    static uint16_t floatToHalf(float f);
+    static float halfToFloat(uint16_t h);
+};
+
+// Three 9-bit mantissas sharing a 5-bit exponent (4 bytes), as in
+// GL_EXT_texture_shared_exponent.  Negative values and NaN store as 0
+// and the range tops out at 65408.
+struct RGB9E5Format {
+    using Storage = uint32_t;
+
+    static Storage encode(const vec3& c);
+    static vec3 decode(const Storage& s);
+    static void encode(const vec3* src, size_t count, Storage* dst);
+    static void decode(const Storage* src, size_t count, vec3* dst);
+    static const char* name() { return "rgb9e5"; }
+};
+
+// 8-bit sRGB-encoded channels (3 bytes), clamped to [0, 1].  Encoding
+// goes through PixelEncoder; decoding is a table lookup.
+struct SRGB8Format {
+    using Storage = std::array<uint8_t, 3>;
+
+    static Storage encode(const vec3& c);
+    static vec3 decode(const Storage& s);
+    static void encode(const vec3* src, size_t count, Storage* dst);
+    static void decode(const Storage* src, size_t count, vec3* dst);
+    static const char* name() { return "srgb8"; }
+};
+
+#endif // PIXELFORMAT_H
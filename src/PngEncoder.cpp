@@ -0,0 +1,320 @@
+#include "PngEncoder.h"
+#include "handleGraphicsArgs.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <zlib.h>
+#include "png++/png.hpp"
+
+namespace {
+    // Feeds png++'s writer one converted row at a time
+    class RowGenerator : public png::generator<png::rgb_pixel, RowGenerator> {
+    public:
+        RowGenerator(size_t width, size_t height, const RowSource& rows, const EncodeOptions& options)
+            : png::generator<png::rgb_pixel, RowGenerator>(width, height),
+              rows(rows), encoder(options), width(width), bytes(width * 3) {
+        }
+
+        void reset(size_t) {}
+
+        png::byte* get_next_row(size_t pos) {
+            const vec3* row = rows(pos, scratch);
+            encoder.encode(row, width, bytes.data(), 0, pos);
+            return bytes.data();
+        }
+
+    private:
+        const RowSource& rows;
+        PixelEncoder encoder;
+        size_t width;
+        std::vector<vec3> scratch;
+        std::vector<png::byte> bytes;
+    };
+
+    const size_t kBytesPerPixel = 3;
+    const size_t kTargetChunkBytes = 128 * 1024;
+
+    // Output of one band of rows: raw deflate data plus the Adler-32 and
+    // length of the filtered bytes that went in
+    struct DeflatedChunk {
+        std::vector<unsigned char> data;
+        uLong adler = 0;
+        size_t rawLength = 0;
+        bool ready = false;
+    };
+
+    void putU32(std::ostream& out, uint32_t v) {
+        unsigned char b[4] = { static_cast<unsigned char>(v >> 24), static_cast<unsigned char>(v >> 16),
+                               static_cast<unsigned char>(v >> 8), static_cast<unsigned char>(v) };
+        out.write(reinterpret_cast<const char*>(b), 4);
+    }
+
+    void writePngChunk(std::ostream& out, const char* type, const unsigned char* data, size_t length) {
+        putU32(out, static_cast<uint32_t>(length));
+        out.write(type, 4);
+        uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(type), 4);
+        if (length > 0) {
+            out.write(reinterpret_cast<const char*>(data), length);
+            crc = crc32(crc, data, static_cast<uInt>(length));
+        }
+        putU32(out, static_cast<uint32_t>(crc));
+    }
+
+    unsigned char paethPredictor(int a, int b, int c) {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) return static_cast<unsigned char>(a);
+        if (pb <= pc) return static_cast<unsigned char>(b);
+        return static_cast<unsigned char>(c);
+    }
+
+    // Filter one scanline with the given PNG filter type (0-4).  out
+    // receives the filter byte followed by the filtered row.
+    void filterRow(int type, const unsigned char* row, const unsigned char* prev, size_t n, unsigned char* out) {
+        out[0] = static_cast<unsigned char>(type);
+        unsigned char* f = out + 1;
+        for (size_t i = 0; i < n; ++i) {
+            int a = (i >= kBytesPerPixel) ? row[i - kBytesPerPixel] : 0;
+            int b = prev ? prev[i] : 0;
+            int c = (prev && i >= kBytesPerPixel) ? prev[i - kBytesPerPixel] : 0;
+            int predicted = 0;
+            switch (type) {
+            case 1: predicted = a; break;
+            case 2: predicted = b; break;
+            case 3: predicted = (a + b) / 2; break;
+            case 4: predicted = paethPredictor(a, b, c); break;
+            default: break;
+            }
+            f[i] = static_cast<unsigned char>(row[i] - predicted);
+        }
+    }
+
+    // Sum of the filtered bytes read as signed values, libpng's
+    // heuristic for choosing a filter
+    size_t filterCost(const unsigned char* filtered, size_t n) {
+        size_t cost = 0;
+        for (size_t i = 0; i < n; ++i) {
+            cost += static_cast<size_t>(std::abs(static_cast<int>(static_cast<signed char>(filtered[i]))));
+        }
+        return cost;
+    }
+
+    void deflateChunk(const std::vector<unsigned char>& raw, const ParallelPngOptions& options, bool last,
+                      DeflatedChunk& chunk) {
+        z_stream zs = {};
+        int strategy = (options.filter == PngFilter::None) ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+        if (deflateInit2(&zs, options.compressionLevel, Z_DEFLATED, -15, 8, strategy) != Z_OK) {
+            throw std::runtime_error("writePngParallel: deflateInit2 failed");
+        }
+
+        chunk.data.resize(deflateBound(&zs, static_cast<uLong>(raw.size())) + 16);
+        zs.next_in = const_cast<Bytef*>(raw.data());
+        zs.avail_in = static_cast<uInt>(raw.size());
+        zs.next_out = chunk.data.data();
+        zs.avail_out = static_cast<uInt>(chunk.data.size());
+
+        // A sync flush ends the piece on a byte boundary without marking
+        // the final block, so the next piece can follow it directly
+        int ret = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+        bool ok = last ? (ret == Z_STREAM_END) : (ret == Z_OK && zs.avail_in == 0);
+        chunk.data.resize(zs.total_out);
+        deflateEnd(&zs);
+        if (!ok) {
+            throw std::runtime_error("writePngParallel: deflate failed");
+        }
+
+        chunk.adler = adler32(adler32(0L, Z_NULL, 0), raw.data(), static_cast<uInt>(raw.size()));
+        chunk.rawLength = raw.size();
+    }
+}
+
+ParallelPngOptions ParallelPngOptions::fromArgs(const sivelab::GraphicsArgs& args) {
+    ParallelPngOptions options;
+    options.numThreads = static_cast<size_t>(std::max(args.numCpus, 0));
+    return options;
+}
+
+void writePngRows(std::ostream& out, size_t width, size_t height, const RowSource& rows,
+                  const EncodeOptions& options) {
+    RowGenerator generator(width, height, rows, options);
+    generator.write(out);
+}
+
+void writePngRows(const std::string& filename, size_t width, size_t height, const RowSource& rows,
+                  const EncodeOptions& options) {
+    std::ofstream stream(filename, std::ios::binary);
+    if (!stream.is_open()) {
+        throw png::std_error(filename);
+    }
+    writePngRows(stream, width, height, rows, options);
+}
+
+void writePngParallel(std::ostream& out, size_t width, size_t height, const RowSource& rows,
+                      const ParallelPngOptions& options) {
+    if (width == 0 || height == 0) {
+        throw std::invalid_argument("writePngParallel: image must not be empty");
+    }
+    if (options.compressionLevel < 0 || options.compressionLevel > 9) {
+        throw std::invalid_argument("writePngParallel: compression level must be 0-9");
+    }
+
+    size_t rowBytes = width * kBytesPerPixel;
+    size_t rowsPerChunk = options.rowsPerChunk;
+    if (rowsPerChunk == 0) {
+        rowsPerChunk = std::max<size_t>(1, kTargetChunkBytes / (rowBytes + 1));
+    }
+    size_t numChunks = (height + rowsPerChunk - 1) / rowsPerChunk;
+
+    size_t numThreads = options.numThreads;
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = std::min(numThreads, numChunks);
+
+    std::vector<DeflatedChunk> chunks(numChunks);
+    std::atomic<size_t> nextChunk(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex lock;
+    std::condition_variable chunkDone;
+
+    auto work = [&]() {
+        PixelEncoder encoder(options.encode);
+        std::vector<vec3> scratch;
+        std::vector<unsigned char> prev(rowBytes), cur(rowBytes), raw, trial(rowBytes + 1);
+
+        while (!failed) {
+            size_t c = nextChunk++;
+            if (c >= numChunks) break;
+
+            try {
+                size_t y0 = c * rowsPerChunk;
+                size_t y1 = std::min(y0 + rowsPerChunk, height);
+                raw.resize((y1 - y0) * (rowBytes + 1));
+
+                // The filters look at the row above, so the first row of a
+                // band re-encodes the last row of the previous band
+                bool havePrev = (y0 > 0) && (options.filter != PngFilter::None);
+                if (havePrev) {
+                    encoder.encode(rows(y0 - 1, scratch), width, prev.data(), 0, y0 - 1);
+                }
+
+                for (size_t y = y0; y < y1; ++y) {
+                    encoder.encode(rows(y, scratch), width, cur.data(), 0, y);
+                    unsigned char* out = &raw[(y - y0) * (rowBytes + 1)];
+                    const unsigned char* above = havePrev ? prev.data() : nullptr;
+
+                    if (options.filter == PngFilter::Adaptive) {
+                        size_t bestCost = SIZE_MAX;
+                        for (int type = 0; type <= 4; ++type) {
+                            filterRow(type, cur.data(), above, rowBytes, trial.data());
+                            size_t cost = filterCost(trial.data() + 1, rowBytes);
+                            if (cost < bestCost) {
+                                bestCost = cost;
+                                std::copy(trial.begin(), trial.end(), out);
+                            }
+                        }
+                    } else {
+                        filterRow(static_cast<int>(options.filter), cur.data(), above, rowBytes, out);
+                    }
+
+                    std::swap(prev, cur);
+                    havePrev = true;
+                }
+
+                DeflatedChunk result;
+                deflateChunk(raw, options, c + 1 == numChunks, result);
+                std::lock_guard<std::mutex> guard(lock);
+                chunks[c] = std::move(result);
+                chunks[c].ready = true;
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(lock);
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+            chunkDone.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back(work);
+    }
+
+    // Signature and header
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.write(reinterpret_cast<const char*>(signature), 8);
+
+    unsigned char ihdr[13];
+    for (int i = 0; i < 4; ++i) {
+        ihdr[i] = static_cast<unsigned char>(static_cast<uint32_t>(width) >> (24 - 8 * i));
+        ihdr[4 + i] = static_cast<unsigned char>(static_cast<uint32_t>(height) >> (24 - 8 * i));
+    }
+    ihdr[8] = 8;   // bit depth
+    ihdr[9] = 2;   // truecolor RGB
+    ihdr[10] = 0;  // deflate
+    ihdr[11] = 0;  // adaptive filtering
+    ihdr[12] = 0;  // no interlace
+    writePngChunk(out, "IHDR", ihdr, sizeof(ihdr));
+
+    // Emit each band as its own IDAT as soon as it and all bands before
+    // it are done.  The first carries the zlib header and the last the
+    // combined Adler-32 of the whole stream.
+    uLong adler = adler32(0L, Z_NULL, 0);
+    for (size_t c = 0; c < numChunks; ++c) {
+        DeflatedChunk chunk;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            chunkDone.wait(guard, [&] { return chunks[c].ready || failed; });
+            if (failed) break;
+            chunk = std::move(chunks[c]);
+        }
+
+        std::vector<unsigned char> idat;
+        if (c == 0) {
+            int level = options.compressionLevel;
+            unsigned char flevel = (level < 2) ? 0 : (level < 6) ? 1 : (level == 6) ? 2 : 3;
+            unsigned char cmf = 0x78;
+            unsigned char flg = static_cast<unsigned char>(flevel << 6);
+            flg = static_cast<unsigned char>(flg + (31 - (cmf * 256 + flg) % 31) % 31);
+            idat.push_back(cmf);
+            idat.push_back(flg);
+        }
+        idat.insert(idat.end(), chunk.data.begin(), chunk.data.end());
+
+        adler = adler32_combine(adler, chunk.adler, static_cast<z_off_t>(chunk.rawLength));
+        if (c + 1 == numChunks) {
+            for (int i = 0; i < 4; ++i) {
+                idat.push_back(static_cast<unsigned char>(adler >> (24 - 8 * i)));
+            }
+        }
+        writePngChunk(out, "IDAT", idat.data(), idat.size());
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    writePngChunk(out, "IEND", nullptr, 0);
+}
+
+void writePngParallel(const std::string& filename, size_t width, size_t height, const RowSource& rows,
+                      const ParallelPngOptions& options) {
+    std::ofstream stream(filename, std::ios::binary);
+    if (!stream.is_open()) {
+        throw png::std_error(filename);
+    }
+    writePngParallel(stream, width, height, rows, options);
+}
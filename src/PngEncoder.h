@@ -0,0 +1,56 @@
+#ifndef PNGENCODER_H
+#define PNGENCODER_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "vec.h"
+#include "FrameBuffer.h"
+#include "PixelEncode.h"
+
+namespace sivelab {
+    class GraphicsArgs;
+}
+
+// Encode a width x height image as 8-bit RGB PNG, pulling one row at a
+// time from rows and converting it straight into libpng's row buffer, so
+// no full-size 8-bit copy of the image is ever made.
+void writePngRows(std::ostream& out, size_t width, size_t height, const RowSource& rows,
+                  const EncodeOptions& options = EncodeOptions());
+void writePngRows(const std::string& filename, size_t width, size_t height, const RowSource& rows,
+                  const EncodeOptions& options = EncodeOptions());
+
+// PNG row filter.  Adaptive picks the filter with the smallest sum of
+// absolute differences for every row, like libpng does.
+enum class PngFilter { None, Sub, Up, Average, Paeth, Adaptive };
+
+struct ParallelPngOptions {
+    // Worker threads; 0 uses all hardware threads
+    size_t numThreads = 0;
+
+    // zlib compression level, 0 (store) to 9 (smallest)
+    int compressionLevel = 6;
+
+    PngFilter filter = PngFilter::Up;
+
+    // Rows deflated together as one independent chunk; 0 picks enough
+    // rows for roughly 128 KB of raw data per chunk
+    size_t rowsPerChunk = 0;
+
+    EncodeOptions encode;
+
+    // Worker count taken from --numcpus
+    static ParallelPngOptions fromArgs(const sivelab::GraphicsArgs& args);
+};
+
+// Encode a PNG on several threads.  Bands of rows are filtered and
+// deflated independently, each ending on a sync flush, and the pieces are
+// stitched into a single zlib stream with a combined Adler-32, the way
+// pigz does.  rows is called concurrently from the worker threads.
+void writePngParallel(std::ostream& out, size_t width, size_t height, const RowSource& rows,
+                      const ParallelPngOptions& options = ParallelPngOptions());
+void writePngParallel(const std::string& filename, size_t width, size_t height, const RowSource& rows,
+                      const ParallelPngOptions& options = ParallelPngOptions());
+
+#endif // PNGENCODER_H
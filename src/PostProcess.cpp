@@ -0,0 +1,352 @@
+#include "PostProcess.h"
+#include "TileScheduler.h"
+#include "handleGraphicsArgs.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    inline float luminance(const vec3& c) {
+        return 0.2126f * c[0] + 0.7152f * c[1] + 0.0722f * c[2];
+    }
+
+    // vec3 is three packed floats, so a span of pixels is a flat run of
+    // 3 * count floats, which the per-channel loops below vectorize over
+    inline float* flat(vec3* pixels) { return &pixels[0][0]; }
+    inline const float* flat(const vec3* pixels) { return &pixels[0][0]; }
+
+    // A rectangle of a tile buffer as a PostRegion
+    PostRegion view(std::vector<vec3>& buffer, long bx0, long by0, size_t stride, long x0, long y0, long x1, long y1) {
+        vec3* origin = buffer.data() + (y0 - by0) * static_cast<long>(stride) + (x0 - bx0);
+        return PostRegion{ origin, stride, x0, y0, x1, y1 };
+    }
+
+    // Make the pixels of r outside the image copies of the nearest edge
+    // pixel, as if the operators had been run on a clamped image
+    void replicateBorder(const PostRegion& r, long width, long height) {
+        const long iy0 = std::max(r.y0, 0L), iy1 = std::min(r.y1, height);
+        for (long y = iy0; y < iy1; ++y) {
+            vec3* row = r.row(y);
+            for (long x = r.x0; x < 0; ++x) row[x - r.x0] = row[-r.x0];
+            for (long x = width; x < r.x1; ++x) row[x - r.x0] = row[width - 1 - r.x0];
+        }
+        for (long y = r.y0; y < iy0; ++y) std::copy(r.row(iy0), r.row(iy0) + r.width(), r.row(y));
+        for (long y = iy1; y < r.y1; ++y) std::copy(r.row(iy1 - 1), r.row(iy1 - 1) + r.width(), r.row(y));
+    }
+
+    // Working buffers reused from tile to tile on each thread, so a pass
+    // only allocates when a thread meets a bigger tile than before.  The
+    // scheduler's workers live for one run; the calling thread keeps its
+    // buffers for the next.
+    struct TileScratch {
+        std::vector<vec3> buffers[2];
+        std::vector<vec3> row;
+        std::vector<vec3> pixels;
+        std::vector<vec3> bright;
+        std::vector<vec3> horizontal;
+        std::vector<float> sum;
+    };
+
+    TileScratch& tileScratch() {
+        thread_local TileScratch scratch;
+        return scratch;
+    }
+
+    struct Band {
+        long y0 = -1, y1 = -1;
+        std::vector<vec3> pixels;
+    };
+
+    // The band of finished rows each thread pulling from a row source is
+    // working through.  Map nodes never move, so a thread can use its
+    // own band without holding the lock.
+    struct BandCache {
+        std::mutex mutex;
+        std::map<std::thread::id, Band> bands;
+    };
+}
+
+void PostOp::applyRow(vec3*, size_t, size_t, size_t, size_t, size_t) const {
+    throw std::logic_error(std::string("PostOp '") + getName() + "' has no per-pixel form");
+}
+
+void PostOp::applyRegion(const PostRegion& in, const PostRegion& out, size_t width, size_t height) const {
+    // A point operator run on a region
+    for (long y = out.y0; y < out.y1; ++y) {
+        std::copy(in.row(y) + (out.x0 - in.x0), in.row(y) + (out.x1 - in.x0), out.row(y));
+        applyRow(out.row(y), static_cast<size_t>(out.width()), static_cast<size_t>(out.x0), static_cast<size_t>(y),
+                 width, height);
+    }
+}
+
+ExposureOp::ExposureOp(float stops)
+    : scale(std::exp2(stops)) {
+}
+
+void ExposureOp::applyRow(vec3* pixels, size_t count, size_t, size_t, size_t, size_t) const {
+    float* f = flat(pixels);
+    for (size_t i = 0; i < 3 * count; ++i) f[i] *= scale;
+}
+
+TonemapOp::TonemapOp(Curve curve)
+    : curve(curve) {
+}
+
+TonemapOp::Curve TonemapOp::curveFromName(const std::string& name) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (Curve c : { Curve::None, Curve::Reinhard, Curve::ACES }) {
+        if (lower == getName(c)) return c;
+    }
+    throw std::invalid_argument("Unknown tonemap curve '" + name + "'");
+}
+
+const char* TonemapOp::getName(Curve curve) {
+    switch (curve) {
+    case Curve::None:     return "none";
+    case Curve::Reinhard: return "reinhard";
+    default:              return "aces";
+    }
+}
+
+void TonemapOp::applyRow(vec3* pixels, size_t count, size_t, size_t, size_t, size_t) const {
+    switch (curve) {
+    case Curve::None:
+        break;
+    case Curve::Reinhard:
+        for (size_t i = 0; i < count; ++i) {
+            pixels[i] *= 1.0f / (1.0f + std::max(luminance(pixels[i]), 0.0f));
+        }
+        break;
+    case Curve::ACES: {
+        float* f = flat(pixels);
+        for (size_t i = 0; i < 3 * count; ++i) {
+            float x = std::max(f[i], 0.0f);
+            float y = (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+            f[i] = std::min(y, 1.0f);
+        }
+        break;
+    }
+    }
+}
+
+VignetteOp::VignetteOp(float strength)
+    : strength(strength) {
+    if (!(strength >= 0.0f && strength <= 1.0f)) {
+        throw std::invalid_argument("VignetteOp: the strength must be in [0, 1]");
+    }
+}
+
+void VignetteOp::applyRow(vec3* pixels, size_t count, size_t x, size_t y, size_t width, size_t height) const {
+    const float cx = 0.5f * width, cy = 0.5f * height;
+    const float scale = strength / (cx * cx + cy * cy);
+    const float dy = y + 0.5f - cy;
+    for (size_t i = 0; i < count; ++i) {
+        float dx = (x + i) + 0.5f - cx;
+        pixels[i] *= 1.0f - scale * (dx * dx + dy * dy);
+    }
+}
+
+ColorGradeOp::ColorGradeOp(const vec3& gain, float contrast, float saturation)
+    : gain(gain), contrast(contrast), saturation(saturation) {
+    if (!(contrast > 0.0f) || !(saturation >= 0.0f)) {
+        throw std::invalid_argument("ColorGradeOp: contrast must be positive and saturation not negative");
+    }
+}
+
+void ColorGradeOp::applyRow(vec3* pixels, size_t count, size_t, size_t, size_t, size_t) const {
+    const float midGrey = 0.18f;
+    for (size_t i = 0; i < count; ++i) {
+        vec3 c(pixels[i][0] * gain[0], pixels[i][1] * gain[1], pixels[i][2] * gain[2]);
+        if (contrast != 1.0f) {
+            for (size_t k = 0; k < 3; ++k) c[k] = midGrey * std::pow(std::max(c[k], 0.0f) / midGrey, contrast);
+        }
+        float l = luminance(c);
+        pixels[i] = vec3(l, l, l) + (c - vec3(l, l, l)) * saturation;
+    }
+}
+
+BloomOp::BloomOp(float intensity, float threshold, size_t radius)
+    : intensity(intensity), threshold(threshold), blurRadius(radius) {
+    if (radius == 0 || !(intensity >= 0.0f)) {
+        throw std::invalid_argument("BloomOp: the radius must be positive and the intensity not negative");
+    }
+    // The kernel reaches three standard deviations
+    const float sigma = radius / 3.0f;
+    float sum = 0.0f;
+    for (long k = -static_cast<long>(radius); k <= static_cast<long>(radius); ++k) {
+        weights.push_back(std::exp(-0.5f * k * k / (sigma * sigma)));
+        sum += weights.back();
+    }
+    for (float& w : weights) w /= sum;
+}
+
+void BloomOp::applyRegion(const PostRegion& in, const PostRegion& out, size_t, size_t) const {
+    const long r = static_cast<long>(blurRadius);
+    const long ow = out.width(), oh = out.height();
+    const size_t taps = weights.size();
+
+    // Bright pass and horizontal blur of every row the vertical blur reads
+    TileScratch& scratch = tileScratch();
+    std::vector<vec3>& bright = scratch.bright;
+    std::vector<vec3>& horizontal = scratch.horizontal;
+    bright.resize(static_cast<size_t>(ow + 2 * r));
+    horizontal.resize(static_cast<size_t>(ow * (oh + 2 * r)));
+    for (long j = 0; j < oh + 2 * r; ++j) {
+        const vec3* src = in.row(out.y0 - r + j) + (out.x0 - r - in.x0);
+        for (size_t i = 0; i < bright.size(); ++i) {
+            float l = luminance(src[i]);
+            bright[i] = l > threshold ? src[i] * ((l - threshold) / l) : vec3(0.0f, 0.0f, 0.0f);
+        }
+        float* dst = flat(horizontal.data() + j * ow);
+        std::fill(dst, dst + 3 * ow, 0.0f);
+        for (size_t k = 0; k < taps; ++k) {
+            const float* b = flat(bright.data() + k);
+            const float w = weights[k];
+            for (long i = 0; i < 3 * ow; ++i) dst[i] += w * b[i];
+        }
+    }
+
+    // Vertical blur, added to the input
+    std::vector<float>& sum = scratch.sum;
+    sum.resize(static_cast<size_t>(3 * ow));
+    for (long j = 0; j < oh; ++j) {
+        std::fill(sum.begin(), sum.end(), 0.0f);
+        for (size_t k = 0; k < taps; ++k) {
+            const float* h = flat(horizontal.data() + (j + static_cast<long>(k)) * ow);
+            const float w = weights[k];
+            for (long i = 0; i < 3 * ow; ++i) sum[i] += w * h[i];
+        }
+        const float* src = flat(in.row(out.y0 + j) + (out.x0 - in.x0));
+        float* dst = flat(out.row(out.y0 + j));
+        for (long i = 0; i < 3 * ow; ++i) dst[i] = src[i] + intensity * sum[i];
+    }
+}
+
+PostPipeline& PostPipeline::add(std::unique_ptr<PostOp> op) {
+    totalRadius += op->radius();
+    ops.push_back(std::move(op));
+    return *this;
+}
+
+void PostPipeline::processRect(const FrameBuffer& in, long x0, long y0, long x1, long y1, vec3* dst, size_t stride) const {
+    const long width = static_cast<long>(in.getWidth()), height = static_cast<long>(in.getHeight());
+    const long h = static_cast<long>(totalRadius);
+
+    // The tile and its halo, with the halo clamped to the image
+    const long bx0 = x0 - h, by0 = y0 - h, bx1 = x1 + h, by1 = y1 + h;
+    const size_t bw = static_cast<size_t>(bx1 - bx0);
+    TileScratch& scratch = tileScratch();
+    std::vector<vec3>* buffers = scratch.buffers;
+    buffers[0].resize(bw * static_cast<size_t>(by1 - by0));
+    if (h > 0) buffers[1].resize(buffers[0].size());
+
+    for (long y = by0; y < by1; ++y) {
+        const vec3* src = in.getRow(static_cast<size_t>(std::clamp(y, 0L, height - 1)), scratch.row);
+        vec3* row = buffers[0].data() + (y - by0) * static_cast<long>(bw);
+        for (long x = bx0; x < bx1; ++x) row[x - bx0] = src[std::clamp(x, 0L, width - 1)];
+    }
+
+    // Each operator with a radius narrows the part of the buffer that
+    // holds finished pixels
+    size_t current = 0;
+    long vx0 = bx0, vy0 = by0, vx1 = bx1, vy1 = by1;
+    for (const auto& op : ops) {
+        const long r = static_cast<long>(op->radius());
+        if (r == 0) {
+            const long cx0 = std::max(vx0, 0L), cx1 = std::min(vx1, width);
+            for (long y = std::max(vy0, 0L); y < std::min(vy1, height); ++y) {
+                vec3* row = buffers[current].data() + (y - by0) * static_cast<long>(bw) + (cx0 - bx0);
+                op->applyRow(row, static_cast<size_t>(cx1 - cx0), static_cast<size_t>(cx0), static_cast<size_t>(y),
+                             in.getWidth(), in.getHeight());
+            }
+        } else {
+            vx0 += r; vy0 += r; vx1 -= r; vy1 -= r;
+            const long ox0 = std::max(vx0, 0L), oy0 = std::max(vy0, 0L);
+            const long ox1 = std::min(vx1, width), oy1 = std::min(vy1, height);
+            PostRegion src = view(buffers[current], bx0, by0, bw, ox0 - r, oy0 - r, ox1 + r, oy1 + r);
+            PostRegion out = view(buffers[1 - current], bx0, by0, bw, ox0, oy0, ox1, oy1);
+            op->applyRegion(src, out, in.getWidth(), in.getHeight());
+            current = 1 - current;
+        }
+        replicateBorder(view(buffers[current], bx0, by0, bw, vx0, vy0, vx1, vy1), width, height);
+    }
+
+    for (long y = y0; y < y1; ++y) {
+        const vec3* row = buffers[current].data() + (y - by0) * static_cast<long>(bw) + (x0 - bx0);
+        std::copy(row, row + (x1 - x0), dst + (y - y0) * static_cast<long>(stride));
+    }
+}
+
+void PostPipeline::apply(const FrameBuffer& in, FrameBuffer& out, TileScheduler& scheduler) const {
+    if (&in == &out && totalRadius > 0) {
+        // Tiles would read halo pixels that other tiles have already written
+        FrameBuffer copy(in);
+        apply(copy, out, scheduler);
+        return;
+    }
+    if (out.getWidth() != in.getWidth() || out.getHeight() != in.getHeight()) {
+        out = FrameBuffer(in.getWidth(), in.getHeight(), in.getLayout());
+    }
+    scheduler.run(in, [&](const Tile& tile) {
+        std::vector<vec3>& pixels = tileScratch().pixels;
+        pixels.resize(tile.width() * tile.height());
+        processRect(in, static_cast<long>(tile.x0), static_cast<long>(tile.y0), static_cast<long>(tile.x1),
+                    static_cast<long>(tile.y1), pixels.data(), tile.width());
+        for (size_t y = tile.y0; y < tile.y1; ++y) {
+            const vec3* row = pixels.data() + (y - tile.y0) * tile.width();
+            for (size_t x = tile.x0; x < tile.x1; ++x) out(x, y) = row[x - tile.x0];
+        }
+    });
+}
+
+void PostPipeline::apply(const FrameBuffer& in, FrameBuffer& out) const {
+    TileScheduler scheduler(0, 64);
+    apply(in, out, scheduler);
+}
+
+RowSource PostPipeline::rowSource(const FrameBuffer& in) const {
+    const size_t width = in.getWidth(), height = in.getHeight();
+    if (totalRadius == 0) {
+        return [this, &in, width, height](size_t y, std::vector<vec3>& scratch) -> const vec3* {
+            scratch.resize(width);
+            in.copyRow(y, scratch.data());
+            for (const auto& op : ops) op->applyRow(scratch.data(), width, 0, y, width, height);
+            return scratch.data();
+        };
+    }
+
+    // Bands tall enough that the halo rows read above and below are a
+    // small part of the work
+    const long bandHeight = std::max(32L, 4 * static_cast<long>(totalRadius));
+    auto cache = std::make_shared<BandCache>();
+    return [this, &in, cache, bandHeight, width, height](size_t y, std::vector<vec3>&) -> const vec3* {
+        Band* band;
+        {
+            std::lock_guard<std::mutex> lock(cache->mutex);
+            band = &cache->bands[std::this_thread::get_id()];
+        }
+        const long row = static_cast<long>(y);
+        if (row < band->y0 || row >= band->y1) {
+            band->y0 = row / bandHeight * bandHeight;
+            band->y1 = std::min(band->y0 + bandHeight, static_cast<long>(height));
+            band->pixels.resize(width * static_cast<size_t>(band->y1 - band->y0));
+            processRect(in, 0, band->y0, static_cast<long>(width), band->y1, band->pixels.data(), width);
+        }
+        return band->pixels.data() + (row - band->y0) * static_cast<long>(width);
+    };
+}
+
+PostPipeline PostPipeline::fromArgs(const sivelab::GraphicsArgs& args) {
+    PostPipeline pipeline;
+    if (args.exposure != 0.0f) pipeline.add(std::make_unique<ExposureOp>(args.exposure));
+    if (args.bloom > 0.0f) pipeline.add(std::make_unique<BloomOp>(args.bloom));
+    TonemapOp::Curve curve = TonemapOp::curveFromName(args.tonemapName);
+    if (curve != TonemapOp::Curve::None) pipeline.add(std::make_unique<TonemapOp>(curve));
+    if (args.vignette > 0.0f) pipeline.add(std::make_unique<VignetteOp>(args.vignette));
+    return pipeline;
+}
@@ -0,0 +1,175 @@
+#ifndef POSTPROCESS_H
+#define POSTPROCESS_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "vec.h"
+#include "FrameBuffer.h"
+
+namespace sivelab {
+    class GraphicsArgs;
+}
+
+class TileScheduler;
+
+// Pixels of the rectangle [x0, x1) x [y0, y1) in image coordinates,
+// stored row-major with stride pixels between rows
+struct PostRegion {
+    vec3* pixels;
+    size_t stride;
+    long x0, y0, x1, y1;
+
+    long width() const { return x1 - x0; }
+    long height() const { return y1 - y0; }
+
+    // Row y, starting at column x0
+    vec3* row(long y) const { return pixels + (y - y0) * static_cast<long>(stride); }
+    vec3& at(long x, long y) const { return row(y)[x - x0]; }
+};
+
+// One step of a PostPipeline.  Point operators change each pixel on its
+// own and implement applyRow.  Operators with a radius also read the
+// pixels up to radius() away and implement applyRegion; the pipeline
+// gives every tile a halo wide enough for them.  Pixels beyond the image
+// edge repeat the nearest edge pixel.
+class PostOp {
+public:
+    virtual ~PostOp() = default;
+
+    virtual const char* getName() const = 0;
+
+    // Pixels read on each side of the one being computed
+    virtual size_t radius() const { return 0; }
+
+    // Transform count pixels of row y, starting at column x, in place.
+    // width and height are those of the whole image.
+    virtual void applyRow(vec3* pixels, size_t count, size_t x, size_t y, size_t width, size_t height) const;
+
+    // Compute every pixel of out from in, which covers out grown by
+    // radius() on all sides
+    virtual void applyRegion(const PostRegion& in, const PostRegion& out, size_t width, size_t height) const;
+};
+
+// Multiplies by 2^stops
+class ExposureOp : public PostOp {
+public:
+    explicit ExposureOp(float stops);
+    const char* getName() const override { return "exposure"; }
+    void applyRow(vec3* pixels, size_t count, size_t x, size_t y, size_t width, size_t height) const override;
+
+private:
+    float scale;
+};
+
+// Maps HDR color into [0, 1].  Reinhard scales by 1 / (1 + luminance),
+// keeping hue; ACES is Narkowicz's fit to the ACES filmic curve, applied
+// per channel.
+class TonemapOp : public PostOp {
+public:
+    enum class Curve { None, Reinhard, ACES };
+
+    explicit TonemapOp(Curve curve);
+
+    // "none", "reinhard" or "aces"; throws std::invalid_argument
+    static Curve curveFromName(const std::string& name);
+    static const char* getName(Curve curve);
+
+    const char* getName() const override { return getName(curve); }
+    Curve getCurve() const { return curve; }
+    void applyRow(vec3* pixels, size_t count, size_t x, size_t y, size_t width, size_t height) const override;
+
+private:
+    Curve curve;
+};
+
+// Darkens toward the corners by 1 - strength * r^2, where r is the
+// distance from the image center relative to the half diagonal
+class VignetteOp : public PostOp {
+public:
+    explicit VignetteOp(float strength);
+    const char* getName() const override { return "vignette"; }
+    void applyRow(vec3* pixels, size_t count, size_t x, size_t y, size_t width, size_t height) const override;
+
+private:
+    float strength;
+};
+
+// Per-channel gain, then contrast around mid grey (0.18) and saturation
+// around luminance
+class ColorGradeOp : public PostOp {
+public:
+    ColorGradeOp(const vec3& gain, float contrast = 1.0f, float saturation = 1.0f);
+    const char* getName() const override { return "grade"; }
+    void applyRow(vec3* pixels, size_t count, size_t x, size_t y, size_t width, size_t height) const override;
+
+private:
+    vec3 gain;
+    float contrast;
+    float saturation;
+};
+
+// Adds intensity times a Gaussian blur of the light above threshold.
+// The blur reaches radius pixels, so it is done within the tile halo.
+class BloomOp : public PostOp {
+public:
+    BloomOp(float intensity, float threshold = 1.0f, size_t radius = 16);
+    const char* getName() const override { return "bloom"; }
+    size_t radius() const override { return blurRadius; }
+    void applyRegion(const PostRegion& in, const PostRegion& out, size_t width, size_t height) const override;
+
+private:
+    float intensity;
+    float threshold;
+    size_t blurRadius;
+    std::vector<float> weights;
+};
+
+// A chain of PostOps run as a single pass.  Each tile is read once with
+// a halo as wide as the radii of all the operators together, every
+// operator is run on it while it is in cache, and only the finished tile
+// is written out.  Quantizing to 8 bits is left to the image writers,
+// which can pull finished rows straight from rowSource.  The result does
+// not depend on the tile size or thread count.
+class PostPipeline {
+public:
+    PostPipeline() = default;
+    PostPipeline(PostPipeline&&) = default;
+    PostPipeline& operator=(PostPipeline&&) = default;
+
+    PostPipeline& add(std::unique_ptr<PostOp> op);
+
+    size_t size() const { return ops.size(); }
+    bool empty() const { return ops.empty(); }
+    const PostOp& getOp(size_t i) const { return *ops[i]; }
+
+    // Halo each tile is read with: the sum of the operator radii
+    size_t halo() const { return totalRadius; }
+
+    // Process in into out, which is resized as needed and keeps in's
+    // layout.  out may be in itself.
+    void apply(const FrameBuffer& in, FrameBuffer& out, TileScheduler& scheduler) const;
+    void apply(const FrameBuffer& in, FrameBuffer& out) const;
+
+    // Finished rows of in for writePngRows and the other image writers.
+    // Rows are made a band at a time, one band per calling thread, so
+    // the parallel PNG encoder can pull from it too.  The pipeline and
+    // in must outlive the source.
+    RowSource rowSource(const FrameBuffer& in) const;
+
+    // Exposure, bloom, tonemap and vignette from --exposure, --bloom,
+    // --tonemap and --vignette, in that order.  Operators left at their
+    // defaults are not added.
+    static PostPipeline fromArgs(const sivelab::GraphicsArgs& args);
+
+private:
+    // Run the whole chain for the rectangle [x0, x1) x [y0, y1) of in,
+    // writing it row-major to dst with the given stride
+    void processRect(const FrameBuffer& in, long x0, long y0, long x1, long y1, vec3* dst, size_t stride) const;
+
+    std::vector<std::unique_ptr<PostOp>> ops;
+    size_t totalRadius = 0;
+};
+
+#endif // POSTPROCESS_H
@@ -0,0 +1,319 @@
+#include "SharedFrame.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "CropWindow.h"
+#include "handleGraphicsArgs.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char kMagic[8] = { 'C', 'S', '4', '2', '1', '2', 'F', 'B' };
+    const uint32_t kVersion = 1;
+
+    // The counters live in memory shared between processes, so they must
+    // not depend on a lock inside the process
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+    static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+    // At the start of the segment.  Followed by tilesX * tilesY tile
+    // versions and then the tiles' pixels, tileSize^2 each.
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t width, height, tileSize;
+        uint32_t tilesX, tilesY;
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> passes;
+        std::atomic<uint32_t> finished;
+    };
+
+    size_t tilesAlong(size_t pixels, size_t tileSize) { return (pixels + tileSize - 1) / tileSize; }
+
+    size_t segmentBytes(size_t tilesX, size_t tilesY, size_t tileSize) {
+        size_t tiles = tilesX * tilesY;
+        return sizeof(Header) + tiles * sizeof(std::atomic<uint64_t>) + tiles * tileSize * tileSize * sizeof(vec3);
+    }
+
+    std::runtime_error systemError(const std::string& what) {
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
+}
+
+// The mapped segment and pointers to its parts
+struct SharedFrameSegment {
+    void* address = nullptr;
+    size_t bytes = 0;
+    Header* header = nullptr;
+    std::atomic<uint64_t>* versions = nullptr;
+    vec3* pixels = nullptr;
+
+    SharedFrameSegment(void* address, size_t bytes, size_t tiles)
+        : address(address), bytes(bytes), header(static_cast<Header*>(address)) {
+        versions = reinterpret_cast<std::atomic<uint64_t>*>(header + 1);
+        pixels = reinterpret_cast<vec3*>(versions + tiles);
+    }
+
+    ~SharedFrameSegment() {
+#ifndef WIN32
+        ::munmap(address, bytes);
+#endif
+    }
+};
+
+#ifndef WIN32
+
+SharedFrameWriter::SharedFrameWriter(const std::string& name, size_t width, size_t height, size_t tileSize)
+    : name(name), width(width), height(height), tileSize(tileSize) {
+    if (width == 0 || height == 0 || tileSize == 0) {
+        throw std::invalid_argument("SharedFrameWriter: the frame and tile size must not be zero");
+    }
+    const size_t tilesX = tilesAlong(width, tileSize), tilesY = tilesAlong(height, tileSize);
+    const size_t bytes = segmentBytes(tilesX, tilesY, tileSize);
+
+    // Start from an empty object so readers never see a stale header
+    ::shm_unlink(name.c_str());
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        throw systemError("Could not create shared memory " + name);
+    }
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw systemError("Could not resize shared memory " + name);
+    }
+    void* address = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        ::shm_unlink(name.c_str());
+        throw systemError("Could not map shared memory " + name);
+    }
+    segment = new SharedFrameSegment(address, bytes, tilesX * tilesY);
+
+    // ftruncate zero-filled everything, so all versions start at 0.  The
+    // magic goes in last; a reader that sees it sees the rest too.
+    Header* header = segment->header;
+    header->version = kVersion;
+    header->width = static_cast<uint32_t>(width);
+    header->height = static_cast<uint32_t>(height);
+    header->tileSize = static_cast<uint32_t>(tileSize);
+    header->tilesX = static_cast<uint32_t>(tilesX);
+    header->tilesY = static_cast<uint32_t>(tilesY);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, kMagic, sizeof(kMagic));
+}
+
+SharedFrameWriter::~SharedFrameWriter() {
+    finish();
+    delete segment;
+    ::shm_unlink(name.c_str());
+}
+
+SharedFrameReader::SharedFrameReader(const std::string& name) {
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw systemError("Could not open shared memory " + name);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw systemError("Could not stat shared memory " + name);
+    }
+    const size_t bytes = static_cast<size_t>(info.st_size);
+    if (bytes < sizeof(Header)) {
+        ::close(fd);
+        throw std::runtime_error("Shared memory " + name + " is not a frame");
+    }
+    void* address = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        throw systemError("Could not map shared memory " + name);
+    }
+
+    const Header* header = static_cast<const Header*>(address);
+    bool valid = std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && header->version == kVersion && header->tileSize > 0 &&
+            header->tilesX == tilesAlong(header->width, header->tileSize) &&
+            header->tilesY == tilesAlong(header->height, header->tileSize) &&
+            bytes >= segmentBytes(header->tilesX, header->tilesY, header->tileSize);
+    if (!valid) {
+        ::munmap(address, bytes);
+        throw std::runtime_error("Shared memory " + name + " is not a frame or is not ready yet");
+    }
+    width = header->width;
+    height = header->height;
+    tileSize = header->tileSize;
+    tilesX = header->tilesX;
+    tilesY = header->tilesY;
+    segment = new SharedFrameSegment(address, bytes, tilesX * tilesY);
+    seen.assign(tilesX * tilesY, 0);
+}
+
+#else
+
+SharedFrameWriter::SharedFrameWriter(const std::string&, size_t, size_t, size_t) {
+    throw std::runtime_error("Shared-memory previews are not supported on this platform");
+}
+
+SharedFrameWriter::~SharedFrameWriter() = default;
+
+SharedFrameReader::SharedFrameReader(const std::string&) {
+    throw std::runtime_error("Shared-memory previews are not supported on this platform");
+}
+
+#endif
+
+std::unique_ptr<SharedFrameWriter> SharedFrameWriter::fromArgs(const sivelab::GraphicsArgs& args) {
+    if (args.previewName.empty()) return nullptr;
+    CropWindow crop = CropWindow::fromArgs(args);
+    return std::make_unique<SharedFrameWriter>(args.previewName, crop.width, crop.height);
+}
+
+void SharedFrameWriter::publishTiles(const Tile& tile, const std::function<void(size_t, size_t, size_t, size_t, vec3*)>& fill) {
+    auto onGrid = [this](size_t v, size_t edge) { return v % tileSize == 0 || v == edge; };
+    if (!onGrid(tile.x0, width) || !onGrid(tile.x1, width) || !onGrid(tile.y0, height) || !onGrid(tile.y1, height) ||
+        tile.x1 > width || tile.y1 > height) {
+        throw std::invalid_argument("SharedFrameWriter: tiles must lie on the shared tile grid");
+    }
+    const size_t tilesX = segment->header->tilesX;
+    for (size_t ty = tile.y0 / tileSize; ty * tileSize < tile.y1; ++ty) {
+        for (size_t tx = tile.x0 / tileSize; tx * tileSize < tile.x1; ++tx) {
+            const size_t index = ty * tilesX + tx;
+            std::atomic<uint64_t>& version = segment->versions[index];
+            const uint64_t v = version.load(std::memory_order_relaxed);
+            version.store(v + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            fill(tx * tileSize, ty * tileSize, std::min((tx + 1) * tileSize, width), std::min((ty + 1) * tileSize, height),
+                 segment->pixels + index * tileSize * tileSize);
+
+            version.store(v + 2, std::memory_order_release);
+        }
+    }
+    segment->header->sequence.fetch_add(1, std::memory_order_release);
+}
+
+void SharedFrameWriter::publish(const AccumulationBuffer& accum, const Tile& tile) {
+    if (accum.getWidth() != width || accum.getHeight() != height) {
+        throw std::invalid_argument("SharedFrameWriter: the buffer must be the size of the frame");
+    }
+    publishTiles(tile, [&](size_t x0, size_t y0, size_t x1, size_t y1, vec3* dst) {
+        for (size_t y = y0; y < y1; ++y) {
+            vec3* row = dst + (y - y0) * tileSize;
+            for (size_t x = x0; x < x1; ++x) row[x - x0] = accum.getMean(x, y);
+        }
+    });
+}
+
+void SharedFrameWriter::publish(const FrameBuffer& fb, const Tile& tile) {
+    if (fb.getWidth() != width || fb.getHeight() != height) {
+        throw std::invalid_argument("SharedFrameWriter: the buffer must be the size of the frame");
+    }
+    publishTiles(tile, [&](size_t x0, size_t y0, size_t x1, size_t y1, vec3* dst) {
+        for (size_t y = y0; y < y1; ++y) {
+            vec3* row = dst + (y - y0) * tileSize;
+            for (size_t x = x0; x < x1; ++x) row[x - x0] = fb(x, y);
+        }
+    });
+}
+
+void SharedFrameWriter::publish(const AccumulationBuffer& accum) {
+    publish(accum, Tile{ 0, 0, 0, width, height });
+}
+
+void SharedFrameWriter::publish(const FrameBuffer& fb) {
+    publish(fb, Tile{ 0, 0, 0, width, height });
+}
+
+void SharedFrameWriter::setPasses(uint64_t passes) {
+    segment->header->passes.store(passes, std::memory_order_relaxed);
+    segment->header->sequence.fetch_add(1, std::memory_order_release);
+}
+
+void SharedFrameWriter::finish() {
+    if (!segment) return;
+    segment->header->finished.store(1, std::memory_order_relaxed);
+    segment->header->sequence.fetch_add(1, std::memory_order_release);
+}
+
+SharedFrameReader::~SharedFrameReader() {
+    delete segment;
+}
+
+Tile SharedFrameReader::getTile(size_t index) const {
+    const size_t tx = index % tilesX, ty = index / tilesX;
+    return Tile{ index, tx * tileSize, ty * tileSize,
+                 std::min((tx + 1) * tileSize, width), std::min((ty + 1) * tileSize, height) };
+}
+
+uint64_t SharedFrameReader::getSequence() const {
+    return segment->header->sequence.load(std::memory_order_acquire);
+}
+
+uint64_t SharedFrameReader::getPasses() const {
+    return segment->header->passes.load(std::memory_order_relaxed);
+}
+
+bool SharedFrameReader::isFinished() const {
+    return segment->header->finished.load(std::memory_order_acquire) != 0;
+}
+
+std::vector<size_t> SharedFrameReader::poll(const std::function<vec3*(size_t)>& dst) {
+    return pollTiles(dst, [](size_t, const vec3*) {});
+}
+
+std::vector<size_t> SharedFrameReader::poll(FrameBuffer& fb) {
+    if (fb.getWidth() != width || fb.getHeight() != height) {
+        throw std::invalid_argument("SharedFrameReader: the buffer must be the size of the frame");
+    }
+    std::vector<vec3> scratch(tileSize * tileSize);
+    return pollTiles([&](size_t) { return scratch.data(); }, [&](size_t index, const vec3* pixels) {
+        Tile tile = getTile(index);
+        for (size_t y = tile.y0; y < tile.y1; ++y) {
+            const vec3* row = pixels + (y - tile.y0) * tileSize;
+            for (size_t x = tile.x0; x < tile.x1; ++x) fb(x, y) = row[x - tile.x0];
+        }
+    });
+}
+
+std::vector<size_t> SharedFrameReader::pollTiles(const std::function<vec3*(size_t)>& dst,
+                                                 const std::function<void(size_t, const vec3*)>& done) {
+    std::vector<size_t> copied;
+    const uint64_t sequence = getSequence();
+    if (sequence == lastSequence) return copied;
+
+    bool complete = true;
+    const size_t tileBytes = tileSize * tileSize * sizeof(vec3);
+    for (size_t index = 0; index < seen.size(); ++index) {
+        const std::atomic<uint64_t>& version = segment->versions[index];
+        const uint64_t before = version.load(std::memory_order_acquire);
+        if (before == seen[index]) continue;
+        if (before & 1) {
+            complete = false;
+            continue;
+        }
+        vec3* pixels = dst(index);
+        std::memcpy(pixels, segment->pixels + index * tileSize * tileSize, tileBytes);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version.load(std::memory_order_relaxed) != before) {
+            complete = false;
+            continue;
+        }
+        seen[index] = before;
+        copied.push_back(index);
+        done(index, pixels);
+    }
+
+    // Torn tiles are retried on the next poll even if nothing new is
+    // published in between
+    if (complete) lastSequence = sequence;
+    return copied;
+}
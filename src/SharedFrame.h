@@ -0,0 +1,128 @@
+#ifndef SHAREDFRAME_H
+#define SHAREDFRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "vec.h"
+#include "AccumulationBuffer.h"
+#include "FrameBuffer.h"
+#include "TileScheduler.h"
+
+namespace sivelab {
+    class GraphicsArgs;
+}
+
+// A progressive render published through a POSIX shared-memory segment
+// so a viewer in another process can watch it.  The segment holds a
+// header, one version counter per tile and the pixels as linear float
+// RGB, each tile stored contiguously.  Tiles form a fixed grid of
+// tileSize x tileSize pixels.
+//
+// Every tile is a seqlock: the writer makes its version odd, writes the
+// pixels and makes it even again.  A reader copies a tile without any
+// locking and keeps the copy only if the version was even and the same
+// before and after, so the render never waits for a viewer.  A frame
+// sequence counter is bumped after every publish so an idle reader can
+// tell at a glance that nothing changed.
+
+struct SharedFrameSegment;
+
+// Creates the segment and publishes into it.  POSIX only.
+class SharedFrameWriter {
+public:
+    // name is a shared-memory object name such as "/cs4212-preview".  An
+    // existing segment of that name is replaced.
+    SharedFrameWriter(const std::string& name, size_t width, size_t height, size_t tileSize = 32);
+
+    // Marks the render finished and removes the name; attached readers
+    // keep their mapping
+    ~SharedFrameWriter();
+
+    SharedFrameWriter(const SharedFrameWriter&) = delete;
+    SharedFrameWriter& operator=(const SharedFrameWriter&) = delete;
+
+    // A writer for --preview sized to the image the render produces (the
+    // crop under --crop), or null when --preview is not given
+    static std::unique_ptr<SharedFrameWriter> fromArgs(const sivelab::GraphicsArgs& args);
+
+    const std::string& getName() const { return name; }
+    size_t getWidth() const { return width; }
+    size_t getHeight() const { return height; }
+    size_t getTileSize() const { return tileSize; }
+
+    // Publish the pixels under tile, whose edges must lie on the tile
+    // grid or the image edge, e.g. a tile from a TileScheduler with a
+    // tile size that is a multiple of this one.  Calls for different tiles may run
+    // concurrently.  AccumulationBuffers are published as their means.
+    void publish(const AccumulationBuffer& accum, const Tile& tile);
+    void publish(const FrameBuffer& fb, const Tile& tile);
+
+    // Publish the whole image
+    void publish(const AccumulationBuffer& accum);
+    void publish(const FrameBuffer& fb);
+
+    // Completed passes, shown by the viewer
+    void setPasses(uint64_t passes);
+
+    // Tell readers no more updates will come
+    void finish();
+
+private:
+    // Run fill(x0, y0, x1, y1, dst) for every grid tile under tile, with
+    // the tile's version odd
+    void publishTiles(const Tile& tile, const std::function<void(size_t, size_t, size_t, size_t, vec3*)>& fill);
+
+    std::string name;
+    size_t width, height, tileSize;
+    SharedFrameSegment* segment = nullptr;
+};
+
+// Attaches read-only to a segment made by SharedFrameWriter
+class SharedFrameReader {
+public:
+    // Throws std::runtime_error if the segment does not exist or is not
+    // a complete frame segment
+    explicit SharedFrameReader(const std::string& name);
+    ~SharedFrameReader();
+
+    SharedFrameReader(const SharedFrameReader&) = delete;
+    SharedFrameReader& operator=(const SharedFrameReader&) = delete;
+
+    size_t getWidth() const { return width; }
+    size_t getHeight() const { return height; }
+    size_t getTileSize() const { return tileSize; }
+    size_t getTileCount() const { return tilesX * tilesY; }
+
+    // Pixel rectangle of grid tile index
+    Tile getTile(size_t index) const;
+
+    uint64_t getSequence() const;
+    uint64_t getPasses() const;
+    bool isFinished() const;
+
+    // Copy every tile that changed since the last poll.  dst(index) gives
+    // where tile index goes, room for getTileSize()^2 pixels in rows of
+    // getTileSize(); only the tile's own width and height are valid.
+    // Returns the indices that were copied.  A tile caught mid-write is
+    // left for the next poll.
+    std::vector<size_t> poll(const std::function<vec3*(size_t)>& dst);
+
+    // Copy the changed tiles into fb, which must match the frame size
+    std::vector<size_t> poll(FrameBuffer& fb);
+
+private:
+    // poll, calling done(index, pixels) after each tile is copied
+    std::vector<size_t> pollTiles(const std::function<vec3*(size_t)>& dst,
+                                  const std::function<void(size_t, const vec3*)>& done);
+
+    size_t width, height, tileSize, tilesX, tilesY;
+    SharedFrameSegment* segment = nullptr;
+    uint64_t lastSequence = 0;
+    std::vector<uint64_t> seen;
+};
+
+#endif // SHAREDFRAME_H
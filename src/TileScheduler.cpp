@@ -0,0 +1,191 @@
+#include "TileScheduler.h"
+#include "handleGraphicsArgs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+namespace {
+    // Position of tile (x, y) along a Hilbert curve covering an n x n
+    // grid, n a power of two
+    size_t hilbertIndex(size_t n, size_t x, size_t y) {
+        size_t d = 0;
+        for (size_t s = n / 2; s > 0; s /= 2) {
+            size_t rx = (x & s) > 0;
+            size_t ry = (y & s) > 0;
+            d += s * s * ((3 * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = s - 1 - x;
+                    y = s - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    // A deque of tile positions guarded by its own lock.  The owner
+    // works from the front, thieves take from the back.
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<size_t> tiles;
+
+        bool pop(size_t& tile) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (tiles.empty()) return false;
+            tile = tiles.front();
+            tiles.pop_front();
+            return true;
+        }
+
+        bool steal(size_t& tile) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (tiles.empty()) return false;
+            tile = tiles.back();
+            tiles.pop_back();
+            return true;
+        }
+    };
+}
+
+TileScheduler::TileScheduler(size_t numThreads, size_t tileSize, Order order)
+    : numThreads(numThreads), tileSize(std::max<size_t>(tileSize, 1)), order(order) {
+    if (this->numThreads == 0) {
+        this->numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+TileScheduler::TileScheduler(const sivelab::GraphicsArgs& args, size_t tileSize, Order order)
+    : TileScheduler(static_cast<size_t>(std::max(args.numCpus, 0)), tileSize, order) {
+}
+
+std::vector<Tile> TileScheduler::makeTiles(size_t width, size_t height) const {
+    size_t tilesX = (width + tileSize - 1) / tileSize;
+    size_t tilesY = (height + tileSize - 1) / tileSize;
+
+    std::vector<Tile> tiles;
+    tiles.reserve(tilesX * tilesY);
+    for (size_t ty = 0; ty < tilesY; ++ty) {
+        for (size_t tx = 0; tx < tilesX; ++tx) {
+            size_t x0 = tx * tileSize;
+            size_t y0 = ty * tileSize;
+            tiles.push_back({ tiles.size(), x0, y0, std::min(x0 + tileSize, width), std::min(y0 + tileSize, height) });
+        }
+    }
+
+    if (order == Order::Spiral) {
+        // Ring by ring outward from the center tile, each ring walked by angle
+        double cx = (tilesX - 1) / 2.0;
+        double cy = (tilesY - 1) / 2.0;
+        auto ring = [&](const Tile& t) {
+            return std::max(std::abs(t.x0 / double(tileSize) - cx), std::abs(t.y0 / double(tileSize) - cy));
+        };
+        auto angle = [&](const Tile& t) {
+            return std::atan2(t.y0 / double(tileSize) - cy, t.x0 / double(tileSize) - cx);
+        };
+        std::stable_sort(tiles.begin(), tiles.end(), [&](const Tile& a, const Tile& b) {
+            double ra = ring(a), rb = ring(b);
+            if (ra != rb) return ra < rb;
+            return angle(a) < angle(b);
+        });
+    } else if (order == Order::Hilbert) {
+        size_t n = 1;
+        while (n < std::max(tilesX, tilesY)) n *= 2;
+        std::stable_sort(tiles.begin(), tiles.end(), [&](const Tile& a, const Tile& b) {
+            return hilbertIndex(n, a.x0 / tileSize, a.y0 / tileSize) < hilbertIndex(n, b.x0 / tileSize, b.y0 / tileSize);
+        });
+    }
+
+    return tiles;
+}
+
+void TileScheduler::run(size_t width, size_t height, const Kernel& kernel) {
+    std::vector<Tile> tiles = makeTiles(width, height);
+    timings.assign(tiles.size(), TileTiming{ 0, 0, 0.0 });
+    if (tiles.empty()) return;
+
+    size_t workers = std::min(numThreads, tiles.size());
+
+    // Deal the tiles out round-robin so that every worker starts near
+    // the front of the requested order
+    std::vector<WorkQueue> queues(workers);
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        queues[i % workers].tiles.push_back(i);
+    }
+
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex errorLock;
+
+    auto work = [&](size_t self) {
+        size_t pos;
+        while (!failed.load(std::memory_order_relaxed)) {
+            bool found = queues[self].pop(pos);
+            for (size_t k = 1; !found && k < workers; ++k) {
+                found = queues[(self + k) % workers].steal(pos);
+            }
+            if (!found) break;
+
+            const Tile& tile = tiles[pos];
+            auto start = std::chrono::steady_clock::now();
+            try {
+                kernel(tile);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(errorLock);
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            timings[tile.index] = TileTiming{ tile.index, self, elapsed.count() };
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t w = 1; w < workers; ++w) {
+        threads.emplace_back(work, w);
+    }
+    work(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void TileScheduler::printTimings(std::ostream& out) const {
+    if (timings.empty()) {
+        out << "No tiles rendered" << std::endl;
+        return;
+    }
+
+    double minTime = timings[0].seconds, maxTime = 0.0, total = 0.0;
+    std::vector<double> busy(numThreads, 0.0);
+    for (const auto& t : timings) {
+        minTime = std::min(minTime, t.seconds);
+        maxTime = std::max(maxTime, t.seconds);
+        total += t.seconds;
+        if (t.worker < busy.size()) busy[t.worker] += t.seconds;
+    }
+    double mean = total / timings.size();
+    double busiest = *std::max_element(busy.begin(), busy.end());
+
+    out << std::fixed << std::setprecision(6);
+    out << "Tiles: " << timings.size() << ", threads: " << numThreads << std::endl;
+    out << "Tile time (s): min " << minTime << ", mean " << mean << ", max " << maxTime << std::endl;
+    for (size_t w = 0; w < busy.size(); ++w) {
+        out << "  worker " << w << " busy " << busy[w] << " s" << std::endl;
+    }
+    // Ratio of the busiest worker to a perfect split; 1.0 is ideal
+    out << "Load imbalance: " << (total > 0.0 ? busiest / (total / numThreads) : 1.0) << std::endl;
+}
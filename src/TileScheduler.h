@@ -0,0 +1,76 @@
+#ifndef TILESCHEDULER_H
+#define TILESCHEDULER_H
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <vector>
+#include "FrameBuffer.h"
+
+namespace sivelab {
+    class GraphicsArgs;
+}
+
+// A rectangular block of pixels covering [x0, x1) x [y0, y1)
+struct Tile {
+    size_t index;
+    size_t x0, y0;
+    size_t x1, y1;
+
+    size_t width() const { return x1 - x0; }
+    size_t height() const { return y1 - y0; }
+};
+
+// How long one tile took to render and which worker rendered it
+struct TileTiming {
+    size_t tileIndex;
+    size_t worker;
+    double seconds;
+};
+
+// Splits an image into square tiles and renders them on a pool of
+// worker threads.  Every worker owns a deque of tiles and, once it runs
+// dry, steals from the back of another worker's deque, so uneven tile
+// costs are balanced without a central queue.
+class TileScheduler {
+public:
+    // Order in which tiles are handed out.  Spiral starts at the image
+    // center, Hilbert keeps consecutive tiles spatially close.
+    enum class Order { Scanline, Spiral, Hilbert };
+
+    using Kernel = std::function<void(const Tile&)>;
+
+    // A thread count of 0 uses all hardware threads
+    TileScheduler(size_t numThreads, size_t tileSize = 16, Order order = Order::Scanline);
+
+    // Sizes the pool from --numcpus
+    explicit TileScheduler(const sivelab::GraphicsArgs& args, size_t tileSize = 16, Order order = Order::Scanline);
+
+    size_t getNumThreads() const { return numThreads; }
+    size_t getTileSize() const { return tileSize; }
+    Order getOrder() const { return order; }
+    void setOrder(Order o) { order = o; }
+
+    // Tiles covering a width x height image, in scheduling order.  Each
+    // tile's index is its position in scanline order.
+    std::vector<Tile> makeTiles(size_t width, size_t height) const;
+
+    // Runs kernel once for every tile and blocks until all are done.
+    // The first exception thrown by a kernel is rethrown here.
+    void run(size_t width, size_t height, const Kernel& kernel);
+    void run(const FrameBuffer& fb, const Kernel& kernel) { run(fb.getWidth(), fb.getHeight(), kernel); }
+
+    // Per-tile timings of the last run, indexed by Tile::index
+    const std::vector<TileTiming>& getTimings() const { return timings; }
+
+    // Writes min/mean/max tile times and per-worker busy time
+    void printTimings(std::ostream& out) const;
+
+private:
+    size_t numThreads;
+    size_t tileSize;
+    Order order;
+    std::vector<TileTiming> timings;
+};
+
+#endif // TILESCHEDULER_H
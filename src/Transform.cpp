@@ -0,0 +1,166 @@
+#include "Transform.h"
+#include "vec_packet.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+namespace {
+    // The widest packet the compiler has registers for
+    template <typename T>
+    struct Widest;
+
+#if !defined(VEC_NO_SIMD) && defined(__AVX512F__)
+    template <> struct Widest<float> { using type = vec_packet<float, 3, 16>; };
+    template <> struct Widest<double> { using type = vec_packet<double, 3, 8>; };
+#elif !defined(VEC_NO_SIMD) && defined(__AVX2__)
+    template <> struct Widest<float> { using type = vec_packet<float, 3, 8>; };
+    template <> struct Widest<double> { using type = vec_packet<double, 3, 4>; };
+#else
+    template <> struct Widest<float> { using type = vec_packet<float, 3, 4>; };
+    template <> struct Widest<double> { using type = vec_packet<double, 3, 2>; };
+#endif
+
+    enum class Kind { Point, Vector, Normal };
+
+    // The matrix and translation broadcast once, outside the loop
+    template <typename T>
+    struct PacketTransform {
+        using Packet = typename Widest<T>::type;
+        using Lanes = typename Packet::lane_type;
+        static constexpr size_t W = Packet::width;
+
+        Lanes m[3][3];
+        Lanes t[3];
+        bool translate;
+        bool normalize;
+
+        PacketTransform(const affine3<T>& xf, Kind kind)
+            : translate(kind == Kind::Point), normalize(kind == Kind::Normal) {
+            mat<T, 3> linear = kind == Kind::Normal ? xf.normalMatrix() : xf.linear;
+            for (size_t r = 0; r < 3; ++r) {
+                for (size_t c = 0; c < 3; ++c) m[r][c] = Lanes(linear(r, c));
+                t[r] = Lanes(xf.translation[r]);
+            }
+        }
+
+        Packet apply(const Packet& p) const {
+            Packet out;
+            for (size_t r = 0; r < 3; ++r) {
+                Lanes v = m[r][0] * p[0] + m[r][1] * p[1] + m[r][2] * p[2];
+                out[r] = translate ? v + t[r] : v;
+            }
+            return normalize ? out.normalized() : out;
+        }
+    };
+
+    template <typename T>
+    const T* element(const T* base, size_t i, size_t stride) {
+        return reinterpret_cast<const T*>(reinterpret_cast<const char*>(base) + i * stride);
+    }
+
+    template <typename T>
+    T* element(T* base, size_t i, size_t stride) {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(base) + i * stride);
+    }
+
+    // Elements [begin, end), a packet at a time; the last packet may be
+    // partial
+    template <typename T>
+    void transformRange(const PacketTransform<T>& xf, const T* src, T* dst, size_t stride, size_t begin, size_t end) {
+        using Packet = typename PacketTransform<T>::Packet;
+        using Lanes = typename PacketTransform<T>::Lanes;
+        constexpr size_t W = Packet::width;
+
+        alignas(Lanes) T soa[3][W] = {};
+        for (size_t i = begin; i < end; i += W) {
+            size_t n = std::min(W, end - i);
+            for (size_t k = 0; k < n; ++k) {
+                const T* e = element(src, i + k, stride);
+                soa[0][k] = e[0];
+                soa[1][k] = e[1];
+                soa[2][k] = e[2];
+            }
+
+            Packet p(Lanes::load(soa[0]), Lanes::load(soa[1]), Lanes::load(soa[2]));
+            Packet q = xf.apply(p);
+            for (size_t c = 0; c < 3; ++c) q[c].store(soa[c]);
+
+            for (size_t k = 0; k < n; ++k) {
+                T* e = element(dst, i + k, stride);
+                e[0] = soa[0][k];
+                e[1] = soa[1][k];
+                e[2] = soa[2][k];
+            }
+        }
+    }
+
+    template <typename T>
+    void transformArray(const affine3<T>& affine, Kind kind, const T* src, T* dst, size_t count, size_t stride,
+                        const TransformOptions& options) {
+        if (count == 0) return;
+        PacketTransform<T> xf(affine, kind);
+        constexpr size_t W = PacketTransform<T>::W;
+
+        size_t numThreads = options.numThreads;
+        if (numThreads == 0) {
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        numThreads = std::clamp<size_t>(count / std::max<size_t>(options.minPerThread, 1), 1, numThreads);
+        if (numThreads == 1) {
+            transformRange(xf, src, dst, stride, 0, count);
+            return;
+        }
+
+        // One contiguous range of whole packets per thread
+        size_t perThread = (count + numThreads - 1) / numThreads;
+        perThread = (perThread + W - 1) / W * W;
+        std::vector<std::thread> threads;
+        for (size_t begin = perThread; begin < count; begin += perThread) {
+            threads.emplace_back(transformRange<T>, std::cref(xf), src, dst, stride, begin, std::min(begin + perThread, count));
+        }
+        transformRange(xf, src, dst, stride, 0, std::min(perThread, count));
+        for (auto& t : threads) t.join();
+    }
+}
+
+template <typename T>
+void transformPoints(const affine3<T>& xf, const T* src, T* dst, size_t count, size_t stride,
+                     const TransformOptions& options) {
+    transformArray(xf, Kind::Point, src, dst, count, stride, options);
+}
+
+template <typename T>
+void transformVectors(const affine3<T>& xf, const T* src, T* dst, size_t count, size_t stride,
+                      const TransformOptions& options) {
+    transformArray(xf, Kind::Vector, src, dst, count, stride, options);
+}
+
+template <typename T>
+void transformNormals(const affine3<T>& xf, const T* src, T* dst, size_t count, size_t stride,
+                      const TransformOptions& options) {
+    transformArray(xf, Kind::Normal, src, dst, count, stride, options);
+}
+
+template <typename T>
+void transformPoints(const affine3<T>& xf, std::vector<vec<T, 3>>& points, const TransformOptions& options) {
+    if (points.empty()) return;
+    transformPoints(xf, &points[0][0], &points[0][0], points.size(), sizeof(vec<T, 3>), options);
+}
+
+template <typename T>
+void transformNormals(const affine3<T>& xf, std::vector<vec<T, 3>>& normals, const TransformOptions& options) {
+    if (normals.empty()) return;
+    transformNormals(xf, &normals[0][0], &normals[0][0], normals.size(), sizeof(vec<T, 3>), options);
+}
+
+template void transformPoints(const affine3f&, const float*, float*, size_t, size_t, const TransformOptions&);
+template void transformPoints(const affine3d&, const double*, double*, size_t, size_t, const TransformOptions&);
+template void transformVectors(const affine3f&, const float*, float*, size_t, size_t, const TransformOptions&);
+template void transformVectors(const affine3d&, const double*, double*, size_t, size_t, const TransformOptions&);
+template void transformNormals(const affine3f&, const float*, float*, size_t, size_t, const TransformOptions&);
+template void transformNormals(const affine3d&, const double*, double*, size_t, size_t, const TransformOptions&);
+template void transformPoints(const affine3f&, std::vector<vec3f>&, const TransformOptions&);
+template void transformPoints(const affine3d&, std::vector<vec3d>&, const TransformOptions&);
+template void transformNormals(const affine3f&, std::vector<vec3f>&, const TransformOptions&);
+template void transformNormals(const affine3d&, std::vector<vec3d>&, const TransformOptions&);
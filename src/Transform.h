@@ -0,0 +1,61 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <cstddef>
+#include <vector>
+#include "mat.h"
+#include "vec.h"
+
+// Batch transforms of 3D points, vectors and normals, in float or double
+// (Real picks the one the build uses for geometry).  The arrays are read
+// and written as the widest vec_packet the compiler targets and split
+// across threads once they are large enough to pay for them.
+//
+// Each element is three numbers and consecutive elements are stride
+// bytes apart, so interleaved vertex data such as the position or normal
+// of every ModelOBJ::Vertex is transformed in place without copying it
+// out.  src and dst may be the same array.
+struct TransformOptions {
+    // Worker threads; 0 uses all hardware threads
+    size_t numThreads = 0;
+
+    // Arrays shorter than this per thread are done on fewer threads
+    size_t minPerThread = 1 << 16;
+};
+
+// p -> linear * p + translation
+template <typename T>
+void transformPoints(const affine3<T>& xf, const T* src, T* dst, size_t count, size_t stride,
+                     const TransformOptions& options = TransformOptions());
+
+// v -> linear * v
+template <typename T>
+void transformVectors(const affine3<T>& xf, const T* src, T* dst, size_t count, size_t stride,
+                      const TransformOptions& options = TransformOptions());
+
+// n -> normalized(inverse transpose of linear * n)
+template <typename T>
+void transformNormals(const affine3<T>& xf, const T* src, T* dst, size_t count, size_t stride,
+                      const TransformOptions& options = TransformOptions());
+
+// In place over arrays of vec
+template <typename T>
+void transformPoints(const affine3<T>& xf, std::vector<vec<T, 3>>& points,
+                     const TransformOptions& options = TransformOptions());
+template <typename T>
+void transformNormals(const affine3<T>& xf, std::vector<vec<T, 3>>& normals,
+                      const TransformOptions& options = TransformOptions());
+
+// Defined for float and double in Transform.cpp
+extern template void transformPoints(const affine3f&, const float*, float*, size_t, size_t, const TransformOptions&);
+extern template void transformPoints(const affine3d&, const double*, double*, size_t, size_t, const TransformOptions&);
+extern template void transformVectors(const affine3f&, const float*, float*, size_t, size_t, const TransformOptions&);
+extern template void transformVectors(const affine3d&, const double*, double*, size_t, size_t, const TransformOptions&);
+extern template void transformNormals(const affine3f&, const float*, float*, size_t, size_t, const TransformOptions&);
+extern template void transformNormals(const affine3d&, const double*, double*, size_t, size_t, const TransformOptions&);
+extern template void transformPoints(const affine3f&, std::vector<vec3f>&, const TransformOptions&);
+extern template void transformPoints(const affine3d&, std::vector<vec3d>&, const TransformOptions&);
+extern template void transformNormals(const affine3f&, std::vector<vec3f>&, const TransformOptions&);
+extern template void transformNormals(const affine3d&, std::vector<vec3d>&, const TransformOptions&);
+
+#endif // TRANSFORM_H
@@ -0,0 +1,99 @@
+#include "ImageCompare.h"
+#include "ImageIO.h"
+#include <cmath>
+#include <iostream>
+#include <string>
+
+void printUsage(const char* programName) {
+    std::cerr << "Usage:" << std::endl;
+    std::cerr << "  " << programName << " [options] <reference> <test>" << std::endl;
+    std::cerr << "    Images may be .png, .pfm, .hdr or .exr and must be the same size." << std::endl;
+    std::cerr << "  Options:" << std::endl;
+    std::cerr << "    -t <size>    tile size for the error map (default 32)" << std::endl;
+    std::cerr << "    -n <count>   threads to use (default all)" << std::endl;
+    std::cerr << "    -m <file>    write a heat map of the per-tile MSE" << std::endl;
+    std::cerr << "    -d <file>    write the absolute difference image" << std::endl;
+    std::cerr << "    -p <dB>      fail when the PSNR is below this" << std::endl;
+    std::cerr << "    -s <ssim>    fail when the SSIM is below this" << std::endl;
+    std::cerr << "    --no-ssim    skip SSIM, which is the slowest metric" << std::endl;
+    std::cerr << "  Exits with 0 when the images pass, 2 when they fail a threshold." << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        CompareOptions options;
+        std::string mapFile, diffFile;
+        double minPsnr = -INFINITY, minSsim = -INFINITY;
+        std::string files[2];
+        int numFiles = 0;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--no-ssim") {
+                options.computeSsim = false;
+            } else if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+                std::string value = argv[++i];
+                switch (arg[1]) {
+                case 't': options.tileSize = std::stoul(value); break;
+                case 'n': options.numThreads = std::stoul(value); break;
+                case 'm': mapFile = value; break;
+                case 'd': diffFile = value; break;
+                case 'p': minPsnr = std::stod(value); break;
+                case 's': minSsim = std::stod(value); break;
+                default:
+                    throw std::invalid_argument("unknown option " + arg);
+                }
+            } else if (numFiles < 2 && (arg.empty() || arg[0] != '-')) {
+                files[numFiles++] = arg;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        if (numFiles != 2) {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        FrameBuffer reference = readImage(files[0]);
+        FrameBuffer test = readImage(files[1]);
+        if (reference.getWidth() != test.getWidth() || reference.getHeight() != test.getHeight()) {
+            std::cerr << "Error: " << files[0] << " is " << reference.getWidth() << "x" << reference.getHeight()
+                      << " but " << files[1] << " is " << test.getWidth() << "x" << test.getHeight() << std::endl;
+            return 1;
+        }
+        CompareResult result = compareImages(reference, test, options);
+
+        size_t worst = result.getWorstTile();
+        std::cout << "MSE:       " << result.mse << " (R " << result.channelMse[0] << ", G " << result.channelMse[1]
+                  << ", B " << result.channelMse[2] << ")" << std::endl;
+        std::cout << "PSNR:      " << result.psnr << " dB" << std::endl;
+        if (options.computeSsim) {
+            std::cout << "SSIM:      " << result.ssim << std::endl;
+        }
+        std::cout << "Max error: " << result.maxError << std::endl;
+        std::cout << "Worst tile: (" << (worst % result.tilesX) * result.tileSize << ", "
+                  << (worst / result.tilesX) * result.tileSize << ") MSE " << result.tileMse[worst] << std::endl;
+
+        if (!mapFile.empty()) {
+            writeImage(result.makeErrorMap(), mapFile);
+        }
+        if (!diffFile.empty()) {
+            writeImage(makeDifferenceImage(reference, test), diffFile);
+        }
+
+        bool pass = result.psnr >= minPsnr && (!options.computeSsim || result.ssim >= minSsim);
+        if (!pass) {
+            std::cerr << "Images differ by more than the given thresholds" << std::endl;
+            return 2;
+        }
+        return 0;
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error parsing arguments: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
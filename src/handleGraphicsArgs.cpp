@@ -32,8 +32,12 @@ GraphicsArgs::GraphicsArgs()
     useDepthOfField(false),
     depthOfFieldDistance(0),
     numCpus(1), rpp(1), 
+    adaptiveSampling(false), adaptiveThreshold(0.01f), minRpp(4),
+    filterName("box"), filterRadius(0.0f),
+    exposure(0.0f), bloom(0.0f), tonemapName("none"), vignette(0.0f),
     recursionDepth(4),
-    splitMethod("objectMedian")
+    splitMethod("objectMedian"),
+    checkpointInterval(300)
 {
   reg("help", "help/usage information", ArgumentParsing::NONE, '?');
   reg("verbose", "turn on verbose output", ArgumentParsing::NONE, 'v');
@@ -45,8 +49,22 @@ GraphicsArgs::GraphicsArgs()
   reg("aspect", "aspect ratio in width/height of image (default is 1)", ArgumentParsing::FLOAT, 'a');
   reg("depth", "depth of field focus distance (default is 0.0 or OFF)", ArgumentParsing::FLOAT, 'd');
   reg("rpp", "rays per pixel (default is 1)", ArgumentParsing::INT, 'r');
+  reg("adaptive", "adaptive sampling, stopping at this relative error (e.g. 0.01)", ArgumentParsing::FLOAT, 'e');
+  reg("minrpp", "minimum rays per pixel with adaptive sampling (default is 4)", ArgumentParsing::INT);
+  reg("filter", "pixel filter: box, tent, gaussian, mitchell or blackmanharris (default is box)", ArgumentParsing::STRING, 'f');
+  reg("filterradius", "pixel filter radius in pixels (default depends on the filter)", ArgumentParsing::FLOAT);
+  reg("denoise", "denoise the final image with a preset: fast, balanced or quality", ArgumentParsing::STRING);
+  reg("exposure", "exposure adjustment in stops (default is 0)", ArgumentParsing::FLOAT);
+  reg("bloom", "bloom intensity (default is 0 or OFF)", ArgumentParsing::FLOAT);
+  reg("tonemap", "tonemap curve: none, reinhard or aces (default is none)", ArgumentParsing::STRING);
+  reg("vignette", "vignette strength from 0 to 1 (default is 0 or OFF)", ArgumentParsing::FLOAT);
   reg("recursionDepth", "recursion depth (default is 4)", ArgumentParsing::INT, 'k');
   reg("split", "split method for bvh construction (default is objectMedian)", ArgumentParsing::STRING, 's');
+  reg("crop", "render only part of the frame: x,y,w,h or band i/n", ArgumentParsing::STRING, 'c');
+  reg("checkpoint", "checkpoint file to write during progressive renders", ArgumentParsing::STRING);
+  reg("checkpointinterval", "seconds between checkpoints (default is 300)", ArgumentParsing::INT);
+  reg("resume", "resume a progressive render from this checkpoint file", ArgumentParsing::STRING);
+  reg("preview", "publish progressive results to this shared-memory name (e.g. /cs4212-preview)", ArgumentParsing::STRING);
   reg("winwidth", "width of window (if using preview)", ArgumentParsing::INT, 'x');
   reg("winheight", "height of window (if using preview)", ArgumentParsing::INT, 'y');
 }
@@ -94,6 +112,36 @@ void GraphicsArgs::process(int argc, char *argv[])
   isSet("rpp", rpp);
   if (verbose) { std::cout << "Setting rays per pixel to " << rpp << std::endl; }
 
+  if (isSet("adaptive", adaptiveThreshold))
+    {
+      adaptiveSampling = true;
+      if (verbose) { std::cout << "Setting adaptive sampling threshold to " << adaptiveThreshold << std::endl; }
+    }
+
+  isSet("minrpp", minRpp);
+  if (verbose) { std::cout << "Setting minimum rays per pixel to " << minRpp << std::endl; }
+
+  isSet("filter", filterName);
+  if (verbose) { std::cout << "Setting pixel filter to " << filterName << std::endl; }
+
+  isSet("filterradius", filterRadius);
+  if (verbose && filterRadius > 0.0f) { std::cout << "Setting pixel filter radius to " << filterRadius << std::endl; }
+
+  isSet("denoise", denoisePreset);
+  if (verbose && !denoisePreset.empty()) { std::cout << "Setting denoise preset to " << denoisePreset << std::endl; }
+
+  isSet("exposure", exposure);
+  if (verbose) { std::cout << "Setting exposure to " << exposure << " stops" << std::endl; }
+
+  isSet("bloom", bloom);
+  if (verbose && bloom > 0.0f) { std::cout << "Setting bloom intensity to " << bloom << std::endl; }
+
+  isSet("tonemap", tonemapName);
+  if (verbose) { std::cout << "Setting tonemap curve to " << tonemapName << std::endl; }
+
+  isSet("vignette", vignette);
+  if (verbose && vignette > 0.0f) { std::cout << "Setting vignette strength to " << vignette << std::endl; }
+
   isSet("recursionDepth", recursionDepth);
   if (verbose) { std::cout << "Setting recursionDepth to " << recursionDepth << std::endl; }
   
@@ -105,5 +153,20 @@ void GraphicsArgs::process(int argc, char *argv[])
   
   isSet("outputfile", outputFileName);
   if (verbose) { std::cout << "Setting outputFileName to " << outputFileName << std::endl; }
+
+  isSet("crop", cropWindow);
+  if (verbose && !cropWindow.empty()) { std::cout << "Setting crop window to " << cropWindow << std::endl; }
+
+  isSet("checkpoint", checkpointFileName);
+  if (verbose) { std::cout << "Setting checkpointFileName to " << checkpointFileName << std::endl; }
+
+  isSet("checkpointinterval", checkpointInterval);
+  if (verbose) { std::cout << "Setting checkpoint interval to " << checkpointInterval << " seconds" << std::endl; }
+
+  isSet("resume", resumeFileName);
+  if (verbose) { std::cout << "Setting resumeFileName to " << resumeFileName << std::endl; }
+
+  isSet("preview", previewName);
+  if (verbose && !previewName.empty()) { std::cout << "Setting preview name to " << previewName << std::endl; }
 }
 
@@ -57,12 +57,49 @@ namespace sivelab {
 
     int rpp;
 
+    // Adaptive sampling: rpp becomes the average budget, every pixel
+    // gets at least minRpp and tiles stop below adaptiveThreshold
+    bool adaptiveSampling;
+    float adaptiveThreshold;
+    int minRpp;
+
+    // Reconstruction filter for splatting samples; a radius of 0 uses
+    // the filter's usual one.  See PixelFilter.
+    std::string filterName;
+    float filterRadius;
+
+    // Denoiser preset (fast, balanced or quality); empty leaves the
+    // image as rendered.  See Denoiser.
+    std::string denoisePreset;
+
+    // Post-processing: exposure in stops, bloom intensity, tonemap
+    // curve name and vignette strength.  See PostPipeline::fromArgs.
+    float exposure;
+    float bloom;
+    std::string tonemapName;
+    float vignette;
+
     int recursionDepth;
     
     std::string splitMethod;
     
     std::string inputFileName;
     std::string outputFileName;
+
+    // Region of the width x height frame to render, "x,y,w,h" or
+    // band "i/n"; empty for the whole frame.  See CropWindow.
+    std::string cropWindow;
+
+    // Progressive renders write checkpointFileName every
+    // checkpointInterval seconds and continue from resumeFileName.
+    // See CheckpointOptions.
+    std::string checkpointFileName;
+    int checkpointInterval;
+    std::string resumeFileName;
+
+    // Shared-memory name progressive renders publish to for the
+    // glfwExample viewer; empty for none.  See SharedFrameWriter::fromArgs.
+    std::string previewName;
   };
 
 }
@@ -0,0 +1,376 @@
+#ifndef MAT_H
+#define MAT_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "vec.h"
+
+// Square matrices stored as N column vectors, the layout OpenGL and glm
+// use, so &m[0][0] can be handed to glUniformMatrix*fv as it is.
+// Constructors and element access are constexpr; arithmetic runs
+// through the vec operators.
+template <typename T, size_t N>
+class mat {
+public:
+    std::array<vec<T, N>, N> cols;
+
+    // Default constructor
+    mat() = default;
+
+    // Elements in reading order, row by row:
+    //     mat3(1, 0, tx,
+    //          0, 1, ty,
+    //          0, 0, 1)
+    template <typename... Args, std::enable_if_t<(std::is_arithmetic_v<Args> && ...) && sizeof...(Args) == N * N, int> = 0>
+    constexpr mat(Args... elements) : cols{} {
+        const T e[] = { static_cast<T>(elements)... };
+        for (size_t r = 0; r < N; ++r) {
+            for (size_t c = 0; c < N; ++c) cols[c][r] = e[r * N + c];
+        }
+    }
+
+    static constexpr mat diagonal(T d) {
+        mat m = zero();
+        for (size_t i = 0; i < N; ++i) m.cols[i][i] = d;
+        return m;
+    }
+
+    static constexpr mat identity() { return diagonal(T(1)); }
+
+    static constexpr mat zero() {
+        mat m;
+        for (size_t c = 0; c < N; ++c) {
+            for (size_t r = 0; r < N; ++r) m.cols[c][r] = T(0);
+        }
+        return m;
+    }
+
+    static constexpr mat fromColumns(const std::array<vec<T, N>, N>& columns) {
+        mat m;
+        m.cols = columns;
+        return m;
+    }
+
+    static constexpr mat fromRows(const std::array<vec<T, N>, N>& rows) {
+        mat m;
+        for (size_t r = 0; r < N; ++r) {
+            for (size_t c = 0; c < N; ++c) m.cols[c][r] = rows[r][c];
+        }
+        return m;
+    }
+
+    // Column access, as in glm
+    constexpr vec<T, N>& operator[](size_t c) { return cols[c]; }
+    constexpr const vec<T, N>& operator[](size_t c) const { return cols[c]; }
+
+    // Element in row r, column c
+    constexpr T& operator()(size_t r, size_t c) { return cols[c][r]; }
+    constexpr const T& operator()(size_t r, size_t c) const { return cols[c][r]; }
+
+    constexpr vec<T, N> row(size_t r) const {
+        vec<T, N> v;
+        for (size_t c = 0; c < N; ++c) v[c] = cols[c][r];
+        return v;
+    }
+
+    // Matrix times column vector
+    vec<T, N> operator*(const vec<T, N>& v) const {
+        vec<T, N> result = cols[0] * v[0];
+        for (size_t c = 1; c < N; ++c) result += cols[c] * v[c];
+        return result;
+    }
+
+    mat operator*(const mat& other) const {
+        mat result;
+        for (size_t c = 0; c < N; ++c) result.cols[c] = *this * other.cols[c];
+        return result;
+    }
+
+    mat operator*(T scalar) const {
+        mat result;
+        for (size_t c = 0; c < N; ++c) result.cols[c] = cols[c] * scalar;
+        return result;
+    }
+
+    mat operator+(const mat& other) const {
+        mat result;
+        for (size_t c = 0; c < N; ++c) result.cols[c] = cols[c] + other.cols[c];
+        return result;
+    }
+
+    mat operator-(const mat& other) const {
+        mat result;
+        for (size_t c = 0; c < N; ++c) result.cols[c] = cols[c] - other.cols[c];
+        return result;
+    }
+
+    mat& operator*=(const mat& other) { return *this = *this * other; }
+
+    constexpr mat transposed() const {
+        mat t;
+        for (size_t r = 0; r < N; ++r) {
+            for (size_t c = 0; c < N; ++c) t.cols[r][c] = cols[c][r];
+        }
+        return t;
+    }
+
+    // Determinant and inverse by Gaussian elimination with partial
+    // pivoting.  inverse() throws std::runtime_error for a singular matrix.
+    T determinant() const {
+        mat a = *this;
+        T det = T(1);
+        for (size_t k = 0; k < N; ++k) {
+            size_t p = pivot(a, k);
+            if (a(p, k) == T(0)) return T(0);
+            if (p != k) {
+                swapRows(a, p, k);
+                det = -det;
+            }
+            det *= a(k, k);
+            for (size_t r = k + 1; r < N; ++r) {
+                T f = a(r, k) / a(k, k);
+                for (size_t c = k; c < N; ++c) a(r, c) -= f * a(k, c);
+            }
+        }
+        return det;
+    }
+
+    mat inverse() const {
+        mat a = *this;
+        mat inv = identity();
+        for (size_t k = 0; k < N; ++k) {
+            size_t p = pivot(a, k);
+            if (a(p, k) == T(0)) {
+                throw std::runtime_error("mat: cannot invert a singular matrix");
+            }
+            swapRows(a, p, k);
+            swapRows(inv, p, k);
+            T scale = T(1) / a(k, k);
+            for (size_t c = 0; c < N; ++c) {
+                a(k, c) *= scale;
+                inv(k, c) *= scale;
+            }
+            for (size_t r = 0; r < N; ++r) {
+                if (r == k || a(r, k) == T(0)) continue;
+                T f = a(r, k);
+                for (size_t c = 0; c < N; ++c) {
+                    a(r, c) -= f * a(k, c);
+                    inv(r, c) -= f * inv(k, c);
+                }
+            }
+        }
+        return inv;
+    }
+
+    bool near(const mat& other, T epsilon = T(1e-5)) const {
+        for (size_t c = 0; c < N; ++c) {
+            for (size_t r = 0; r < N; ++r) {
+                if (std::abs(cols[c][r] - other.cols[c][r]) > epsilon) return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator==(const mat& other) const {
+        for (size_t c = 0; c < N; ++c) {
+            if (cols[c] != other.cols[c]) return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const mat& other) const {
+        return !(*this == other);
+    }
+
+private:
+    static size_t pivot(const mat& a, size_t k) {
+        size_t p = k;
+        for (size_t r = k + 1; r < N; ++r) {
+            if (std::abs(a(r, k)) > std::abs(a(p, k))) p = r;
+        }
+        return p;
+    }
+
+    static void swapRows(mat& a, size_t i, size_t j) {
+        if (i == j) return;
+        for (size_t c = 0; c < N; ++c) std::swap(a(i, c), a(j, c));
+    }
+};
+
+// Scalar multiplication (commutative)
+template <typename T, size_t N>
+mat<T, N> operator*(T scalar, const mat<T, N>& m) {
+    return m * scalar;
+}
+
+// Unit quaternion rotations, w + xi + yj + zk.  The constructor takes w
+// first, as glm::quat does.
+template <typename T>
+class quat {
+public:
+    T w, x, y, z;
+
+    // Default constructor
+    quat() = default;
+
+    constexpr quat(T w, T x, T y, T z) : w(w), x(x), y(y), z(z) {}
+
+    static constexpr quat identity() { return quat(T(1), T(0), T(0), T(0)); }
+
+    // Rotation by angle radians about axis, right-handed
+    static quat fromAxisAngle(const vec<T, 3>& axis, T angle) {
+        vec<T, 3> a = axis.normalized();
+        T s = std::sin(angle / T(2));
+        return quat(std::cos(angle / T(2)), a[0] * s, a[1] * s, a[2] * s);
+    }
+
+    // Hamilton product: rotating by (a * b) rotates by b, then a
+    quat operator*(const quat& o) const {
+        return quat(w * o.w - x * o.x - y * o.y - z * o.z,
+                    w * o.x + x * o.w + y * o.z - z * o.y,
+                    w * o.y - x * o.z + y * o.w + z * o.x,
+                    w * o.z + x * o.y - y * o.x + z * o.w);
+    }
+
+    constexpr quat conjugate() const { return quat(w, -x, -y, -z); }
+
+    T dot(const quat& o) const { return w * o.w + x * o.x + y * o.y + z * o.z; }
+    T length() const { return std::sqrt(dot(*this)); }
+
+    quat normalized() const {
+        T len = length();
+        if (len == T(0)) return identity();
+        return quat(w / len, x / len, y / len, z / len);
+    }
+
+    // Rotate v; the quaternion is assumed to be unit length
+    vec<T, 3> rotate(const vec<T, 3>& v) const {
+        // v + 2u x (u x v + w v), with u the vector part
+        vec<T, 3> u(x, y, z);
+        vec<T, 3> t = u.cross(v) * T(2);
+        return v + t * w + u.cross(t);
+    }
+
+    mat<T, 3> toMat3() const {
+        T xx = x * x, yy = y * y, zz = z * z;
+        T xy = x * y, xz = x * z, yz = y * z;
+        T wx = w * x, wy = w * y, wz = w * z;
+        return mat<T, 3>(T(1) - T(2) * (yy + zz), T(2) * (xy - wz), T(2) * (xz + wy),
+                         T(2) * (xy + wz), T(1) - T(2) * (xx + zz), T(2) * (yz - wx),
+                         T(2) * (xz - wy), T(2) * (yz + wx), T(1) - T(2) * (xx + yy));
+    }
+
+    bool near(const quat& o, T epsilon = T(1e-5)) const {
+        return std::abs(w - o.w) <= epsilon && std::abs(x - o.x) <= epsilon && std::abs(y - o.y) <= epsilon
+               && std::abs(z - o.z) <= epsilon;
+    }
+};
+
+// Spherical interpolation along the shorter arc
+template <typename T>
+quat<T> slerp(const quat<T>& a, quat<T> b, T t) {
+    T cosine = a.dot(b);
+    if (cosine < T(0)) {
+        b = quat<T>(-b.w, -b.x, -b.y, -b.z);
+        cosine = -cosine;
+    }
+
+    // Nearly parallel: fall back to a normalized lerp
+    T wa = T(1) - t, wb = t;
+    if (cosine < T(0.9995)) {
+        T angle = std::acos(cosine);
+        T s = std::sin(angle);
+        wa = std::sin((T(1) - t) * angle) / s;
+        wb = std::sin(t * angle) / s;
+    }
+    return quat<T>(wa * a.w + wb * b.w, wa * a.x + wb * b.x, wa * a.y + wb * b.y, wa * a.z + wb * b.z).normalized();
+}
+
+// A linear map followed by a translation, p -> linear * p + translation.
+// Cheaper to apply and invert than a full mat4 and enough for instancing
+// and model placement.
+template <typename T>
+class affine3 {
+public:
+    mat<T, 3> linear;
+    vec<T, 3> translation;
+
+    // Default constructor
+    affine3() = default;
+
+    constexpr affine3(const mat<T, 3>& linear, const vec<T, 3>& translation)
+        : linear(linear), translation(translation) {}
+
+    static constexpr affine3 identity() { return affine3(mat<T, 3>::identity(), vec<T, 3>(T(0), T(0), T(0))); }
+
+    static constexpr affine3 translate(const vec<T, 3>& t) { return affine3(mat<T, 3>::identity(), t); }
+
+    static constexpr affine3 scale(T s) { return affine3(mat<T, 3>::diagonal(s), vec<T, 3>(T(0), T(0), T(0))); }
+
+    static constexpr affine3 scale(const vec<T, 3>& s) {
+        return affine3(mat<T, 3>(s[0], T(0), T(0), T(0), s[1], T(0), T(0), T(0), s[2]), vec<T, 3>(T(0), T(0), T(0)));
+    }
+
+    static affine3 rotate(const quat<T>& q) { return affine3(q.toMat3(), vec<T, 3>(T(0), T(0), T(0))); }
+
+    static affine3 rotate(const vec<T, 3>& axis, T angle) { return rotate(quat<T>::fromAxisAngle(axis, angle)); }
+
+    // Apply o first, then this
+    affine3 operator*(const affine3& o) const {
+        return affine3(linear * o.linear, linear * o.translation + translation);
+    }
+
+    vec<T, 3> transformPoint(const vec<T, 3>& p) const { return linear * p + translation; }
+
+    vec<T, 3> transformVector(const vec<T, 3>& v) const { return linear * v; }
+
+    // Normals go through the inverse transpose so they stay perpendicular
+    // to surfaces under non-uniform scale
+    vec<T, 3> transformNormal(const vec<T, 3>& n) const { return (normalMatrix() * n).normalized(); }
+
+    mat<T, 3> normalMatrix() const { return linear.inverse().transposed(); }
+
+    affine3 inverse() const {
+        mat<T, 3> inv = linear.inverse();
+        return affine3(inv, (inv * translation) * T(-1));
+    }
+
+    mat<T, 4> toMat4() const {
+        mat<T, 4> m = mat<T, 4>::identity();
+        for (size_t c = 0; c < 3; ++c) {
+            for (size_t r = 0; r < 3; ++r) m(r, c) = linear(r, c);
+            m(c, 3) = translation[c];
+        }
+        return m;
+    }
+
+    bool near(const affine3& o, T epsilon = T(1e-5)) const {
+        return linear.near(o.linear, epsilon) && translation.near(o.translation, epsilon);
+    }
+};
+
+// Type aliases
+using mat3f = mat<float, 3>;
+using mat4f = mat<float, 4>;
+using mat3d = mat<double, 3>;
+using mat4d = mat<double, 4>;
+using quatf = quat<float>;
+using quatd = quat<double>;
+using affine3f = affine3<float>;
+using affine3d = affine3<double>;
+
+// For convenience, as vec3 is vec3f
+using mat3 = mat3f;
+using mat4 = mat4f;
+
+// At the precision chosen for geometry, see Real in vec.h
+using mat3r = mat<Real, 3>;
+using mat4r = mat<Real, 4>;
+using quatr = quat<Real>;
+using affine3r = affine3<Real>;
+
+#endif // MAT_H
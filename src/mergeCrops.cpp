@@ -0,0 +1,63 @@
+#include "CropMerge.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void printUsage(const char* programName) {
+    std::cerr << "Usage:" << std::endl;
+    std::cerr << "  " << programName << " [-s <width>x<height>] <output> <crop1> [<crop2> ...]" << std::endl;
+    std::cerr << "    output: merged image (.exr, .hdr or .png)" << std::endl;
+    std::cerr << "    crop:   an EXR rendered with --crop, which records its own position," << std::endl;
+    std::cerr << "            or file@x,y to place any other image with its top left at (x, y)" << std::endl;
+    std::cerr << "    -s:     full frame size, needed when no input is an EXR crop" << std::endl;
+    std::cerr << "  Rows are streamed, so memory use stays at one row per input." << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        size_t width = 0, height = 0;
+        int arg = 1;
+        if (arg < argc && std::string(argv[arg]) == "-s") {
+            if (arg + 1 >= argc) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            std::string size = argv[arg + 1];
+            size_t x = size.find('x');
+            if (x == std::string::npos) {
+                throw std::invalid_argument("frame size must be <width>x<height>");
+            }
+            width = std::stoul(size.substr(0, x));
+            height = std::stoul(size.substr(x + 1));
+            arg += 2;
+        }
+
+        if (argc - arg < 2) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        std::string output = argv[arg++];
+
+        std::vector<MergeInput> inputs;
+        for (; arg < argc; ++arg) {
+            inputs.push_back(MergeInput::parse(argv[arg]));
+        }
+
+        MergeReport report = mergeCrops(inputs, output, width, height);
+        if (report.uncoveredPixels > 0) {
+            std::cerr << "Warning: " << report.uncoveredPixels << " pixels were not covered by any input and are black" << std::endl;
+        }
+        if (report.overlappedPixels > 0) {
+            std::cerr << "Warning: " << report.overlappedPixels << " pixels are covered by more than one input" << std::endl;
+        }
+        return 0;
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error parsing arguments: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -42,6 +42,14 @@
 #include <string>
 #include <iostream>
 #include "model_obj.h"
+#include "Transform.h"
+
+// fscanf conversion for one Real
+#if defined(USE_DOUBLE_PRECISION)
+#define REAL_SCANF "%lf"
+#else
+#define REAL_SCANF "%f"
+#endif
 
 namespace
 {
@@ -74,20 +82,20 @@ ModelOBJ::~ModelOBJ()
     destroy();
 }
 
-void ModelOBJ::bounds(float center[3], float &width, float &height,
-                      float &length, float &radius) const
+void ModelOBJ::bounds(Real center[3], Real &width, Real &height,
+                      Real &length, Real &radius) const
 {
-    float xMax = std::numeric_limits<float>::min();
-    float yMax = std::numeric_limits<float>::min();
-    float zMax = std::numeric_limits<float>::min();
+    Real xMax = std::numeric_limits<Real>::min();
+    Real yMax = std::numeric_limits<Real>::min();
+    Real zMax = std::numeric_limits<Real>::min();
 
-    float xMin = std::numeric_limits<float>::max();
-    float yMin = std::numeric_limits<float>::max();
-    float zMin = std::numeric_limits<float>::max();
+    Real xMin = std::numeric_limits<Real>::max();
+    Real yMin = std::numeric_limits<Real>::max();
+    Real zMin = std::numeric_limits<Real>::max();
 
-    float x = 0.0f;
-    float y = 0.0f;
-    float z = 0.0f;
+    Real x = 0.0f;
+    Real y = 0.0f;
+    Real z = 0.0f;
 
     int numVerts = static_cast<int>(m_vertexBuffer.size());
 
@@ -225,18 +233,18 @@ bool ModelOBJ::import(const char *pszFilename, bool rebuildNormals)
     return true;
 }
 
-void ModelOBJ::normalize(float scaleTo, bool center)
+void ModelOBJ::normalize(Real scaleTo, bool center)
 {
-    float width = 0.0f;
-    float height = 0.0f;
-    float length = 0.0f;
-    float radius = 0.0f;
-    float centerPos[3] = {0.0f};
+    Real width = 0.0f;
+    Real height = 0.0f;
+    Real length = 0.0f;
+    Real radius = 0.0f;
+    Real centerPos[3] = {0.0f};
 
     bounds(centerPos, width, height, length, radius);
 
-    float scalingFactor = scaleTo / radius;
-    float offset[3] = {0.0f};
+    Real scalingFactor = scaleTo / radius;
+    Real offset[3] = {0.0f};
 
     if (center)
     {
@@ -267,8 +275,8 @@ void ModelOBJ::reverseWinding()
         m_indexBuffer[i + 2] = swap;
     }
 
-    float *pNormal = 0;
-    float *pTangent = 0;
+    Real *pNormal = 0;
+    Real *pTangent = 0;
 
     // Invert normals and tangents.
     for (int i = 0; i < static_cast<int>(m_vertexBuffer.size()); ++i)
@@ -285,22 +293,19 @@ void ModelOBJ::reverseWinding()
     }
 }
 
-void ModelOBJ::scale(float scaleFactor, float offset[3])
+void ModelOBJ::scale(Real scaleFactor, Real offset[3])
 {
-    float *pPosition = 0;
-
-    for (int i = 0; i < static_cast<int>(m_vertexBuffer.size()); ++i)
-    {
-        pPosition = m_vertexBuffer[i].position;
+    if (m_vertexBuffer.empty())
+        return;
 
-        pPosition[0] += offset[0];
-        pPosition[1] += offset[1];
-        pPosition[2] += offset[2];
+    // (position + offset) * scaleFactor, in packets and on all cores for
+    // large meshes.  The positions are transformed where they sit in the
+    // interleaved vertex buffer.
+    affine3r xf = affine3r::scale(scaleFactor) *
+        affine3r::translate(vec3r(offset[0], offset[1], offset[2]));
+    Real *pPosition = m_vertexBuffer[0].position;
 
-        pPosition[0] *= scaleFactor;
-        pPosition[1] *= scaleFactor;
-        pPosition[2] *= scaleFactor;
-    }
+    transformPoints(xf, pPosition, pPosition, m_vertexBuffer.size(), sizeof(Vertex));
 }
 
 void ModelOBJ::addTrianglePos(int index, int material, int v0, int v1, int v2)
@@ -544,10 +549,10 @@ void ModelOBJ::generateNormals()
     Vertex *pVertex0 = 0;
     Vertex *pVertex1 = 0;
     Vertex *pVertex2 = 0;
-    float edge1[3] = {0.0f, 0.0f, 0.0f};
-    float edge2[3] = {0.0f, 0.0f, 0.0f};
-    float normal[3] = {0.0f, 0.0f, 0.0f};
-    float length = 0.0f;
+    Real edge1[3] = {0.0f, 0.0f, 0.0f};
+    Real edge2[3] = {0.0f, 0.0f, 0.0f};
+    Real normal[3] = {0.0f, 0.0f, 0.0f};
+    Real length = 0.0f;
     int totalVertices = getNumberOfVertices();
     int totalTriangles = getNumberOfTriangles();
 
@@ -603,7 +608,7 @@ void ModelOBJ::generateNormals()
     {
         pVertex0 = &m_vertexBuffer[i];
 
-        length = 1.0f / sqrtf(pVertex0->normal[0] * pVertex0->normal[0] +
+        length = 1.0f / std::sqrt(pVertex0->normal[0] * pVertex0->normal[0] +
             pVertex0->normal[1] * pVertex0->normal[1] +
             pVertex0->normal[2] * pVertex0->normal[2]);
 
@@ -621,16 +626,16 @@ void ModelOBJ::generateTangents()
     Vertex *pVertex0 = 0;
     Vertex *pVertex1 = 0;
     Vertex *pVertex2 = 0;
-    float edge1[3] = {0.0f, 0.0f, 0.0f};
-    float edge2[3] = {0.0f, 0.0f, 0.0f};
+    Real edge1[3] = {0.0f, 0.0f, 0.0f};
+    Real edge2[3] = {0.0f, 0.0f, 0.0f};
     float texEdge1[2] = {0.0f, 0.0f};
     float texEdge2[2] = {0.0f, 0.0f};
-    float tangent[3] = {0.0f, 0.0f, 0.0f};
-    float bitangent[3] = {0.0f, 0.0f, 0.0f};
-    float det = 0.0f;
-    float nDotT = 0.0f;
-    float bDotB = 0.0f;
-    float length = 0.0f;
+    Real tangent[3] = {0.0f, 0.0f, 0.0f};
+    Real bitangent[3] = {0.0f, 0.0f, 0.0f};
+    Real det = 0.0f;
+    Real nDotT = 0.0f;
+    Real bDotB = 0.0f;
+    Real length = 0.0f;
     int totalVertices = getNumberOfVertices();
     int totalTriangles = getNumberOfTriangles();
 
@@ -740,7 +745,7 @@ void ModelOBJ::generateTangents()
 
         // Normalize the tangent.
 
-        length = 1.0f / sqrtf(pVertex0->tangent[0] * pVertex0->tangent[0] +
+        length = 1.0f / std::sqrt(pVertex0->tangent[0] * pVertex0->tangent[0] +
                               pVertex0->tangent[1] * pVertex0->tangent[1] +
                               pVertex0->tangent[2] * pVertex0->tangent[2]);
 
@@ -1082,7 +1087,7 @@ void ModelOBJ::importGeometrySecondPass(FILE *pFile)
             switch (buffer[1])
             {
             case '\0': // v
-                fscanf(pFile, "%f %f %f",
+                fscanf(pFile, REAL_SCANF " " REAL_SCANF " " REAL_SCANF,
                     &m_vertexCoords[3 * numVertices],
                     &m_vertexCoords[3 * numVertices + 1],
                     &m_vertexCoords[3 * numVertices + 2]);
@@ -1090,7 +1095,7 @@ void ModelOBJ::importGeometrySecondPass(FILE *pFile)
                 break;
 
             case 'n': // vn
-                fscanf(pFile, "%f %f %f",
+                fscanf(pFile, REAL_SCANF " " REAL_SCANF " " REAL_SCANF,
                     &m_normals[3 * numNormals],
                     &m_normals[3 * numNormals + 1],
                     &m_normals[3 * numNormals + 2]);
@@ -27,6 +27,7 @@
 #include <map>
 #include <string>
 #include <vector>
+#include "vec.h"
 
 //-----------------------------------------------------------------------------
 // Alias|Wavefront OBJ file loader.
@@ -40,6 +41,10 @@
 //    it isn't then the MTL file will fail to load and a default material is
 //    used instead.
 // 4. This loader triangulates all polygonal faces during importing.
+//
+// Positions, normals, tangents and the bounds are Real, so they are read
+// and transformed in double when the library is built with
+// ENABLE_DOUBLE_PRECISION.  Texture coordinates and materials stay float.
 //-----------------------------------------------------------------------------
 
 class ModelOBJ
@@ -60,11 +65,11 @@ public:
 
     struct Vertex
     {
-        float position[3];
+        Real position[3];
         float texCoord[2];
-        float normal[3];
-        float tangent[4];
-        float bitangent[3];
+        Real normal[3];
+        Real tangent[4];
+        Real bitangent[3];
     };
 
     struct Mesh
@@ -79,16 +84,16 @@ public:
 
     void destroy();
     bool import(const char *pszFilename, bool rebuildNormals = false);
-    void normalize(float scaleTo = 1.0f, bool center = true);
+    void normalize(Real scaleTo = 1.0f, bool center = true);
     void reverseWinding();
 
     // Getter methods.
 
-    void getCenter(float &x, float &y, float &z) const;
-    float getWidth() const;
-    float getHeight() const;
-    float getLength() const;
-    float getRadius() const;
+    void getCenter(Real &x, Real &y, Real &z) const;
+    Real getWidth() const;
+    Real getHeight() const;
+    Real getLength() const;
+    Real getRadius() const;
 
     const int *getIndexBuffer() const;
     int getIndexSize() const;
@@ -127,15 +132,15 @@ private:
         int vt0, int vt1, int vt2,
         int vn0, int vn1, int vn2);
     int addVertex(int hash, const Vertex *pVertex);
-    void bounds(float center[3], float &width, float &height,
-        float &length, float &radius) const;
+    void bounds(Real center[3], Real &width, Real &height,
+        Real &length, Real &radius) const;
     void buildMeshes();
     void generateNormals();
     void generateTangents();
     void importGeometryFirstPass(FILE *pFile);
     void importGeometrySecondPass(FILE *pFile);
     bool importMaterials(const char *pszFilename);
-    void scale(float scaleFactor, float offset[3]);
+    void scale(Real scaleFactor, Real offset[3]);
 
     bool m_hasPositions;
     bool m_hasTextureCoords;
@@ -149,11 +154,11 @@ private:
     int m_numberOfMaterials;
     int m_numberOfMeshes;
 
-    float m_center[3];
-    float m_width;
-    float m_height;
-    float m_length;
-    float m_radius;
+    Real m_center[3];
+    Real m_width;
+    Real m_height;
+    Real m_length;
+    Real m_radius;
 
     std::string m_directoryPath;
 
@@ -162,9 +167,9 @@ private:
     std::vector<Vertex> m_vertexBuffer;
     std::vector<int> m_indexBuffer;
     std::vector<int> m_attributeBuffer;
-    std::vector<float> m_vertexCoords;
+    std::vector<Real> m_vertexCoords;
     std::vector<float> m_textureCoords;
-    std::vector<float> m_normals;
+    std::vector<Real> m_normals;
 
     std::map<std::string, int> m_materialCache;
     std::map<int, std::vector<int> > m_vertexCache;
@@ -172,19 +177,19 @@ private:
 
 //-----------------------------------------------------------------------------
 
-inline void ModelOBJ::getCenter(float &x, float &y, float &z) const
+inline void ModelOBJ::getCenter(Real &x, Real &y, Real &z) const
 { x = m_center[0]; y = m_center[1]; z = m_center[2]; }
 
-inline float ModelOBJ::getWidth() const
+inline Real ModelOBJ::getWidth() const
 { return m_width; }
 
-inline float ModelOBJ::getHeight() const
+inline Real ModelOBJ::getHeight() const
 { return m_height; }
 
-inline float ModelOBJ::getLength() const
+inline Real ModelOBJ::getLength() const
 { return m_length; }
 
-inline float ModelOBJ::getRadius() const
+inline Real ModelOBJ::getRadius() const
 { return m_radius; }
 
 inline const int *ModelOBJ::getIndexBuffer() const
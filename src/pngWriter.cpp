@@ -1,13 +1,16 @@
+#include "FastMath.h"
 #include "FrameBuffer.h"
+#include "PngEncoder.h"
+#include "TileScheduler.h"
+#include "handleGraphicsArgs.h"
+#include <algorithm>
 #include <iostream>
-#include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <cstdlib>
 #include <string>
-#include <cstdio>
+#include <vector>
 #include <cmath>
-#include <unistd.h>
 
 // Parse hex color string (format: "RRGGBB" or "#RRGGBB") to vec3
 vec3 parseHexColor(const std::string& hexStr) {
@@ -61,6 +64,9 @@ ColorPoint parseColorPoint(const std::string& spec) {
 
 void printUsage(const char* programName) {
     std::cerr << "Usage:" << std::endl;
+    std::cerr << "  " << programName << " [options] <mode> ..." << std::endl;
+    std::cerr << "    options:   libsivelab graphics options, e.g. --numcpus N (0 uses every core, default 1)" << std::endl;
+    std::cerr << std::endl;
     std::cerr << "  Solid color mode:" << std::endl;
     std::cerr << "    " << programName << " solid <width> <height> <hex_color>" << std::endl;
     std::cerr << "    width:     Image width in pixels" << std::endl;
@@ -94,7 +100,7 @@ void generateSolidColor(FrameBuffer& fb, int width, int height, const std::strin
 }
 
 void generateGradient(FrameBuffer& fb, int width, int height, const std::string& startColorStr, 
-                      const std::string& endColorStr, float degrees) {
+                      const std::string& endColorStr, float degrees, TileScheduler& scheduler) {
     // Validate dimensions
     if (width <= 0 || height <= 0) {
         std::cerr << "Error: width and height must be positive integers" << std::endl;
@@ -111,10 +117,11 @@ void generateGradient(FrameBuffer& fb, int width, int height, const std::string&
     float sinAngle = std::sin(radians);
     
     // Find the maximum distance along the gradient direction
-    // This ensures the gradient spans the full image
+    // This ensures the gradient spans the full image.  The distance is
+    // linear in x and y, so the maximum is always at a corner pixel.
     float maxDist = 0.0f;
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
+    for (int y : { 0, height - 1 }) {
+        for (int x : { 0, width - 1 }) {
             float px = x - width / 2.0f;
             float py = y - height / 2.0f;
             float dist = px * cosAngle + py * sinAngle;
@@ -127,25 +134,27 @@ void generateGradient(FrameBuffer& fb, int width, int height, const std::string&
     if (maxDist == 0.0f) maxDist = 1.0f;
     
     // Generate gradient
-    for (size_t y = 0; y < height; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-            float px = x - width / 2.0f;
-            float py = y - height / 2.0f;
-            float dist = px * cosAngle + py * sinAngle;
-            
-            // Normalize to [0, 1] range
-            float t = (dist + maxDist) / (2.0f * maxDist);
-            t = std::clamp(t, 0.0f, 1.0f);
-            
-            // Interpolate colors
-            vec3 pixelColor = startColor * (1.0f - t) + endColor * t;
-            
-            fb.setPixel(x, y, pixelColor);
+    scheduler.run(fb, [&](const Tile& tile) {
+        for (size_t y = tile.y0; y < tile.y1; ++y) {
+            for (size_t x = tile.x0; x < tile.x1; ++x) {
+                float px = x - width / 2.0f;
+                float py = y - height / 2.0f;
+                float dist = px * cosAngle + py * sinAngle;
+
+                // Normalize to [0, 1] range
+                float t = (dist + maxDist) / (2.0f * maxDist);
+                t = std::clamp(t, 0.0f, 1.0f);
+
+                // Interpolate colors
+                vec3 pixelColor = startColor * (1.0f - t) + endColor * t;
+
+                fb.setPixel(x, y, pixelColor);
+            }
         }
-    }
+    });
 }
 
-void generateMultipoint(FrameBuffer& fb, int width, int height, int argc, char* argv[]) {
+void generateMultipoint(FrameBuffer& fb, int width, int height, int argc, char* argv[], TileScheduler& scheduler) {
     if (argc < 6) {
         std::cerr << "Multipoint mode requires at least 3 points" << std::endl;
         throw std::invalid_argument("Insufficient points");
@@ -174,56 +183,81 @@ void generateMultipoint(FrameBuffer& fb, int width, int height, int argc, char*
     }
     
     // Create PNG image using inverse distance weighting
-    for (size_t y = 0; y < height; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-            // Calculate weighted average of colors using inverse distance weighting
-            float px = static_cast<float>(x);
-            float py = static_cast<float>(y);
-            
-            vec3 pixelColor(0.0f, 0.0f, 0.0f);
-            float totalWeight = 0.0f;
-            
-            // Small epsilon to avoid division by zero when pixel is exactly on a point
-            const float epsilon = 1e-6f;
-            
-            for (const auto& point : points) {
-                float dx = px - point.x;
-                float dy = py - point.y;
-                float distSq = dx * dx + dy * dy;
-                float dist = std::sqrt(distSq);
-                
-                // Use inverse distance as weight (closer = higher weight)
-                // If exactly on point, use that color exclusively
-                float weight;
-                if (dist < epsilon) {
-                    pixelColor = point.color;
-                    totalWeight = 1.0f;
-                    break;  // If on exact point, use only that color
-                } else {
-                    weight = 1.0f / dist;
+    scheduler.run(fb, [&](const Tile& tile) {
+        for (size_t y = tile.y0; y < tile.y1; ++y) {
+            for (size_t x = tile.x0; x < tile.x1; ++x) {
+                // Calculate weighted average of colors using inverse distance weighting
+                float px = static_cast<float>(x);
+                float py = static_cast<float>(y);
+
+                vec3 pixelColor(0.0f, 0.0f, 0.0f);
+                float totalWeight = 0.0f;
+
+                // Small epsilon to avoid division by zero when pixel is exactly on a point
+                const float epsilon = 1e-6f;
+
+                for (const auto& point : points) {
+                    float dx = px - point.x;
+                    float dy = py - point.y;
+                    float distSq = dx * dx + dy * dy;
+
+                    // Use inverse distance as weight (closer = higher weight)
+                    // If exactly on point, use that color exclusively
+                    float weight;
+                    if (distSq < epsilon * epsilon) {
+                        pixelColor = point.color;
+                        totalWeight = 1.0f;
+                        break;  // If on exact point, use only that color
+                    } else {
+                        weight = fastmath::rsqrt(distSq);
+                    }
+
+                    pixelColor = pixelColor + point.color * weight;
+                    totalWeight += weight;
+                }
+
+                // Normalize to get weighted average
+                if (totalWeight > 0.0f) {
+                    pixelColor = pixelColor / totalWeight;
                 }
-                
-                pixelColor = pixelColor + point.color * weight;
-                totalWeight += weight;
-            }
-            
-            // Normalize to get weighted average
-            if (totalWeight > 0.0f) {
-                pixelColor = pixelColor / totalWeight;
-            }
 
-            fb.setPixel(x, y, pixelColor);
+                fb.setPixel(x, y, pixelColor);
+            }
         }
-    }
+    });
+}
+
+bool isMode(const std::string& name) {
+    return name == "solid" || name == "gradient" || name == "multipoint";
 }
 
 int main(int argc, char* argv[]) {
+    // Graphics options such as --numcpus come before the mode; the mode
+    // and its positional arguments are parsed here
+    int modeIndex = 1;
+    while (modeIndex < argc && !isMode(argv[modeIndex])) ++modeIndex;
+
+    sivelab::GraphicsArgs args;
+    try {
+        args.process(modeIndex, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error parsing options: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<char*> positional{ argv[0] };
+    positional.insert(positional.end(), argv + modeIndex, argv + argc);
+    argc = static_cast<int>(positional.size());
+    argv = positional.data();
+
     if (argc < 4) {
         printUsage(argv[0]);
         return 1;
     }
     
     try {
+        TileScheduler scheduler(args, 64);
         int width = std::stoi(argv[2]);
         int height = std::stoi(argv[3]);
         FrameBuffer fb(width, height);
@@ -235,10 +269,10 @@ int main(int argc, char* argv[]) {
                 printUsage(argv[0]);
                 return 1;
             }
-            generateGradient(fb, width, height, argv[4], argv[5], std::stof(argv[6]));
+            generateGradient(fb, width, height, argv[4], argv[5], std::stof(argv[6]), scheduler);
             
         } else if (mode == "multipoint") {
-            generateMultipoint(fb, width, height, argc, argv);
+            generateMultipoint(fb, width, height, argc, argv, scheduler);
             
         } else if (mode == "solid") {
             if (argc != 5) {
@@ -254,32 +288,17 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
-        // Write to stdout
-        char tmpfile[] = "/tmp/pngWriter_XXXXXX";
-        int tmpfd = mkstemp(tmpfile);
-        if (tmpfd < 0) {
-            std::cerr << "Error creating temporary file" << std::endl;
-            return 1;
+        // Write to stdout, deflating bands of rows in parallel when there
+        // is more than one thread to do it
+        if (scheduler.getNumThreads() > 1) {
+            writePngParallel(std::cout, fb.getWidth(), fb.getHeight(), fb.getRowSource(), ParallelPngOptions::fromArgs(args));
+        } else {
+            fb.writeToPng(std::cout);
         }
-        close(tmpfd);
-        
-        try {
-            fb.writeToPng(tmpfile);
-            
-            std::ifstream infile(tmpfile, std::ios::binary);
-            if (!infile) {
-                std::cerr << "Error reading temporary PNG file" << std::endl;
-                std::remove(tmpfile);
-                return 1;
-            }
-            
-            std::cout << infile.rdbuf();
-            infile.close();
-            
-            std::remove(tmpfile);
-        } catch (const std::exception& e) {
-            std::remove(tmpfile);
-            throw;
+        std::cout.flush();
+        if (!std::cout) {
+            std::cerr << "Error writing PNG to stdout" << std::endl;
+            return 1;
         }
         
         return 0;
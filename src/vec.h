@@ -3,10 +3,111 @@
 
 #include <array>
 #include <cmath>
+#include <cstddef>
 #include <type_traits>
 
+// The arithmetic of vec<float, 3> and vec<float, 4> runs in SSE registers
+// on x86.  Define VEC_NO_SIMD to use the portable loops everywhere.
+#if !defined(VEC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define VEC_SSE2 1
+#endif
+
+namespace vec_detail {
+    // vec<float, 4> fills an SSE register exactly and is aligned to load
+    // as one.  vec<float, 3> stays three packed floats: it is the pixel
+    // type of FrameBuffer, whose layout is shared with mapped files,
+    // checkpoints and the preview segment.
+    template <typename T, size_t N>
+    constexpr size_t alignment() {
+        return (std::is_same_v<T, float> && N == 4) ? 16 : alignof(T);
+    }
+
+    // Element-wise kernels behind the vec operators.  These loops are the
+    // fallback; ops is specialized below for the sizes with SIMD versions.
+    template <typename T, size_t N>
+    struct scalar_ops {
+        static void add(const T* a, const T* b, T* r) { for (size_t i = 0; i < N; ++i) r[i] = a[i] + b[i]; }
+        static void sub(const T* a, const T* b, T* r) { for (size_t i = 0; i < N; ++i) r[i] = a[i] - b[i]; }
+        static void mul(const T* a, T s, T* r) { for (size_t i = 0; i < N; ++i) r[i] = a[i] * s; }
+        static void div(const T* a, T s, T* r) { for (size_t i = 0; i < N; ++i) r[i] = a[i] / s; }
+        static T dot(const T* a, const T* b) {
+            T sum = 0;
+            for (size_t i = 0; i < N; ++i) sum += a[i] * b[i];
+            return sum;
+        }
+        static void cross(const T* a, const T* b, T* r) {
+            T x = a[1] * b[2] - a[2] * b[1];
+            T y = a[2] * b[0] - a[0] * b[2];
+            T z = a[0] * b[1] - a[1] * b[0];
+            r[0] = x; r[1] = y; r[2] = z;
+        }
+    };
+
+    template <typename T, size_t N>
+    struct ops : scalar_ops<T, N> {};
+
+#if defined(VEC_SSE2)
+    // Sum of the four lanes, in every lane
+    inline __m128 horizontalSum(__m128 v) {
+        __m128 s = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+    }
+
+    // (y, z, x, w), the lane rotation a cross product needs
+    inline __m128 yzx(__m128 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1)); }
+
+    inline __m128 crossLanes(__m128 a, __m128 b) {
+        // a x b = (a * yzx(b) - yzx(a) * b) rotated once more
+        __m128 c = _mm_sub_ps(_mm_mul_ps(a, yzx(b)), _mm_mul_ps(yzx(a), b));
+        return yzx(c);
+    }
+
+    template <>
+    struct ops<float, 4> {
+        static __m128 load(const float* p) { return _mm_load_ps(p); }
+        static void store(float* p, __m128 v) { _mm_store_ps(p, v); }
+
+        static void add(const float* a, const float* b, float* r) { store(r, _mm_add_ps(load(a), load(b))); }
+        static void sub(const float* a, const float* b, float* r) { store(r, _mm_sub_ps(load(a), load(b))); }
+        static void mul(const float* a, float s, float* r) { store(r, _mm_mul_ps(load(a), _mm_set1_ps(s))); }
+        static void div(const float* a, float s, float* r) { store(r, _mm_div_ps(load(a), _mm_set1_ps(s))); }
+        static float dot(const float* a, const float* b) {
+            return _mm_cvtss_f32(horizontalSum(_mm_mul_ps(load(a), load(b))));
+        }
+        // Cross product of the xyz parts; w of the result is zero
+        static void cross(const float* a, const float* b, float* r) { store(r, crossLanes(load(a), load(b))); }
+    };
+
+    // Three floats go in the low lanes with the top lane zero, so sums
+    // and products never see anything from past the end of the vector
+    template <>
+    struct ops<float, 3> {
+        static __m128 load(const float* p) {
+            __m128 xy = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p));
+            return _mm_movelh_ps(xy, _mm_load_ss(p + 2));
+        }
+        static void store(float* p, __m128 v) {
+            _mm_storel_pi(reinterpret_cast<__m64*>(p), v);
+            _mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+        }
+
+        static void add(const float* a, const float* b, float* r) { store(r, _mm_add_ps(load(a), load(b))); }
+        static void sub(const float* a, const float* b, float* r) { store(r, _mm_sub_ps(load(a), load(b))); }
+        static void mul(const float* a, float s, float* r) { store(r, _mm_mul_ps(load(a), _mm_set1_ps(s))); }
+        static void div(const float* a, float s, float* r) { store(r, _mm_div_ps(load(a), _mm_set1_ps(s))); }
+        static float dot(const float* a, const float* b) {
+            return _mm_cvtss_f32(horizontalSum(_mm_mul_ps(load(a), load(b))));
+        }
+        static void cross(const float* a, const float* b, float* r) { store(r, crossLanes(load(a), load(b))); }
+    };
+#endif
+}
+
 template <typename T, size_t N>
-class vec {
+class alignas(vec_detail::alignment<T, N>()) vec {
+    using ops = vec_detail::ops<T, N>;
+
 public:
     std::array<T, N> data;
 
@@ -14,118 +115,89 @@ public:
     vec() = default;
 
     // Constructor from array
-    vec(const std::array<T, N>& arr) : data(arr) {}
+    constexpr vec(const std::array<T, N>& arr) : data(arr) {}
 
-    // Variadic constructor
-    template <typename... Args>
-    vec(Args... args) : data{static_cast<T>(args)...} {
+    // Variadic constructor, from numbers only so that other types can
+    // convert themselves to a vec
+    template <typename... Args, std::enable_if_t<(std::is_arithmetic_v<Args> && ...), int> = 0>
+    constexpr vec(Args... args) : data{static_cast<T>(args)...} {
         static_assert(sizeof...(Args) == N, "Number of arguments must match vector dimension");
     }
 
     // Access operators
-    T& operator[](size_t i) { return data[i]; }
-    const T& operator[](size_t i) const { return data[i]; }
+    constexpr T& operator[](size_t i) { return data[i]; }
+    constexpr const T& operator[](size_t i) const { return data[i]; }
 
     // Vector addition
     vec operator+(const vec& other) const {
         vec result;
-        for (size_t i = 0; i < N; ++i) {
-            result[i] = data[i] + other[i];
-        }
+        ops::add(data.data(), other.data.data(), result.data.data());
         return result;
     }
 
     // Vector subtraction
     vec operator-(const vec& other) const {
         vec result;
-        for (size_t i = 0; i < N; ++i) {
-            result[i] = data[i] - other[i];
-        }
+        ops::sub(data.data(), other.data.data(), result.data.data());
         return result;
     }
 
     // Scalar multiplication
     vec operator*(T scalar) const {
         vec result;
-        for (size_t i = 0; i < N; ++i) {
-            result[i] = data[i] * scalar;
-        }
+        ops::mul(data.data(), scalar, result.data.data());
         return result;
     }
 
     // Scalar division
     vec operator/(T scalar) const {
         vec result;
-        for (size_t i = 0; i < N; ++i) {
-            result[i] = data[i] / scalar;
-        }
+        ops::div(data.data(), scalar, result.data.data());
         return result;
     }
 
     // Compound assignment operators
     vec& operator+=(const vec& other) {
-        for (size_t i = 0; i < N; ++i) {
-            data[i] += other[i];
-        }
+        ops::add(data.data(), other.data.data(), data.data());
         return *this;
     }
 
     vec& operator-=(const vec& other) {
-        for (size_t i = 0; i < N; ++i) {
-            data[i] -= other[i];
-        }
+        ops::sub(data.data(), other.data.data(), data.data());
         return *this;
     }
 
     vec& operator*=(T scalar) {
-        for (size_t i = 0; i < N; ++i) {
-            data[i] *= scalar;
-        }
+        ops::mul(data.data(), scalar, data.data());
         return *this;
     }
 
     vec& operator/=(T scalar) {
-        for (size_t i = 0; i < N; ++i) {
-            data[i] /= scalar;
-        }
+        ops::div(data.data(), scalar, data.data());
         return *this;
     }
 
     // Length (magnitude)
     T length() const {
-        T sum = 0;
-        for (const auto& val : data) {
-            sum += val * val;
-        }
-        return std::sqrt(sum);
+        return std::sqrt(length_squared());
     }
 
     // Squared length (useful for comparisons)
     T length_squared() const {
-        T sum = 0;
-        for (const auto& val : data) {
-            sum += val * val;
-        }
-        return sum;
+        return ops::dot(data.data(), data.data());
     }
 
     // Dot product
     T dot(const vec& other) const {
-        T sum = 0;
-        for (size_t i = 0; i < N; ++i) {
-            sum += data[i] * other[i];
-        }
-        return sum;
+        return ops::dot(data.data(), other.data.data());
     }
 
-    // Cross product (only for 3D vectors)
+    // Cross product (3D vectors, or the xyz part of 4D ones with w = 0)
     vec cross(const vec& other) const {
-        static_assert(N == 3, "Cross product is only defined for 3D vectors");
-        return vec(
-            data[1] * other[2] - data[2] * other[1],
-            data[2] * other[0] - data[0] * other[2],
-            data[0] * other[1] - data[1] * other[0]
-        );
+        static_assert(N == 3 || N == 4, "Cross product is only defined for 3D vectors");
+        vec result{};
+        ops::cross(data.data(), other.data.data(), result.data.data());
+        return result;
     }
 
     // Check if two vectors are within epsilon distance
@@ -170,8 +242,26 @@ using vec3f = vec<float, 3>;
 using vec3d = vec<double, 3>;
 using vec2f = vec<float, 2>;
 using vec2d = vec<double, 2>;
+using vec4f = vec<float, 4>;
 
 // For convenience, vec3 as vec3f
 using vec3 = vec3f;
 
-#endif // VEC_H
\ No newline at end of file
+// Precision of geometry: positions, directions and transforms.  Float
+// unless the library is built with ENABLE_DOUBLE_PRECISION, for scenes
+// whose coordinates are too large for float.  Colors and pixels stay
+// vec3: FrameBuffer's layout is shared with image files, checkpoints and
+// the preview segment, and float is plenty for radiance.
+#if defined(USE_DOUBLE_PRECISION)
+using Real = double;
+#else
+using Real = float;
+#endif
+
+using vec2r = vec<Real, 2>;
+using vec3r = vec<Real, 3>;
+
+static_assert(sizeof(vec3f) == 3 * sizeof(float), "vec3 must stay three packed floats");
+static_assert(alignof(vec4f) == 16, "vec4f must be aligned for SSE loads");
+
+#endif // VEC_H
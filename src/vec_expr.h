@@ -0,0 +1,156 @@
+#ifndef VEC_EXPR_H
+#define VEC_EXPR_H
+
+#include <cstddef>
+#include <type_traits>
+#include "vec.h"
+
+// Opt-in expression templates for vec.  Wrapping an operand in lazy()
+// makes the operators around it build a small expression object instead
+// of a vec, and the whole expression is evaluated in one loop when it is
+// assigned to a vec:
+//
+//     vec3 c = lazy(startColor) * (1.0f - t) + lazy(endColor) * t;
+//
+// Code that never calls lazy() keeps the ordinary vec operators.
+// Expressions refer to their vec operands, so convert them to a vec in
+// the same statement rather than keeping them in an auto variable.
+namespace vec_expr {
+    template <typename E>
+    struct expr {
+        const E& self() const { return static_cast<const E&>(*this); }
+
+        // Assigning to a vec is where the expression is evaluated
+        template <typename T, size_t N>
+        operator vec<T, N>() const {
+            static_assert(std::is_same_v<T, typename E::value_type> && N == E::size,
+                          "Expression and vector types must match");
+            vec<T, N> result;
+            for (size_t i = 0; i < N; ++i) result[i] = self()[i];
+            return result;
+        }
+    };
+
+    template <typename T>
+    constexpr bool is_expr = std::is_base_of_v<expr<T>, T>;
+
+    template <typename T, size_t N>
+    struct ref : expr<ref<T, N>> {
+        using value_type = T;
+        static constexpr size_t size = N;
+
+        const vec<T, N>& v;
+
+        explicit ref(const vec<T, N>& v) : v(v) {}
+        T operator[](size_t i) const { return v[i]; }
+    };
+
+    template <typename A, typename B, typename Op>
+    struct binary : expr<binary<A, B, Op>> {
+        using value_type = typename A::value_type;
+        static constexpr size_t size = A::size;
+        static_assert(A::size == B::size, "Vector dimensions must match");
+
+        A a;
+        B b;
+
+        binary(const A& a, const B& b) : a(a), b(b) {}
+        value_type operator[](size_t i) const { return Op::apply(a[i], b[i]); }
+    };
+
+    template <typename A, typename Op>
+    struct scalar : expr<scalar<A, Op>> {
+        using value_type = typename A::value_type;
+        static constexpr size_t size = A::size;
+
+        A a;
+        value_type s;
+
+        scalar(const A& a, value_type s) : a(a), s(s) {}
+        value_type operator[](size_t i) const { return Op::apply(a[i], s); }
+    };
+
+    template <typename A>
+    struct negate : expr<negate<A>> {
+        using value_type = typename A::value_type;
+        static constexpr size_t size = A::size;
+
+        A a;
+
+        explicit negate(const A& a) : a(a) {}
+        value_type operator[](size_t i) const { return -a[i]; }
+    };
+
+    struct add { template <typename T> static T apply(T a, T b) { return a + b; } };
+    struct sub { template <typename T> static T apply(T a, T b) { return a - b; } };
+    struct mul { template <typename T> static T apply(T a, T b) { return a * b; } };
+    struct div { template <typename T> static T apply(T a, T b) { return a / b; } };
+
+    // Evaluate an expression into dst, one element at a time
+    template <typename E>
+    void assign(vec<typename E::value_type, E::size>& dst, const expr<E>& e) {
+        const E& x = e.self();
+        for (size_t i = 0; i < E::size; ++i) dst[i] = x[i];
+    }
+
+    template <typename E>
+    vec<typename E::value_type, E::size> eval(const expr<E>& e) {
+        return e;
+    }
+
+    // Operands of the operators below: expressions as they are, vecs by
+    // reference
+    template <typename E>
+    const E& operand(const expr<E>& e) { return e.self(); }
+
+    template <typename T, size_t N>
+    ref<T, N> operand(const vec<T, N>& v) { return ref<T, N>(v); }
+
+    template <typename X>
+    using operand_t = std::decay_t<decltype(operand(std::declval<const X&>()))>;
+
+    // At least one side must already be an expression, so vec + vec still
+    // uses the eager operators in vec.h
+    template <typename A, typename B>
+    constexpr bool either_expr = is_expr<A> || is_expr<B>;
+
+    // The operators are found by argument-dependent lookup on the
+    // expression operand
+    template <typename A, typename B, std::enable_if_t<either_expr<A, B>, int> = 0>
+    auto operator+(const A& a, const B& b) {
+        return binary<operand_t<A>, operand_t<B>, add>(operand(a), operand(b));
+    }
+
+    template <typename A, typename B, std::enable_if_t<either_expr<A, B>, int> = 0>
+    auto operator-(const A& a, const B& b) {
+        return binary<operand_t<A>, operand_t<B>, sub>(operand(a), operand(b));
+    }
+
+    template <typename E, std::enable_if_t<is_expr<E>, int> = 0>
+    auto operator-(const E& e) {
+        return negate<E>(e);
+    }
+
+    template <typename E, std::enable_if_t<is_expr<E>, int> = 0>
+    auto operator*(const E& e, typename E::value_type s) {
+        return scalar<E, mul>(e, s);
+    }
+
+    template <typename E, std::enable_if_t<is_expr<E>, int> = 0>
+    auto operator*(typename E::value_type s, const E& e) {
+        return scalar<E, mul>(e, s);
+    }
+
+    template <typename E, std::enable_if_t<is_expr<E>, int> = 0>
+    auto operator/(const E& e, typename E::value_type s) {
+        return scalar<E, div>(e, s);
+    }
+}
+
+// Start an expression from a vec
+template <typename T, size_t N>
+vec_expr::ref<T, N> lazy(const vec<T, N>& v) {
+    return vec_expr::ref<T, N>(v);
+}
+
+#endif // VEC_EXPR_H
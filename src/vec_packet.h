@@ -0,0 +1,538 @@
+#ifndef VEC_PACKET_H
+#define VEC_PACKET_H
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "vec.h"
+
+// Structure-of-arrays vectors for ray packets and bulk shading.
+// packet<T, W> holds W lanes of one number, vec_packet<T, N, W> holds W
+// vec<T, N> as N packets (all x, then all y, ...), and packet_mask<W>
+// marks lanes, one bit each.  Packets that fill an SSE, AVX2 or AVX-512
+// register (float x4/x8/x16, double x2/x4/x8) use those instructions
+// when the compiler targets them (see ENABLE_NATIVE_ARCH); everything
+// else runs the portable lane loops.
+#if !defined(VEC_NO_SIMD) && (defined(__AVX2__) || defined(__AVX512F__))
+#include <immintrin.h>
+#endif
+
+template <size_t W>
+class packet_mask {
+    static_assert(W > 0 && W <= 32, "Packets are 1 to 32 lanes wide");
+
+public:
+    static constexpr uint32_t full = W == 32 ? ~0u : (1u << W) - 1;
+
+    uint32_t bits = 0;
+
+    packet_mask() = default;
+    explicit packet_mask(uint32_t bits) : bits(bits & full) {}
+
+    static packet_mask allLanes() { return packet_mask(full); }
+
+    // The first count lanes, for the partial packet at the end of an array
+    static packet_mask first(size_t count) {
+        return packet_mask(count >= 32 ? ~0u : (1u << count) - 1);
+    }
+
+    bool operator[](size_t i) const { return (bits >> i) & 1u; }
+    void set(size_t i, bool on) { bits = on ? bits | (1u << i) : bits & ~(1u << i); }
+
+    bool any() const { return bits != 0; }
+    bool all() const { return bits == full; }
+    bool none() const { return bits == 0; }
+    int count() const { return std::popcount(bits); }
+
+    packet_mask operator&(packet_mask o) const { return packet_mask(bits & o.bits); }
+    packet_mask operator|(packet_mask o) const { return packet_mask(bits | o.bits); }
+    packet_mask operator^(packet_mask o) const { return packet_mask(bits ^ o.bits); }
+    packet_mask operator~() const { return packet_mask(~bits); }
+    packet_mask& operator&=(packet_mask o) { bits &= o.bits; return *this; }
+    packet_mask& operator|=(packet_mask o) { bits |= o.bits; return *this; }
+    bool operator==(packet_mask o) const { return bits == o.bits; }
+    bool operator!=(packet_mask o) const { return bits != o.bits; }
+};
+
+namespace packet_detail {
+    // A full packet is aligned to its size, up to a cache line
+    template <typename T, size_t W>
+    constexpr size_t alignment() {
+        size_t bytes = sizeof(T) * W;
+        if (bytes > 64) return 64;
+        return (bytes & (bytes - 1)) == 0 ? bytes : alignof(T);
+    }
+
+    // Lane kernels behind packet.  Comparisons return one bit per lane and
+    // select(m, a, b) takes a where the bit is set and b elsewhere.
+    template <typename T, size_t W>
+    struct ops {
+        using reg = std::array<T, W>;
+
+        static reg load(const T* p) { reg r; for (size_t i = 0; i < W; ++i) r[i] = p[i]; return r; }
+        static void store(T* p, const reg& a) { for (size_t i = 0; i < W; ++i) p[i] = a[i]; }
+        static reg broadcast(T s) { reg r; r.fill(s); return r; }
+
+        template <typename F>
+        static reg map(const reg& a, const reg& b, F f) { reg r; for (size_t i = 0; i < W; ++i) r[i] = f(a[i], b[i]); return r; }
+        template <typename F>
+        static uint32_t compare(const reg& a, const reg& b, F f) {
+            uint32_t m = 0;
+            for (size_t i = 0; i < W; ++i) m |= uint32_t(f(a[i], b[i])) << i;
+            return m;
+        }
+
+        static reg add(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return x + y; }); }
+        static reg sub(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return x - y; }); }
+        static reg mul(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return x * y; }); }
+        static reg div(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return x / y; }); }
+        static reg min(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return y < x ? y : x; }); }
+        static reg max(const reg& a, const reg& b) { return map(a, b, [](T x, T y) { return x < y ? y : x; }); }
+        static reg sqrt(const reg& a) { reg r; for (size_t i = 0; i < W; ++i) r[i] = std::sqrt(a[i]); return r; }
+
+        static uint32_t lt(const reg& a, const reg& b) { return compare(a, b, [](T x, T y) { return x < y; }); }
+        static uint32_t le(const reg& a, const reg& b) { return compare(a, b, [](T x, T y) { return x <= y; }); }
+        static uint32_t eq(const reg& a, const reg& b) { return compare(a, b, [](T x, T y) { return x == y; }); }
+
+        static reg select(uint32_t m, const reg& a, const reg& b) {
+            reg r;
+            for (size_t i = 0; i < W; ++i) r[i] = (m >> i) & 1u ? a[i] : b[i];
+            return r;
+        }
+    };
+
+#if defined(VEC_SSE2)
+    template <>
+    struct ops<float, 4> {
+        using reg = __m128;
+
+        static reg load(const float* p) { return _mm_load_ps(p); }
+        static void store(float* p, reg a) { _mm_store_ps(p, a); }
+        static reg broadcast(float s) { return _mm_set1_ps(s); }
+
+        static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+        static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+        static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+        static reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+        static reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+        static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+        static reg sqrt(reg a) { return _mm_sqrt_ps(a); }
+
+        static uint32_t lt(reg a, reg b) { return uint32_t(_mm_movemask_ps(_mm_cmplt_ps(a, b))); }
+        static uint32_t le(reg a, reg b) { return uint32_t(_mm_movemask_ps(_mm_cmple_ps(a, b))); }
+        static uint32_t eq(reg a, reg b) { return uint32_t(_mm_movemask_ps(_mm_cmpeq_ps(a, b))); }
+
+        static reg select(uint32_t m, reg a, reg b) {
+            // Spread the mask bits back out to whole lanes
+            const __m128i lane = _mm_setr_epi32(1, 2, 4, 8);
+            __m128 on = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(int(m)), lane), lane));
+            return _mm_or_ps(_mm_and_ps(on, a), _mm_andnot_ps(on, b));
+        }
+    };
+
+    template <>
+    struct ops<double, 2> {
+        using reg = __m128d;
+
+        static reg load(const double* p) { return _mm_load_pd(p); }
+        static void store(double* p, reg a) { _mm_store_pd(p, a); }
+        static reg broadcast(double s) { return _mm_set1_pd(s); }
+
+        static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+        static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+        static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+        static reg div(reg a, reg b) { return _mm_div_pd(a, b); }
+        static reg min(reg a, reg b) { return _mm_min_pd(a, b); }
+        static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+        static reg sqrt(reg a) { return _mm_sqrt_pd(a); }
+
+        static uint32_t lt(reg a, reg b) { return uint32_t(_mm_movemask_pd(_mm_cmplt_pd(a, b))); }
+        static uint32_t le(reg a, reg b) { return uint32_t(_mm_movemask_pd(_mm_cmple_pd(a, b))); }
+        static uint32_t eq(reg a, reg b) { return uint32_t(_mm_movemask_pd(_mm_cmpeq_pd(a, b))); }
+
+        static reg select(uint32_t m, reg a, reg b) {
+            // No 64-bit integer compare before SSE4.1, so build the lanes
+            __m128d on = _mm_castsi128_pd(_mm_set_epi64x(-int64_t((m >> 1) & 1u), -int64_t(m & 1u)));
+            return _mm_or_pd(_mm_and_pd(on, a), _mm_andnot_pd(on, b));
+        }
+    };
+#endif
+
+#if !defined(VEC_NO_SIMD) && defined(__AVX2__)
+    template <>
+    struct ops<float, 8> {
+        using reg = __m256;
+
+        static reg load(const float* p) { return _mm256_load_ps(p); }
+        static void store(float* p, reg a) { _mm256_store_ps(p, a); }
+        static reg broadcast(float s) { return _mm256_set1_ps(s); }
+
+        static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+        static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+        static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+        static reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+        static reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+        static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+        static reg sqrt(reg a) { return _mm256_sqrt_ps(a); }
+
+        static uint32_t lt(reg a, reg b) { return uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ))); }
+        static uint32_t le(reg a, reg b) { return uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ))); }
+        static uint32_t eq(reg a, reg b) { return uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ))); }
+
+        static reg select(uint32_t m, reg a, reg b) {
+            const __m256i lane = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+            __m256i on = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(int(m)), lane), lane);
+            return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(on));
+        }
+    };
+
+    template <>
+    struct ops<double, 4> {
+        using reg = __m256d;
+
+        static reg load(const double* p) { return _mm256_load_pd(p); }
+        static void store(double* p, reg a) { _mm256_store_pd(p, a); }
+        static reg broadcast(double s) { return _mm256_set1_pd(s); }
+
+        static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+        static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+        static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+        static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+        static reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+        static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+        static reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+
+        static uint32_t lt(reg a, reg b) { return uint32_t(_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LT_OQ))); }
+        static uint32_t le(reg a, reg b) { return uint32_t(_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LE_OQ))); }
+        static uint32_t eq(reg a, reg b) { return uint32_t(_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ))); }
+
+        static reg select(uint32_t m, reg a, reg b) {
+            const __m256i lane = _mm256_setr_epi64x(1, 2, 4, 8);
+            __m256i on = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(int64_t(m)), lane), lane);
+            return _mm256_blendv_pd(b, a, _mm256_castsi256_pd(on));
+        }
+    };
+#endif
+
+#if !defined(VEC_NO_SIMD) && defined(__AVX512F__)
+    // AVX-512 compares straight into mask registers, which are our bits
+    template <>
+    struct ops<float, 16> {
+        using reg = __m512;
+
+        static reg load(const float* p) { return _mm512_load_ps(p); }
+        static void store(float* p, reg a) { _mm512_store_ps(p, a); }
+        static reg broadcast(float s) { return _mm512_set1_ps(s); }
+
+        static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+        static reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+        static reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+        static reg div(reg a, reg b) { return _mm512_div_ps(a, b); }
+        static reg min(reg a, reg b) { return _mm512_min_ps(a, b); }
+        static reg max(reg a, reg b) { return _mm512_max_ps(a, b); }
+        static reg sqrt(reg a) { return _mm512_sqrt_ps(a); }
+
+        static uint32_t lt(reg a, reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+        static uint32_t le(reg a, reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+        static uint32_t eq(reg a, reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+
+        static reg select(uint32_t m, reg a, reg b) { return _mm512_mask_blend_ps(__mmask16(m), b, a); }
+    };
+    template <>
+    struct ops<double, 8> {
+        using reg = __m512d;
+
+        static reg load(const double* p) { return _mm512_load_pd(p); }
+        static void store(double* p, reg a) { _mm512_store_pd(p, a); }
+        static reg broadcast(double s) { return _mm512_set1_pd(s); }
+
+        static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+        static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+        static reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+        static reg div(reg a, reg b) { return _mm512_div_pd(a, b); }
+        static reg min(reg a, reg b) { return _mm512_min_pd(a, b); }
+        static reg max(reg a, reg b) { return _mm512_max_pd(a, b); }
+        static reg sqrt(reg a) { return _mm512_sqrt_pd(a); }
+
+        static uint32_t lt(reg a, reg b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+        static uint32_t le(reg a, reg b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+        static uint32_t eq(reg a, reg b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+
+        static reg select(uint32_t m, reg a, reg b) { return _mm512_mask_blend_pd(__mmask8(m), b, a); }
+    };
+#endif
+}
+
+// W lanes of one number
+template <typename T, size_t W>
+class alignas(packet_detail::alignment<T, W>()) packet {
+    using ops = packet_detail::ops<T, W>;
+    using reg = typename ops::reg;
+
+    static packet wrap(reg r) {
+        packet p;
+        p.r = r;
+        return p;
+    }
+
+public:
+    using mask = packet_mask<W>;
+    static constexpr size_t width = W;
+
+    reg r;
+
+    packet() = default;
+
+    // Every lane set to s; implicit so that scalars mix with packets
+    packet(T s) : r(ops::broadcast(s)) {}
+
+    // Load and store W numbers; p must be aligned like the packet
+    static packet load(const T* p) { return wrap(ops::load(p)); }
+    void store(T* p) const { ops::store(p, r); }
+
+    // Lane access goes through memory, so keep it out of inner loops
+    T operator[](size_t i) const {
+        alignas(packet) T lanes[W];
+        store(lanes);
+        return lanes[i];
+    }
+
+    void set(size_t i, T value) {
+        alignas(packet) T lanes[W];
+        store(lanes);
+        lanes[i] = value;
+        r = ops::load(lanes);
+    }
+
+    friend packet operator+(const packet& a, const packet& b) { return wrap(ops::add(a.r, b.r)); }
+    friend packet operator-(const packet& a, const packet& b) { return wrap(ops::sub(a.r, b.r)); }
+    friend packet operator*(const packet& a, const packet& b) { return wrap(ops::mul(a.r, b.r)); }
+    friend packet operator/(const packet& a, const packet& b) { return wrap(ops::div(a.r, b.r)); }
+    packet operator-() const { return wrap(ops::mul(r, ops::broadcast(T(-1)))); }
+
+    packet& operator+=(const packet& o) { r = ops::add(r, o.r); return *this; }
+    packet& operator-=(const packet& o) { r = ops::sub(r, o.r); return *this; }
+    packet& operator*=(const packet& o) { r = ops::mul(r, o.r); return *this; }
+    packet& operator/=(const packet& o) { r = ops::div(r, o.r); return *this; }
+
+    // Lane-wise comparisons; a lane holding NaN compares false
+    friend mask operator<(const packet& a, const packet& b) { return mask(ops::lt(a.r, b.r)); }
+    friend mask operator<=(const packet& a, const packet& b) { return mask(ops::le(a.r, b.r)); }
+    friend mask operator>(const packet& a, const packet& b) { return mask(ops::lt(b.r, a.r)); }
+    friend mask operator>=(const packet& a, const packet& b) { return mask(ops::le(b.r, a.r)); }
+    friend mask operator==(const packet& a, const packet& b) { return mask(ops::eq(a.r, b.r)); }
+    friend mask operator!=(const packet& a, const packet& b) { return ~mask(ops::eq(a.r, b.r)); }
+
+    friend packet min(const packet& a, const packet& b) { return wrap(ops::min(a.r, b.r)); }
+    friend packet max(const packet& a, const packet& b) { return wrap(ops::max(a.r, b.r)); }
+    friend packet sqrt(const packet& a) { return wrap(ops::sqrt(a.r)); }
+
+    // a in the lanes set in m, b in the others
+    friend packet select(mask m, const packet& a, const packet& b) { return wrap(ops::select(m.bits, a.r, b.r)); }
+
+    // Reductions across the lanes
+    T horizontalSum() const { return reduce([](T a, T b) { return a + b; }); }
+    T horizontalMin() const { return reduce([](T a, T b) { return b < a ? b : a; }); }
+    T horizontalMax() const { return reduce([](T a, T b) { return a < b ? b : a; }); }
+
+private:
+    // Pairwise, the same order for every width
+    template <typename F>
+    T reduce(F f) const {
+        alignas(packet) T lanes[W];
+        store(lanes);
+        for (size_t step = 1; step < W; step *= 2) {
+            for (size_t i = 0; i + step < W; i += 2 * step) lanes[i] = f(lanes[i], lanes[i + step]);
+        }
+        return lanes[0];
+    }
+};
+
+// W vec<T, N> stored as N packets
+template <typename T, size_t N, size_t W>
+class vec_packet {
+public:
+    using lane_type = packet<T, W>;
+    using mask = packet_mask<W>;
+    using value_type = vec<T, N>;
+    static constexpr size_t width = W;
+
+    std::array<lane_type, N> data;
+
+    vec_packet() = default;
+
+    // One packet per component, e.g. vec3x8(x, y, z)
+    template <typename... Args, std::enable_if_t<(std::is_convertible_v<Args, lane_type> && ...), int> = 0>
+    vec_packet(const Args&... components) : data{ lane_type(components)... } {
+        static_assert(sizeof...(Args) == N, "Number of arguments must match vector dimension");
+    }
+
+    // The same vector in every lane
+    explicit vec_packet(const value_type& v) {
+        for (size_t c = 0; c < N; ++c) data[c] = lane_type(v[c]);
+    }
+
+    lane_type& operator[](size_t c) { return data[c]; }
+    const lane_type& operator[](size_t c) const { return data[c]; }
+
+    value_type lane(size_t i) const {
+        value_type v;
+        for (size_t c = 0; c < N; ++c) v[c] = data[c][i];
+        return v;
+    }
+
+    void setLane(size_t i, const value_type& v) {
+        for (size_t c = 0; c < N; ++c) data[c].set(i, v[c]);
+    }
+
+    // W consecutive vectors to and from an array of vec.  With a count,
+    // only that many are read (the rest are zero) or written.
+    static vec_packet load(const value_type* src, size_t count = W) {
+        alignas(lane_type) T soa[N][W] = {};
+        for (size_t i = 0; i < count && i < W; ++i) {
+            for (size_t c = 0; c < N; ++c) soa[c][i] = src[i][c];
+        }
+        return fromComponents(soa);
+    }
+
+    void store(value_type* dst, size_t count = W) const {
+        store(dst, mask::first(count));
+    }
+
+    void store(value_type* dst, mask m) const {
+        alignas(lane_type) T soa[N][W];
+        for (size_t c = 0; c < N; ++c) data[c].store(soa[c]);
+        for (size_t i = 0; i < W; ++i) {
+            if (!m[i]) continue;
+            for (size_t c = 0; c < N; ++c) dst[i][c] = soa[c][i];
+        }
+    }
+
+    // Vectors at base[indices[i]] to and from lane i
+    static vec_packet gather(const value_type* base, const uint32_t* indices, mask m = mask::allLanes()) {
+        alignas(lane_type) T soa[N][W] = {};
+        for (size_t i = 0; i < W; ++i) {
+            if (!m[i]) continue;
+            for (size_t c = 0; c < N; ++c) soa[c][i] = base[indices[i]][c];
+        }
+        return fromComponents(soa);
+    }
+
+    void scatter(value_type* base, const uint32_t* indices, mask m = mask::allLanes()) const {
+        alignas(lane_type) T soa[N][W];
+        for (size_t c = 0; c < N; ++c) data[c].store(soa[c]);
+        for (size_t i = 0; i < W; ++i) {
+            if (!m[i]) continue;
+            for (size_t c = 0; c < N; ++c) base[indices[i]][c] = soa[c][i];
+        }
+    }
+
+    friend vec_packet operator+(const vec_packet& a, const vec_packet& b) {
+        vec_packet r;
+        for (size_t c = 0; c < N; ++c) r.data[c] = a.data[c] + b.data[c];
+        return r;
+    }
+
+    friend vec_packet operator-(const vec_packet& a, const vec_packet& b) {
+        vec_packet r;
+        for (size_t c = 0; c < N; ++c) r.data[c] = a.data[c] - b.data[c];
+        return r;
+    }
+
+    vec_packet operator-() const {
+        vec_packet r;
+        for (size_t c = 0; c < N; ++c) r.data[c] = -data[c];
+        return r;
+    }
+
+    // Scaling by a packet scales each lane by its own number; a plain
+    // scalar converts to a packet
+    friend vec_packet operator*(const vec_packet& v, const lane_type& s) {
+        vec_packet r;
+        for (size_t c = 0; c < N; ++c) r.data[c] = v.data[c] * s;
+        return r;
+    }
+
+    friend vec_packet operator*(const lane_type& s, const vec_packet& v) { return v * s; }
+
+    friend vec_packet operator/(const vec_packet& v, const lane_type& s) {
+        return v * (lane_type(T(1)) / s);
+    }
+
+    vec_packet& operator+=(const vec_packet& o) { return *this = *this + o; }
+    vec_packet& operator-=(const vec_packet& o) { return *this = *this - o; }
+    vec_packet& operator*=(const lane_type& s) { return *this = *this * s; }
+    vec_packet& operator/=(const lane_type& s) { return *this = *this / s; }
+
+    lane_type dot(const vec_packet& o) const {
+        lane_type sum = data[0] * o.data[0];
+        for (size_t c = 1; c < N; ++c) sum += data[c] * o.data[c];
+        return sum;
+    }
+
+    vec_packet cross(const vec_packet& o) const {
+        static_assert(N == 3, "Cross product is only defined for 3D vectors");
+        return vec_packet(data[1] * o.data[2] - data[2] * o.data[1],
+                          data[2] * o.data[0] - data[0] * o.data[2],
+                          data[0] * o.data[1] - data[1] * o.data[0]);
+    }
+
+    lane_type length_squared() const { return dot(*this); }
+    lane_type length() const { return sqrt(length_squared()); }
+
+    // Zero-length lanes stay zero, as in vec::normalized
+    vec_packet normalized() const {
+        lane_type len = length();
+        mask zero = len == lane_type(T(0));
+        lane_type inv = select(zero, lane_type(T(0)), lane_type(T(1)) / len);
+        return *this * inv;
+    }
+
+    mask near(const vec_packet& o, T epsilon = T(1e-5)) const {
+        return (o - *this).length_squared() <= lane_type(epsilon * epsilon);
+    }
+
+    friend mask operator==(const vec_packet& a, const vec_packet& b) {
+        mask m = mask::allLanes();
+        for (size_t c = 0; c < N; ++c) m &= a.data[c] == b.data[c];
+        return m;
+    }
+
+    friend mask operator!=(const vec_packet& a, const vec_packet& b) { return ~(a == b); }
+
+    // Per-component sum of the lanes
+    value_type horizontalSum() const {
+        value_type v;
+        for (size_t c = 0; c < N; ++c) v[c] = data[c].horizontalSum();
+        return v;
+    }
+
+    friend vec_packet select(mask m, const vec_packet& a, const vec_packet& b) {
+        vec_packet r;
+        for (size_t c = 0; c < N; ++c) r.data[c] = select(m, a.data[c], b.data[c]);
+        return r;
+    }
+
+private:
+    static vec_packet fromComponents(const T (&soa)[N][W]) {
+        vec_packet r;
+        for (size_t c = 0; c < N; ++c) r.data[c] = lane_type::load(soa[c]);
+        return r;
+    }
+};
+
+// Type aliases
+using floatx4 = packet<float, 4>;
+using floatx8 = packet<float, 8>;
+using floatx16 = packet<float, 16>;
+using vec3x4 = vec_packet<float, 3, 4>;
+using vec3x8 = vec_packet<float, 3, 8>;
+using vec3x16 = vec_packet<float, 3, 16>;
+using doublex2 = packet<double, 2>;
+using doublex4 = packet<double, 4>;
+using doublex8 = packet<double, 8>;
+
+#endif // VEC_PACKET_H
@@ -0,0 +1,119 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <stdexcept>
+#include "AOVBuffer.h"
+
+TEST_CASE("AOVBuffer layers", "[AOVBuffer]") {
+    AOVBuffer aovs(20, 10);
+    size_t depth = aovs.addLayer("depth", AOVBuffer::Type::Float);
+    size_t normal = aovs.addLayer("normal", AOVBuffer::Type::Vec3);
+    size_t id = aovs.addLayer("objectID", AOVBuffer::Type::UInt32);
+
+    REQUIRE(aovs.getNumLayers() == 3);
+    REQUIRE(aovs.getLayerIndex("normal") == normal);
+    REQUIRE(aovs.getLayerName(id) == "objectID");
+    REQUIRE(aovs.getLayerType(depth) == AOVBuffer::Type::Float);
+    REQUIRE(aovs.hasLayer("depth"));
+    REQUIRE(!aovs.hasLayer("albedo"));
+    REQUIRE_THROWS_AS(aovs.getLayerIndex("albedo"), std::out_of_range);
+    REQUIRE_THROWS_AS(aovs.addLayer("depth", AOVBuffer::Type::Float), std::invalid_argument);
+
+    // 4 + 12 + 4 bytes per pixel
+    REQUIRE(aovs.getMemoryUsage() == 20 * 10 * 20);
+
+    aovs.set(depth, 3, 4, 2.5f);
+    aovs.set(normal, 3, 4, vec3(0.0f, 1.0f, 0.5f));
+    aovs.set(id, 3, 4, 42u);
+    REQUIRE(aovs.getFloat(depth, 3, 4) == 2.5f);
+    REQUIRE(aovs.getVec3(normal, 3, 4) == vec3(0.0f, 1.0f, 0.5f));
+    REQUIRE(aovs.getUInt(id, 3, 4) == 42u);
+    REQUIRE(aovs.getFloat(depth, 4, 3) == 0.0f);
+
+    // Vec3 layers are stored as three planes
+    REQUIRE(aovs.getPlane(normal, 1)[4 * 20 + 3] == 1.0f);
+    REQUIRE(aovs.getPlane(normal, 2)[4 * 20 + 3] == 0.5f);
+    REQUIRE(aovs.getUIntPlane(id)[4 * 20 + 3] == 42u);
+    REQUIRE_THROWS_AS(aovs.getPlane(normal, 3), std::out_of_range);
+
+    // Values must match the layer type
+    REQUIRE_THROWS_AS(aovs.set(depth, 0, 0, vec3(1.0f, 1.0f, 1.0f)), std::invalid_argument);
+    REQUIRE_THROWS_AS(aovs.getFloat(id, 0, 0), std::invalid_argument);
+
+    FrameBuffer fb = aovs.toFrameBuffer(id, FrameBuffer::Layout::Tiled8);
+    REQUIRE(fb(3, 4) == vec3(42.0f, 42.0f, 42.0f));
+
+    aovs.clear();
+    REQUIRE(aovs.getVec3(normal, 3, 4) == vec3(0.0f, 0.0f, 0.0f));
+}
+
+TEST_CASE("AOVBuffer tiles write every layer", "[AOVBuffer]") {
+    AOVBuffer aovs(70, 45);
+    size_t depth = aovs.addLayer("depth", AOVBuffer::Type::Float);
+    size_t albedo = aovs.addLayer("albedo", AOVBuffer::Type::Vec3);
+    size_t samples = aovs.addLayer("samples", AOVBuffer::Type::UInt32);
+
+    TileScheduler scheduler(3, 16);
+    scheduler.run(aovs.getWidth(), aovs.getHeight(), [&](const Tile& tile) {
+        AOVBuffer::TileBuffer local = aovs.makeTile(tile);
+        for (size_t y = tile.y0; y < tile.y1; ++y) {
+            for (size_t x = tile.x0; x < tile.x1; ++x) {
+                local.set(depth, x, y, float(x + y));
+                local.set(albedo, x, y, vec3(float(x), float(y), float(tile.index)));
+                local.set(samples, x, y, uint32_t(x * y));
+            }
+        }
+        aovs.merge(local);
+    });
+
+    for (size_t y = 0; y < aovs.getHeight(); ++y) {
+        for (size_t x = 0; x < aovs.getWidth(); ++x) {
+            REQUIRE(aovs.getFloat(depth, x, y) == float(x + y));
+            REQUIRE(aovs.getVec3(albedo, x, y)[0] == float(x));
+            REQUIRE(aovs.getVec3(albedo, x, y)[1] == float(y));
+            REQUIRE(aovs.getUInt(samples, x, y) == x * y);
+        }
+    }
+
+    // A tile made before a layer was added no longer fits
+    AOVBuffer::TileBuffer stale = aovs.makeTile(Tile{ 0, 0, 0, 8, 8 });
+    aovs.addLayer("extra", AOVBuffer::Type::Float);
+    REQUIRE_THROWS_AS(aovs.merge(stale), std::invalid_argument);
+}
+
+TEST_CASE("AOV writes", "[.][benchmark][AOVBuffer]") {
+    const size_t width = 1024, height = 1024;
+    AOVBuffer aovs(width, height);
+    size_t depth = aovs.addLayer("depth", AOVBuffer::Type::Float);
+    size_t normal = aovs.addLayer("normal", AOVBuffer::Type::Vec3);
+    size_t id = aovs.addLayer("objectID", AOVBuffer::Type::UInt32);
+    FrameBuffer depthFb(width, height), normalFb(width, height), idFb(width, height);
+    TileScheduler scheduler(1, 32);
+
+    BENCHMARK("separate FrameBuffers") {
+        scheduler.run(width, height, [&](const Tile& tile) {
+            for (size_t y = tile.y0; y < tile.y1; ++y) {
+                for (size_t x = tile.x0; x < tile.x1; ++x) {
+                    depthFb(x, y) = vec3(float(x), 0.0f, 0.0f);
+                    normalFb(x, y) = vec3(0.0f, 1.0f, 0.0f);
+                    idFb(x, y) = vec3(float(y), 0.0f, 0.0f);
+                }
+            }
+        });
+        return depthFb(1, 1);
+    };
+
+    BENCHMARK("AOVBuffer tiles") {
+        scheduler.run(width, height, [&](const Tile& tile) {
+            AOVBuffer::TileBuffer local = aovs.makeTile(tile);
+            for (size_t y = tile.y0; y < tile.y1; ++y) {
+                for (size_t x = tile.x0; x < tile.x1; ++x) {
+                    local.set(depth, x, y, float(x));
+                    local.set(normal, x, y, vec3(0.0f, 1.0f, 0.0f));
+                    local.set(id, x, y, uint32_t(y));
+                }
+            }
+            aovs.merge(local);
+        });
+        return aovs.getFloat(depth, 1, 1);
+    };
+}
@@ -0,0 +1,61 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "AccumulationBuffer.h"
+
+TEST_CASE("AccumulationBuffer basic operations", "[AccumulationBuffer]") {
+    AccumulationBuffer accum(8, 4, true);
+
+    SECTION("Initialization") {
+        REQUIRE(accum.getWidth() == 8);
+        REQUIRE(accum.getHeight() == 4);
+        REQUIRE(accum.hasMoments());
+        REQUIRE(accum.getTotalSamples() == 0);
+        REQUIRE(accum.getMean(3, 2) == vec3(0.0f, 0.0f, 0.0f));
+    }
+
+    SECTION("Mean and variance") {
+        accum.addSample(1, 1, vec3(1.0f, 0.0f, 2.0f));
+        accum.addSample(1, 1, vec3(3.0f, 0.0f, 2.0f));
+        REQUIRE(accum.getSampleCount(1, 1) == 2);
+        REQUIRE(accum.getMean(1, 1) == vec3(2.0f, 0.0f, 2.0f));
+
+        vec3 var = accum.getVariance(1, 1);
+        REQUIRE_THAT(var[0], Catch::Matchers::WithinAbs(2.0f, 1e-5f));
+        REQUIRE_THAT(var[1], Catch::Matchers::WithinAbs(0.0f, 1e-5f));
+        REQUIRE_THAT(var[2], Catch::Matchers::WithinAbs(0.0f, 1e-5f));
+    }
+
+    SECTION("Tile merge and resolve") {
+        TileScheduler scheduler(2, 3);
+        for (int pass = 0; pass < 3; ++pass) {
+            scheduler.run(accum.getWidth(), accum.getHeight(), [&](const Tile& tile) {
+                auto local = accum.makeTile(tile);
+                for (size_t y = tile.y0; y < tile.y1; ++y) {
+                    for (size_t x = tile.x0; x < tile.x1; ++x) {
+                        local.addSample(x, y, vec3(float(x), float(y), float(pass)));
+                    }
+                }
+                accum.merge(local);
+            });
+        }
+
+        REQUIRE(accum.getTotalSamples() == 8 * 4 * 3);
+
+        FrameBuffer fb(8, 4);
+        accum.resolve(fb, scheduler);
+        for (size_t y = 0; y < 4; ++y) {
+            for (size_t x = 0; x < 8; ++x) {
+                REQUIRE(accum.getSampleCount(x, y) == 3);
+                REQUIRE(fb(x, y) == vec3(float(x), float(y), 1.0f));
+            }
+        }
+
+        accum.clear();
+        REQUIRE(accum.getTotalSamples() == 0);
+    }
+
+    SECTION("Mismatched resolve target") {
+        FrameBuffer fb(4, 4);
+        REQUIRE_THROWS(accum.resolve(fb));
+    }
+}
@@ -0,0 +1,144 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include "AdaptiveSampler.h"
+#include "handleGraphicsArgs.h"
+
+namespace {
+    // Deterministic uniform value in [0, 1) for a pixel and sample
+    float hashUniform(size_t x, size_t y, uint32_t i) {
+        uint64_t h = (uint64_t(x) * 0x9E3779B97F4A7C15ull) ^ (uint64_t(y) * 0xC2B2AE3D27D4EB4Full) ^ (uint64_t(i) * 0x165667B19E3779F9ull);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        return float(h >> 40) / float(1u << 24);
+    }
+
+    // Flat on the left half, noisy with mean 0.5 on the right
+    vec3 halfNoisy(size_t x, size_t y, uint32_t i, size_t width) {
+        if (x < width / 2) {
+            return vec3(0.25f, 0.5f, 0.75f);
+        }
+        float v = hashUniform(x, y, i);
+        return vec3(v, v, v);
+    }
+}
+
+TEST_CASE("Adaptive sampling stops flat tiles and spends the rest on noise", "[AdaptiveSampler]") {
+    const size_t width = 64, height = 32;
+    AdaptiveOptions options;
+    options.samplesPerPixel = 16;
+    options.minSamples = 4;
+    options.threshold = 0.02f;
+
+    AdaptiveSampler sampler(width, height, options);
+    TileScheduler scheduler(2, 16);
+    uint64_t spent = sampler.render(scheduler, [&](size_t x, size_t y, uint32_t i) {
+        return halfNoisy(x, y, i, width);
+    });
+
+    REQUIRE(spent == sampler.getSamplesSpent());
+    REQUIRE(spent <= options.samplesPerPixel * width * height);
+    // Nearly the whole budget is used, just not evenly
+    REQUIRE(spent >= options.samplesPerPixel * width * height * 9 / 10);
+    REQUIRE(sampler.getPasses() > 1);
+    REQUIRE(sampler.getNumTiles() == 8);
+
+    const AccumulationBuffer& accum = sampler.getAccumulation();
+    for (size_t i = 0; i < sampler.getNumTiles(); ++i) {
+        const Tile& tile = sampler.getTile(i);
+        if (tile.x1 <= width / 2) {
+            // Zero variance: converged after the first pass
+            REQUIRE(sampler.isTileConverged(i));
+            REQUIRE(sampler.getTileError(i) == 0.0f);
+            REQUIRE(accum.getSampleCount(tile.x0, tile.y0) == options.minSamples);
+        } else {
+            REQUIRE(accum.getSampleCount(tile.x0, tile.y0) > options.samplesPerPixel);
+        }
+    }
+    REQUIRE(sampler.getNumConverged() >= 4);
+
+    FrameBuffer fb(width, height);
+    sampler.resolve(fb);
+    REQUIRE(fb(3, 3) == vec3(0.25f, 0.5f, 0.75f));
+    REQUIRE(std::fabs(fb(50, 20)[0] - 0.5f) < 0.25f);
+
+    // Fewest samples are black, most are white
+    FrameBuffer heat = sampler.makeHeatmap();
+    REQUIRE(heat(3, 3) == vec3(0.0f, 0.0f, 0.0f));
+    REQUIRE(heat(50, 20)[0] > 0.0f);
+}
+
+TEST_CASE("Adaptive sampling ends early when everything converges", "[AdaptiveSampler]") {
+    AdaptiveOptions options;
+    options.samplesPerPixel = 64;
+    AdaptiveSampler sampler(40, 24, options);
+    TileScheduler scheduler(1, 8);
+
+    uint64_t spent = sampler.render(scheduler, [](size_t, size_t, uint32_t) { return vec3(1.0f, 1.0f, 1.0f); });
+    REQUIRE(spent == 40 * 24 * options.minSamples);
+    REQUIRE(sampler.getPasses() == 1);
+    REQUIRE(sampler.getNumConverged() == sampler.getNumTiles());
+}
+
+TEST_CASE("Adaptive sampling respects the per-pixel cap", "[AdaptiveSampler]") {
+    AdaptiveOptions options;
+    options.samplesPerPixel = 32;
+    options.maxSamples = 10;
+    options.threshold = 1e-6f;
+    AdaptiveSampler sampler(16, 16, options);
+    TileScheduler scheduler(2, 8);
+
+    sampler.render(scheduler, [](size_t x, size_t y, uint32_t i) {
+        float v = hashUniform(x, y, i);
+        return vec3(v, v, v);
+    });
+    for (size_t y = 0; y < 16; ++y) {
+        for (size_t x = 0; x < 16; ++x) {
+            REQUIRE(sampler.getAccumulation().getSampleCount(x, y) == 10);
+        }
+    }
+
+    options.threshold = 0.0f;
+    REQUIRE_THROWS_AS(AdaptiveSampler(4, 4, options), std::invalid_argument);
+
+    // One sample per pixel cannot pay for the two-sample first pass
+    AdaptiveOptions tooSmall;
+    tooSmall.samplesPerPixel = 1;
+    REQUIRE_THROWS_AS(AdaptiveSampler(4, 4, tooSmall), std::invalid_argument);
+
+    // Default arguments give a budget the sampler accepts
+    sivelab::GraphicsArgs args;
+    AdaptiveOptions fromDefaults = AdaptiveOptions::fromArgs(args);
+    REQUIRE(fromDefaults.samplesPerPixel == 2);
+    REQUIRE_NOTHROW(AdaptiveSampler(4, 4, fromDefaults));
+}
+
+TEST_CASE("Adaptive versus uniform sampling", "[.][benchmark][AdaptiveSampler]") {
+    const size_t width = 256, height = 256;
+    auto sample = [&](size_t x, size_t y, uint32_t i) { return halfNoisy(x, y, i, width); };
+    TileScheduler scheduler(0, 16);
+
+    BENCHMARK("uniform 32 spp") {
+        AccumulationBuffer accum(width, height);
+        scheduler.run(width, height, [&](const Tile& tile) {
+            AccumulationBuffer::TileAccumulator local = accum.makeTile(tile);
+            for (size_t y = tile.y0; y < tile.y1; ++y) {
+                for (size_t x = tile.x0; x < tile.x1; ++x) {
+                    for (uint32_t i = 0; i < 32; ++i) local.addSample(x, y, sample(x, y, i));
+                }
+            }
+            accum.merge(local);
+        });
+        return accum.getTotalSamples();
+    };
+
+    BENCHMARK("adaptive 32 spp budget") {
+        AdaptiveOptions options;
+        options.samplesPerPixel = 32;
+        AdaptiveSampler sampler(width, height, options);
+        return sampler.render(scheduler, sample);
+    };
+}
@@ -0,0 +1,196 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "Checkpoint.h"
+#include "handleGraphicsArgs.h"
+
+namespace {
+    // Sample value depends only on (seed, x, y, sample index), as a
+    // resumable sampler's random numbers must
+    vec3 sample(uint64_t seed, size_t x, size_t y, uint32_t i) {
+        uint64_t h = seed ^ (uint64_t(x) * 0x9E3779B97F4A7C15ull) ^ (uint64_t(y) * 0xC2B2AE3D27D4EB4Full) ^ (uint64_t(i) << 40);
+        h ^= h >> 31;
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 29;
+        float v = float(h >> 40) / float(1u << 24);
+        return vec3(v, v * v, 1.0f - v);
+    }
+
+    void renderPasses(AccumulationBuffer& accum, uint64_t seed, size_t passes) {
+        for (size_t p = 0; p < passes; ++p) {
+            for (size_t y = 0; y < accum.getHeight(); ++y) {
+                for (size_t x = 0; x < accum.getWidth(); ++x) {
+                    accum.addSample(x, y, sample(seed, x, y, accum.getSampleCount(x, y)));
+                }
+            }
+        }
+    }
+
+    bool sameBits(const AccumulationBuffer& a, const AccumulationBuffer& b) {
+        for (size_t y = 0; y < a.getHeight(); ++y) {
+            for (size_t x = 0; x < a.getWidth(); ++x) {
+                vec3 sa = a.getSum(x, y), sb = b.getSum(x, y);
+                vec3 va = a.getVariance(x, y), vb = b.getVariance(x, y);
+                if (std::memcmp(&sa, &sb, sizeof(vec3)) != 0 || std::memcmp(&va, &vb, sizeof(vec3)) != 0 ||
+                    a.getSampleCount(x, y) != b.getSampleCount(x, y)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+TEST_CASE("Checkpoint round trip", "[Checkpoint]") {
+    const char* filename = "utest_Checkpoint.ckpt";
+    AccumulationBuffer accum(23, 17, true);
+    renderPasses(accum, 99, 3);
+
+    CheckpointInfo info;
+    info.seed = 99;
+    info.passes = 3;
+    info.userData = std::string("rng\0state", 9);
+    Checkpoint::write(filename, accum, info);
+
+    AccumulationBuffer loaded(1, 1);
+    CheckpointInfo loadedInfo = Checkpoint::read(filename, loaded);
+    REQUIRE(loadedInfo.seed == 99);
+    REQUIRE(loadedInfo.passes == 3);
+    REQUIRE(loadedInfo.userData == info.userData);
+    REQUIRE(loaded.getWidth() == 23);
+    REQUIRE(loaded.getHeight() == 17);
+    REQUIRE(loaded.hasMoments());
+    REQUIRE(sameBits(accum, loaded));
+
+    std::remove(filename);
+}
+
+TEST_CASE("Damaged checkpoints are rejected", "[Checkpoint]") {
+    const char* filename = "utest_Checkpoint_bad.ckpt";
+    AccumulationBuffer accum(8, 8);
+    renderPasses(accum, 1, 2);
+    Checkpoint::write(filename, accum, CheckpointInfo());
+
+    std::string bytes;
+    {
+        std::ifstream in(filename, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    auto rewrite = [&](const std::string& contents) {
+        std::ofstream out(filename, std::ios::binary);
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    };
+
+    AccumulationBuffer loaded(8, 8);
+
+    std::string flipped = bytes;
+    flipped[flipped.size() / 2] ^= 0x10;
+    rewrite(flipped);
+    REQUIRE_THROWS_AS(Checkpoint::read(filename, loaded), std::runtime_error);
+
+    rewrite(bytes.substr(0, bytes.size() - 10));
+    REQUIRE_THROWS_AS(Checkpoint::read(filename, loaded), std::runtime_error);
+
+    rewrite("not a checkpoint at all, just some text");
+    REQUIRE_THROWS_AS(Checkpoint::read(filename, loaded), std::runtime_error);
+
+    std::remove(filename);
+    REQUIRE_THROWS_AS(Checkpoint::read(filename, loaded), std::runtime_error);
+}
+
+TEST_CASE("Resuming from an asynchronous checkpoint is bit-exact", "[Checkpoint]") {
+    const char* filename = "utest_Checkpoint_resume.ckpt";
+    const uint64_t seed = 1234;
+
+    AccumulationBuffer reference(31, 19, true);
+    renderPasses(reference, seed, 8);
+
+    // Render three passes, checkpointing after each, then "crash"
+    {
+        AccumulationBuffer accum(31, 19, true);
+        CheckpointWriter writer(filename);
+        for (uint64_t pass = 1; pass <= 3; ++pass) {
+            renderPasses(accum, seed, 1);
+            writer.save(accum, CheckpointInfo{ seed, pass, "" });
+        }
+        writer.wait();
+        REQUIRE(writer.getWritesCompleted() >= 1);
+        REQUIRE(!writer.saveIfDue(accum, CheckpointInfo{ seed, 3, "" }, std::chrono::hours(1)));
+    }
+
+    AccumulationBuffer resumed(1, 1);
+    CheckpointInfo info = Checkpoint::read(filename, resumed);
+    REQUIRE(info.passes == 3);
+    renderPasses(resumed, info.seed, 8 - info.passes);
+    REQUIRE(sameBits(reference, resumed));
+
+    std::remove(filename);
+}
+
+TEST_CASE("Checkpoint options from the command line", "[Checkpoint]") {
+    const char* filename = "utest_Checkpoint_args.ckpt";
+    sivelab::GraphicsArgs args;
+
+    // No flags: no writer and nothing to resume
+    CheckpointOptions off = CheckpointOptions::fromArgs(args);
+    REQUIRE(off.interval == std::chrono::seconds(300));
+    REQUIRE(off.makeWriter() == nullptr);
+    AccumulationBuffer fresh(4, 3);
+    CheckpointInfo freshInfo{ 77, 0, "" };
+    REQUIRE(!off.resume(fresh, freshInfo));
+    REQUIRE(freshInfo.seed == 77);
+
+    args.checkpointFileName = filename;
+    args.checkpointInterval = 60;
+    CheckpointOptions on = CheckpointOptions::fromArgs(args);
+    REQUIRE(on.interval == std::chrono::seconds(60));
+    {
+        AccumulationBuffer accum(4, 3);
+        renderPasses(accum, 5, 2);
+        auto writer = on.makeWriter();
+        REQUIRE(writer != nullptr);
+        REQUIRE(writer->getFilename() == filename);
+        writer->save(accum, CheckpointInfo{ 5, 2, "" });
+    }
+
+    args.resumeFileName = filename;
+    CheckpointOptions resuming = CheckpointOptions::fromArgs(args);
+    AccumulationBuffer resumed(4, 3);
+    CheckpointInfo info{ 77, 0, "" };
+    REQUIRE(resuming.resume(resumed, info));
+    REQUIRE(info.seed == 5);
+    REQUIRE(info.passes == 2);
+    REQUIRE(resumed.getSampleCount(3, 2) == 2);
+
+    // A checkpoint of another size leaves the buffer alone
+    AccumulationBuffer otherSize(5, 3);
+    REQUIRE_THROWS_AS(resuming.resume(otherSize, info), std::runtime_error);
+    REQUIRE(otherSize.getWidth() == 5);
+
+    args.checkpointInterval = 0;
+    REQUIRE_THROWS_AS(CheckpointOptions::fromArgs(args), std::invalid_argument);
+
+    std::remove(filename);
+}
+
+TEST_CASE("Checkpoint cost on the render thread", "[.][benchmark][Checkpoint]") {
+    const char* filename = "utest_Checkpoint_bench.ckpt";
+    AccumulationBuffer accum(1920, 1080, true);
+    CheckpointWriter writer(filename);
+
+    BENCHMARK("snapshot (render thread)") {
+        writer.save(accum, CheckpointInfo());
+        return writer.getFilename().size();
+    };
+    writer.wait();
+
+    BENCHMARK("synchronous write") {
+        Checkpoint::write(filename, accum, CheckpointInfo());
+        return 0;
+    };
+    std::remove(filename);
+}
@@ -0,0 +1,148 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include "CompactFrameBuffer.h"
+
+namespace {
+    // Wide dynamic range plus the awkward values
+    std::vector<vec3> makeColors(size_t count) {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> exponent(-20.0f, 17.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<vec3> colors(count);
+        for (auto& c : colors) {
+            for (int k = 0; k < 3; ++k) {
+                c[k] = unit(rng) < 0.5f ? std::exp2(exponent(rng)) : unit(rng);
+            }
+        }
+        colors[0] = vec3(0.0f, -1.0f, std::numeric_limits<float>::quiet_NaN());
+        colors[1] = vec3(1e9f, 65504.0f, 1e-30f);
+        return colors;
+    }
+
+    // The bulk conversions must agree exactly with the scalar ones,
+    // including the odd-sized tails
+    template <typename Format>
+    void requireBulkMatchesScalar() {
+        for (size_t count : { size_t(1), size_t(7), size_t(1001) }) {
+            std::vector<vec3> colors = makeColors(count);
+            std::vector<typename Format::Storage> packed(count);
+            Format::encode(colors.data(), count, packed.data());
+
+            std::vector<vec3> decoded(count);
+            Format::decode(packed.data(), count, decoded.data());
+            for (size_t i = 0; i < count; ++i) {
+                REQUIRE(packed[i] == Format::encode(colors[i]));
+                vec3 expected = Format::decode(packed[i]);
+                REQUIRE(std::memcmp(&decoded[i], &expected, sizeof(vec3)) == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("Half conversions", "[CompactFrameBuffer]") {
+    REQUIRE(Half16Format::floatToHalf(1.0f) == 0x3C00);
+    REQUIRE(Half16Format::floatToHalf(-2.0f) == 0xC000);
+    REQUIRE(Half16Format::floatToHalf(65504.0f) == 0x7BFF);
+    REQUIRE(Half16Format::floatToHalf(65520.0f) == 0x7C00);
+    REQUIRE(Half16Format::floatToHalf(std::exp2(-24.0f)) == 0x0001);
+    REQUIRE(Half16Format::floatToHalf(std::exp2(-26.0f)) == 0x0000);
+    REQUIRE((Half16Format::floatToHalf(std::numeric_limits<float>::quiet_NaN()) & 0x7FFF) > 0x7C00);
+
+    // Ties round to even
+    REQUIRE(Half16Format::floatToHalf(1.0f + std::exp2(-11.0f)) == 0x3C00);
+    REQUIRE(Half16Format::floatToHalf(1.0f + 3.0f * std::exp2(-11.0f)) == 0x3C02);
+
+    // Every finite half survives the trip through float
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+        if ((h & 0x7C00) == 0x7C00) continue;
+        REQUIRE(Half16Format::floatToHalf(Half16Format::halfToFloat(uint16_t(h))) == h);
+    }
+
+    requireBulkMatchesScalar<Half16Format>();
+}
+
+TEST_CASE("RGB9E5 conversions", "[CompactFrameBuffer]") {
+    REQUIRE(RGB9E5Format::decode(RGB9E5Format::encode(vec3(1.0f, 0.5f, 0.25f))) == vec3(1.0f, 0.5f, 0.25f));
+    REQUIRE(RGB9E5Format::decode(RGB9E5Format::encode(vec3(-1.0f, 0.0f, std::numeric_limits<float>::quiet_NaN()))) ==
+            vec3(0.0f, 0.0f, 0.0f));
+    REQUIRE(RGB9E5Format::decode(RGB9E5Format::encode(vec3(1e9f, 0.0f, 0.0f)))[0] == 65408.0f);
+
+    // The error is bounded by the shared exponent, i.e. by the largest channel
+    for (const vec3& c : makeColors(500)) {
+        vec3 d = RGB9E5Format::decode(RGB9E5Format::encode(c));
+        float maxc = 0.0f;
+        for (int k = 0; k < 3; ++k) maxc = std::max(maxc, std::isnan(c[k]) ? 0.0f : std::min(c[k], 65408.0f));
+        for (int k = 0; k < 3; ++k) {
+            float expected = (c[k] > 0.0f) ? std::min(c[k], 65408.0f) : 0.0f;
+            REQUIRE(std::fabs(d[k] - expected) <= std::max(maxc / 512.0f, std::exp2(-25.0f)));
+        }
+    }
+
+    requireBulkMatchesScalar<RGB9E5Format>();
+}
+
+TEST_CASE("sRGB8 conversions", "[CompactFrameBuffer]") {
+    // Decoding any byte and encoding it again gives the same byte
+    for (int i = 0; i < 256; ++i) {
+        SRGB8Format::Storage s = { uint8_t(i), uint8_t(255 - i), uint8_t(i / 2) };
+        REQUIRE(SRGB8Format::encode(SRGB8Format::decode(s)) == s);
+    }
+    REQUIRE(SRGB8Format::decode({ 0, 255, 0 }) == vec3(0.0f, 1.0f, 0.0f));
+
+    requireBulkMatchesScalar<SRGB8Format>();
+}
+
+TEST_CASE("CompactFrameBuffer stores and converts rows", "[CompactFrameBuffer]") {
+    REQUIRE(HalfFrameBuffer::bytesPerPixel() == 6);
+    REQUIRE(RGB9E5FrameBuffer::bytesPerPixel() == 4);
+    REQUIRE(SRGB8FrameBuffer::bytesPerPixel() == 3);
+
+    FrameBuffer fb(29, 13, FrameBuffer::Layout::Tiled8);
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) {
+            fb.setPixel(x, y, vec3(x / 29.0f, y / 13.0f, 0.5f));
+        }
+    }
+
+    HalfFrameBuffer half(fb);
+    REQUIRE(half.getData().size() == 29 * 13);
+    FrameBuffer back = half.toFrameBuffer(FrameBuffer::Layout::Morton);
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) {
+            for (int k = 0; k < 3; ++k) {
+                REQUIRE(std::fabs(back(x, y)[k] - fb(x, y)[k]) <= 1.0f / 2048.0f);
+            }
+        }
+    }
+
+    SRGB8FrameBuffer srgb(4, 2);
+    srgb.setBackground(vec3(1.0f, 0.0f, 1.0f));
+    srgb.setPixel(3, 1, vec3(0.0f, 1.0f, 0.0f));
+    REQUIRE(srgb.getPixel(0, 0) == vec3(1.0f, 0.0f, 1.0f));
+    REQUIRE(srgb.getPixel(3, 1) == vec3(0.0f, 1.0f, 0.0f));
+
+    std::vector<vec3> scratch;
+    const vec3* row = srgb.getRowSource()(1, scratch);
+    REQUIRE(row[2] == vec3(1.0f, 0.0f, 1.0f));
+    REQUIRE(row[3] == vec3(0.0f, 1.0f, 0.0f));
+}
+
+TEST_CASE("Compact pixel conversion throughput", "[.][benchmark][CompactFrameBuffer]") {
+    const size_t count = 1920 * 1080;
+    std::vector<vec3> colors = makeColors(count);
+    std::vector<vec3> decoded(count);
+    std::vector<Half16Format::Storage> half(count);
+    std::vector<RGB9E5Format::Storage> shared(count);
+    std::vector<SRGB8Format::Storage> srgb(count);
+
+    BENCHMARK("half16 encode") { Half16Format::encode(colors.data(), count, half.data()); return half[0]; };
+    BENCHMARK("half16 decode") { Half16Format::decode(half.data(), count, decoded.data()); return decoded[0]; };
+    BENCHMARK("rgb9e5 encode") { RGB9E5Format::encode(colors.data(), count, shared.data()); return shared[0]; };
+    BENCHMARK("rgb9e5 decode") { RGB9E5Format::decode(shared.data(), count, decoded.data()); return decoded[0]; };
+    BENCHMARK("srgb8 encode") { SRGB8Format::encode(colors.data(), count, srgb.data()); return srgb[0]; };
+    BENCHMARK("srgb8 decode") { SRGB8Format::decode(srgb.data(), count, decoded.data()); return decoded[0]; };
+}
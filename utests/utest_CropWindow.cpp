@@ -0,0 +1,141 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "CropWindow.h"
+#include "CropMerge.h"
+#include "ImageIO.h"
+
+namespace {
+    // Distinct, exactly representable value for every full-frame pixel
+    vec3 framePixel(size_t x, size_t y) {
+        return vec3(float(x), float(y), float(x * 1000 + y));
+    }
+
+    FrameBuffer renderCrop(const CropWindow& crop) {
+        FrameBuffer fb(crop.width, crop.height);
+        for (size_t y = 0; y < crop.height; ++y) {
+            for (size_t x = 0; x < crop.width; ++x) {
+                fb.setPixel(x, y, framePixel(crop.toFullX(x), crop.toFullY(y)));
+            }
+        }
+        return fb;
+    }
+
+    void removeAll(const std::vector<std::string>& filenames) {
+        for (const auto& f : filenames) std::remove(f.c_str());
+    }
+}
+
+TEST_CASE("Crop windows parse rectangles and bands", "[CropWindow]") {
+    CropWindow rect = CropWindow::parse("10,20,30,40", 100, 80);
+    REQUIRE(rect == CropWindow{ 10, 20, 30, 40, 100, 80 });
+    REQUIRE_FALSE(rect.isFullFrame());
+    REQUIRE(rect.toFullX(5) == 15);
+    REQUIRE(rect.toFullY(5) == 25);
+
+    CropWindow band = CropWindow::parse("1/3", 100, 80);
+    REQUIRE(band == CropWindow{ 0, 26, 100, 27, 100, 80 });
+
+    REQUIRE(CropWindow::parse("0,0,100,80", 100, 80).isFullFrame());
+
+    REQUIRE_THROWS_AS(CropWindow::parse("10,20,30", 100, 80), std::invalid_argument);
+    REQUIRE_THROWS_AS(CropWindow::parse("10,20,-30,40", 100, 80), std::invalid_argument);
+    REQUIRE_THROWS_AS(CropWindow::parse("80,0,30,40", 100, 80), std::invalid_argument);
+    REQUIRE_THROWS_AS(CropWindow::parse("0,0,0,40", 100, 80), std::invalid_argument);
+    REQUIRE_THROWS_AS(CropWindow::parse("3/3", 100, 80), std::invalid_argument);
+    REQUIRE_THROWS_AS(CropWindow::parse("a/3", 100, 80), std::invalid_argument);
+}
+
+TEST_CASE("Bands cover the frame without overlap", "[CropWindow]") {
+    std::vector<CropWindow> bands = CropWindow::bands(64, 101, 7);
+    REQUIRE(bands.size() == 7);
+    size_t nextRow = 0;
+    for (const CropWindow& band : bands) {
+        REQUIRE(band.y0 == nextRow);
+        REQUIRE(band.width == 64);
+        REQUIRE((band.height == 14 || band.height == 15));
+        nextRow += band.height;
+    }
+    REQUIRE(nextRow == 101);
+
+    REQUIRE_THROWS_AS(CropWindow::bands(64, 4, 5), std::invalid_argument);
+}
+
+TEST_CASE("Merge inputs parse optional offsets", "[CropWindow]") {
+    MergeInput plain = MergeInput::parse("band0.exr");
+    REQUIRE(plain.filename == "band0.exr");
+    REQUIRE_FALSE(plain.hasOffset);
+
+    MergeInput placed = MergeInput::parse("dir@v2/part.pfm@16,32");
+    REQUIRE(placed.filename == "dir@v2/part.pfm");
+    REQUIRE(placed.hasOffset);
+    REQUIRE(placed.x0 == 16);
+    REQUIRE(placed.y0 == 32);
+
+    // Anything else after an '@' belongs to the filename
+    for (const char* name : { "part@2x.png", "part.pfm@16", "part.pfm@x,2", "part.pfm@-1,2", "@1,2" }) {
+        MergeInput input = MergeInput::parse(name);
+        REQUIRE(input.filename == name);
+        REQUIRE_FALSE(input.hasOffset);
+    }
+}
+
+TEST_CASE("Merging EXR bands rebuilds the frame", "[CropWindow]") {
+    const size_t width = 45, height = 31;
+    std::vector<std::string> files;
+    std::vector<MergeInput> inputs;
+    for (const CropWindow& band : CropWindow::bands(width, height, 4)) {
+        std::string filename = "utest_CropWindow_band" + std::to_string(files.size()) + ".exr";
+        writeImage(renderCrop(band), filename, band);
+        files.push_back(filename);
+        inputs.push_back(MergeInput::parse(filename));
+    }
+    files.push_back("utest_CropWindow_merged.exr");
+
+    MergeReport report = mergeCrops(inputs, files.back());
+    FrameBuffer merged = readImage(files.back());
+    removeAll(files);
+
+    REQUIRE(report.width == width);
+    REQUIRE(report.height == height);
+    REQUIRE(report.uncoveredPixels == 0);
+    REQUIRE(report.overlappedPixels == 0);
+    REQUIRE(merged.getWidth() == width);
+    REQUIRE(merged.getHeight() == height);
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                REQUIRE(merged(x, y)[c] == framePixel(x, y)[c]);
+            }
+        }
+    }
+}
+
+TEST_CASE("Merging placed tiles reports gaps and overlaps", "[CropWindow]") {
+    // Two 20x10 tiles side by side in a 40x12 frame, overlapping by 4
+    // columns and leaving the bottom two rows empty
+    CropWindow left{ 0, 0, 22, 10, 40, 12 };
+    CropWindow right{ 18, 0, 22, 10, 40, 12 };
+    std::vector<std::string> files = { "utest_CropWindow_left.pfm", "utest_CropWindow_right.pfm",
+                                       "utest_CropWindow_merged.exr" };
+    writeImage(renderCrop(left), files[0], left);
+    writeImage(renderCrop(right), files[1], right);
+
+    std::vector<MergeInput> inputs = { MergeInput::parse(files[0] + "@0,0"), MergeInput::parse(files[1] + "@18,0") };
+    REQUIRE_THROWS_AS(mergeCrops(inputs, files[2]), std::invalid_argument);
+    REQUIRE_THROWS_AS(mergeCrops(inputs, "utest_CropWindow_merged.pfm", 40, 12), std::invalid_argument);
+    REQUIRE_THROWS_AS(mergeCrops(inputs, files[2], 30, 12), std::runtime_error);
+
+    MergeReport report = mergeCrops(inputs, files[2], 40, 12);
+    FrameBuffer merged = readImage(files[2]);
+    removeAll(files);
+
+    REQUIRE(report.uncoveredPixels == 2 * 40);
+    REQUIRE(report.overlappedPixels == 4 * 10);
+    REQUIRE(merged(5, 5)[0] == framePixel(5, 5)[0]);
+    REQUIRE(merged(20, 3)[2] == framePixel(20, 3)[2]);
+    REQUIRE(merged(39, 9)[1] == framePixel(39, 9)[1]);
+    REQUIRE(merged(7, 11)[0] == 0.0f);
+}
@@ -0,0 +1,173 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include "Denoiser.h"
+#include "ImageCompare.h"
+
+using Catch::Matchers::WithinAbs;
+
+namespace {
+    // Two flat, evenly lit surfaces meeting at a vertical edge, with
+    // different albedo and normals, and the guide layers that go with
+    // them.  The noise is in the lighting, so it scales with albedo as it
+    // does in a path tracer.
+    struct Scene {
+        FrameBuffer truth, noisy;
+        AOVBuffer guides;
+
+        Scene(size_t width, size_t height, float noise)
+            : truth(width, height), noisy(width, height), guides(width, height) {
+            size_t normal = guides.addLayer("normal", AOVBuffer::Type::Vec3);
+            size_t albedo = guides.addLayer("albedo", AOVBuffer::Type::Vec3);
+            size_t depth = guides.addLayer("depth", AOVBuffer::Type::Float);
+            std::mt19937 rng(7);
+            std::uniform_real_distribution<float> jitter(-noise, noise);
+            for (size_t y = 0; y < height; ++y) {
+                for (size_t x = 0; x < width; ++x) {
+                    bool left = x < width / 2;
+                    vec3 a = left ? vec3(0.5f, 0.4f, 0.3f) : vec3(0.4f, 0.4f, 0.4f);
+                    guides.set(albedo, x, y, a);
+                    guides.set(normal, x, y, left ? vec3(0.0f, 0.0f, 1.0f) : vec3(1.0f, 0.0f, 0.0f));
+                    guides.set(depth, x, y, left ? 2.0f : 3.0f);
+                    truth(x, y) = a;
+                    noisy(x, y) = vec3(a[0] * (1.0f + jitter(rng)), a[1] * (1.0f + jitter(rng)), a[2] * (1.0f + jitter(rng)));
+                }
+            }
+        }
+
+        // Mean squared error over the columns within two pixels of the edge
+        double edgeError(const FrameBuffer& image) const {
+            double sum = 0.0;
+            size_t count = 0;
+            for (size_t y = 0; y < truth.getHeight(); ++y) {
+                for (size_t x = truth.getWidth() / 2 - 2; x < truth.getWidth() / 2 + 2; ++x) {
+                    vec3 d = image(x, y) - truth(x, y);
+                    sum += d.dot(d);
+                    ++count;
+                }
+            }
+            return sum / count;
+        }
+    };
+}
+
+TEST_CASE("A constant image is left alone", "[Denoiser]") {
+    FrameBuffer fb(37, 23);
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) fb(x, y) = vec3(0.25f, 0.5f, 4.0f);
+    }
+    FrameBuffer out(1, 1);
+    Denoiser().denoise(fb, out);
+    REQUIRE(out.getWidth() == fb.getWidth());
+    REQUIRE(out.getHeight() == fb.getHeight());
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) {
+            for (int c = 0; c < 3; ++c) REQUIRE_THAT(out(x, y)[c], WithinAbs(fb(x, y)[c], 1e-5f));
+        }
+    }
+}
+
+TEST_CASE("Guides remove noise and keep edges", "[Denoiser]") {
+    Scene scene(96, 64, 0.5f);
+    double noisyError = compareImages(scene.truth, scene.noisy).mse;
+
+    Denoiser denoiser;
+    FrameBuffer guided(1, 1), unguided(1, 1);
+    denoiser.denoise(scene.noisy, scene.guides, guided);
+    denoiser.denoise(scene.noisy, unguided);
+
+    REQUIRE(compareImages(scene.truth, guided).mse < 0.01 * noisyError);
+    REQUIRE(compareImages(scene.truth, unguided).mse < 0.5 * noisyError);
+    REQUIRE(scene.edgeError(guided) < 0.1 * scene.edgeError(unguided));
+}
+
+TEST_CASE("A noise-free edge stays sharp", "[Denoiser]") {
+    // No noise to measure, so the color width bottoms out and the weights
+    // across the edge are far below the exponent clamp
+    FrameBuffer fb(64, 64);
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) fb(x, y) = x < 32 ? vec3(0.0f, 0.0f, 0.0f) : vec3(1.0f, 1.0f, 1.0f);
+    }
+    FrameBuffer out(1, 1);
+    Denoiser().denoise(fb, out);
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) {
+            for (int c = 0; c < 3; ++c) REQUIRE_THAT(out(x, y)[c], WithinAbs(fb(x, y)[c], 1e-5f));
+        }
+    }
+}
+
+TEST_CASE("Infinitely distant background depth", "[Denoiser]") {
+    for (float background : { INFINITY, FLT_MAX }) {
+        Scene scene(64, 48, 0.2f);
+        size_t depth = scene.guides.getLayerIndex("depth");
+        for (size_t y = 0; y < 48; ++y) {
+            for (size_t x = 32; x < 64; ++x) scene.guides.set(depth, x, y, background);
+        }
+
+        FrameBuffer out(1, 1);
+        Denoiser().denoise(scene.noisy, scene.guides, out);
+        for (size_t y = 0; y < out.getHeight(); ++y) {
+            for (size_t x = 0; x < out.getWidth(); ++x) {
+                for (int c = 0; c < 3; ++c) REQUIRE(std::isfinite(out(x, y)[c]));
+            }
+        }
+        REQUIRE(compareImages(scene.truth, out).mse < 0.01 * compareImages(scene.truth, scene.noisy).mse);
+    }
+}
+
+TEST_CASE("Thread count and layout do not change the result", "[Denoiser]") {
+    Scene scene(150, 90, 0.2f);
+    DenoiseOptions options;
+    options.numThreads = 1;
+    FrameBuffer serial(1, 1);
+    Denoiser(options).denoise(scene.noisy, scene.guides, serial);
+
+    options.numThreads = 4;
+    FrameBuffer tiled(scene.noisy.getWidth(), scene.noisy.getHeight(), FrameBuffer::Layout::Tiled8);
+    for (size_t y = 0; y < tiled.getHeight(); ++y) {
+        for (size_t x = 0; x < tiled.getWidth(); ++x) tiled(x, y) = scene.noisy(x, y);
+    }
+    // Denoise in place
+    Denoiser(options).denoise(tiled, scene.guides, tiled);
+    REQUIRE(tiled.getLayout() == FrameBuffer::Layout::Tiled8);
+    for (size_t y = 0; y < tiled.getHeight(); ++y) {
+        for (size_t x = 0; x < tiled.getWidth(); ++x) REQUIRE(tiled(x, y) == serial(x, y));
+    }
+}
+
+TEST_CASE("Presets and bad input", "[Denoiser]") {
+    REQUIRE(DenoiseOptions::presetFromName("Fast") == DenoiseOptions::Preset::Fast);
+    REQUIRE(DenoiseOptions::presetFromName("quality") == DenoiseOptions::Preset::Quality);
+    REQUIRE_THROWS_AS(DenoiseOptions::presetFromName("nlmeans"), std::invalid_argument);
+    REQUIRE(DenoiseOptions::fromPreset(DenoiseOptions::Preset::Fast).iterations <
+            DenoiseOptions::fromPreset(DenoiseOptions::Preset::Quality).iterations);
+
+    DenoiseOptions bad;
+    bad.sigmaColor = 0.0f;
+    REQUIRE_THROWS_AS(Denoiser(bad), std::invalid_argument);
+
+    FrameBuffer fb(16, 16), out(16, 16);
+    AOVBuffer guides(8, 8);
+    REQUIRE_THROWS_AS(Denoiser().denoise(fb, guides, out), std::invalid_argument);
+
+    AOVBuffer wrongType(16, 16);
+    wrongType.addLayer("normal", AOVBuffer::Type::Float);
+    REQUIRE_THROWS_AS(Denoiser().denoise(fb, wrongType, out), std::invalid_argument);
+}
+
+TEST_CASE("Denoiser throughput", "[.][benchmark][Denoiser]") {
+    Scene scene(1920, 1080, 0.2f);
+    FrameBuffer out(1, 1);
+    for (auto preset : { DenoiseOptions::Preset::Fast, DenoiseOptions::Preset::Balanced }) {
+        Denoiser denoiser(DenoiseOptions::fromPreset(preset));
+        BENCHMARK(std::string("1080p, ") + (preset == DenoiseOptions::Preset::Fast ? "fast" : "balanced")) {
+            denoiser.denoise(scene.noisy, scene.guides, out);
+            return out(7, 7)[0];
+        };
+    }
+}
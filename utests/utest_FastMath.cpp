@@ -0,0 +1,218 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "FastMath.h"
+
+using fastmath::Accuracy;
+
+namespace {
+    // Largest error of f against the double reference over samples of
+    // [lo, hi], spaced evenly or geometrically.  Relative errors are taken
+    // against max(|reference|, floor), so floor 1 gives absolute errors
+    // near zero and relative ones elsewhere.
+    template <typename F, typename R>
+    double maxError(F f, R reference, float lo, float hi, bool geometric, double floor = 0.0) {
+        const int samples = 200000;
+        double worst = 0.0;
+        for (int i = 0; i <= samples; ++i) {
+            double t = double(i) / samples;
+            float x = geometric ? float(lo * std::pow(double(hi) / lo, t)) : float(lo + (double(hi) - lo) * t);
+            double expected = reference(double(x));
+            double error = std::abs(double(f(x)) - expected) / std::max(std::abs(expected), floor);
+            worst = std::max(worst, error);
+        }
+        return worst;
+    }
+
+    std::vector<float> randomFloats(size_t count, float lo, float hi, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> value(lo, hi);
+        std::vector<float> v(count);
+        for (auto& x : v) x = value(rng);
+        return v;
+    }
+
+    // packet::load wants aligned memory, which std::vector<float> does not
+    // promise
+    template <typename P>
+    P loadPacket(const float* p) {
+        alignas(P) float lanes[P::width];
+        std::copy(p, p + P::width, lanes);
+        return P::load(lanes);
+    }
+}
+
+TEST_CASE("Precise is the standard library", "[FastMath]") {
+    for (float x : { 0.1f, 1.0f, 2.5f, 40.0f }) {
+        REQUIRE(fastmath::rsqrt<Accuracy::Precise>(x) == 1.0f / std::sqrt(x));
+        REQUIRE(fastmath::exp<Accuracy::Precise>(-x) == std::exp(-x));
+        REQUIRE(fastmath::log<Accuracy::Precise>(x) == std::log(x));
+        REQUIRE(fastmath::pow<Accuracy::Precise>(x, 1.7f) == std::pow(x, 1.7f));
+        REQUIRE(fastmath::sin<Accuracy::Precise>(x) == std::sin(x));
+        REQUIRE(fastmath::cos<Accuracy::Precise>(x) == std::cos(x));
+    }
+}
+
+TEST_CASE("rsqrt error bounds", "[FastMath]") {
+    auto reference = [](double x) { return 1.0 / std::sqrt(x); };
+    REQUIRE(maxError(fastmath::rsqrt<Accuracy::Fast>, reference, 1e-20f, 1e20f, true) < 5e-6);
+    REQUIRE(maxError(fastmath::rsqrt<Accuracy::Fastest>, reference, 1e-20f, 1e20f, true) < 2e-3);
+
+    // Packets start from the hardware estimate where there is one
+    auto packetFast = [](float x) { return fastmath::rsqrt<Accuracy::Fast>(floatx8(x))[0]; };
+    auto packetFastest = [](float x) { return fastmath::rsqrt<Accuracy::Fastest>(floatx8(x))[0]; };
+    REQUIRE(maxError(packetFast, reference, 1e-20f, 1e20f, true) < 5e-6);
+    REQUIRE(maxError(packetFastest, reference, 1e-20f, 1e20f, true) < 2e-3);
+}
+
+TEST_CASE("exp error bounds", "[FastMath]") {
+    auto reference = [](double x) { return std::exp(x); };
+    REQUIRE(maxError(fastmath::exp<Accuracy::Fast>, reference, -87.0f, 88.0f, false) < 3e-7);
+    REQUIRE(maxError(fastmath::exp<Accuracy::Fastest>, reference, -87.0f, 88.0f, false) < 6e-5);
+
+    REQUIRE(fastmath::exp(0.0f) == 1.0f);
+    // Saturates rather than overflowing or going denormal
+    REQUIRE(std::isfinite(fastmath::exp(1000.0f)));
+    REQUIRE(fastmath::exp(1000.0f) == fastmath::exp(88.0f));
+    REQUIRE(std::isnormal(fastmath::exp(-1000.0f)));
+    REQUIRE(fastmath::exp(-1000.0f) < 1e-37f);
+}
+
+TEST_CASE("log error bounds", "[FastMath]") {
+    // Absolute near x = 1, relative once |ln x| > 1
+    auto reference = [](double x) { return std::log(x); };
+    REQUIRE(maxError(fastmath::log<Accuracy::Fast>, reference, 1e-30f, 1e30f, true, 1.0) < 2e-7);
+    REQUIRE(maxError(fastmath::log<Accuracy::Fastest>, reference, 1e-30f, 1e30f, true, 1.0) < 7e-5);
+    REQUIRE(fastmath::log(1.0f) == 0.0f);
+}
+
+TEST_CASE("pow error bounds", "[FastMath]") {
+    for (float y : { -4.0f, -1.5f, -0.5f, 0.5f, 2.2f, 4.0f }) {
+        auto fast = [y](float x) { return fastmath::pow<Accuracy::Fast>(x, y); };
+        auto fastest = [y](float x) { return fastmath::pow<Accuracy::Fastest>(x, y); };
+        auto reference = [y](double x) { return std::pow(x, double(y)); };
+        REQUIRE(maxError(fast, reference, 0.01f, 100.0f, true) < 3e-6);
+        REQUIRE(maxError(fastest, reference, 0.01f, 100.0f, true) < 4e-4);
+    }
+}
+
+TEST_CASE("sin and cos error bounds", "[FastMath]") {
+    auto sinReference = [](double x) { return std::sin(x); };
+    auto cosReference = [](double x) { return std::cos(x); };
+    for (float range : { 4.0f, 100.0f, 10000.0f }) {
+        REQUIRE(maxError(fastmath::sin<Accuracy::Fast>, sinReference, -range, range, false, 1.0) < 3e-7);
+        REQUIRE(maxError(fastmath::cos<Accuracy::Fast>, cosReference, -range, range, false, 1.0) < 3e-7);
+        REQUIRE(maxError(fastmath::sin<Accuracy::Fastest>, sinReference, -range, range, false, 1.0) < 2e-4);
+        REQUIRE(maxError(fastmath::cos<Accuracy::Fastest>, cosReference, -range, range, false, 1.0) < 2e-4);
+    }
+
+    float s, c;
+    fastmath::sincos(0.0f, s, c);
+    REQUIRE(s == 0.0f);
+    REQUIRE(c == 1.0f);
+    fastmath::sincos(3.0f, s, c);
+    REQUIRE(s == fastmath::sin(3.0f));
+    REQUIRE(c == fastmath::cos(3.0f));
+}
+
+TEMPLATE_TEST_CASE("Packet versions match the scalar ones", "[FastMath]", floatx4, floatx8, floatx16) {
+    using P = TestType;
+    const size_t W = P::width;
+    std::vector<float> x = randomFloats(W, 0.05f, 20.0f, 1);
+    std::vector<float> y = randomFloats(W, -3.0f, 3.0f, 2);
+    P px = loadPacket<P>(x.data()), py = loadPacket<P>(y.data());
+
+    P rsqrts = fastmath::rsqrt(px), exps = fastmath::exp(py), logs = fastmath::log(px), pows = fastmath::pow(px, py);
+    P sines, cosines;
+    fastmath::sincos<Accuracy::Fastest>(py, sines, cosines);
+    P roughSines = fastmath::sin<Accuracy::Fastest>(py);
+    P roughRsqrts = fastmath::rsqrt<Accuracy::Fastest>(px);
+    for (size_t i = 0; i < W; ++i) {
+        double expected = 1.0 / std::sqrt(double(x[i]));
+        REQUIRE(std::abs(rsqrts[i] - expected) < 5e-6 * expected);
+        REQUIRE(std::abs(roughRsqrts[i] - expected) < 2e-3 * expected);
+        REQUIRE(exps[i] == fastmath::exp(y[i]));
+        REQUIRE(logs[i] == fastmath::log(x[i]));
+        REQUIRE(pows[i] == fastmath::pow(x[i], y[i]));
+        REQUIRE(sines[i] == fastmath::sin<Accuracy::Fastest>(y[i]));
+        REQUIRE(cosines[i] == fastmath::cos<Accuracy::Fastest>(y[i]));
+        REQUIRE(roughSines[i] == sines[i]);
+    }
+}
+
+TEST_CASE("Normalizing through rsqrt", "[FastMath]") {
+    vec3 v(3.0f, -4.0f, 12.0f);
+    vec3x8 packets(vec3(0.0f, 0.0f, 0.0f));
+    packets.setLane(1, v);
+    packets.setLane(5, vec3(-1.0f, 2.0f, 0.5f));
+    vec3x8 unit = fastmath::normalized(packets);
+    REQUIRE(unit.lane(0) == vec3(0.0f, 0.0f, 0.0f));
+    REQUIRE(unit.lane(1).near(v.normalized(), 1e-5f));
+    REQUIRE(unit.lane(5).near(vec3(-1.0f, 2.0f, 0.5f).normalized(), 1e-5f));
+    REQUIRE(fastmath::normalized<Accuracy::Fastest>(packets).lane(1).near(v.normalized(), 3e-3f));
+}
+
+TEST_CASE("Fast math throughput", "[.][benchmark][FastMath]") {
+    const size_t count = 1 << 16;
+    std::vector<float> angles = randomFloats(count, -10.0f, 10.0f, 3);
+    std::vector<float> positive = randomFloats(count, 0.01f, 100.0f, 4);
+
+    std::vector<floatx8> angle(count / 8), value(count / 8), out(count / 8);
+    for (size_t i = 0; i < angle.size(); ++i) {
+        angle[i] = loadPacket<floatx8>(&angles[i * 8]);
+        value[i] = loadPacket<floatx8>(&positive[i * 8]);
+    }
+    auto apply = [&](const std::vector<floatx8>& in, auto f) {
+        for (size_t i = 0; i < in.size(); ++i) out[i] = f(in[i]);
+        return out[0][0];
+    };
+
+    // Precise runs the standard library lane by lane
+    BENCHMARK("rsqrt, Precise") { return apply(value, [](const floatx8& x) { return fastmath::rsqrt<Accuracy::Precise>(x); }); };
+    BENCHMARK("rsqrt, Fast") { return apply(value, [](const floatx8& x) { return fastmath::rsqrt<Accuracy::Fast>(x); }); };
+    BENCHMARK("rsqrt, Fastest") { return apply(value, [](const floatx8& x) { return fastmath::rsqrt<Accuracy::Fastest>(x); }); };
+
+    BENCHMARK("exp, Precise") { return apply(angle, [](const floatx8& x) { return fastmath::exp<Accuracy::Precise>(x); }); };
+    BENCHMARK("exp, Fast") { return apply(angle, [](const floatx8& x) { return fastmath::exp<Accuracy::Fast>(x); }); };
+    BENCHMARK("exp, Fastest") { return apply(angle, [](const floatx8& x) { return fastmath::exp<Accuracy::Fastest>(x); }); };
+
+    BENCHMARK("log, Precise") { return apply(value, [](const floatx8& x) { return fastmath::log<Accuracy::Precise>(x); }); };
+    BENCHMARK("log, Fast") { return apply(value, [](const floatx8& x) { return fastmath::log<Accuracy::Fast>(x); }); };
+    BENCHMARK("log, Fastest") { return apply(value, [](const floatx8& x) { return fastmath::log<Accuracy::Fastest>(x); }); };
+
+    BENCHMARK("pow, Precise") { return apply(value, [](const floatx8& x) { return fastmath::pow<Accuracy::Precise>(x, floatx8(2.2f)); }); };
+    BENCHMARK("pow, Fast") { return apply(value, [](const floatx8& x) { return fastmath::pow<Accuracy::Fast>(x, floatx8(2.2f)); }); };
+    BENCHMARK("pow, Fastest") { return apply(value, [](const floatx8& x) { return fastmath::pow<Accuracy::Fastest>(x, floatx8(2.2f)); }); };
+
+    BENCHMARK("sin, Precise") { return apply(angle, [](const floatx8& x) { return fastmath::sin<Accuracy::Precise>(x); }); };
+    BENCHMARK("sin, Fast") { return apply(angle, [](const floatx8& x) { return fastmath::sin<Accuracy::Fast>(x); }); };
+    BENCHMARK("sin, Fastest") { return apply(angle, [](const floatx8& x) { return fastmath::sin<Accuracy::Fastest>(x); }); };
+
+    // The scalar kernels on their own, one float at a time
+    BENCHMARK("sin, std, scalar") {
+        float sum = 0.0f;
+        for (float x : angles) sum += std::sin(x);
+        return sum;
+    };
+    BENCHMARK("sin, Fast, scalar") {
+        float sum = 0.0f;
+        for (float x : angles) sum += fastmath::sin(x);
+        return sum;
+    };
+
+    std::vector<vec3x8> vectors(count / 8);
+    for (size_t i = 0; i < vectors.size(); ++i) vectors[i] = vec3x8(angle[i], value[i], floatx8(1.0f));
+    BENCHMARK("vec3x8::normalized") {
+        for (auto& v : vectors) v = v.normalized();
+        return vectors[0][0][0];
+    };
+    BENCHMARK("fastmath::normalized, vec3x8") {
+        for (auto& v : vectors) v = fastmath::normalized(v);
+        return vectors[0][0][0];
+    };
+}
@@ -0,0 +1,228 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include "AccumulationBuffer.h"
+#include "Film.h"
+#include "ImageCompare.h"
+
+using Catch::Matchers::WithinAbs;
+
+namespace {
+    const PixelFilter::Type kAllFilters[] = { PixelFilter::Type::Box, PixelFilter::Type::Tent,
+                                              PixelFilter::Type::Gaussian, PixelFilter::Type::Mitchell,
+                                              PixelFilter::Type::BlackmanHarris };
+
+    // Deterministic jittered sample position inside pixel (x, y)
+    std::pair<float, float> jitter(size_t x, size_t y, size_t s) {
+        uint32_t h = uint32_t(x * 73856093u) ^ uint32_t(y * 19349663u) ^ uint32_t(s * 83492791u);
+        h ^= h >> 13;
+        h *= 0x5bd1e995u;
+        h ^= h >> 15;
+        return { x + (h & 0xFFFF) / 65536.0f, y + (h >> 16) / 65536.0f };
+    }
+}
+
+TEST_CASE("Pixel filters have the expected shapes", "[PixelFilter]") {
+    PixelFilter box(PixelFilter::Type::Box);
+    REQUIRE(box.getRadius() == 0.5f);
+    REQUIRE(box.getPixelRadius() == 0);
+    REQUIRE(box.evaluate(0.2f, -0.4f) == 1.0f);
+    REQUIRE(box.evaluate(0.6f, 0.0f) == 0.0f);
+
+    PixelFilter tent(PixelFilter::Type::Tent);
+    REQUIRE(tent.getPixelRadius() == 1);
+    REQUIRE_THAT(tent.evaluate1D(0.5f), WithinAbs(0.5f, 1e-6f));
+
+    PixelFilter gaussian(PixelFilter::Type::Gaussian);
+    REQUIRE(gaussian.getRadius() == 1.5f);
+    REQUIRE(gaussian.evaluate1D(1.5f) == 0.0f);
+    REQUIRE(gaussian.evaluate1D(0.0f) > gaussian.evaluate1D(1.0f));
+
+    PixelFilter mitchell(PixelFilter::Type::Mitchell);
+    REQUIRE(mitchell.getPixelRadius() == 2);
+    REQUIRE_THAT(mitchell.evaluate1D(0.0f), WithinAbs(8.0f / 9.0f, 1e-6f));
+    REQUIRE(mitchell.evaluate1D(1.3f) < 0.0f);  // negative lobe
+
+    PixelFilter bh(PixelFilter::Type::BlackmanHarris);
+    REQUIRE_THAT(bh.evaluate1D(0.0f), WithinAbs(1.0f, 1e-5f));
+    REQUIRE_THAT(bh.evaluate1D(1.999f), WithinAbs(0.0f, 1e-3f));
+
+    REQUIRE(PixelFilter(PixelFilter::Type::Tent, 2.5f).getPixelRadius() == 2);
+    REQUIRE_THROWS_AS(PixelFilter(PixelFilter::Type::Tent, -1.0f), std::invalid_argument);
+}
+
+TEST_CASE("Pixel filter names round trip", "[PixelFilter]") {
+    for (PixelFilter::Type type : kAllFilters) {
+        REQUIRE(PixelFilter::typeFromName(PixelFilter::getName(type)) == type);
+    }
+    REQUIRE(PixelFilter::typeFromName("Gaussian") == PixelFilter::Type::Gaussian);
+    REQUIRE_THROWS_AS(PixelFilter::typeFromName("lanczos"), std::invalid_argument);
+}
+
+TEST_CASE("Weight tables follow the filters", "[PixelFilter]") {
+    for (PixelFilter::Type type : kAllFilters) {
+        PixelFilter filter(type);
+        float r = filter.getRadius();
+        // Each table bin spans r / kTableSize, so the error is bounded
+        // by the slope times half a bin
+        for (int i = 0; i <= 1000; ++i) {
+            float d = -r + 2.0f * r * i / 1000.0f;
+            REQUIRE_THAT(filter.weight1D(d), WithinAbs(filter.evaluate1D(d), 0.05f));
+        }
+        REQUIRE(filter.weight1D(r + 0.01f) == 0.0f);
+        REQUIRE(filter.weight1D(-r - 0.1f) == 0.0f);
+    }
+}
+
+TEST_CASE("A box film matches the accumulation buffer", "[Film]") {
+    const size_t width = 13, height = 9;
+    Film film(width, height);
+    AccumulationBuffer accum(width, height);
+    for (size_t s = 0; s < 4; ++s) {
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                auto [px, py] = jitter(x, y, s);
+                vec3 color(px, py, float(s));
+                film.addSample(px, py, color);
+                accum.addSample(x, y, color);
+            }
+        }
+    }
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            REQUIRE(film.getWeight(x, y) == 4.0f);
+            for (int c = 0; c < 3; ++c) {
+                REQUIRE_THAT(film.getPixel(x, y)[c], WithinAbs(accum.getMean(x, y)[c], 1e-5f));
+            }
+        }
+    }
+}
+
+TEST_CASE("Every filter reproduces a constant image", "[Film]") {
+    const vec3 color(0.25f, 0.5f, 2.0f);
+    for (PixelFilter::Type type : kAllFilters) {
+        Film film(20, 15, PixelFilter(type));
+        for (size_t y = 0; y < film.getHeight(); ++y) {
+            for (size_t x = 0; x < film.getWidth(); ++x) {
+                auto [px, py] = jitter(x, y, 0);
+                film.addSample(px, py, color);
+            }
+        }
+        FrameBuffer fb(film.getWidth(), film.getHeight());
+        film.resolve(fb);
+        for (size_t y = 0; y < fb.getHeight(); ++y) {
+            for (size_t x = 0; x < fb.getWidth(); ++x) {
+                for (int c = 0; c < 3; ++c) {
+                    REQUIRE_THAT(fb(x, y)[c], WithinAbs(color[c], 1e-5f));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Tiled passes match direct splatting", "[Film]") {
+    const size_t width = 50, height = 37;
+    PixelFilter filter(PixelFilter::Type::Mitchell);
+    auto kernel = [](Film::FilmTile& tile) {
+        const Tile& t = tile.getTile();
+        for (size_t y = t.y0; y < t.y1; ++y) {
+            for (size_t x = t.x0; x < t.x1; ++x) {
+                for (size_t s = 0; s < 2; ++s) {
+                    auto [px, py] = jitter(x, y, s);
+                    tile.addSample(px, py, vec3(std::sin(px), std::cos(py), 1.0f));
+                }
+            }
+        }
+    };
+
+    Film direct(width, height, filter);
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            for (size_t s = 0; s < 2; ++s) {
+                auto [px, py] = jitter(x, y, s);
+                direct.addSample(px, py, vec3(std::sin(px), std::cos(py), 1.0f));
+            }
+        }
+    }
+
+    Film serial(width, height, filter), parallel(width, height, filter);
+    TileScheduler one(1, 8), many(4, 8, TileScheduler::Order::Hilbert);
+    for (int pass = 0; pass < 2; ++pass) {
+        serial.renderPass(one, kernel);
+        parallel.renderPass(many, kernel);
+    }
+
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            // The merge order is fixed by the phases, so thread count
+            // and tile order do not change a single bit
+            REQUIRE(parallel.getWeight(x, y) == serial.getWeight(x, y));
+            REQUIRE(parallel.getSum(x, y) == serial.getSum(x, y));
+            REQUIRE_THAT(serial.getWeight(x, y), WithinAbs(2.0f * direct.getWeight(x, y), 1e-4f));
+            for (int c = 0; c < 3; ++c) {
+                REQUIRE_THAT(serial.getPixel(x, y)[c], WithinAbs(direct.getPixel(x, y)[c], 1e-4f));
+            }
+        }
+    }
+}
+
+TEST_CASE("Tiles must be wider than the filter apron", "[Film]") {
+    Film film(32, 32, PixelFilter(PixelFilter::Type::Gaussian, 3.0f));
+    TileScheduler small(1, 4);
+    REQUIRE_THROWS_AS(film.renderPass(small, [](Film::FilmTile&) {}), std::invalid_argument);
+    REQUIRE_THROWS_AS(Film(8, 8, PixelFilter(PixelFilter::Type::Tent, 20.0f)), std::invalid_argument);
+}
+
+TEST_CASE("Wide filters lower noise at one sample per pixel", "[Film]") {
+    // A smooth image seen through noisy samples
+    const size_t width = 96, height = 64;
+    auto truth = [](float px, float py) { return vec3(0.5f + 0.2f * std::sin(px * 0.05f), 0.5f, 0.5f + 0.2f * std::cos(py * 0.05f)); };
+    FrameBuffer reference(width, height);
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) reference(x, y) = truth(x + 0.5f, y + 0.5f);
+    }
+
+    auto render = [&](PixelFilter::Type type) {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> noise(-0.3f, 0.3f);
+        Film film(width, height, PixelFilter(type));
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                auto [px, py] = jitter(x, y, 0);
+                film.addSample(px, py, truth(px, py) + vec3(noise(rng), noise(rng), noise(rng)));
+            }
+        }
+        FrameBuffer fb(width, height);
+        film.resolve(fb);
+        return compareImages(reference, fb).mse;
+    };
+
+    double boxError = render(PixelFilter::Type::Box);
+    REQUIRE(render(PixelFilter::Type::Gaussian) < 0.5 * boxError);
+    REQUIRE(render(PixelFilter::Type::Tent) < 0.5 * boxError);
+}
+
+TEST_CASE("Filtered splatting throughput", "[.][benchmark][Film]") {
+    const size_t width = 512, height = 512;
+    TileScheduler scheduler(0, 32);
+    for (PixelFilter::Type type : { PixelFilter::Type::Box, PixelFilter::Type::Gaussian, PixelFilter::Type::Mitchell }) {
+        Film film(width, height, PixelFilter(type));
+        BENCHMARK(std::string("4 spp pass, ") + PixelFilter::getName(type)) {
+            film.renderPass(scheduler, [](Film::FilmTile& tile) {
+                const Tile& t = tile.getTile();
+                for (size_t y = t.y0; y < t.y1; ++y) {
+                    for (size_t x = t.x0; x < t.x1; ++x) {
+                        for (size_t s = 0; s < 4; ++s) {
+                            auto [px, py] = jitter(x, y, s);
+                            tile.addSample(px, py, vec3(px, py, 1.0f));
+                        }
+                    }
+                }
+            });
+            return film.getWeight(7, 7);
+        };
+    }
+}
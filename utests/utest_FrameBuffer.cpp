@@ -1,5 +1,10 @@
 #include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
 #include "FrameBuffer.h"
+#include "PngEncoder.h"
+#include "TileScheduler.h"
 
 TEST_CASE("FrameBuffer basic operations", "[FrameBuffer]") {
     FrameBuffer fb(10, 20);
@@ -53,5 +58,163 @@ TEST_CASE("FrameBuffer basic operations", "[FrameBuffer]") {
         
         // Test that writing to PNG doesn't throw an exception
         REQUIRE_NOTHROW(fb.writeToPng("test_output.png"));
+        std::remove("test_output.png");
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("FrameBuffer storage layouts", "[FrameBuffer]") {
+    const FrameBuffer::Layout layouts[] = { FrameBuffer::Layout::RowMajor,
+                                            FrameBuffer::Layout::Tiled8,
+                                            FrameBuffer::Layout::Tiled16,
+                                            FrameBuffer::Layout::Morton };
+
+    for (auto layout : layouts) {
+        // Deliberately not a multiple of any tile size
+        FrameBuffer fb(37, 21, layout);
+        REQUIRE(fb.getLayout() == layout);
+        REQUIRE(fb.getData().size() >= 37 * 21);
+
+        for (size_t y = 0; y < fb.getHeight(); ++y) {
+            for (size_t x = 0; x < fb.getWidth(); ++x) {
+                fb.setPixel(x, y, vec3(float(x), float(y), 0.0f));
+            }
+        }
+
+        // Every pixel maps to its own storage slot
+        {
+            std::vector<bool> used(fb.getData().size(), false);
+            for (size_t y = 0; y < fb.getHeight(); ++y) {
+                for (size_t x = 0; x < fb.getWidth(); ++x) {
+                    size_t idx = fb.index(x, y);
+                    REQUIRE(idx < used.size());
+                    REQUIRE(!used[idx]);
+                    used[idx] = true;
+                }
+            }
+        }
+
+        // Iterator visits pixels in row-major order
+        {
+            size_t count = 0;
+            for (auto it = fb.begin(); it != fb.end(); ++it, ++count) {
+                REQUIRE(it.x() == count % fb.getWidth());
+                REQUIRE(it.y() == count / fb.getWidth());
+                REQUIRE(*it == vec3(float(it.x()), float(it.y()), 0.0f));
+            }
+            REQUIRE(count == fb.getWidth() * fb.getHeight());
+        }
+
+        // Row access
+        {
+            std::vector<vec3> scratch;
+            const vec3* row = fb.getRow(7, scratch);
+            for (size_t x = 0; x < fb.getWidth(); ++x) {
+                REQUIRE(row[x] == vec3(float(x), 7.0f, 0.0f));
+            }
+
+            std::vector<vec3> newRow(fb.getWidth(), vec3(1.0f, 2.0f, 3.0f));
+            fb.setRow(20, newRow.data());
+            for (size_t x = 0; x < fb.getWidth(); ++x) {
+                REQUIRE(fb(x, 20) == vec3(1.0f, 2.0f, 3.0f));
+            }
+            REQUIRE(fb(0, 19) == vec3(0.0f, 19.0f, 0.0f));
+        }
+    }
+}
+
+
+TEST_CASE("Streaming PNG encode", "[FrameBuffer]") {
+    FrameBuffer fb(19, 11, FrameBuffer::Layout::Tiled8);
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) {
+            fb.setPixel(x, y, vec3(x / 18.0f, y / 10.0f, 1.0f));
+        }
+    }
+
+    std::stringstream stream;
+    writePngRows(stream, fb.getWidth(), fb.getHeight(), [&](size_t y, std::vector<vec3>& scratch) {
+        return fb.getRow(y, scratch);
+    });
+
+    png::image<png::rgb_pixel> image(stream);
+    REQUIRE(image.get_width() == 19);
+    REQUIRE(image.get_height() == 11);
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) {
+            REQUIRE(image[y][x].red == static_cast<png::byte>(fb(x, y)[0] * 255.0f + 0.5f));
+            REQUIRE(image[y][x].green == static_cast<png::byte>(fb(x, y)[1] * 255.0f + 0.5f));
+            REQUIRE(image[y][x].blue == 255);
+        }
+    }
+}
+
+TEST_CASE("PNG encode to memory", "[FrameBuffer]") {
+    FrameBuffer fb(5, 3);
+    fb.setBackground(vec3(0.0f, 1.0f, 0.0f));
+    fb.setPixel(4, 2, vec3(1.0f, 0.0f, 1.0f));
+
+    std::vector<uint8_t> bytes = fb.encodePng();
+    REQUIRE(bytes.size() > 8);
+    REQUIRE(bytes[1] == 'P');
+    REQUIRE(bytes[2] == 'N');
+    REQUIRE(bytes[3] == 'G');
+
+    std::stringstream stream(std::string(bytes.begin(), bytes.end()));
+    png::image<png::rgb_pixel> image(stream);
+    REQUIRE(image.get_width() == 5);
+    REQUIRE(image.get_height() == 3);
+    REQUIRE(image[0][0].green == 255);
+    REQUIRE(image[2][4].red == 255);
+    REQUIRE(image[2][4].green == 0);
+}
+
+TEST_CASE("Memory-mapped FrameBuffer keeps its pixels in the file", "[FrameBuffer]") {
+    const char* filename = "utest_FrameBuffer.map";
+    const FrameBuffer::Layout layouts[] = { FrameBuffer::Layout::RowMajor,
+                                            FrameBuffer::Layout::Tiled16 };
+
+    for (auto layout : layouts) {
+        {
+            FrameBuffer fb(123, 77, layout, filename);
+            REQUIRE(fb.isMapped());
+            REQUIRE(fb.getData().size() >= 123 * 77);
+
+            // Render tile by tile, paging each one in and out
+            TileScheduler scheduler(2, 32);
+            scheduler.run(fb, [&](const Tile& tile) {
+                fb.adviseTile(tile);
+                for (size_t y = tile.y0; y < tile.y1; ++y) {
+                    for (size_t x = tile.x0; x < tile.x1; ++x) {
+                        fb(x, y) = vec3(float(x), float(y), float(tile.index));
+                    }
+                }
+                fb.flushTile(tile);
+            });
+
+            // Copies are plain heap buffers with the same pixels
+            FrameBuffer copy = fb;
+            REQUIRE(!copy.isMapped());
+            REQUIRE(copy(100, 50) == fb(100, 50));
+
+            // Moving keeps the mapping
+            FrameBuffer moved = std::move(fb);
+            REQUIRE(moved.isMapped());
+            REQUIRE(moved(5, 6)[0] == 5.0f);
+        }
+
+        // Mapping the file again finds the rendered image
+        {
+            FrameBuffer fb(123, 77, layout, filename);
+            for (size_t y = 0; y < fb.getHeight(); ++y) {
+                for (size_t x = 0; x < fb.getWidth(); ++x) {
+                    REQUIRE(fb(x, y)[0] == float(x));
+                    REQUIRE(fb(x, y)[1] == float(y));
+                }
+            }
+        }
+        std::remove(filename);
+    }
+
+    REQUIRE_THROWS_AS(FrameBuffer(0, 10, FrameBuffer::Layout::RowMajor, filename), std::invalid_argument);
+    REQUIRE_THROWS_AS(FrameBuffer(10, 10, FrameBuffer::Layout::RowMajor, "no/such/dir/fb.map"), std::runtime_error);
+}
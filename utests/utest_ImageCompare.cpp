@@ -0,0 +1,210 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include "ImageCompare.h"
+#include "ImageIO.h"
+
+namespace {
+    FrameBuffer makeTestImage(size_t width, size_t height, FrameBuffer::Layout layout = FrameBuffer::Layout::RowMajor) {
+        FrameBuffer fb(width, height, layout);
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                float r = 0.5f + 0.4f * std::sin(0.13f * x);
+                float g = 0.5f + 0.4f * std::cos(0.07f * y);
+                float b = float((x / 8 + y / 8) % 2) * 0.8f;
+                fb.setPixel(x, y, vec3(r, g, b));
+            }
+        }
+        return fb;
+    }
+
+    FrameBuffer addNoise(const FrameBuffer& fb, float amount, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> noise(-amount, amount);
+        FrameBuffer result(fb.getWidth(), fb.getHeight());
+        for (size_t y = 0; y < fb.getHeight(); ++y) {
+            for (size_t x = 0; x < fb.getWidth(); ++x) {
+                const vec3& c = fb(x, y);
+                result.setPixel(x, y, vec3(c[0] + noise(rng), c[1] + noise(rng), c[2] + noise(rng)));
+            }
+        }
+        return result;
+    }
+}
+
+TEST_CASE("Identical images have no error", "[ImageCompare]") {
+    FrameBuffer fb = makeTestImage(67, 45);
+    CompareResult result = compareImages(fb, fb);
+    REQUIRE(result.mse == 0.0);
+    REQUIRE(std::isinf(result.psnr));
+    REQUIRE(std::fabs(result.ssim - 1.0) < 1e-6);
+    REQUIRE(result.maxError == 0.0f);
+    REQUIRE(result.tilesX == 3);
+    REQUIRE(result.tilesY == 2);
+}
+
+TEST_CASE("MSE and PSNR match a direct computation", "[ImageCompare]") {
+    // An odd width exercises the scalar tail after the SIMD loop
+    FrameBuffer a = makeTestImage(101, 37);
+    FrameBuffer b = addNoise(a, 0.2f, 7);
+
+    double sum[3] = { 0.0, 0.0, 0.0 };
+    float maxError = 0.0f;
+    for (size_t y = 0; y < a.getHeight(); ++y) {
+        for (size_t x = 0; x < a.getWidth(); ++x) {
+            for (int c = 0; c < 3; ++c) {
+                double d = double(a(x, y)[c]) - b(x, y)[c];
+                sum[c] += d * d;
+                maxError = std::max(maxError, std::fabs(a(x, y)[c] - b(x, y)[c]));
+            }
+        }
+    }
+    double pixels = double(a.getWidth()) * a.getHeight();
+    double mse = (sum[0] + sum[1] + sum[2]) / (3.0 * pixels);
+
+    CompareResult result = compareImages(a, b);
+    for (int c = 0; c < 3; ++c) {
+        REQUIRE(std::fabs(result.channelMse[c] - sum[c] / pixels) < 1e-5 * result.channelMse[c]);
+    }
+    REQUIRE(std::fabs(result.mse - mse) < 1e-5 * mse);
+    REQUIRE(std::fabs(result.psnr - 10.0 * std::log10(1.0 / mse)) < 1e-3);
+    REQUIRE(result.maxError == maxError);
+}
+
+TEST_CASE("A constant offset gives the expected PSNR", "[ImageCompare]") {
+    FrameBuffer a(64, 64), b(64, 64);
+    a.setBackground(vec3(0.25f, 0.25f, 0.25f));
+    b.setBackground(vec3(0.35f, 0.35f, 0.35f));
+    CompareResult result = compareImages(a, b);
+    REQUIRE(std::fabs(result.mse - 0.01) < 1e-6);
+    REQUIRE(std::fabs(result.psnr - 20.0) < 1e-3);
+}
+
+TEST_CASE("Tile error maps find the changed tile", "[ImageCompare]") {
+    FrameBuffer a = makeTestImage(96, 64);
+    FrameBuffer b = a;
+    b.setPixel(70, 40, vec3(5.0f, 5.0f, 5.0f));
+
+    CompareOptions options;
+    options.tileSize = 16;
+    CompareResult result = compareImages(a, b, options);
+    REQUIRE(result.tilesX == 6);
+    REQUIRE(result.tilesY == 4);
+
+    size_t changed = (40 / 16) * result.tilesX + 70 / 16;
+    REQUIRE(result.getWorstTile() == changed);
+    for (size_t t = 0; t < result.tileMse.size(); ++t) {
+        if (t != changed) REQUIRE(result.tileMse[t] == 0.0f);
+    }
+    REQUIRE(result.tileSsim[changed] < 1.0f);
+    REQUIRE(result.tileSsim[0] > 0.9999f);
+
+    FrameBuffer map = result.makeErrorMap();
+    REQUIRE(map.getWidth() == a.getWidth());
+    REQUIRE(map(70, 40)[2] == 1.0f);
+    REQUIRE(map(0, 0)[0] == 0.0f);
+}
+
+TEST_CASE("Results do not depend on layout or thread count", "[ImageCompare]") {
+    FrameBuffer a = makeTestImage(77, 53);
+    FrameBuffer b = addNoise(a, 0.1f, 3);
+    CompareResult expected = compareImages(a, b);
+
+    for (auto layout : { FrameBuffer::Layout::Tiled16, FrameBuffer::Layout::Morton }) {
+        FrameBuffer la(a.getWidth(), a.getHeight(), layout), lb(b.getWidth(), b.getHeight(), layout);
+        for (size_t y = 0; y < a.getHeight(); ++y) {
+            for (size_t x = 0; x < a.getWidth(); ++x) {
+                la(x, y) = a(x, y);
+                lb(x, y) = b(x, y);
+            }
+        }
+        CompareOptions options;
+        options.numThreads = 1;
+        CompareResult result = compareImages(la, lb, options);
+        REQUIRE(result.mse == expected.mse);
+        REQUIRE(result.ssim == expected.ssim);
+        REQUIRE(result.tileMse == expected.tileMse);
+    }
+}
+
+TEST_CASE("SSIM falls as noise grows", "[ImageCompare]") {
+    FrameBuffer a = makeTestImage(80, 60);
+    double previous = 1.0;
+    for (float amount : { 0.02f, 0.1f, 0.3f }) {
+        CompareResult result = compareImages(a, addNoise(a, amount, 11));
+        REQUIRE(result.ssim < previous);
+        REQUIRE(result.ssim > 0.0);
+        previous = result.ssim;
+    }
+
+    CompareOptions options;
+    options.computeSsim = false;
+    REQUIRE(compareImages(a, addNoise(a, 0.3f, 11), options).ssim == 1.0);
+}
+
+TEST_CASE("Comparing different or empty sizes throws", "[ImageCompare]") {
+    FrameBuffer a(10, 10), b(10, 11);
+    REQUIRE_THROWS_AS(compareImages(a, b), std::invalid_argument);
+    REQUIRE_THROWS_AS(makeDifferenceImage(a, b), std::invalid_argument);
+
+    // No tiles, so no worst tile to report
+    FrameBuffer empty(0, 0);
+    REQUIRE_THROWS_AS(compareImages(empty, empty), std::invalid_argument);
+    REQUIRE_THROWS_AS(CompareResult().getWorstTile(), std::logic_error);
+}
+
+TEST_CASE("PNG round trips stay within 8-bit precision", "[ImageCompare]") {
+    FrameBuffer fb = makeTestImage(64, 48);
+    fb.writeToPng("utest_ImageCompare.png");
+    FrameBuffer loaded = readImage("utest_ImageCompare.png");
+    std::remove("utest_ImageCompare.png");
+
+    CompareResult result = compareImages(fb, loaded);
+    REQUIRE(result.maxError <= 0.5f / 255.0f + 1e-6f);
+    REQUIRE(result.psnr > 50.0);
+    REQUIRE(result.ssim > 0.999);
+}
+
+TEST_CASE("Convergence logs write one CSV line per point", "[ImageCompare]") {
+    FrameBuffer reference = makeTestImage(32, 32);
+    CompareOptions options;
+    options.computeSsim = false;
+    ConvergenceLog log(reference, options);
+    log.record(addNoise(reference, 0.4f, 1), 0.5, 16);
+    log.record(addNoise(reference, 0.1f, 2), 2.0, 256);
+    log.record(reference, 10.0, 4096);
+
+    REQUIRE(log.getPoints().size() == 3);
+    REQUIRE(log.getPoints()[0].mse > log.getPoints()[1].mse);
+    REQUIRE(log.getPoints()[2].mse == 0.0);
+
+    std::ostringstream csv;
+    log.writeCSV(csv);
+    std::istringstream lines(csv.str());
+    std::string line;
+    std::getline(lines, line);
+    REQUIRE(line == "seconds,samples,mse,psnr,ssim");
+    std::getline(lines, line);
+    REQUIRE(line.rfind("0.5,16,", 0) == 0);
+    size_t count = 1;
+    while (std::getline(lines, line)) ++count;
+    REQUIRE(count == 3);
+}
+
+TEST_CASE("Image comparison throughput", "[.][benchmark][ImageCompare]") {
+    FrameBuffer a = makeTestImage(3840, 2160);
+    FrameBuffer b = addNoise(a, 0.05f, 5);
+
+    CompareOptions mseOnly;
+    mseOnly.computeSsim = false;
+    BENCHMARK("4K MSE") {
+        return compareImages(a, b, mseOnly).mse;
+    };
+    BENCHMARK("4K MSE and SSIM") {
+        return compareImages(a, b).ssim;
+    };
+}
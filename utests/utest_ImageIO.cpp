@@ -0,0 +1,269 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "ImageIO.h"
+
+namespace {
+    // HDR values well outside [0, 1], with flat runs for the encoders to
+    // compress and some noise-like detail
+    FrameBuffer makeTestImage(size_t width, size_t height, FrameBuffer::Layout layout = FrameBuffer::Layout::RowMajor) {
+        FrameBuffer fb(width, height, layout);
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                if (x < width / 3) {
+                    fb.setPixel(x, y, vec3(0.25f, 4.0f, 0.0f));
+                } else {
+                    float r = 100.0f * x / float(width);
+                    float g = 0.001f * (y + 1);
+                    float b = 1.0f + std::sin(0.37f * x) * std::cos(0.21f * y);
+                    fb.setPixel(x, y, vec3(r, g, b));
+                }
+            }
+        }
+        return fb;
+    }
+
+    std::unique_ptr<ImageRowReader> roundTrip(const FrameBuffer& fb, ImageFormat format, std::stringstream& buffer,
+                                              ExrCompression compression = ExrCompression::None) {
+        switch (format) {
+        case ImageFormat::PFM: writePFM(buffer, fb.getWidth(), fb.getHeight(), fb.getRowSource()); break;
+        case ImageFormat::HDR: writeRadianceHDR(buffer, fb.getWidth(), fb.getHeight(), fb.getRowSource()); break;
+        default:               writeEXR(buffer, fb.getWidth(), fb.getHeight(), fb.getRowSource(), compression); break;
+        }
+        buffer.seekg(0);
+        return openImage(buffer, format);
+    }
+
+    // Collects whatever is written but cannot seek, like a pipe
+    class PipeBuffer : public std::streambuf {
+    public:
+        std::string data;
+
+    protected:
+        int_type overflow(int_type c) override {
+            if (c != traits_type::eof()) data.push_back(traits_type::to_char_type(c));
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            data.append(s, static_cast<size_t>(n));
+            return n;
+        }
+    };
+
+    void requireExact(const FrameBuffer& fb, ImageRowReader& reader) {
+        REQUIRE(reader.getWidth() == fb.getWidth());
+        REQUIRE(reader.getHeight() == fb.getHeight());
+        std::vector<vec3> row(fb.getWidth());
+        for (size_t y = 0; y < fb.getHeight(); ++y) {
+            reader.readRow(row.data());
+            for (size_t x = 0; x < fb.getWidth(); ++x) {
+                for (int c = 0; c < 3; ++c) {
+                    REQUIRE(row[x][c] == fb(x, y)[c]);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Image format from file extension", "[ImageIO]") {
+    REQUIRE(imageFormatFromFilename("out.png") == ImageFormat::PNG);
+    REQUIRE(imageFormatFromFilename("out.PFM") == ImageFormat::PFM);
+    REQUIRE(imageFormatFromFilename("dir.v2/out.hdr") == ImageFormat::HDR);
+    REQUIRE(imageFormatFromFilename("out.exr") == ImageFormat::EXR);
+    REQUIRE_THROWS_AS(imageFormatFromFilename("out.tga"), std::invalid_argument);
+    REQUIRE_THROWS_AS(imageFormatFromFilename("noextension"), std::invalid_argument);
+}
+
+TEST_CASE("PFM round trip is exact", "[ImageIO]") {
+    FrameBuffer fb = makeTestImage(37, 23);
+    std::stringstream buffer;
+    auto reader = roundTrip(fb, ImageFormat::PFM, buffer);
+    requireExact(fb, *reader);
+}
+
+TEST_CASE("EXR round trip is exact", "[ImageIO]") {
+    for (ExrCompression compression : { ExrCompression::None, ExrCompression::RLE }) {
+        FrameBuffer fb = makeTestImage(53, 19);
+        std::stringstream buffer;
+        auto reader = roundTrip(fb, ImageFormat::EXR, buffer, compression);
+        requireExact(fb, *reader);
+    }
+}
+
+TEST_CASE("EXR RLE shrinks empty regions", "[ImageIO]") {
+    FrameBuffer fb(128, 64);
+    fb.setBackground(vec3(0.0f, 0.0f, 0.0f));
+    fb.setPixel(70, 20, vec3(0.5f, 1.5f, 2.5f));
+
+    std::stringstream raw, rle;
+    writeEXR(raw, fb.getWidth(), fb.getHeight(), fb.getRowSource(), ExrCompression::None);
+    writeEXR(rle, fb.getWidth(), fb.getHeight(), fb.getRowSource(), ExrCompression::RLE);
+    REQUIRE(rle.str().size() * 10 < raw.str().size());
+
+    rle.seekg(0);
+    auto reader = openImage(rle, ImageFormat::EXR);
+    requireExact(fb, *reader);
+}
+
+TEST_CASE("Uncompressed EXR streams to pipes", "[ImageIO]") {
+    FrameBuffer fb = makeTestImage(37, 11);
+    PipeBuffer pipe;
+    std::ostream out(&pipe);
+    REQUIRE(out.tellp() == std::streampos(-1));
+    writeEXR(out, fb.getWidth(), fb.getHeight(), fb.getRowSource(), ExrCompression::None);
+    REQUIRE(out);
+
+    std::stringstream seekable;
+    writeEXR(seekable, fb.getWidth(), fb.getHeight(), fb.getRowSource(), ExrCompression::None);
+    REQUIRE(pipe.data == seekable.str());
+
+    std::stringstream buffer(pipe.data);
+    auto reader = openImage(buffer, ImageFormat::EXR);
+    requireExact(fb, *reader);
+
+    // RLE has to go back for its offset table, and says so before writing
+    PipeBuffer rlePipe;
+    std::ostream rleOut(&rlePipe);
+    REQUIRE_THROWS_AS(writeEXR(rleOut, fb.getWidth(), fb.getHeight(), fb.getRowSource(), ExrCompression::RLE),
+                      std::invalid_argument);
+    REQUIRE(rlePipe.data.empty());
+}
+
+TEST_CASE("EXR crops record their place in the frame", "[ImageIO]") {
+    CropWindow crop{ 12, 30, 41, 17, 100, 60 };
+    FrameBuffer fb = makeTestImage(crop.width, crop.height);
+
+    std::stringstream buffer;
+    writeEXR(buffer, crop, fb.getRowSource(), ExrCompression::RLE);
+    buffer.seekg(0);
+    auto reader = openImage(buffer, ImageFormat::EXR);
+    REQUIRE(reader->getCrop() == crop);
+    requireExact(fb, *reader);
+
+    // Plain files are a crop covering their whole frame
+    std::stringstream plain;
+    auto plainReader = roundTrip(fb, ImageFormat::PFM, plain);
+    REQUIRE(plainReader->getCrop() == CropWindow::fullFrame(crop.width, crop.height));
+
+    CropWindow tooBig{ 90, 0, 20, 10, 100, 60 };
+    std::stringstream bad;
+    REQUIRE_THROWS_AS(writeEXR(bad, tooBig, fb.getRowSource()), std::invalid_argument);
+}
+
+TEST_CASE("Radiance HDR round trip is within RGBE precision", "[ImageIO]") {
+    // Widths below 8 are written flat, the rest run-length encoded
+    for (size_t width : { size_t(5), size_t(64), size_t(301) }) {
+        FrameBuffer fb = makeTestImage(width, 17);
+        std::stringstream buffer;
+        auto reader = roundTrip(fb, ImageFormat::HDR, buffer);
+        REQUIRE(reader->getWidth() == width);
+        REQUIRE(reader->getHeight() == 17);
+
+        std::vector<vec3> row(width);
+        for (size_t y = 0; y < fb.getHeight(); ++y) {
+            reader->readRow(row.data());
+            for (size_t x = 0; x < width; ++x) {
+                // RGBE shares one exponent, so the error scales with the
+                // brightest channel of the pixel
+                const vec3& expected = fb(x, y);
+                float peak = std::max(expected[0], std::max(expected[1], expected[2]));
+                for (int c = 0; c < 3; ++c) {
+                    REQUIRE(std::fabs(row[x][c] - expected[c]) <= peak / 128.0f);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("writeImage and readImage keep tiled layouts", "[ImageIO]") {
+    FrameBuffer fb = makeTestImage(45, 30, FrameBuffer::Layout::Tiled16);
+    for (const char* filename : { "utest_ImageIO.pfm", "utest_ImageIO.exr" }) {
+        writeImage(fb, filename);
+        FrameBuffer loaded = readImage(filename, FrameBuffer::Layout::Morton);
+        std::remove(filename);
+
+        REQUIRE(loaded.getLayout() == FrameBuffer::Layout::Morton);
+        REQUIRE(loaded.getWidth() == fb.getWidth());
+        REQUIRE(loaded.getHeight() == fb.getHeight());
+        for (size_t y = 0; y < fb.getHeight(); ++y) {
+            for (size_t x = 0; x < fb.getWidth(); ++x) {
+                for (int c = 0; c < 3; ++c) {
+                    REQUIRE(loaded(x, y)[c] == fb(x, y)[c]);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("PNG files read back scaled to [0, 1]", "[ImageIO]") {
+    FrameBuffer fb(16, 8);
+    fb.setBackground(vec3(1.0f, 0.0f, 0.2f));
+    writeImage(fb, "utest_ImageIO.png");
+    FrameBuffer loaded = readImage("utest_ImageIO.png");
+    std::remove("utest_ImageIO.png");
+
+    REQUIRE(loaded(3, 4)[0] == 1.0f);
+    REQUIRE(loaded(3, 4)[1] == 0.0f);
+    REQUIRE(std::fabs(loaded(3, 4)[2] - 51.0f / 255.0f) < 1e-6f);
+}
+
+TEST_CASE("Unsupported EXR compression throws", "[ImageIO]") {
+    FrameBuffer fb = makeTestImage(8, 4);
+    std::stringstream buffer;
+    writeEXR(buffer, fb.getWidth(), fb.getHeight(), fb.getRowSource());
+    std::string data = buffer.str();
+
+    // The attribute is name, type name, a 4-byte size and the method byte;
+    // 3 is ZIP, and 0x80 and up must not pass for None or RLE either
+    const std::string attribute("compression\0compression\0", 24);
+    size_t method = data.find(attribute);
+    REQUIRE(method != std::string::npos);
+    method += attribute.size() + 4;
+    for (unsigned char value : { 3, 0x80, 0xff }) {
+        data[method] = static_cast<char>(value);
+        std::stringstream patched(data);
+        REQUIRE_THROWS_AS(openImage(patched, ImageFormat::EXR), std::runtime_error);
+    }
+}
+
+TEST_CASE("Truncated files throw", "[ImageIO]") {
+    FrameBuffer fb = makeTestImage(20, 10);
+    std::stringstream buffer;
+    writeEXR(buffer, fb.getWidth(), fb.getHeight(), fb.getRowSource());
+    std::string data = buffer.str();
+    std::stringstream truncated(data.substr(0, data.size() / 2));
+
+    auto reader = openImage(truncated, ImageFormat::EXR);
+    std::vector<vec3> row(fb.getWidth());
+    REQUIRE_THROWS_AS([&] {
+        for (size_t y = 0; y < fb.getHeight(); ++y) reader->readRow(row.data());
+    }(), std::runtime_error);
+}
+
+TEST_CASE("HDR writer throughput", "[.][benchmark][ImageIO]") {
+    FrameBuffer fb = makeTestImage(1920, 1080);
+
+    BENCHMARK("PNG (8-bit)") {
+        return fb.encodePng().size();
+    };
+    BENCHMARK("PFM") {
+        std::ostringstream out;
+        writePFM(out, fb.getWidth(), fb.getHeight(), fb.getRowSource());
+        return out.tellp();
+    };
+    BENCHMARK("Radiance HDR") {
+        std::ostringstream out;
+        writeRadianceHDR(out, fb.getWidth(), fb.getHeight(), fb.getRowSource());
+        return out.tellp();
+    };
+    BENCHMARK("EXR RLE") {
+        std::stringstream out;
+        writeEXR(out, fb.getWidth(), fb.getHeight(), fb.getRowSource(), ExrCompression::RLE);
+        return out.tellp();
+    };
+}
@@ -0,0 +1,81 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "PixelEncode.h"
+
+namespace {
+    // Ramp of values with extra density near zero, where the curves are steepest
+    std::vector<vec3> makeRamp(size_t count) {
+        std::vector<vec3> pixels(count);
+        for (size_t i = 0; i < count; ++i) {
+            float t = i / float(count - 1);
+            pixels[i] = vec3(t, t * t * t, std::pow(t, 8.0f));
+        }
+        return pixels;
+    }
+}
+
+TEST_CASE("PixelEncoder matches the reference curves", "[PixelEncode]") {
+    const TransferFunction transfers[] = { TransferFunction::Linear,
+                                           TransferFunction::SRGB,
+                                           TransferFunction::Gamma };
+
+    // An odd count exercises both the vector loop and the scalar tail
+    std::vector<vec3> pixels = makeRamp(4099);
+    std::vector<uint8_t> bytes(pixels.size() * 3);
+
+    for (auto transfer : transfers) {
+        EncodeOptions options;
+        options.transfer = transfer;
+        PixelEncoder encoder(options);
+        encoder.encode(pixels.data(), pixels.size(), bytes.data());
+
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            for (size_t c = 0; c < 3; ++c) {
+                int expected = static_cast<int>(std::lround(encoder.reference(pixels[i][c])));
+                REQUIRE(std::abs(int(bytes[3 * i + c]) - expected) <= 1);
+            }
+        }
+    }
+}
+
+TEST_CASE("PixelEncoder edge values", "[PixelEncode]") {
+    std::vector<vec3> pixels = { vec3(0.0f, 1.0f, 0.5f),
+                                 vec3(-1.0f, 2.0f, NAN),
+                                 vec3(128 / 255.0f, 1 / 255.0f, 254 / 255.0f) };
+    std::vector<uint8_t> bytes(pixels.size() * 3);
+
+    PixelEncoder linear;
+    linear.encode(pixels.data(), pixels.size(), bytes.data());
+    REQUIRE(bytes == std::vector<uint8_t>{ 0, 255, 128, 0, 255, 0, 128, 1, 254 });
+
+    EncodeOptions options;
+    options.transfer = TransferFunction::SRGB;
+    PixelEncoder srgb(options);
+    srgb.encode(pixels.data(), pixels.size(), bytes.data());
+    REQUIRE(bytes[0] == 0);
+    REQUIRE(bytes[1] == 255);
+    REQUIRE(bytes[2] == 188);  // linear 0.5 is sRGB 188
+}
+
+TEST_CASE("PixelEncoder ordered dither", "[PixelEncode]") {
+    EncodeOptions options;
+    options.dither = true;
+    PixelEncoder encoder(options);
+
+    // A value halfway between two codes dithers into a 50/50 mix
+    const size_t count = 64;
+    std::vector<vec3> pixels(count, vec3(100.5f / 255.0f, 100.5f / 255.0f, 100.5f / 255.0f));
+    std::vector<uint8_t> bytes(count * 3);
+
+    size_t high = 0;
+    for (size_t y = 0; y < 4; ++y) {
+        encoder.encode(pixels.data(), count, bytes.data(), 0, y);
+        for (uint8_t b : bytes) {
+            REQUIRE((b == 100 || b == 101));
+            high += (b == 101);
+        }
+    }
+    REQUIRE(high == count * 3 * 4 / 2);
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <cmath>
+#include <sstream>
+#include "PngEncoder.h"
+
+namespace {
+    // Smooth gradients with some high-frequency detail so every filter
+    // type has something to do
+    FrameBuffer makeTestImage(size_t width, size_t height) {
+        FrameBuffer fb(width, height);
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                float r = x / float(width);
+                float g = y / float(height);
+                float b = 0.5f + 0.5f * std::sin(0.37f * x) * std::cos(0.21f * y);
+                fb.setPixel(x, y, vec3(r, g, b));
+            }
+        }
+        return fb;
+    }
+
+    void requireSamePixels(std::istream& a, std::istream& b) {
+        png::image<png::rgb_pixel> imageA(a);
+        png::image<png::rgb_pixel> imageB(b);
+        REQUIRE(imageA.get_width() == imageB.get_width());
+        REQUIRE(imageA.get_height() == imageB.get_height());
+        for (size_t y = 0; y < imageA.get_height(); ++y) {
+            for (size_t x = 0; x < imageA.get_width(); ++x) {
+                REQUIRE(imageA[y][x].red == imageB[y][x].red);
+                REQUIRE(imageA[y][x].green == imageB[y][x].green);
+                REQUIRE(imageA[y][x].blue == imageB[y][x].blue);
+            }
+        }
+    }
+}
+
+TEST_CASE("Parallel PNG encode matches the libpng path", "[PngEncoder]") {
+    FrameBuffer fb = makeTestImage(67, 45);
+
+    std::stringstream reference;
+    writePngRows(reference, fb.getWidth(), fb.getHeight(), fb.getRowSource());
+
+    const PngFilter filters[] = { PngFilter::None, PngFilter::Sub, PngFilter::Up,
+                                  PngFilter::Average, PngFilter::Paeth, PngFilter::Adaptive };
+    for (auto filter : filters) {
+        for (int level : { 0, 1, 6, 9 }) {
+            ParallelPngOptions options;
+            options.numThreads = 3;
+            options.rowsPerChunk = 4;
+            options.filter = filter;
+            options.compressionLevel = level;
+
+            std::stringstream parallel;
+            writePngParallel(parallel, fb.getWidth(), fb.getHeight(), fb.getRowSource(), options);
+
+            reference.clear();
+            reference.seekg(0);
+            requireSamePixels(reference, parallel);
+        }
+    }
+}
+
+TEST_CASE("Parallel PNG encode rejects bad options", "[PngEncoder]") {
+    FrameBuffer fb(4, 4);
+    std::stringstream out;
+    ParallelPngOptions options;
+    options.compressionLevel = 12;
+    REQUIRE_THROWS_AS(writePngParallel(out, 4, 4, fb.getRowSource(), options), std::invalid_argument);
+}
+
+TEST_CASE("PNG encode benchmark", "[.][benchmark][PngEncoder]") {
+    FrameBuffer fb = makeTestImage(2048, 2048);
+
+    BENCHMARK("libpng, one thread") {
+        std::stringstream out;
+        writePngRows(out, fb.getWidth(), fb.getHeight(), fb.getRowSource());
+        return out.tellp();
+    };
+
+    BENCHMARK("parallel chunked deflate, all threads") {
+        std::stringstream out;
+        writePngParallel(out, fb.getWidth(), fb.getHeight(), fb.getRowSource());
+        return out.tellp();
+    };
+
+    BENCHMARK("parallel chunked deflate, level 1") {
+        ParallelPngOptions options;
+        options.compressionLevel = 1;
+        std::stringstream out;
+        writePngParallel(out, fb.getWidth(), fb.getHeight(), fb.getRowSource(), options);
+        return out.tellp();
+    };
+}
@@ -0,0 +1,177 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include "PngEncoder.h"
+#include "PostProcess.h"
+#include "TileScheduler.h"
+
+using Catch::Matchers::WithinAbs;
+using Catch::Matchers::WithinRel;
+
+namespace {
+    FrameBuffer randomImage(size_t width, size_t height, float maxValue, unsigned seed) {
+        FrameBuffer fb(width, height);
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> value(0.0f, maxValue);
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) fb(x, y) = vec3(value(rng), value(rng), value(rng));
+        }
+        return fb;
+    }
+
+    PostPipeline fullPipeline() {
+        PostPipeline pipeline;
+        pipeline.add(std::make_unique<ExposureOp>(0.5f))
+            .add(std::make_unique<BloomOp>(0.3f, 1.0f, 5))
+            .add(std::make_unique<ColorGradeOp>(vec3(1.0f, 0.9f, 0.8f), 1.2f, 0.8f))
+            .add(std::make_unique<BloomOp>(0.2f, 0.5f, 3))
+            .add(std::make_unique<TonemapOp>(TonemapOp::Curve::ACES))
+            .add(std::make_unique<VignetteOp>(0.4f));
+        return pipeline;
+    }
+}
+
+TEST_CASE("Point operators", "[PostProcess]") {
+    FrameBuffer fb = randomImage(33, 17, 4.0f, 1);
+
+    PostPipeline pipeline;
+    pipeline.add(std::make_unique<ExposureOp>(1.0f)).add(std::make_unique<TonemapOp>(TonemapOp::Curve::ACES));
+    REQUIRE(pipeline.halo() == 0);
+
+    FrameBuffer out(1, 1);
+    pipeline.apply(fb, out);
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) {
+            for (int c = 0; c < 3; ++c) {
+                float v = 2.0f * fb(x, y)[c];
+                float expected = std::min((v * (2.51f * v + 0.03f)) / (v * (2.43f * v + 0.59f) + 0.14f), 1.0f);
+                REQUIRE_THAT(out(x, y)[c], WithinAbs(expected, 1e-6f));
+            }
+        }
+    }
+
+    // Reinhard keeps hue and brings luminance below one
+    FrameBuffer grey(4, 4);
+    grey.setBackground(vec3(3.0f, 1.5f, 0.75f));
+    PostPipeline reinhard;
+    reinhard.add(std::make_unique<TonemapOp>(TonemapOp::Curve::Reinhard));
+    reinhard.apply(grey, grey);
+    REQUIRE_THAT(grey(2, 2)[0] / grey(2, 2)[1], WithinRel(2.0f, 1e-5f));
+    REQUIRE(0.2126f * grey(2, 2)[0] + 0.7152f * grey(2, 2)[1] + 0.0722f * grey(2, 2)[2] < 1.0f);
+
+    // The vignette leaves the center alone and darkens the corners
+    FrameBuffer flat(64, 64);
+    flat.setBackground(vec3(1.0f, 1.0f, 1.0f));
+    PostPipeline vignette;
+    vignette.add(std::make_unique<VignetteOp>(0.5f));
+    vignette.apply(flat, flat);
+    REQUIRE_THAT(flat(32, 32)[0], WithinAbs(1.0f, 1e-3f));
+    REQUIRE_THAT(flat(0, 0)[0], WithinAbs(0.5f, 0.03f));
+    REQUIRE(flat(0, 0) == flat(63, 63));
+}
+
+TEST_CASE("Bloom spreads light above the threshold", "[PostProcess]") {
+    const size_t radius = 6;
+    FrameBuffer fb(40, 40);
+    fb.setBackground(vec3(0.5f, 0.5f, 0.5f));
+    fb(20, 20) = vec3(11.0f, 11.0f, 11.0f);
+
+    PostPipeline pipeline;
+    pipeline.add(std::make_unique<BloomOp>(1.0f, 1.0f, radius));
+    REQUIRE(pipeline.halo() == radius);
+    FrameBuffer out(1, 1);
+    pipeline.apply(fb, out);
+
+    // All of the light above the threshold is spread within the radius
+    double added = 0.0;
+    for (size_t y = 0; y < 40; ++y) {
+        for (size_t x = 0; x < 40; ++x) {
+            float d = out(x, y)[0] - fb(x, y)[0];
+            bool inside = std::max(x > 20 ? x - 20 : 20 - x, y > 20 ? y - 20 : 20 - y) <= radius;
+            if (!inside) REQUIRE(d == 0.0f);
+            added += d;
+        }
+    }
+    REQUIRE_THAT(added, WithinRel(10.0, 1e-4));
+    REQUIRE(out(20, 23)[0] > out(20, 25)[0]);
+
+    // With no threshold a constant image is brightened evenly, edges too
+    FrameBuffer flat(30, 20);
+    flat.setBackground(vec3(1.0f, 2.0f, 3.0f));
+    PostPipeline glow;
+    glow.add(std::make_unique<BloomOp>(0.5f, 0.0f, 4));
+    glow.apply(flat, flat);
+    for (size_t y = 0; y < 20; ++y) {
+        for (size_t x = 0; x < 30; ++x) {
+            for (int c = 0; c < 3; ++c) REQUIRE_THAT(flat(x, y)[c], WithinRel(1.5f * (c + 1), 1e-5f));
+        }
+    }
+}
+
+TEST_CASE("Tiling, threads and row sources give the same image", "[PostProcess]") {
+    FrameBuffer fb = randomImage(101, 67, 3.0f, 2);
+    PostPipeline pipeline = fullPipeline();
+    REQUIRE(pipeline.halo() == 8);
+
+    TileScheduler serial(1, 200);
+    FrameBuffer whole(1, 1);
+    pipeline.apply(fb, whole, serial);
+
+    TileScheduler small(4, 7);
+    FrameBuffer tiled(fb.getWidth(), fb.getHeight(), FrameBuffer::Layout::Tiled8);
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) tiled(x, y) = fb(x, y);
+    }
+    pipeline.apply(tiled, tiled, small);
+    REQUIRE(tiled.getLayout() == FrameBuffer::Layout::Tiled8);
+
+    RowSource rows = pipeline.rowSource(fb);
+    std::vector<vec3> scratch;
+    for (size_t y : { 0, 40, 66, 39, 1, 65 }) {
+        const vec3* row = rows(y, scratch);
+        for (size_t x = 0; x < fb.getWidth(); ++x) REQUIRE(row[x] == whole(x, y));
+    }
+    for (size_t y = 0; y < fb.getHeight(); ++y) {
+        for (size_t x = 0; x < fb.getWidth(); ++x) REQUIRE(tiled(x, y) == whole(x, y));
+    }
+
+    // The parallel encoder pulls rows from several threads at once
+    ParallelPngOptions options;
+    options.numThreads = 4;
+    options.rowsPerChunk = 5;
+    std::ostringstream direct, streamed;
+    writePngParallel(direct, whole.getWidth(), whole.getHeight(), whole.getRowSource(), options);
+    writePngParallel(streamed, fb.getWidth(), fb.getHeight(), pipeline.rowSource(fb), options);
+    REQUIRE(direct.str() == streamed.str());
+}
+
+TEST_CASE("Bad operator settings", "[PostProcess]") {
+    REQUIRE(TonemapOp::curveFromName("ACES") == TonemapOp::Curve::ACES);
+    REQUIRE(TonemapOp::curveFromName("none") == TonemapOp::Curve::None);
+    REQUIRE_THROWS_AS(TonemapOp::curveFromName("filmic"), std::invalid_argument);
+    REQUIRE_THROWS_AS(BloomOp(1.0f, 1.0f, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(VignetteOp(1.5f), std::invalid_argument);
+    REQUIRE_THROWS_AS(ColorGradeOp(vec3(1.0f, 1.0f, 1.0f), 0.0f), std::invalid_argument);
+}
+
+TEST_CASE("Post-processing throughput", "[.][benchmark][PostProcess]") {
+    FrameBuffer fb = randomImage(1920, 1080, 3.0f, 3);
+    FrameBuffer out(1, 1);
+    PostPipeline point;
+    point.add(std::make_unique<ExposureOp>(0.5f))
+        .add(std::make_unique<TonemapOp>(TonemapOp::Curve::ACES))
+        .add(std::make_unique<VignetteOp>(0.3f));
+    PostPipeline withBloom = fullPipeline();
+
+    BENCHMARK("1080p, exposure + ACES + vignette") {
+        point.apply(fb, out);
+        return out(7, 7)[0];
+    };
+    BENCHMARK("1080p, full chain with two blooms") {
+        withBloom.apply(fb, out);
+        return out(7, 7)[0];
+    };
+}
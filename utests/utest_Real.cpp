@@ -0,0 +1,138 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
+#include "Transform.h"
+#include "model_obj.h"
+#include "vec_packet.h"
+
+TEST_CASE("Real follows the build option", "[Real]") {
+#if defined(USE_DOUBLE_PRECISION)
+    STATIC_REQUIRE(std::is_same_v<Real, double>);
+#else
+    STATIC_REQUIRE(std::is_same_v<Real, float>);
+#endif
+    STATIC_REQUIRE(std::is_same_v<vec3r, vec<Real, 3>>);
+    STATIC_REQUIRE(std::is_same_v<affine3r, affine3<Real>>);
+
+    STATIC_REQUIRE(std::is_same_v<std::remove_extent_t<decltype(ModelOBJ::Vertex::position)>, Real>);
+
+    // Pixels are float either way
+    STATIC_REQUIRE(std::is_same_v<vec3, vec3f>);
+}
+
+TEST_CASE("Double keeps detail far from the origin", "[Real]") {
+    // A quarter unit away from a point ten million units out: float's
+    // spacing there is a whole unit, so only double sees the difference
+    affine3d toLocal = affine3d::translate(vec3d(-1.0e7, 0.0, 0.0));
+    std::vector<vec3d> points{ vec3d(1.0e7 + 0.25, 1.0, 2.0) };
+    transformPoints(toLocal, points);
+    REQUIRE(points[0] == vec3d(0.25, 1.0, 2.0));
+
+    affine3f toLocalF = affine3f::translate(vec3f(-1.0e7f, 0.0f, 0.0f));
+    std::vector<vec3f> pointsF{ vec3f(1.0e7f + 0.25f, 1.0f, 2.0f) };
+    transformPoints(toLocalF, pointsF);
+    REQUIRE(pointsF[0][0] != 0.25f);
+}
+
+TEST_CASE("ModelOBJ reads and normalizes positions as Real", "[Real]") {
+    const std::string path = "/tmp/utest_Real_" + std::to_string(::getpid()) + ".obj";
+    {
+        std::ofstream obj(path);
+        obj << "v 10000000.25 0 0\nv 10000001 0 0\nv 10000000 1 0\nf 1 2 3\n";
+    }
+
+    ModelOBJ model;
+    REQUIRE(model.import(path.c_str()));
+    std::remove(path.c_str());
+
+    // In a double build the quarter survives the import; in a float
+    // build it is lost the same way a float literal loses it
+    REQUIRE(model.getVertex(0).position[0] == Real(10000000.25));
+    REQUIRE(model.getWidth() == Real(10000001) - Real(10000000));
+
+    model.normalize(Real(1), false);
+    REQUIRE(model.getRadius() == Real(1));
+}
+
+TEMPLATE_TEST_CASE("Batch transforms in both precisions", "[Real]", float, double) {
+    using T = TestType;
+    std::mt19937 rng(9);
+    std::uniform_real_distribution<T> value(-100, 100);
+    std::vector<vec<T, 3>> points(257);
+    for (auto& p : points) p = vec<T, 3>(value(rng), value(rng), value(rng));
+
+    affine3<T> xf = affine3<T>::translate(vec<T, 3>(T(5), T(-3), T(1))) * affine3<T>::rotate(vec<T, 3>(T(0), T(1), T(1)), T(0.4))
+                    * affine3<T>::scale(T(1.5));
+    std::vector<vec<T, 3>> expected(points);
+    for (auto& p : expected) p = xf.transformPoint(p);
+
+    TransformOptions options;
+    options.numThreads = 3;
+    options.minPerThread = 32;
+    transformPoints(xf, points, options);
+    for (size_t i = 0; i < points.size(); ++i) REQUIRE(points[i].near(expected[i], T(1e-3)));
+}
+
+namespace {
+    // Nearest hit of a ray against a row of spheres, the inner loop of an
+    // intersection test written once for either precision
+    template <typename T>
+    T nearestHit(const vec<T, 3>& origin, const vec<T, 3>& dir, const std::vector<vec<T, 3>>& centers, T radius) {
+        T nearest = T(1e30);
+        for (const auto& c : centers) {
+            vec<T, 3> oc = origin - c;
+            T b = oc.dot(dir);
+            T disc = b * b - (oc.dot(oc) - radius * radius);
+            if (disc < T(0)) continue;
+            T t = -b - std::sqrt(disc);
+            if (t > T(0) && t < nearest) nearest = t;
+        }
+        return nearest;
+    }
+
+    template <typename T>
+    std::vector<vec<T, 3>> sphereCenters(size_t count) {
+        std::mt19937 rng(10);
+        std::uniform_real_distribution<T> value(-50, 50);
+        std::vector<vec<T, 3>> centers(count);
+        for (auto& c : centers) c = vec<T, 3>(value(rng), value(rng), T(100) + value(rng));
+        return centers;
+    }
+}
+
+TEMPLATE_TEST_CASE("Float and double throughput", "[.][benchmark][Real]", float, double) {
+    using T = TestType;
+    const size_t count = 1 << 20;
+    std::vector<vec<T, 3>> points = sphereCenters<T>(count);
+    affine3<T> xf = affine3<T>::rotate(vec<T, 3>(T(1), T(2), T(3)), T(0.3)) * affine3<T>::scale(T(1.0001));
+
+    TransformOptions single;
+    single.numThreads = 1;
+    BENCHMARK("transformPoints, one thread") {
+        transformPoints(xf, points, single);
+        return points[count / 2][0];
+    };
+
+    std::vector<vec<T, 3>> centers = sphereCenters<T>(4096);
+    vec<T, 3> origin(T(0), T(0), T(0));
+    vec<T, 3> dir = vec<T, 3>(T(0.1), T(-0.05), T(1)).normalized();
+    BENCHMARK("Ray against 4096 spheres") {
+        return nearestHit(origin, dir, centers, T(2));
+    };
+
+    // SoA packets of the same width in bytes hold half as many doubles
+    using Packet = vec_packet<T, 3, 32 / sizeof(T)>;
+    std::vector<Packet> packets(count / Packet::width);
+    for (size_t i = 0; i < packets.size(); ++i) packets[i] = Packet::load(&points[i * Packet::width]);
+    BENCHMARK("Normalize 32-byte packets") {
+        for (auto& p : packets) p = p.normalized();
+        return packets[0][0][0];
+    };
+}
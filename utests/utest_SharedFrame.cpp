@@ -0,0 +1,208 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "SharedFrame.h"
+#include "handleGraphicsArgs.h"
+
+namespace {
+    // Names are per process so parallel test runs do not collide
+    std::string segmentName(const char* what) {
+        return "/cs4212-utest-" + std::string(what) + "-" + std::to_string(::getpid());
+    }
+
+    void fill(FrameBuffer& fb, float base) {
+        for (size_t y = 0; y < fb.getHeight(); ++y) {
+            for (size_t x = 0; x < fb.getWidth(); ++x) fb(x, y) = vec3(base + x, base + y, base);
+        }
+    }
+
+    bool sameImage(const FrameBuffer& a, const FrameBuffer& b) {
+        for (size_t y = 0; y < a.getHeight(); ++y) {
+            for (size_t x = 0; x < a.getWidth(); ++x) {
+                if (a(x, y) != b(x, y)) return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST_CASE("Readers see whole frames and then only changed tiles", "[SharedFrame]") {
+    const std::string name = segmentName("tiles");
+    SharedFrameWriter writer(name, 70, 45, 16);
+    SharedFrameReader reader(name);
+    REQUIRE(reader.getWidth() == 70);
+    REQUIRE(reader.getHeight() == 45);
+    REQUIRE(reader.getTileCount() == 5 * 3);
+    REQUIRE(reader.getTile(14).x1 == 70);
+    REQUIRE(reader.getTile(14).y1 == 45);
+
+    FrameBuffer received(70, 45);
+    REQUIRE(reader.poll(received).empty());
+
+    FrameBuffer fb(70, 45);
+    fill(fb, 1.0f);
+    writer.publish(fb);
+    writer.setPasses(3);
+    REQUIRE(reader.poll(received).size() == 15);
+    REQUIRE(sameImage(received, fb));
+    REQUIRE(reader.getPasses() == 3);
+    REQUIRE(reader.poll(received).empty());
+
+    // A 32-pixel scheduler tile covers four shared tiles
+    fill(fb, 100.0f);
+    writer.publish(fb, Tile{ 0, 32, 16, 64, 45 });
+    std::vector<size_t> changed = reader.poll(received);
+    REQUIRE(changed == std::vector<size_t>{ 7, 8, 12, 13 });
+    REQUIRE(received(40, 20) == fb(40, 20));
+    REQUIRE(received(10, 10) != fb(10, 10));
+
+    AccumulationBuffer accum(70, 45);
+    accum.addSample(69, 44, vec3(2.0f, 4.0f, 6.0f));
+    accum.addSample(69, 44, vec3(4.0f, 4.0f, 4.0f));
+    writer.publish(accum, Tile{ 0, 64, 32, 70, 45 });
+    REQUIRE(reader.poll(received) == std::vector<size_t>{ 14 });
+    REQUIRE(received(69, 44) == vec3(3.0f, 4.0f, 5.0f));
+
+    REQUIRE_FALSE(reader.isFinished());
+    writer.finish();
+    REQUIRE(reader.isFinished());
+}
+
+TEST_CASE("Bad tiles and segments are rejected", "[SharedFrame]") {
+    const std::string name = segmentName("bad");
+    SharedFrameWriter writer(name, 64, 64, 16);
+    FrameBuffer fb(64, 64);
+    REQUIRE_THROWS_AS(writer.publish(fb, Tile{ 0, 8, 0, 24, 16 }), std::invalid_argument);
+    REQUIRE_THROWS_AS(writer.publish(fb, Tile{ 0, 0, 0, 20, 16 }), std::invalid_argument);
+    FrameBuffer wrongSize(32, 64);
+    REQUIRE_THROWS_AS(writer.publish(wrongSize), std::invalid_argument);
+
+    REQUIRE_THROWS_AS(SharedFrameReader(segmentName("missing")), std::runtime_error);
+}
+
+TEST_CASE("Concurrent reads never see torn tiles", "[SharedFrame]") {
+    const std::string name = segmentName("torn");
+    const size_t size = 96, tileSize = 8;
+    SharedFrameWriter writer(name, size, size, tileSize);
+    SharedFrameReader reader(name);
+
+    // Every publish fills a tile with one value, so a torn copy shows up
+    // as a tile with two
+    std::atomic<bool> done{ false };
+    std::thread renderer([&] {
+        FrameBuffer fb(size, size);
+        for (int pass = 1; pass <= 200; ++pass) {
+            fb.setBackground(vec3(float(pass), float(pass), float(pass)));
+            for (size_t y = 0; y < size; y += tileSize) {
+                for (size_t x = 0; x < size; x += tileSize) writer.publish(fb, Tile{ 0, x, y, x + tileSize, y + tileSize });
+            }
+        }
+        done = true;
+    });
+
+    FrameBuffer received(size, size);
+    size_t copies = 0;
+    bool torn = false;
+    while (!done) {
+        for (size_t index : reader.poll(received)) {
+            Tile tile = reader.getTile(index);
+            for (size_t y = tile.y0; y < tile.y1; ++y) {
+                for (size_t x = tile.x0; x < tile.x1; ++x) torn = torn || received(x, y) != received(tile.x0, tile.y0);
+            }
+            ++copies;
+        }
+    }
+    renderer.join();
+    reader.poll(received);
+
+    REQUIRE_FALSE(torn);
+    REQUIRE(copies > 0);
+    REQUIRE(received(0, 0) == vec3(200.0f, 200.0f, 200.0f));
+    REQUIRE(received(size - 1, size - 1) == vec3(200.0f, 200.0f, 200.0f));
+}
+
+TEST_CASE("Preview writers from the command line", "[SharedFrame]") {
+    sivelab::GraphicsArgs args;
+    args.width = 64;
+    args.height = 48;
+    REQUIRE(SharedFrameWriter::fromArgs(args) == nullptr);
+
+    args.previewName = segmentName("args");
+    auto writer = SharedFrameWriter::fromArgs(args);
+    REQUIRE(writer != nullptr);
+    REQUIRE(writer->getName() == args.previewName);
+    REQUIRE(writer->getWidth() == 64);
+    REQUIRE(writer->getHeight() == 48);
+    SharedFrameReader reader(args.previewName);
+    REQUIRE(reader.getWidth() == 64);
+    writer.reset();
+
+    // A crop previews only the part it renders
+    args.cropWindow = "1/4";
+    writer = SharedFrameWriter::fromArgs(args);
+    REQUIRE(writer->getWidth() == 64);
+    REQUIRE(writer->getHeight() == 12);
+}
+
+TEST_CASE("A frame published by another process", "[SharedFrame]") {
+    const std::string name = segmentName("process");
+    FrameBuffer expected(50, 30);
+    fill(expected, 7.0f);
+
+    // The viewer tells the renderer it has attached through a pipe
+    int attached[2];
+    REQUIRE(::pipe(attached) == 0);
+    pid_t child = ::fork();
+    REQUIRE(child >= 0);
+    if (child == 0) {
+        // The renderer: publish the frame a band at a time, then finish
+        int status = 0;
+        try {
+            SharedFrameWriter writer(name, 50, 30, 10);
+            char byte;
+            status = ::read(attached[0], &byte, 1) == 1 ? 0 : 1;
+            for (size_t y = 0; y < 30; y += 10) {
+                writer.publish(expected, Tile{ 0, 0, y, 50, y + 10 });
+                writer.setPasses(y / 10 + 1);
+            }
+        }
+        catch (...) {
+            status = 1;
+        }
+        ::_exit(status);
+    }
+
+    // The viewer, headless: attach once the segment exists and follow it
+    std::unique_ptr<SharedFrameReader> reader;
+    for (int attempt = 0; !reader && attempt < 100; ++attempt) {
+        try {
+            reader = std::make_unique<SharedFrameReader>(name);
+        }
+        catch (const std::runtime_error&) {
+            ::usleep(10000);
+        }
+    }
+    REQUIRE(reader);
+    REQUIRE(::write(attached[1], "x", 1) == 1);
+    FrameBuffer received(50, 30);
+    while (true) {
+        bool finished = reader->isFinished();
+        reader->poll(received);
+        if (finished) break;
+        ::usleep(1000);
+    }
+
+    int status = -1;
+    ::waitpid(child, &status, 0);
+    ::close(attached[0]);
+    ::close(attached[1]);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+    REQUIRE(reader->getPasses() == 3);
+    REQUIRE(sameImage(received, expected));
+}
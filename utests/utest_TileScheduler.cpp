@@ -0,0 +1,82 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include "TileScheduler.h"
+
+TEST_CASE("TileScheduler tiling", "[TileScheduler]") {
+    const TileScheduler::Order orders[] = { TileScheduler::Order::Scanline,
+                                            TileScheduler::Order::Spiral,
+                                            TileScheduler::Order::Hilbert };
+
+    for (auto order : orders) {
+        TileScheduler scheduler(1, 16, order);
+        std::vector<Tile> tiles = scheduler.makeTiles(100, 40);
+
+        // 7 x 3 tiles, the last column and row are partial
+        REQUIRE(tiles.size() == 21);
+
+        // Every tile appears exactly once and tiles cover the image
+        std::vector<bool> seen(tiles.size(), false);
+        size_t area = 0;
+        for (const auto& t : tiles) {
+            REQUIRE(t.index < tiles.size());
+            REQUIRE(!seen[t.index]);
+            seen[t.index] = true;
+            REQUIRE(t.x1 <= 100);
+            REQUIRE(t.y1 <= 40);
+            area += t.width() * t.height();
+        }
+        REQUIRE(area == 100 * 40);
+    }
+
+    SECTION("Spiral starts at the center") {
+        TileScheduler scheduler(1, 10, TileScheduler::Order::Spiral);
+        std::vector<Tile> tiles = scheduler.makeTiles(50, 50);
+        REQUIRE(tiles.front().x0 == 20);
+        REQUIRE(tiles.front().y0 == 20);
+    }
+
+    SECTION("Hilbert neighbours share an edge") {
+        TileScheduler scheduler(1, 8, TileScheduler::Order::Hilbert);
+        std::vector<Tile> tiles = scheduler.makeTiles(64, 64);
+        for (size_t i = 1; i < tiles.size(); ++i) {
+            size_t dx = std::max(tiles[i].x0, tiles[i - 1].x0) - std::min(tiles[i].x0, tiles[i - 1].x0);
+            size_t dy = std::max(tiles[i].y0, tiles[i - 1].y0) - std::min(tiles[i].y0, tiles[i - 1].y0);
+            REQUIRE(dx + dy == 8);
+        }
+    }
+}
+
+TEST_CASE("TileScheduler run", "[TileScheduler]") {
+    FrameBuffer fb(123, 77);
+    TileScheduler scheduler(4, 16, TileScheduler::Order::Spiral);
+
+    SECTION("Every pixel is written exactly once") {
+        std::vector<std::atomic<int>> hits(fb.getWidth() * fb.getHeight());
+        scheduler.run(fb, [&](const Tile& tile) {
+            for (size_t y = tile.y0; y < tile.y1; ++y) {
+                for (size_t x = tile.x0; x < tile.x1; ++x) {
+                    hits[y * fb.getWidth() + x]++;
+                    fb.setPixel(x, y, vec3(1.0f, 0.0f, 0.0f));
+                }
+            }
+        });
+
+        for (const auto& h : hits) {
+            REQUIRE(h == 1);
+        }
+        REQUIRE(scheduler.getTimings().size() == scheduler.makeTiles(123, 77).size());
+        for (const auto& t : scheduler.getTimings()) {
+            REQUIRE(t.worker < scheduler.getNumThreads());
+            REQUIRE(t.seconds >= 0.0);
+        }
+    }
+
+    SECTION("Kernel exceptions are rethrown") {
+        REQUIRE_THROWS_AS(scheduler.run(fb, [](const Tile& tile) {
+            if (tile.index == 3) throw std::runtime_error("tile failed");
+        }), std::runtime_error);
+    }
+}
@@ -0,0 +1,134 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "Transform.h"
+#include "model_obj.h"
+
+namespace {
+    std::vector<vec3> randomPoints(size_t count, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+        std::vector<vec3> points(count);
+        for (auto& p : points) p = vec3(value(rng), value(rng), value(rng));
+        return points;
+    }
+
+    affine3f testTransform() {
+        return affine3f::translate(vec3(1.0f, -2.0f, 0.5f)) * affine3f::rotate(vec3(1.0f, 1.0f, 0.0f), 0.7f)
+               * affine3f::scale(vec3(2.0f, 0.5f, 1.5f));
+    }
+}
+
+TEST_CASE("Batch transforms match one-at-a-time transforms", "[Transform]") {
+    affine3f xf = testTransform();
+
+    // Counts that end on a partial packet, on one thread and on several
+    for (size_t count : { 1, 7, 33, 1000 }) {
+        for (size_t threads : { 1, 4 }) {
+            TransformOptions options;
+            options.numThreads = threads;
+            options.minPerThread = 16;
+
+            std::vector<vec3> points = randomPoints(count, 1);
+            std::vector<vec3> normals = randomPoints(count, 2);
+            std::vector<vec3> expectedPoints(points), expectedNormals(normals);
+            for (auto& p : expectedPoints) p = xf.transformPoint(p);
+            for (auto& n : expectedNormals) n = xf.transformNormal(n);
+
+            transformPoints(xf, points, options);
+            transformNormals(xf, normals, options);
+            for (size_t i = 0; i < count; ++i) {
+                REQUIRE(points[i].near(expectedPoints[i], 1e-4f));
+                REQUIRE(normals[i].near(expectedNormals[i], 1e-5f));
+            }
+        }
+    }
+}
+
+TEST_CASE("Strided batch transforms leave the other fields alone", "[Transform]") {
+    struct Vertex {
+        float position[3];
+        float uv[2];
+        float normal[3];
+    };
+
+    affine3f xf = testTransform();
+    std::vector<vec3> source = randomPoints(100, 3);
+    std::vector<Vertex> vertices(100);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        vertices[i] = { { source[i][0], source[i][1], source[i][2] }, { float(i), -float(i) }, { 0.0f, 0.0f, 1.0f } };
+    }
+
+    // Out of place into a second buffer, then in place
+    std::vector<Vertex> moved(vertices);
+    transformPoints(xf, vertices[0].position, moved[0].position, vertices.size(), sizeof(Vertex));
+    transformVectors(xf, moved[0].normal, moved[0].normal, moved.size(), sizeof(Vertex));
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const float* p = moved[i].position;
+        REQUIRE(vec3(p[0], p[1], p[2]).near(xf.transformPoint(source[i]), 1e-4f));
+        const float* n = moved[i].normal;
+        REQUIRE(vec3(n[0], n[1], n[2]).near(xf.transformVector(vec3(0.0f, 0.0f, 1.0f))));
+        REQUIRE(moved[i].uv[0] == float(i));
+        REQUIRE(moved[i].uv[1] == -float(i));
+        REQUIRE(vertices[i].position[0] == source[i][0]);
+    }
+}
+
+TEST_CASE("ModelOBJ::normalize centers and scales with the batch transform", "[Transform]") {
+    const std::string path = "/tmp/utest_Transform_" + std::to_string(::getpid()) + ".obj";
+    {
+        std::ofstream obj(path);
+        obj << "v 10 20 30\nv 14 20 30\nv 10 26 30\nv 10 20 34\n"
+            << "f 1 2 3\nf 1 2 4\nf 1 3 4\nf 2 3 4\n";
+    }
+
+    ModelOBJ model;
+    REQUIRE(model.import(path.c_str()));
+    std::remove(path.c_str());
+    REQUIRE(model.getNumberOfVertices() > 0);
+
+    model.normalize(2.0f);
+    Real x, y, z;
+    model.getCenter(x, y, z);
+    REQUIRE_THAT(x, Catch::Matchers::WithinAbs(0.0f, 1e-5f));
+    REQUIRE_THAT(y, Catch::Matchers::WithinAbs(0.0f, 1e-5f));
+    REQUIRE_THAT(z, Catch::Matchers::WithinAbs(0.0f, 1e-5f));
+    REQUIRE_THAT(model.getRadius(), Catch::Matchers::WithinRel(2.0f, 1e-5f));
+
+    // The bounding box was 4 x 6 x 4 and keeps its proportions
+    REQUIRE_THAT(model.getWidth() / model.getHeight(), Catch::Matchers::WithinRel(4.0f / 6.0f, 1e-5f));
+}
+
+TEST_CASE("Batch transform throughput", "[.][benchmark][Transform]") {
+    const size_t count = 1 << 20;
+    affine3f xf = testTransform();
+    std::vector<vec3> points = randomPoints(count, 4);
+
+    BENCHMARK("affine3f::transformPoint one at a time") {
+        for (auto& p : points) p = xf.transformPoint(p);
+        return points[count / 2][0];
+    };
+
+    TransformOptions single;
+    single.numThreads = 1;
+    BENCHMARK("transformPoints, one thread") {
+        transformPoints(xf, points, single);
+        return points[count / 2][0];
+    };
+
+    BENCHMARK("transformPoints, all threads") {
+        transformPoints(xf, points);
+        return points[count / 2][0];
+    };
+
+    BENCHMARK("transformNormals, all threads") {
+        transformNormals(xf, points);
+        return points[count / 2][0];
+    };
+}
@@ -0,0 +1,109 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <stdexcept>
+#include "mat.h"
+
+namespace {
+    constexpr float kPi = 3.14159265358979f;
+
+    // Built at compile time
+    constexpr mat3f kShear(1, 2, 0,
+                           0, 1, 0,
+                           0, 0, 1);
+    constexpr affine3f kPlacement = affine3f::translate(vec3(1.0f, 2.0f, 3.0f));
+    constexpr quatf kNoRotation = quatf::identity();
+}
+
+TEST_CASE("Matrix construction and access", "[mat]") {
+    STATIC_REQUIRE(kShear(0, 1) == 2.0f);
+    STATIC_REQUIRE(kShear[1][0] == 2.0f);
+    STATIC_REQUIRE(mat4f::identity()(3, 3) == 1.0f);
+    STATIC_REQUIRE(kPlacement.translation[2] == 3.0f);
+    STATIC_REQUIRE(kNoRotation.w == 1.0f);
+    STATIC_REQUIRE(sizeof(mat4f) == 16 * sizeof(float));
+
+    // Columns are contiguous, as OpenGL expects
+    const float* p = &kShear[0][0];
+    REQUIRE(p[3] == 2.0f);
+
+    REQUIRE(kShear.row(0) == vec3(1.0f, 2.0f, 0.0f));
+    REQUIRE(kShear.transposed()(1, 0) == 2.0f);
+    REQUIRE(mat3f::fromRows({ vec3(1, 2, 0), vec3(0, 1, 0), vec3(0, 0, 1) }) == kShear);
+    REQUIRE(mat3f::fromColumns({ vec3(1, 0, 0), vec3(2, 1, 0), vec3(0, 0, 1) }) == kShear);
+}
+
+TEST_CASE("Matrix arithmetic, determinant and inverse", "[mat]") {
+    mat3f a(2, 0, 1,
+            1, 3, 0,
+            0, 1, 4);
+    REQUIRE(a * vec3(1.0f, 1.0f, 1.0f) == vec3(3.0f, 4.0f, 5.0f));
+    REQUIRE(a * mat3f::identity() == a);
+    REQUIRE((a * 2.0f)(2, 2) == 8.0f);
+    REQUIRE(2.0f * a == a + a);
+    REQUIRE((a - a) == mat3f::zero());
+    REQUIRE_THAT(a.determinant(), Catch::Matchers::WithinAbs(25.0f, 1e-5f));
+    REQUIRE((a * a.inverse()).near(mat3f::identity()));
+    REQUIRE((a.inverse() * a).near(mat3f::identity()));
+
+    mat4d b(4, 3, 2, 1,
+            0, 1, 7, 2,
+            3, 0, 1, 5,
+            1, 2, 0, 6);
+    REQUIRE((b * b.inverse()).near(mat4d::identity(), 1e-12));
+    REQUIRE_THAT(b.determinant(), Catch::Matchers::WithinAbs((b.transposed()).determinant(), 1e-9));
+    REQUIRE_THAT((b * b).determinant(), Catch::Matchers::WithinRel(b.determinant() * b.determinant(), 1e-12));
+
+    mat3f singular(1, 2, 3,
+                   2, 4, 6,
+                   0, 1, 1);
+    REQUIRE(singular.determinant() == 0.0f);
+    REQUIRE_THROWS_AS(singular.inverse(), std::runtime_error);
+}
+
+TEST_CASE("Quaternion rotations", "[mat]") {
+    quatf q = quatf::fromAxisAngle(vec3(0.0f, 0.0f, 2.0f), kPi / 2.0f);
+    REQUIRE_THAT(q.length(), Catch::Matchers::WithinAbs(1.0f, 1e-6f));
+    REQUIRE(q.rotate(vec3(1.0f, 0.0f, 0.0f)).near(vec3(0.0f, 1.0f, 0.0f)));
+    REQUIRE((q.toMat3() * vec3(1.0f, 2.0f, 3.0f)).near(q.rotate(vec3(1.0f, 2.0f, 3.0f))));
+    REQUIRE((q * q.conjugate()).near(quatf::identity()));
+
+    // (a * b) rotates by b first
+    quatf r = quatf::fromAxisAngle(vec3(1.0f, 0.0f, 0.0f), kPi / 2.0f);
+    vec3 v(0.3f, -1.2f, 2.0f);
+    REQUIRE((q * r).rotate(v).near(q.rotate(r.rotate(v))));
+    REQUIRE(((q * r).toMat3()).near(q.toMat3() * r.toMat3()));
+
+    REQUIRE(slerp(quatf::identity(), q, 0.0f).near(quatf::identity()));
+    REQUIRE(slerp(quatf::identity(), q, 1.0f).near(q));
+    quatf half = slerp(quatf::identity(), q, 0.5f);
+    REQUIRE(half.near(quatf::fromAxisAngle(vec3(0.0f, 0.0f, 1.0f), kPi / 4.0f)));
+
+    // The negated quaternion is the same rotation; slerp takes the short way
+    quatf negated(-q.w, -q.x, -q.y, -q.z);
+    REQUIRE(slerp(quatf::identity(), negated, 0.5f).rotate(v).near(half.rotate(v)));
+}
+
+TEST_CASE("Affine transforms", "[mat]") {
+    affine3f xf = affine3f::translate(vec3(1.0f, 2.0f, 3.0f)) * affine3f::rotate(vec3(0.0f, 0.0f, 1.0f), kPi / 2.0f)
+                  * affine3f::scale(vec3(2.0f, 1.0f, 1.0f));
+    REQUIRE(xf.transformPoint(vec3(1.0f, 0.0f, 0.0f)).near(vec3(1.0f, 4.0f, 3.0f)));
+    REQUIRE(xf.transformVector(vec3(1.0f, 0.0f, 0.0f)).near(vec3(0.0f, 2.0f, 0.0f)));
+    REQUIRE((xf * xf.inverse()).near(affine3f::identity()));
+    REQUIRE(xf.inverse().transformPoint(xf.transformPoint(vec3(0.5f, -1.0f, 4.0f))).near(vec3(0.5f, -1.0f, 4.0f)));
+
+    vec4f h = vec4f(0.0f, 0.0f, 0.0f, 0.0f);
+    mat4f m = xf.toMat4();
+    vec3 p(0.5f, -1.0f, 4.0f);
+    for (size_t r = 0; r < 4; ++r) h[r] = m.row(r).dot(vec4f(p[0], p[1], p[2], 1.0f));
+    REQUIRE(vec3(h[0], h[1], h[2]).near(xf.transformPoint(p)));
+    REQUIRE(h[3] == 1.0f);
+
+    // A normal stays perpendicular to the surface under non-uniform scale
+    affine3f squash = affine3f::scale(vec3(4.0f, 1.0f, 1.0f));
+    vec3 tangent = vec3(1.0f, -1.0f, 0.0f);
+    vec3 normal = vec3(1.0f, 1.0f, 0.0f).normalized();
+    vec3 n = squash.transformNormal(normal);
+    REQUIRE_THAT(n.dot(squash.transformVector(tangent)), Catch::Matchers::WithinAbs(0.0f, 1e-6f));
+    REQUIRE_THAT(n.length(), Catch::Matchers::WithinAbs(1.0f, 1e-6f));
+}
@@ -1,5 +1,8 @@
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <random>
+#include <vector>
 #include "vec.h"
 
 TEST_CASE("vec3 basic operations", "[vec3]") {
@@ -75,4 +78,119 @@ TEST_CASE("vec3 basic operations", "[vec3]") {
         REQUIRE_THAT(unit[1], Catch::Matchers::WithinRel(0.8f, 0.001f));  // 4/5
         REQUIRE_THAT(unit[2], Catch::Matchers::WithinRel(0.0f, 0.001f));
     }
-}
\ No newline at end of file
+}
+TEST_CASE("vec4f operations", "[vec4]") {
+    vec4f v1(1.0f, 2.0f, 3.0f, 4.0f);
+    vec4f v2(5.0f, 6.0f, 7.0f, 8.0f);
+    REQUIRE(alignof(vec4f) == 16);
+
+    REQUIRE(v1 + v2 == vec4f(6.0f, 8.0f, 10.0f, 12.0f));
+    REQUIRE(v2 - v1 == vec4f(4.0f, 4.0f, 4.0f, 4.0f));
+    REQUIRE(v1 * 2.0f == vec4f(2.0f, 4.0f, 6.0f, 8.0f));
+    REQUIRE(2.0f * v1 == v1 * 2.0f);
+    REQUIRE(v2 / 2.0f == vec4f(2.5f, 3.0f, 3.5f, 4.0f));
+    REQUIRE(v1.dot(v2) == 70.0f);
+    REQUIRE(vec4f(0.0f, 3.0f, 0.0f, 4.0f).length() == 5.0f);
+
+    vec4f v = v1;
+    v += v2;
+    v -= v1;
+    v *= 3.0f;
+    v /= 3.0f;
+    REQUIRE(v == v2);
+
+    // The cross product uses xyz and leaves w zero
+    REQUIRE(vec4f(1.0f, 0.0f, 0.0f, 0.0f).cross(vec4f(0.0f, 1.0f, 0.0f, 0.0f)) == vec4f(0.0f, 0.0f, 1.0f, 0.0f));
+    REQUIRE(vec4f(0.0f, 0.0f, 0.0f, 0.0f).normalized() == vec4f(0.0f, 0.0f, 0.0f, 0.0f));
+}
+
+TEST_CASE("SIMD kernels match the scalar fallback", "[vec3][vec4]") {
+    using Scalar3 = vec_detail::scalar_ops<float, 3>;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+    for (int i = 0; i < 1000; ++i) {
+        vec3 a(value(rng), value(rng), value(rng));
+        vec3 b(value(rng), value(rng), value(rng));
+        float s = value(rng);
+        vec3 expected;
+
+        // Single operations per lane, so the results are identical
+        Scalar3::add(a.data.data(), b.data.data(), expected.data.data());
+        REQUIRE(a + b == expected);
+        Scalar3::sub(a.data.data(), b.data.data(), expected.data.data());
+        REQUIRE(a - b == expected);
+        Scalar3::mul(a.data.data(), s, expected.data.data());
+        REQUIRE(a * s == expected);
+        Scalar3::div(a.data.data(), s, expected.data.data());
+        REQUIRE(a / s == expected);
+
+        // The compiler may contract the scalar products and sums into
+        // FMAs (it does under ENABLE_NATIVE_ARCH), so these are only close
+        Scalar3::cross(a.data.data(), b.data.data(), expected.data.data());
+        REQUIRE(a.cross(b).near(expected, 1e-4f));
+        REQUIRE_THAT(a.dot(b), Catch::Matchers::WithinAbs(Scalar3::dot(a.data.data(), b.data.data()), 1e-4f));
+
+        vec4f c(a[0], a[1], a[2], value(rng));
+        vec4f d(b[0], b[1], b[2], value(rng));
+        float dot4 = vec_detail::scalar_ops<float, 4>::dot(c.data.data(), d.data.data());
+        REQUIRE_THAT(c.dot(d), Catch::Matchers::WithinAbs(dot4, 1e-4f));
+        REQUIRE_THAT(c.normalized().length(), Catch::Matchers::WithinRel(1.0f, 1e-5f));
+    }
+}
+
+namespace {
+    // A shading-style inner loop: normalize, dot, scale and accumulate
+    template <typename V, typename Ops>
+    float shade(const std::vector<V>& normals, const std::vector<V>& lights) {
+        V sum{};
+        for (size_t i = 0; i < normals.size(); ++i) {
+            V n, l, r;
+            float inv = 1.0f / std::sqrt(Ops::dot(normals[i].data.data(), normals[i].data.data()));
+            Ops::mul(normals[i].data.data(), inv, n.data.data());
+            float cosine = Ops::dot(n.data.data(), lights[i].data.data());
+            Ops::mul(lights[i].data.data(), cosine > 0.0f ? cosine : 0.0f, l.data.data());
+            Ops::cross(n.data.data(), l.data.data(), r.data.data());
+            Ops::add(sum.data.data(), r.data.data(), sum.data.data());
+            Ops::add(sum.data.data(), l.data.data(), sum.data.data());
+        }
+        return sum[0] + sum[1] + sum[2];
+    }
+
+    template <typename V>
+    std::vector<V> randomVectors(size_t count, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+        std::vector<V> v(count);
+        for (auto& x : v) {
+            for (size_t k = 0; k < 3; ++k) x[k] = value(rng);
+        }
+        return v;
+    }
+}
+
+TEST_CASE("vec SIMD throughput", "[.][benchmark][vec3][vec4]") {
+    const size_t count = 1 << 16;
+    auto n3 = randomVectors<vec3>(count, 1), l3 = randomVectors<vec3>(count, 2);
+    auto n4 = randomVectors<vec4f>(count, 1), l4 = randomVectors<vec4f>(count, 2);
+
+    BENCHMARK("vec3 shading loop, scalar") { return shade<vec3, vec_detail::scalar_ops<float, 3>>(n3, l3); };
+    BENCHMARK("vec3 shading loop, vec_detail::ops") { return shade<vec3, vec_detail::ops<float, 3>>(n3, l3); };
+    BENCHMARK("vec4f shading loop, scalar") { return shade<vec4f, vec_detail::scalar_ops<float, 4>>(n4, l4); };
+    BENCHMARK("vec4f shading loop, vec_detail::ops") { return shade<vec4f, vec_detail::ops<float, 4>>(n4, l4); };
+    BENCHMARK("vec3 operators") {
+        vec3 sum(0.0f, 0.0f, 0.0f);
+        for (size_t i = 0; i < count; ++i) {
+            vec3 n = n3[i].normalized();
+            sum += n.cross(l3[i]) + l3[i] * std::max(n.dot(l3[i]), 0.0f);
+        }
+        return sum[0];
+    };
+    BENCHMARK("vec4f operators") {
+        vec4f sum(0.0f, 0.0f, 0.0f, 0.0f);
+        for (size_t i = 0; i < count; ++i) {
+            vec4f n = n4[i].normalized();
+            sum += n.cross(l4[i]) + l4[i] * std::max(n.dot(l4[i]), 0.0f);
+        }
+        return sum[0];
+    };
+}
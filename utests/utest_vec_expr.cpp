@@ -0,0 +1,104 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <random>
+#include <vector>
+#include "vec_expr.h"
+
+TEST_CASE("Lazy expressions give the same results as the vec operators", "[vec_expr]") {
+    vec3 a(1.0f, 2.0f, 3.0f);
+    vec3 b(4.0f, 5.0f, 6.0f);
+    vec3 c(-1.5f, 0.25f, 8.0f);
+    float t = 0.3f;
+
+    vec3 lerp = lazy(a) * (1.0f - t) + lazy(b) * t;
+    REQUIRE(lerp == a * (1.0f - t) + b * t);
+
+    // vec operands mix with expressions on either side
+    vec3 mixed = a + lazy(b) * 2.0f - c / 4.0f;
+    REQUIRE(mixed == a + b * 2.0f - c / 4.0f);
+    REQUIRE(vec3(c - 0.5f * lazy(a)) == c - 0.5f * a);
+    REQUIRE(vec3(-(lazy(a) - b)) == b - a);
+
+    // Assignment, eval and assign all evaluate in place
+    vec3 r;
+    r = (lazy(a) + b + c) / 3.0f;
+    REQUIRE(r == (a + b + c) / 3.0f);
+    REQUIRE(vec_expr::eval(lazy(a) + b) == a + b);
+    vec_expr::assign(r, lazy(c) * 2.0f);
+    REQUIRE(r == c * 2.0f);
+
+    // The destination may be one of the operands
+    r = a;
+    r = lazy(r) * 2.0f + r;
+    REQUIRE(r == vec3(3.0f, 6.0f, 9.0f));
+
+    vec2d d(1.0, 2.0);
+    REQUIRE(vec2d(lazy(d) * 3.0 + d) == vec2d(4.0, 8.0));
+
+    // Without lazy() the operators are the eager ones
+    STATIC_REQUIRE(std::is_same_v<decltype(a + b), vec3>);
+    STATIC_REQUIRE(vec_expr::is_expr<std::decay_t<decltype(lazy(a) + b)>>);
+}
+
+namespace {
+    struct Surface {
+        vec3 ambient, diffuse, specular, emission, normal;
+    };
+
+    std::vector<Surface> randomSurfaces(size_t count) {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> value(0.0f, 1.0f);
+        auto random = [&] { return vec3(value(rng), value(rng), value(rng)); };
+        std::vector<Surface> surfaces(count);
+        for (auto& s : surfaces) s = { random(), random(), random(), random(), random() };
+        return surfaces;
+    }
+}
+
+TEST_CASE("Expression template throughput", "[.][benchmark][vec_expr]") {
+    const size_t count = 1 << 16;
+    std::vector<Surface> surfaces = randomSurfaces(count);
+    std::vector<vec3> out(count);
+    const vec3 light(0.9f, 0.8f, 0.7f), fog(0.5f, 0.6f, 0.7f);
+    const float ka = 0.1f, kd = 0.7f, ks = 0.2f, haze = 0.15f;
+
+    // A shading-sized expression: eight operators, each one a temporary
+    // with the eager vec operators
+    BENCHMARK("Eager shading expression") {
+        for (size_t i = 0; i < count; ++i) {
+            const Surface& s = surfaces[i];
+            float ndotl = s.normal[1];
+            out[i] = (s.ambient * ka + s.diffuse * (kd * ndotl) + s.specular * ks + s.emission - light * 0.05f) * (1.0f - haze)
+                     + fog * haze;
+        }
+        return out[count / 2][0];
+    };
+
+    BENCHMARK("Lazy shading expression") {
+        for (size_t i = 0; i < count; ++i) {
+            const Surface& s = surfaces[i];
+            float ndotl = s.normal[1];
+            out[i] = (lazy(s.ambient) * ka + lazy(s.diffuse) * (kd * ndotl) + s.specular * ks + s.emission - light * 0.05f)
+                         * (1.0f - haze)
+                     + fog * haze;
+        }
+        return out[count / 2][0];
+    };
+
+    const vec3 startColor(1.0f, 0.0f, 0.0f), endColor(0.0f, 0.0f, 1.0f);
+    BENCHMARK("Eager gradient lerp") {
+        for (size_t i = 0; i < count; ++i) {
+            float t = i / float(count);
+            out[i] = startColor * (1.0f - t) + endColor * t;
+        }
+        return out[count / 2][0];
+    };
+
+    BENCHMARK("Lazy gradient lerp") {
+        for (size_t i = 0; i < count; ++i) {
+            float t = i / float(count);
+            out[i] = lazy(startColor) * (1.0f - t) + lazy(endColor) * t;
+        }
+        return out[count / 2][0];
+    };
+}
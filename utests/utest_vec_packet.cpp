@@ -0,0 +1,211 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "vec_packet.h"
+
+namespace {
+    template <typename V>
+    std::vector<V> randomVectors(size_t count, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> value(-4.0f, 4.0f);
+        std::vector<V> v(count);
+        for (auto& x : v) {
+            for (size_t c = 0; c < x.data.size(); ++c) x[c] = value(rng);
+        }
+        return v;
+    }
+}
+
+TEST_CASE("Packet masks", "[vec_packet]") {
+    using mask8 = packet_mask<8>;
+    REQUIRE(mask8::allLanes().bits == 0xff);
+    REQUIRE(mask8::allLanes().all());
+    REQUIRE(mask8().none());
+    REQUIRE(mask8::first(3).bits == 0x07);
+    REQUIRE(mask8::first(20).all());
+    REQUIRE((~mask8(0x0f)).bits == 0xf0);
+    REQUIRE((mask8(0x0f) | mask8(0x30)).count() == 6);
+    REQUIRE((mask8(0x0f) & mask8(0x3c)) == mask8(0x0c));
+
+    mask8 m;
+    m.set(5, true);
+    REQUIRE(m[5]);
+    REQUIRE(m.any());
+    m.set(5, false);
+    REQUIRE(m.none());
+    REQUIRE(packet_mask<32>::allLanes().bits == ~0u);
+}
+
+TEMPLATE_TEST_CASE("Packets agree with vec lane by lane", "[vec_packet]",
+                   vec3x4, vec3x8, vec3x16, (vec_packet<double, 3, 2>), (vec_packet<double, 3, 4>),
+                   (vec_packet<double, 3, 8>), (vec_packet<float, 3, 3>)) {
+    using P = TestType;
+    using V = typename P::value_type;
+    using T = std::decay_t<decltype(std::declval<V>()[0])>;
+    constexpr size_t W = P::width;
+    REQUIRE(alignof(typename P::lane_type) == packet_detail::alignment<T, W>());
+
+    auto as = randomVectors<V>(W * 8, 1), bs = randomVectors<V>(W * 8, 2);
+    for (size_t base = 0; base < as.size(); base += W) {
+        P a = P::load(&as[base]);
+        P b = P::load(&bs[base]);
+        P sum = a + b, diff = a - b, scaled = a * T(2.5), halved = a / T(2), cross = a.cross(b), unit = a.normalized();
+        auto dot = a.dot(b), len = a.length();
+        for (size_t i = 0; i < W; ++i) {
+            const V& x = as[base + i];
+            const V& y = bs[base + i];
+            REQUIRE(a.lane(i) == x);
+            REQUIRE(sum.lane(i) == x + y);
+            REQUIRE(diff.lane(i) == x - y);
+            REQUIRE(scaled.lane(i) == x * T(2.5));
+            REQUIRE(halved.lane(i).near(x / T(2)));
+            REQUIRE(cross.lane(i).near(x.cross(y), T(1e-4)));
+            REQUIRE_THAT(dot[i], Catch::Matchers::WithinAbs(x.dot(y), 1e-4));
+            REQUIRE_THAT(len[i], Catch::Matchers::WithinRel(x.length(), T(1e-6)));
+            REQUIRE(unit.lane(i).near(x.normalized()));
+        }
+    }
+
+    // Zero-length lanes normalize to zero rather than NaN
+    P z(V(T(3), T(0), T(4)));
+    z.setLane(1, V(T(0), T(0), T(0)));
+    P n = z.normalized();
+    REQUIRE(n.lane(0).near(V(T(0.6), T(0), T(0.8))));
+    REQUIRE(n.lane(1) == V(T(0), T(0), T(0)));
+}
+
+TEMPLATE_TEST_CASE("Packet compare, select and reductions", "[vec_packet]", floatx4, floatx8, floatx16, doublex2, doublex4,
+                   doublex8) {
+    using P = TestType;
+    using T = decltype(std::declval<P>()[0]);
+    constexpr size_t W = P::width;
+
+    // Lanes 0, 1, 2, ...
+    P ramp(T(0));
+    for (size_t i = 0; i < W; ++i) ramp.set(i, T(i));
+    REQUIRE(ramp.horizontalSum() == T(W * (W - 1) / 2));
+    REQUIRE(ramp.horizontalMin() == T(0));
+    REQUIRE(ramp.horizontalMax() == T(W - 1));
+
+    auto below = ramp < T(2);
+    REQUIRE(below == packet_mask<W>::first(2));
+    REQUIRE((ramp >= T(2)) == ~below);
+    REQUIRE((ramp <= T(2)).count() == int(std::min<size_t>(W, 3)));
+    REQUIRE((ramp > T(W)).none());
+    REQUIRE((ramp == T(1)).bits == 0x2);
+    REQUIRE((ramp != T(1)).count() == int(W - 1));
+
+    P chosen = select(below, P(T(-1)), ramp);
+    for (size_t i = 0; i < W; ++i) REQUIRE(chosen[i] == (i < 2 ? T(-1) : T(i)));
+
+    P clamped = min(max(ramp, P(T(1))), P(T(3)));
+    REQUIRE(clamped[0] == T(1));
+    REQUIRE(clamped[W - 1] == std::clamp(T(W - 1), T(1), T(3)));
+    REQUIRE(sqrt(P(T(16)))[W - 1] == T(4));
+    REQUIRE((-ramp)[1] == T(-1));
+    REQUIRE((T(2) * ramp + ramp / T(2))[1] == T(2.5));
+}
+
+TEMPLATE_TEST_CASE("Gather, scatter and partial loads", "[vec_packet]", vec3x4, vec3x8, vec3x16) {
+    using P = TestType;
+    constexpr size_t W = P::width;
+    using mask = typename P::mask;
+    auto src = randomVectors<vec3>(64, 3);
+
+    // Every third vector, backwards
+    uint32_t indices[W];
+    for (size_t i = 0; i < W; ++i) indices[i] = uint32_t(3 * (W - 1 - i));
+    P g = P::gather(src.data(), indices);
+    for (size_t i = 0; i < W; ++i) REQUIRE(g.lane(i) == src[indices[i]]);
+
+    std::vector<vec3> dst(64, vec3(0.0f, 0.0f, 0.0f));
+    mask even;
+    for (size_t i = 0; i < W; i += 2) even.set(i, true);
+    g.scatter(dst.data(), indices, even);
+    for (size_t i = 0; i < W; ++i) {
+        REQUIRE(dst[indices[i]] == (i % 2 == 0 ? src[indices[i]] : vec3(0.0f, 0.0f, 0.0f)));
+    }
+
+    // A partial packet at the end of an array reads and writes only what
+    // is there
+    P tail = P::load(&src[64 - 3], 3);
+    REQUIRE(tail.lane(2) == src[63]);
+    REQUIRE(tail.lane(W - 1) == vec3(0.0f, 0.0f, 0.0f));
+    std::vector<vec3> out(3);
+    tail.store(out.data(), 3);
+    REQUIRE(out[2] == src[63]);
+
+    P both = P::load(src.data());
+    REQUIRE((both == both).all());
+    P moved = both;
+    moved.setLane(1, vec3(100.0f, 0.0f, 0.0f));
+    REQUIRE((both != moved) == mask(0x2));
+    REQUIRE((both.near(moved)).count() == int(W - 1));
+
+    vec3 total(0.0f, 0.0f, 0.0f);
+    for (size_t i = 0; i < W; ++i) total += src[i];
+    REQUIRE(both.horizontalSum().near(total, 1e-3f));
+    REQUIRE(select(mask(0x1), moved, both).lane(1) == src[1]);
+}
+
+namespace {
+    // Lambert-style shading of one normal against one light direction
+    template <typename V, typename S>
+    V shade(const V& normal, const V& light, const V& albedo) {
+        using std::max;
+        V n = normal.normalized();
+        S cosine = max(n.dot(light), S(0.0f));
+        return albedo * cosine + n.cross(light) * 0.1f;
+    }
+}
+
+TEST_CASE("Packet throughput", "[.][benchmark][vec_packet]") {
+    const size_t count = 1 << 16;
+    auto normals = randomVectors<vec3>(count, 4), lights = randomVectors<vec3>(count, 5), albedo = randomVectors<vec3>(count, 6);
+    std::vector<vec3> out(count);
+
+    BENCHMARK("vec3 one at a time") {
+        for (size_t i = 0; i < count; ++i) out[i] = shade<vec3, float>(normals[i], lights[i], albedo[i]);
+        return out[count / 2][0];
+    };
+
+    // Converting from and to arrays of vec3 is part of the cost
+    auto packets = [&](auto tag) {
+        using P = decltype(tag);
+        constexpr size_t W = P::width;
+        for (size_t i = 0; i < count; i += W) {
+            P r = shade<P, typename P::lane_type>(P::load(&normals[i]), P::load(&lights[i]), P::load(&albedo[i]));
+            r.store(&out[i]);
+        }
+        return out[count / 2][0];
+    };
+    BENCHMARK("vec3x4 from vec3 arrays") { return packets(vec3x4()); };
+    BENCHMARK("vec3x8 from vec3 arrays") { return packets(vec3x8()); };
+    BENCHMARK("vec3x16 from vec3 arrays") { return packets(vec3x16()); };
+
+    // Kept in structure-of-arrays form throughout
+    auto soa = [&](auto tag) {
+        using P = decltype(tag);
+        constexpr size_t W = P::width;
+        std::vector<P> n(count / W), l(count / W), a(count / W), r(count / W);
+        for (size_t i = 0; i < count / W; ++i) {
+            n[i] = P::load(&normals[i * W]);
+            l[i] = P::load(&lights[i * W]);
+            a[i] = P::load(&albedo[i * W]);
+        }
+        return [=]() mutable {
+            for (size_t i = 0; i < n.size(); ++i) r[i] = shade<P, typename P::lane_type>(n[i], l[i], a[i]);
+            return r[n.size() / 2][0][0];
+        };
+    };
+    auto soa4 = soa(vec3x4());
+    auto soa8 = soa(vec3x8());
+    auto soa16 = soa(vec3x16());
+    BENCHMARK("vec3x4 structure of arrays") { return soa4(); };
+    BENCHMARK("vec3x8 structure of arrays") { return soa8(); };
+    BENCHMARK("vec3x16 structure of arrays") { return soa16(); };
+}